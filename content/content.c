@@ -68,9 +68,11 @@ static void content_convert(struct content *c)
 {
 	assert(c);
 	assert(c->status == CONTENT_STATUS_LOADING ||
-	       c->status == CONTENT_STATUS_ERROR);
+	       c->status == CONTENT_STATUS_ERROR ||
+	       (c->status == CONTENT_STATUS_READY && c->progressive));
 
-	if (c->status != CONTENT_STATUS_LOADING)
+	if (c->status != CONTENT_STATUS_LOADING &&
+	    c->status != CONTENT_STATUS_READY)
 		return;
 
 	if (c->locked == true)
@@ -80,7 +82,9 @@ static void content_convert(struct content *c)
 	      nsurl_access_log(llcache_handle_get_url(c->llcache)), c);
 
 	if (c->handler->data_complete != NULL) {
-		c->locked = true;
+		/* A progressive content remains displayable, and so
+		 * unlocked, while its final conversion takes place */
+		c->locked = !c->progressive;
 		if (c->handler->data_complete(c) == false) {
 			content_set_error(c);
 		}
@@ -234,6 +238,7 @@ content__init(struct content *c,
 	c->user_list = user_sentinel;
 	c->sub_status[0] = 0;
 	c->locked = false;
+	c->progressive = false;
 	c->total_size = 0;
 	c->http_code = 0;
 
@@ -284,6 +289,19 @@ void content_set_status(struct content *c, const char *status_message)
 /* exported interface documented in content/protected.h */
 void content_set_ready(struct content *c)
 {
+	if (c->progressive) {
+		/* Users already have the content; the conversion is now
+		 * complete so it just needs reformatting for them. */
+		assert(c->status == CONTENT_STATUS_READY);
+		assert(c->locked == false);
+		c->progressive = false;
+
+		content_update_status(c);
+		content__reformat(c, false,
+				  c->available_width, c->available_height);
+		return;
+	}
+
 	/* The content must be locked at this point, as it can only
 	 * become READY after conversion. */
 	assert(c->locked);
@@ -295,6 +313,20 @@ void content_set_ready(struct content *c)
 }
 
 
+/* exported interface documented in content/protected.h */
+void content_set_ready_progressive(struct content *c)
+{
+	assert(c->status == CONTENT_STATUS_LOADING);
+	assert(c->locked == false);
+
+	c->progressive = true;
+
+	c->status = CONTENT_STATUS_READY;
+	content_update_status(c);
+	content_broadcast(c, CONTENT_MSG_READY, NULL);
+}
+
+
 /* exported interface documented in content/protected.h */
 void content_set_done(struct content *c)
 {
@@ -313,6 +345,7 @@ void content_set_done(struct content *c)
 void content_set_error(struct content *c)
 {
 	c->locked = false;
+	c->progressive = false;
 	c->status = CONTENT_STATUS_ERROR;
 }
 
@@ -1437,6 +1470,7 @@ nserror content__clone(const struct content *c, struct content *nc)
 	memcpy(&(nc->sub_status), &(c->sub_status), 80);
 
 	nc->locked = c->locked;
+	nc->progressive = c->progressive;
 	nc->total_size = c->total_size;
 	nc->http_code = c->http_code;
 
@@ -275,6 +275,11 @@ struct content {
 	 * inconsistent and content must not be redrawn or modified.
 	 */
 	bool locked;
+	/**
+	 * Content was made READY before all its source data arrived
+	 * and has not yet completed its final conversion.
+	 */
+	bool progressive;
 
 	/**
 	 * Total data size, 0 if unknown.
@@ -326,9 +331,22 @@ nserror content__clone(const struct content *c, struct content *nc);
 
 /**
  * Put a content in status CONTENT_STATUS_READY and unlock the content.
+ *
+ * If the content was previously made ready progressively, users are
+ * instead informed that the content has been reformatted.
  */
 void content_set_ready(struct content *c);
 
+/**
+ * Put a content in status CONTENT_STATUS_READY while its source data
+ * is still being received.
+ *
+ * The content may be displayed while it continues to load. Its final
+ * conversion is started as usual once all the data has arrived and
+ * must be completed with content_set_ready().
+ */
+void content_set_ready_progressive(struct content *c);
+
 /**
  * Put a content in status CONTENT_STATUS_DONE.
  */
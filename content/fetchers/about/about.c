@@ -52,6 +52,7 @@
 #include "chart.h"
 #include "choices.h"
 #include "imagecache.h"
+#include "memory.h"
 #include "nscolours.h"
 #include "query.h"
 #include "query_auth.h"
@@ -426,6 +427,14 @@ struct about_handlers about_handler_list[] = {
 		fetch_about_imagecache_handler,
 		true
 	},
+	{
+		/* how much style data is being shared */
+		"memory",
+		SLEN("memory"),
+		NULL,
+		fetch_about_memory_handler,
+		true
+	},
 	{
 		/* The default blank page */
 		"blank",
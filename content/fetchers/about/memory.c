@@ -0,0 +1,101 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf.
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * content generator for the about scheme memory page
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "netsurf/types.h"
+#include "netsurf/inttypes.h"
+#include "utils/errors.h"
+
+#include "css/select.h"
+#include "html/css.h"
+
+#include "private.h"
+#include "memory.h"
+
+/* exported interface documented in about/memory.h */
+bool fetch_about_memory_handler(struct fetch_about_context *ctx)
+{
+	struct nscss_select_stats select_stats;
+	struct html_css_select_stats context_stats;
+	nserror res;
+
+	nscss_get_select_stats(&select_stats);
+	html_css_get_select_stats(&context_stats);
+
+	/* content is going to return ok */
+	fetch_about_set_http_code(ctx, 200);
+
+	/* content type */
+	if (fetch_about_send_header(ctx, "Content-Type: text/html"))
+		goto fetch_about_memory_handler_aborted;
+
+	res = fetch_about_ssenddataf(ctx,
+		"<html>\n<head>\n"
+		"<title>Memory Usage</title>\n"
+		"<link rel=\"stylesheet\" type=\"text/css\" "
+		"href=\"resource:internal.css\">\n"
+		"</head>\n"
+		"<body class=\"ns-even-bg ns-even-fg ns-border\">\n"
+		"<h1 class=\"ns-border\">Memory Usage</h1>\n");
+	if (res != NSERROR_OK) {
+		goto fetch_about_memory_handler_aborted;
+	}
+
+	/* Computed styles are interned by libcss, so equal styles are
+	 * already a single allocation; what NetSurf saves on top is
+	 * the per-element selection results */
+	res = fetch_about_ssenddataf(ctx,
+		"<h2 class=\"ns-border\">Computed styles</h2>\n"
+		"<p>Elements selected for: %u</p>\n"
+		"<p>Selection results shared with a sibling: %u "
+		"(%"PRIsizet" bytes not allocated)</p>\n",
+		select_stats.selections,
+		select_stats.shared,
+		select_stats.shared * sizeof(css_select_results));
+	if (res != NSERROR_OK) {
+		goto fetch_about_memory_handler_aborted;
+	}
+
+	res = fetch_about_ssenddataf(ctx,
+		"<h2 class=\"ns-border\">Selection contexts</h2>\n"
+		"<p>Contexts built: %u</p>\n"
+		"<p>Contexts shared with another document: %u</p>\n"
+		"<p>Contexts in use: %u (by %u documents)</p>\n"
+		"</body>\n</html>\n",
+		context_stats.created,
+		context_stats.reused,
+		context_stats.live,
+		context_stats.users);
+	if (res != NSERROR_OK) {
+		goto fetch_about_memory_handler_aborted;
+	}
+
+	fetch_about_send_finished(ctx);
+
+	return true;
+
+fetch_about_memory_handler_aborted:
+	return false;
+}
@@ -17,10 +17,12 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
 #include "utils/nsoption.h"
+#include "utils/ascii.h"
 #include "utils/corestrings.h"
 #include "utils/log.h"
 #include "utils/nsurl.h"
@@ -239,9 +241,485 @@ static void nscss_dom_user_data_handler(dom_node_operation operation,
 	}
 }
 
+/**
+ * Interned id of an element, stored as libdom node user data
+ */
+struct nscss_node_id {
+	lwc_string *id; /**< Interned id, or NULL if the element has none */
+};
+
+/**
+ * Destroy a cached node id
+ *
+ * \param node_id  Cached id to destroy
+ */
+static void nscss_node_id_destroy(struct nscss_node_id *node_id)
+{
+	if (node_id->id != NULL)
+		lwc_string_unref(node_id->id);
+
+	free(node_id);
+}
+
+/* Handler for cached node ids, stored as libdom node user data */
+static void nscss_node_id_user_data_handler(dom_node_operation operation,
+		dom_string *key, void *data, struct dom_node *src,
+		struct dom_node *dst)
+{
+	if (dom_string_isequal(corestring_dom___ns_key_node_id_data,
+			key) == false || data == NULL) {
+		return;
+	}
+
+	switch (operation) {
+	case DOM_NODE_CLONED:
+		/* The clone looks its id up when first selected for */
+	case DOM_NODE_RENAMED:
+		break;
+
+	case DOM_NODE_IMPORTED:
+	case DOM_NODE_ADOPTED:
+	case DOM_NODE_DELETED:
+		nscss_node_id_destroy(data);
+		break;
+
+	default:
+		NSLOG(netsurf, INFO, "User data operation not handled.");
+		assert(0);
+	}
+}
+
+/**
+ * Get the interned id of an element, looking it up on first use
+ *
+ * \param n   Element to get id of
+ * \param id  Updated to the element's id, or NULL if it has none;
+ *            not referenced
+ * \return CSS_OK on success, CSS_NOMEM on memory exhaustion
+ */
+static css_error nscss_node_get_id(dom_node *n, lwc_string **id)
+{
+	struct nscss_node_id *node_id = NULL;
+	void *old_node_id;
+	dom_string *attr;
+	dom_exception err;
+
+	err = dom_node_get_user_data(n, corestring_dom___ns_key_node_id_data,
+			(void *) &node_id);
+	if (err == DOM_NO_ERR && node_id != NULL) {
+		*id = node_id->id;
+		return CSS_OK;
+	}
+
+	/** \todo Assumes an HTML DOM */
+	err = dom_html_element_get_id(n, &attr);
+	if (err != DOM_NO_ERR)
+		return CSS_NOMEM;
+
+	node_id = malloc(sizeof(*node_id));
+	if (node_id == NULL) {
+		if (attr != NULL)
+			dom_string_unref(attr);
+		return CSS_NOMEM;
+	}
+	node_id->id = NULL;
+
+	if (attr != NULL) {
+		err = dom_string_intern(attr, &node_id->id);
+		dom_string_unref(attr);
+		if (err != DOM_NO_ERR) {
+			free(node_id);
+			return CSS_NOMEM;
+		}
+	}
+
+	err = dom_node_set_user_data(n, corestring_dom___ns_key_node_id_data,
+			node_id, nscss_node_id_user_data_handler,
+			(void *) &old_node_id);
+	if (err != DOM_NO_ERR) {
+		nscss_node_id_destroy(node_id);
+		return CSS_NOMEM;
+	}
+
+	*id = node_id->id;
+
+	return CSS_OK;
+}
+
+/**
+ * Discard an element's cached id
+ *
+ * Must be called whenever the element's attributes change.
+ *
+ * \param n  Element whose attributes changed
+ */
+void nscss_node_attributes_changed(dom_node *n)
+{
+	void *node_id = NULL;
+	dom_exception err;
+
+	err = dom_node_set_user_data(n, corestring_dom___ns_key_node_id_data,
+			NULL, NULL, &node_id);
+	if (err == DOM_NO_ERR && node_id != NULL)
+		nscss_node_id_destroy(node_id);
+}
+
+/** Style selection statistics */
+static struct nscss_select_stats nscss_select_stats;
+
+/**
+ * Get style selection statistics
+ *
+ * \param stats  Updated with the statistics since startup
+ */
+void nscss_get_select_stats(struct nscss_select_stats *stats)
+{
+	*stats = nscss_select_stats;
+}
+
+/** Number of entries in a style sharing cache */
+#define NSCSS_STYLE_CACHE_SIZE 16
+
+/**
+ * Styles selected for an element, kept so that its siblings may share them
+ */
+struct nscss_style_cache_entry {
+	/** Parent of the element; used only for comparison */
+	dom_node *parent;
+	/** Style the element's computed styles were composed with */
+	const css_computed_style *parent_style;
+	/** Partial styles returned by libcss, one reference each */
+	css_computed_style *partial[CSS_PSEUDO_ELEMENT_COUNT];
+	/** Complete results, owned by the element's box */
+	css_select_results *styles;
+};
+
+/**
+ * Style sharing cache
+ *
+ * libcss shares partial styles between elements that no selector can
+ * tell apart, so identical siblings get back identical partial styles.
+ * Composing those with the same parent style can only produce the
+ * same result, so the first sibling's complete results are reused
+ * rather than composed and allocated again.
+ */
+struct nscss_style_cache {
+	struct nscss_style_cache_entry entry[NSCSS_STYLE_CACHE_SIZE];
+};
+
+/**
+ * Destroy a set of partial styles
+ *
+ * \param partial  Styles to destroy, indexed by pseudo element
+ */
+static void nscss_destroy_partial_styles(
+		css_computed_style *partial[CSS_PSEUDO_ELEMENT_COUNT])
+{
+	int i;
+
+	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		if (partial[i] != NULL) {
+			css_computed_style_destroy(partial[i]);
+			partial[i] = NULL;
+		}
+	}
+}
+
+/**
+ * Create a style sharing cache
+ *
+ * \return Pointer to cache, or NULL on memory exhaustion
+ */
+struct nscss_style_cache *nscss_style_cache_create(void)
+{
+	return calloc(1, sizeof(struct nscss_style_cache));
+}
+
+/**
+ * Drop the styles held by a style sharing cache entry
+ *
+ * \param entry  Entry to empty
+ */
+static void nscss_style_cache_clear(struct nscss_style_cache_entry *entry)
+{
+	nscss_destroy_partial_styles(entry->partial);
+
+	entry->parent = NULL;
+	entry->parent_style = NULL;
+	entry->styles = NULL;
+}
+
+/**
+ * Remove selection results from a style sharing cache
+ *
+ * Must be called before destroying results that may be in the cache.
+ *
+ * \param cache   Cache to update, or NULL
+ * \param styles  Results about to be destroyed
+ */
+void nscss_style_cache_forget(struct nscss_style_cache *cache,
+		const css_select_results *styles)
+{
+	int i;
+
+	if (cache == NULL)
+		return;
+
+	for (i = 0; i < NSCSS_STYLE_CACHE_SIZE; i++) {
+		if (cache->entry[i].styles == styles)
+			nscss_style_cache_clear(&cache->entry[i]);
+	}
+}
+
+/**
+ * Destroy a style sharing cache
+ *
+ * Results shared from the cache remain owned by their boxes.
+ *
+ * \param cache  Cache to destroy, or NULL
+ */
+void nscss_style_cache_destroy(struct nscss_style_cache *cache)
+{
+	int i;
+
+	if (cache == NULL)
+		return;
+
+	for (i = 0; i < NSCSS_STYLE_CACHE_SIZE; i++)
+		nscss_style_cache_clear(&cache->entry[i]);
+
+	free(cache);
+}
+
+/**
+ * Find the style sharing cache entry for an element
+ *
+ * \param ctx     CSS selection context
+ * \param n       Element being selected for
+ * \param parent  Updated to contain the element's parent
+ * \return Entry for elements with the same parent, or NULL
+ */
+static struct nscss_style_cache_entry *
+nscss_style_cache_entry(nscss_select_ctx *ctx, dom_node *n,
+		dom_node **parent)
+{
+	dom_exception err;
+
+	if (ctx->style_cache == NULL || ctx->parent_style == NULL)
+		return NULL;
+
+	err = dom_node_get_parent_node(n, parent);
+	if (err != DOM_NO_ERR || *parent == NULL)
+		return NULL;
+
+	/* Only the address is needed */
+	dom_node_unref(*parent);
+
+	return &ctx->style_cache->entry[
+			((uintptr_t) *parent >> 4) % NSCSS_STYLE_CACHE_SIZE];
+}
+
+/**
+ * Check whether an element may share the styles held by a cache entry
+ *
+ * \param entry         Entry for the element's parent
+ * \param parent        Parent of the element
+ * \param parent_style  Style the element's styles are composed with
+ * \param styles        Partial styles selected for the element
+ * \return true if composing \a styles would reproduce the entry's results
+ */
+static bool nscss_style_cache_match(
+		const struct nscss_style_cache_entry *entry,
+		dom_node *parent,
+		const css_computed_style *parent_style,
+		const css_select_results *styles)
+{
+	int i;
+
+	if (entry->styles == NULL || entry->parent != parent ||
+			entry->parent_style != parent_style)
+		return false;
+
+	for (i = 0; i < CSS_PSEUDO_ELEMENT_COUNT; i++) {
+		if (styles->styles[i] != entry->partial[i])
+			return false;
+	}
+
+	return true;
+}
+
+/** Number of counters in an ancestor filter; must be a power of two */
+#define NSCSS_ANCESTOR_FILTER_SIZE 256
+
+/**
+ * Counting Bloom filter of the names of an element's ancestors
+ *
+ * Box construction pushes each element as it descends into its
+ * children and pops it on the way back up, so while an element is
+ * selected for the filter holds its ancestors. Every node libcss
+ * reaches from the element by moving to parents and siblings has
+ * ancestors among those, so a name the filter has never seen can't
+ * be a named ancestor of any node the selection asks about.
+ */
+struct nscss_ancestor_filter {
+	/** Elements containing each name's hash bits, saturating */
+	uint8_t count[NSCSS_ANCESTOR_FILTER_SIZE];
+	uint32_t *stack; /**< Hashes of pushed elements */
+	size_t depth; /**< Number of pushed elements */
+	size_t alloc; /**< Allocated size of stack */
+};
+
+/**
+ * Compute the case-insensitive hash of an element name
+ *
+ * \param data  Name
+ * \param len   Length of name in bytes
+ * \return Hash of name
+ */
+static uint32_t nscss_ancestor_filter_hash(const char *data, size_t len)
+{
+	uint32_t hash = 0x811c9dc5;
+
+	while (len-- > 0) {
+		hash ^= (uint8_t) ascii_to_lower(*data++);
+		hash *= 0x01000193;
+	}
+
+	return hash;
+}
+
+/**
+ * Create an ancestor filter
+ *
+ * \return Pointer to empty filter, or NULL on memory exhaustion
+ */
+struct nscss_ancestor_filter *nscss_ancestor_filter_create(void)
+{
+	return calloc(1, sizeof(struct nscss_ancestor_filter));
+}
+
+/**
+ * Destroy an ancestor filter
+ *
+ * \param filter  Filter to destroy, or NULL
+ */
+void nscss_ancestor_filter_destroy(struct nscss_ancestor_filter *filter)
+{
+	if (filter == NULL)
+		return;
+
+	free(filter->stack);
+	free(filter);
+}
+
+/**
+ * Add an element to an ancestor filter
+ *
+ * Must be balanced by nscss_ancestor_filter_pop() once the element's
+ * descendants have been selected for.
+ *
+ * \param filter  Filter to update
+ * \param n       Element whose children are about to be selected for
+ * \return true on success, false on memory exhaustion
+ */
+bool nscss_ancestor_filter_push(struct nscss_ancestor_filter *filter,
+		dom_node *n)
+{
+	dom_string *name;
+	dom_exception err;
+	uint32_t hash;
+	uint8_t *c;
+
+	if (filter->depth == filter->alloc) {
+		size_t alloc = filter->alloc == 0 ? 32 : filter->alloc * 2;
+		uint32_t *stack;
+
+		stack = realloc(filter->stack, alloc * sizeof(*stack));
+		if (stack == NULL)
+			return false;
+
+		filter->stack = stack;
+		filter->alloc = alloc;
+	}
+
+	err = dom_node_get_node_name(n, &name);
+	if (err != DOM_NO_ERR || name == NULL)
+		return false;
+
+	hash = nscss_ancestor_filter_hash(dom_string_data(name),
+			dom_string_byte_length(name));
+
+	dom_string_unref(name);
+
+	filter->stack[filter->depth++] = hash;
+
+	c = &filter->count[hash & (NSCSS_ANCESTOR_FILTER_SIZE - 1)];
+	if (*c != UINT8_MAX)
+		(*c)++;
+	c = &filter->count[(hash >> 16) & (NSCSS_ANCESTOR_FILTER_SIZE - 1)];
+	if (*c != UINT8_MAX)
+		(*c)++;
+
+	return true;
+}
+
+/**
+ * Remove the most recently pushed element from an ancestor filter
+ *
+ * Counters that saturated are left alone, which only costs precision.
+ *
+ * \param filter  Filter to update
+ */
+void nscss_ancestor_filter_pop(struct nscss_ancestor_filter *filter)
+{
+	uint32_t hash;
+	uint8_t *c;
+
+	assert(filter->depth > 0);
+
+	hash = filter->stack[--filter->depth];
+
+	c = &filter->count[hash & (NSCSS_ANCESTOR_FILTER_SIZE - 1)];
+	if (*c != UINT8_MAX)
+		(*c)--;
+	c = &filter->count[(hash >> 16) & (NSCSS_ANCESTOR_FILTER_SIZE - 1)];
+	if (*c != UINT8_MAX)
+		(*c)--;
+}
+
+/**
+ * Check whether the current element may have an ancestor with a name
+ *
+ * \param ctx   CSS selection context
+ * \param name  Element name to look for
+ * \return false if no ancestor has the name, true if one might
+ */
+static bool nscss_ancestor_filter_test(const nscss_select_ctx *ctx,
+		lwc_string *name)
+{
+	const struct nscss_ancestor_filter *filter;
+	uint32_t hash;
+
+	if (ctx == NULL || ctx->ancestors == NULL)
+		return true;
+
+	filter = ctx->ancestors;
+
+	hash = nscss_ancestor_filter_hash(lwc_string_data(name),
+			lwc_string_length(name));
+
+	return filter->count[hash & (NSCSS_ANCESTOR_FILTER_SIZE - 1)] != 0 &&
+		filter->count[(hash >> 16) &
+				(NSCSS_ANCESTOR_FILTER_SIZE - 1)] != 0;
+}
+
 /**
  * Get style selection results for an element
  *
+ * If the context has a style sharing cache, the results may belong to
+ * an earlier sibling of the element, in which case ctx->styles_shared
+ * is set and the caller must not destroy them.
+ *
  * \param ctx             CSS selection context
  * \param n               Element to select for
  * \param media           Permitted media types
@@ -255,11 +733,16 @@ css_select_results *nscss_get_style(nscss_select_ctx *ctx, dom_node *n,
 		const css_unit_ctx *unit_len_ctx,
 		const css_stylesheet *inline_style)
 {
+	css_computed_style *partial[CSS_PSEUDO_ELEMENT_COUNT] = { NULL };
+	struct nscss_style_cache_entry *entry = NULL;
+	dom_node *parent = NULL;
 	css_computed_style *composed;
 	css_select_results *styles;
 	int pseudo_element;
 	css_error error;
 
+	ctx->styles_shared = false;
+
 	/* Select style for node */
 	error = css_select_style(ctx->ctx, n, unit_len_ctx, media, inline_style,
 			&selection_handler, ctx, &styles);
@@ -269,6 +752,24 @@ css_select_results *nscss_get_style(nscss_select_ctx *ctx, dom_node *n,
 		return NULL;
 	}
 
+	nscss_select_stats.selections++;
+
+	/* First-letter and first-line styles are left partial, so
+	 * elements that have them are not shared */
+	if (inline_style == NULL &&
+			styles->styles[CSS_PSEUDO_ELEMENT_FIRST_LETTER] == NULL &&
+			styles->styles[CSS_PSEUDO_ELEMENT_FIRST_LINE] == NULL) {
+		entry = nscss_style_cache_entry(ctx, n, &parent);
+	}
+
+	if (entry != NULL && nscss_style_cache_match(entry, parent,
+			ctx->parent_style, styles)) {
+		css_select_results_destroy(styles);
+		nscss_select_stats.shared++;
+		ctx->styles_shared = true;
+		return entry->styles;
+	}
+
 	/* If there's a parent style, compose with partial to obtain
 	 * complete computed style for element */
 	if (ctx->parent_style != NULL) {
@@ -283,8 +784,8 @@ css_select_results *nscss_get_style(nscss_select_ctx *ctx, dom_node *n,
 		}
 
 		/* Replace select_results style with composed style */
-		css_computed_style_destroy(
-				styles->styles[CSS_PSEUDO_ELEMENT_NONE]);
+		partial[CSS_PSEUDO_ELEMENT_NONE] =
+				styles->styles[CSS_PSEUDO_ELEMENT_NONE];
 		styles->styles[CSS_PSEUDO_ELEMENT_NONE] = composed;
 	}
 
@@ -311,15 +812,27 @@ css_select_results *nscss_get_style(nscss_select_ctx *ctx, dom_node *n,
 		if (error != CSS_OK) {
 			/* TODO: perhaps this shouldn't be quite so
 			 * catastrophic? */
+			nscss_destroy_partial_styles(partial);
 			css_select_results_destroy(styles);
 			return NULL;
 		}
 
 		/* Replace select_results style with composed style */
-		css_computed_style_destroy(styles->styles[pseudo_element]);
+		partial[pseudo_element] = styles->styles[pseudo_element];
 		styles->styles[pseudo_element] = composed;
 	}
 
+	if (entry != NULL) {
+		/* Keep the partial styles for comparison with siblings */
+		nscss_style_cache_clear(entry);
+		memcpy(entry->partial, partial, sizeof(partial));
+		entry->parent = parent;
+		entry->parent_style = ctx->parent_style;
+		entry->styles = styles;
+	} else {
+		nscss_destroy_partial_styles(partial);
+	}
+
 	return styles;
 }
 
@@ -434,26 +947,17 @@ css_error node_classes(void *pw, void *node,
  */
 css_error node_id(void *pw, void *node, lwc_string **id)
 {
-	dom_node *n = node;
-	dom_string *attr;
-	dom_exception err;
-
-	*id = NULL;
-
-	/** \todo Assumes an HTML DOM */
-	err = dom_html_element_get_id(n, &attr);
-	if (err != DOM_NO_ERR)
-		return CSS_NOMEM;
+	css_error error;
 
-	if (attr != NULL) {
-		err = dom_string_intern(attr, id);
-		if (err != DOM_NO_ERR) {
-			dom_string_unref(attr);
-			return CSS_NOMEM;
-		}
-		dom_string_unref(attr);
+	error = nscss_node_get_id(node, id);
+	if (error != CSS_OK) {
+		*id = NULL;
+		return error;
 	}
 
+	if (*id != NULL)
+		*id = lwc_string_ref(*id);
+
 	return CSS_OK;
 }
 
@@ -471,6 +975,12 @@ css_error node_id(void *pw, void *node, lwc_string **id)
 css_error named_ancestor_node(void *pw, void *node,
 		const css_qname *qname, void **ancestor)
 {
+	if (nscss_ancestor_filter_test(pw, qname->name) == false) {
+		/* Provably absent, so don't walk the tree */
+		*ancestor = NULL;
+		return CSS_OK;
+	}
+
 	dom_element_named_ancestor_node(node, qname->name,
 			(struct dom_element **)ancestor);
 	dom_node_unref(*ancestor);
@@ -492,6 +1002,11 @@ css_error named_ancestor_node(void *pw, void *node,
 css_error named_parent_node(void *pw, void *node,
 		const css_qname *qname, void **parent)
 {
+	if (nscss_ancestor_filter_test(pw, qname->name) == false) {
+		*parent = NULL;
+		return CSS_OK;
+	}
+
 	dom_element_named_parent_node(node, qname->name,
 			(struct dom_element **)parent);
 	dom_node_unref(*parent);
@@ -779,22 +1294,16 @@ css_error node_has_class(void *pw, void *node,
 css_error node_has_id(void *pw, void *node,
 		lwc_string *name, bool *match)
 {
-	dom_node *n = node;
-	dom_string *attr;
-	dom_exception err;
+	lwc_string *id;
 
 	*match = false;
 
-	/** \todo Assumes an HTML DOM */
-	err = dom_html_element_get_id(n, &attr);
-	if (err != DOM_NO_ERR)
+	if (nscss_node_get_id(node, &id) != CSS_OK || id == NULL)
 		return CSS_OK;
 
-	if (attr != NULL) {
-		*match = dom_string_lwc_isequal(attr, name);
-
-		dom_string_unref(attr);
-	}
+	/* Both are interned, so this is a pointer comparison */
+	if (lwc_string_isequal(id, name, match) != lwc_error_ok)
+		*match = false;
 
 	return CSS_OK;
 }
@@ -1731,10 +2240,18 @@ css_error ua_default_for_property(void *pw, uint32_t property, css_hint *hint)
 
 css_error set_libcss_node_data(void *pw, void *node, void *libcss_node_data)
 {
+	nscss_select_ctx *ctx = pw;
 	dom_node *n = node;
 	dom_exception err;
 	void *old_node_data;
 
+	if (ctx->discard_node_data) {
+		/* Selection is transient; node data must not outlive it */
+		return css_libcss_node_data_handler(&selection_handler,
+				CSS_NODE_DELETED, NULL, n, NULL,
+				libcss_node_data);
+	}
+
 	/* Set this node's node data */
 	err = dom_node_set_user_data(n,
 			corestring_dom___ns_key_libcss_node_data,
@@ -1751,9 +2268,15 @@ css_error set_libcss_node_data(void *pw, void *node, void *libcss_node_data)
 
 css_error get_libcss_node_data(void *pw, void *node, void **libcss_node_data)
 {
+	nscss_select_ctx *ctx = pw;
 	dom_node *n = node;
 	dom_exception err;
 
+	if (ctx->discard_node_data) {
+		*libcss_node_data = NULL;
+		return CSS_OK;
+	}
+
 	/* Get this node's node data */
 	err = dom_node_get_user_data(n,
 			corestring_dom___ns_key_libcss_node_data,
@@ -27,6 +27,8 @@
 
 struct content;
 struct nsurl;
+struct nscss_style_cache;
+struct nscss_ancestor_filter;
 
 /**
  * Selection context
@@ -39,8 +41,25 @@ typedef struct nscss_select_ctx
 	lwc_string *universal;
 	const css_computed_style *root_style;
 	const css_computed_style *parent_style;
+	bool discard_node_data; /**< Don't keep libcss data on DOM nodes */
+	struct nscss_style_cache *style_cache; /**< Styles of earlier
+						* siblings, or NULL */
+	bool styles_shared; /**< Set if the returned selection results
+			     * belong to an earlier sibling */
+	/** Names of the element's ancestors, or NULL if not tracked */
+	const struct nscss_ancestor_filter *ancestors;
 } nscss_select_ctx;
 
+/**
+ * Style selection statistics
+ */
+struct nscss_select_stats {
+	unsigned int selections; /**< Elements styles were selected for */
+	unsigned int shared; /**< Of which, results shared with a sibling */
+};
+
+void nscss_get_select_stats(struct nscss_select_stats *stats);
+
 css_stylesheet *nscss_create_inline_style(const uint8_t *data, size_t len,
 		const char *charset, const char *url, bool allow_quirks);
 
@@ -49,6 +68,19 @@ css_select_results *nscss_get_style(nscss_select_ctx *ctx, dom_node *n,
 		const css_unit_ctx *unit_len_ctx,
 		const css_stylesheet *inline_style);
 
+struct nscss_style_cache *nscss_style_cache_create(void);
+void nscss_style_cache_forget(struct nscss_style_cache *cache,
+		const css_select_results *styles);
+void nscss_style_cache_destroy(struct nscss_style_cache *cache);
+
+void nscss_node_attributes_changed(dom_node *n);
+
+struct nscss_ancestor_filter *nscss_ancestor_filter_create(void);
+void nscss_ancestor_filter_destroy(struct nscss_ancestor_filter *filter);
+bool nscss_ancestor_filter_push(struct nscss_ancestor_filter *filter,
+		dom_node *n);
+void nscss_ancestor_filter_pop(struct nscss_ancestor_filter *filter);
+
 css_computed_style *nscss_get_blank_style(nscss_select_ctx *ctx,
 		const css_unit_ctx *unit_len_ctx,
 		const css_computed_style *parent);
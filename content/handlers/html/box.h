@@ -41,6 +41,7 @@ struct nsurl;
 struct dom_node;
 struct dom_string;
 struct rect;
+struct layout_text_breaks;
 
 #define UNKNOWN_WIDTH INT_MAX
 #define UNKNOWN_MAX_WIDTH INT_MAX
@@ -86,7 +87,13 @@ typedef enum {
 	REPLACE_DIM = 1 << 9,	/* replaced element has given dimensions */
 	IFRAME      = 1 << 10,	/* box contains an iframe */
 	CONVERT_CHILDREN = 1 << 11,  /* wanted children converting */
-	IS_REPLACED = 1 << 12	/* box is a replaced element */
+	IS_REPLACED = 1 << 12,	/* box is a replaced element */
+	NEEDS_LAYOUT = 1 << 13,	/* box or descendant changed since layout */
+	STYLES_SHARED = 1 << 14, /* styles are owned by an earlier sibling */
+	FLOAT_FREE  = 1 << 15,	/* inline container was laid out clear of floats */
+	DEFERRED    = 1 << 16,	/* layout of contents deferred, height estimated */
+	LAYOUT_KEPT = 1 << 17,	/* previous layout of contents was kept */
+	REDRAW_STALE = 1 << 18	/* drawn differently since redraw list built */
 } box_flags;
 
 
@@ -106,6 +113,30 @@ struct box_border {
 };
 
 
+/**
+ * Margins, padding and borders of a box.
+ *
+ * Text boxes, which are the most numerous, have none of their own and
+ * share a single empty set. See box_create_text().
+ */
+struct box_edges {
+	/**
+	 * Margin: TOP, RIGHT, BOTTOM, LEFT.
+	 */
+	int margin[4];
+
+	/**
+	 * Padding: TOP, RIGHT, BOTTOM, LEFT.
+	 */
+	int padding[4];
+
+	/**
+	 * Border: TOP, RIGHT, BOTTOM, LEFT.
+	 */
+	struct box_border border[4];
+};
+
+
 /**
  * Table column data.
  */
@@ -169,6 +200,97 @@ struct object_params {
 };
 
 
+/**
+ * Box data needed only by some kinds of box.
+ *
+ * Kept out of struct box so that the common boxes, mostly runs of
+ * text, don't carry it. See box_ensure_ext() and the accessors in
+ * box_inspect.h.
+ */
+struct box_ext {
+	/**
+	 * Link target, or NULL.
+	 */
+	const char *target;
+
+	/**
+	 * Title, or NULL.
+	 */
+	const char *title;
+
+	/**
+	 * Horizontal scroll.
+	 */
+	struct scrollbar *scroll_x;
+
+	/**
+	 * Vertical scroll.
+	 */
+	struct scrollbar *scroll_y;
+
+	/**
+	 * Number of columns for TABLE / TABLE_CELL.
+	 */
+	unsigned int columns;
+
+	/**
+	 * Number of rows for TABLE only.
+	 */
+	unsigned int rows;
+
+	/**
+	 * Start column for TABLE_CELL only.
+	 */
+	unsigned int start_column;
+
+	/**
+	 * Array of table column data for TABLE only.
+	 */
+	struct column *col;
+
+	/**
+	 * List marker box if this is a list-item, or NULL.
+	 */
+	struct box *list_marker;
+
+	/**
+	 * List item value.
+	 */
+	int list_value;
+
+	/**
+	 * Form control data, or NULL if not a form control.
+	 */
+	struct form_control* gadget;
+
+	/**
+	 * Object in this box (usually an image), or NULL if none.
+	 */
+	struct hlcache_handle* object;
+
+	/**
+	 * (Image)map to use with this object, or NULL if none
+	 */
+	char *usemap;
+
+	/**
+	 * Parameters for the object, or NULL.
+	 */
+	struct object_params *object_params;
+
+	/**
+	 * Iframe's browser_window, or NULL if none
+	 */
+	struct browser_window *iframe;
+
+	/**
+	 * Line break opportunities in the text of a long text box, shared
+	 * with the clones split from it, or NULL.
+	 */
+	struct layout_text_breaks *breaks;
+};
+
+
 /**
  * Node in box tree. All dimensions are in pixels.
  */
@@ -310,29 +432,9 @@ struct box {
 	int descendant_y1;  /**< bottom edge of descendants */
 
 	/**
-	 * Margin: TOP, RIGHT, BOTTOM, LEFT.
-	 */
-	int margin[4];
-
-	/**
-	 * Padding: TOP, RIGHT, BOTTOM, LEFT.
-	 */
-	int padding[4];
-
-	/**
-	 * Border: TOP, RIGHT, BOTTOM, LEFT.
-	 */
-	struct box_border border[4];
-
-	/**
-	 * Horizontal scroll.
-	 */
-	struct scrollbar *scroll_x;
-
-	/**
-	 * Vertical scroll.
+	 * Margins, padding and borders. Never NULL.
 	 */
-	struct scrollbar *scroll_y;
+	struct box_edges *edges;
 
 	/**
 	 * Width of box taking all line breaks (including margins
@@ -373,59 +475,6 @@ struct box {
 	 */
 	struct nsurl *href;
 
-	/**
-	 * Link target, or NULL.
-	 */
-	const char *target;
-
-	/**
-	 * Title, or NULL.
-	 */
-	const char *title;
-
-
-	/**
-	 * Number of columns for TABLE / TABLE_CELL.
-	 */
-	unsigned int columns;
-
-	/**
-	 * Number of rows for TABLE only.
-	 */
-	unsigned int rows;
-
-	/**
-	 * Start column for TABLE_CELL only.
-	 */
-	unsigned int start_column;
-
-	/**
-	 * Array of table column data for TABLE only.
-	 */
-	struct column *col;
-
-	/**
-	 * List item value.
-	 */
-	int list_value;
-
-	/**
-	 * List marker box if this is a list-item, or NULL.
-	 */
-	struct box *list_marker;
-
-
-	/**
-	 * Form control data, or NULL if not a form control.
-	 */
-	struct form_control* gadget;
-
-
-	/**
-	 * (Image)map to use with this object, or NULL if none
-	 */
-	char *usemap;
-
 
 	/**
 	 * Background image for this box, or NULL if none
@@ -434,20 +483,10 @@ struct box {
 
 
 	/**
-	 * Object in this box (usually an image), or NULL if none.
+	 * Data for links, tables, lists, scrollbars, form controls and
+	 * replaced elements, or NULL.
 	 */
-	struct hlcache_handle* object;
-
-	/**
-	 * Parameters for the object, or NULL.
-	 */
-	struct object_params *object_params;
-
-
-	/**
-	 * Iframe's browser_window, or NULL if none
-	 */
-	struct browser_window *iframe;
+	struct box_ext *ext;
 
 };
 
@@ -42,6 +42,7 @@
 #include "html/private.h"
 #include "html/object.h"
 #include "html/box.h"
+#include "html/box_inspect.h"
 #include "html/box_manipulate.h"
 #include "html/box_construct.h"
 #include "html/box_special.h"
@@ -60,7 +61,22 @@ struct box_construct_ctx {
 
 	box_construct_complete_cb cb;	/**< Callback to invoke on completion */
 
-	int *bctx;			/**< talloc context */
+	struct box_arena *bctx;		/**< box allocation context */
+
+	bool synchronous;		/**< Construct without yielding */
+
+	bool discard_node_data;		/**< Don't use cached libcss node data */
+
+	struct nscss_style_cache *style_cache; /**< Styles to share between
+						* siblings, or NULL */
+
+	/** Names of the current node's ancestors, or NULL if not tracked */
+	struct nscss_ancestor_filter *ancestors;
+
+	dom_node *stop;			/**< Root of subtree being converted,
+					 * or NULL for the whole document */
+
+	bool failed;			/**< Completing an element failed */
 };
 
 /**
@@ -175,8 +191,8 @@ box_extract_properties(dom_node *n, struct box_construct_props *props)
 			if (parent_box != NULL) {
 				props->parent_style = parent_box->style;
 				props->href = parent_box->href;
-				props->target = parent_box->target;
-				props->title = parent_box->title;
+				props->target = box_get_target(parent_box);
+				props->title = box_get_title(parent_box);
 
 				dom_node_unref(parent_node);
 				break;
@@ -236,18 +252,20 @@ box_extract_properties(dom_node *n, struct box_construct_props *props)
 /**
  * Get the style for an element.
  *
- * \param  c               content of type CONTENT_HTML that is being processed
+ * \param  construct       tree construction context, positioned at the element
  * \param  parent_style    style at this point in xml tree, or NULL for root
  * \param  root_style      root node's style, or NULL for root
- * \param  n               node in xml tree
+ * \param  shared          updated to true if the style belongs to a sibling
  * \return  the new style, or NULL on memory exhaustion
  */
 static css_select_results *
-box_get_style(html_content *c,
+box_get_style(struct box_construct_ctx *construct,
 	      const css_computed_style *parent_style,
 	      const css_computed_style *root_style,
-	      dom_node *n)
+	      bool *shared)
 {
+	html_content *c = construct->content;
+	dom_node *n = construct->n;
 	dom_string *s;
 	dom_exception err;
 	css_stylesheet *inline_style = NULL;
@@ -280,10 +298,14 @@ box_get_style(html_content *c,
 	ctx.universal = c->universal;
 	ctx.root_style = root_style;
 	ctx.parent_style = parent_style;
+	ctx.discard_node_data = construct->discard_node_data;
+	ctx.style_cache = construct->style_cache;
+	ctx.ancestors = construct->ancestors;
 
 	/* Select style for element */
 	styles = nscss_get_style(&ctx, n, &c->media, &c->unit_len_ctx,
 			inline_style);
+	*shared = ctx.styles_shared;
 
 	/* No longer need inline style */
 	if (inline_style != NULL)
@@ -432,7 +454,10 @@ box_construct_marker(struct box *box,
 		nsurl_unref(url);
 	}
 
-	box->list_marker = marker;
+	if (box_ensure_ext(box, ctx->bctx) == NULL)
+		return false;
+
+	box->ext->list_marker = marker;
 	marker->parent = box;
 
 	return true;
@@ -457,6 +482,7 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
 	dom_exception err;
 	struct box_construct_props props;
 	const css_computed_style *root_style = NULL;
+	bool styles_shared = false;
 
 	assert(ctx->n != NULL);
 
@@ -473,8 +499,8 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
 		root_style = ctx->root_box->style;
 	}
 
-	styles = box_get_style(ctx->content, props.parent_style, root_style,
-			ctx->n);
+	styles = box_get_style(ctx, props.parent_style, root_style,
+			&styles_shared);
 	if (styles == NULL)
 		return false;
 
@@ -518,6 +544,9 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
 	if (box == NULL)
 		return false;
 
+	if (styles_shared)
+		box->flags |= STYLES_SHARED;
+
 	/* If this is the root box, add it to the context */
 	if (props.node_is_root)
 		ctx->root_box = box;
@@ -530,8 +559,13 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
 	if (s != NULL) {
 		const char *val = dom_string_data(s);
 
-		if ('0' <= val[0] && val[0] <= '9')
-			box->columns = strtol(val, NULL, 10);
+		if ('0' <= val[0] && val[0] <= '9') {
+			if (box_ensure_ext(box, ctx->bctx) == NULL) {
+				dom_string_unref(s);
+				return false;
+			}
+			box->ext->columns = strtol(val, NULL, 10);
+		}
 
 		dom_string_unref(s);
 	}
@@ -543,8 +577,13 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
 	if (s != NULL) {
 		const char *val = dom_string_data(s);
 
-		if ('0' <= val[0] && val[0] <= '9')
-			box->rows = strtol(val, NULL, 10);
+		if ('0' <= val[0] && val[0] <= '9') {
+			if (box_ensure_ext(box, ctx->bctx) == NULL) {
+				dom_string_unref(s);
+				return false;
+			}
+			box->ext->rows = strtol(val, NULL, 10);
+		}
 
 		dom_string_unref(s);
 	}
@@ -591,14 +630,17 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
 	    (ns_computed_display(box->style,
 				 props.node_is_root) == CSS_DISPLAY_NONE &&
 	     props.node_is_root == false)) {
-		css_select_results_destroy(styles);
+		if (styles_shared == false) {
+			nscss_style_cache_forget(ctx->style_cache, styles);
+			css_select_results_destroy(styles);
+		}
 		box->styles = NULL;
 		box->style = NULL;
 
 		/* Invalidate associated gadget, if any */
-		if (box->gadget != NULL) {
-			box->gadget->box = NULL;
-			box->gadget = NULL;
+		if (box_get_gadget(box) != NULL) {
+			box->ext->gadget->box = NULL;
+			box->ext->gadget = NULL;
 		}
 
 		/* Can't do this, because the lifetimes of boxes and gadgets
@@ -725,11 +767,15 @@ box_construct_element(struct box_construct_ctx *ctx, bool *convert_children)
  * Complete construction of the box tree for an element.
  *
  * \param n        DOM node to construct for
- * \param content  Containing document
+ * \param ctx      Tree construction context
+ * \return  true on success, false on memory exhaustion
  *
- * This will be called after all children of an element have been processed
+ * This will be called after all children of an element have been
+ * processed. The element's box is normalised here, so the tree is
+ * normalised as it is built.
  */
-static void box_construct_element_after(dom_node *n, html_content *content)
+static bool
+box_construct_element_after(dom_node *n, struct box_construct_ctx *ctx)
 {
 	struct box_construct_props props;
 	struct box *box = box_for_node(n);
@@ -746,20 +792,20 @@ static void box_construct_element_after(dom_node *n, html_content *content)
 
 		err = dom_node_has_child_nodes(n, &has_children);
 		if (err != DOM_NO_ERR)
-			return;
+			return false;
 
 		if (has_children == false ||
 				(box->flags & CONVERT_CHILDREN) == 0) {
 			/* No children, or didn't want children converted */
-			return;
+			return true;
 		}
 
 		if (props.inline_container == NULL) {
 			/* Create inline container if we don't have one */
 			props.inline_container = box_create(NULL, NULL, false,
-					NULL, NULL, NULL, NULL, content->bctx);
+					NULL, NULL, NULL, NULL, ctx->bctx);
 			if (props.inline_container == NULL)
-				return;
+				return false;
 
 			props.inline_container->type = BOX_INLINE_CONTAINER;
 
@@ -768,24 +814,142 @@ static void box_construct_element_after(dom_node *n, html_content *content)
 		}
 
 		inline_end = box_create(NULL, box->style, false,
-				box->href, box->target, box->title,
+				box->href, box_get_target(box),
+				box_get_title(box),
 				box->id == NULL ? NULL :
-				lwc_string_ref(box->id), content->bctx);
-		if (inline_end != NULL) {
-			inline_end->type = BOX_INLINE_END;
+				lwc_string_ref(box->id), ctx->bctx);
+		if (inline_end == NULL)
+			return false;
 
-			assert(props.inline_container != NULL);
+		inline_end->type = BOX_INLINE_END;
 
-			box_add_child(props.inline_container, inline_end);
+		assert(props.inline_container != NULL);
 
-			box->inline_end = inline_end;
-			inline_end->inline_end = box;
-		}
-	} else if (!(box->flags & IS_REPLACED)) {
+		box_add_child(props.inline_container, inline_end);
+
+		box->inline_end = inline_end;
+		inline_end->inline_end = box;
+
+		return true;
+	}
+
+	if (!(box->flags & IS_REPLACED)) {
 		/* Handle the :after pseudo element */
-		box_construct_generate(n, content, box,
+		box_construct_generate(n, ctx->content, box,
 				box->styles->styles[CSS_PSEUDO_ELEMENT_AFTER]);
 	}
+
+	switch (box->type) {
+	case BOX_BLOCK:
+	case BOX_INLINE_BLOCK:
+	case BOX_TABLE_CELL:
+		return box_normalise_block(box, ctx->root_box, ctx->content);
+
+	case BOX_TABLE:
+		return box_normalise_table(box, ctx->root_box, ctx->content);
+
+	default:
+		/* Table rows and row groups are normalised with their
+		 * table, once it is complete */
+		return true;
+	}
+}
+
+
+/**
+ * Complete construction of an element's box, if it has one.
+ *
+ * \param n    DOM node to construct for
+ * \param ctx  Tree construction context
+ * \return  true on success, false on memory exhaustion
+ */
+static inline bool
+box_construct_complete(dom_node *n, struct box_construct_ctx *ctx)
+{
+	if (box_for_node(n) == NULL)
+		return true;
+
+	if (box_construct_element_after(n, ctx))
+		return true;
+
+	ctx->failed = true;
+
+	return false;
+}
+
+
+/**
+ * Note that construction is descending into an element's children
+ *
+ * \param ctx  Tree construction context
+ * \param n    Element whose children are next
+ */
+static void box_construct_enter(struct box_construct_ctx *ctx, dom_node *n)
+{
+	if (ctx->ancestors == NULL)
+		return;
+
+	if (nscss_ancestor_filter_push(ctx->ancestors, n) == false) {
+		/* Selection works without it, only slower */
+		nscss_ancestor_filter_destroy(ctx->ancestors);
+		ctx->ancestors = NULL;
+	}
+}
+
+
+/**
+ * Enter a subtree root and all its ancestors
+ *
+ * Used when construction starts part way down the DOM tree.
+ *
+ * \param ctx  Tree construction context
+ * \param n    Root of the subtree being constructed
+ */
+static void box_construct_enter_ancestors(struct box_construct_ctx *ctx,
+		dom_node *n)
+{
+	dom_node *node = dom_node_ref(n);
+
+	while (node != NULL && ctx->ancestors != NULL) {
+		dom_node *parent = NULL;
+		dom_node_type type;
+		dom_exception err;
+
+		err = dom_node_get_node_type(node, &type);
+		if (err == DOM_NO_ERR && type != DOM_ELEMENT_NODE) {
+			/* Reached the document */
+			break;
+		}
+
+		if (err == DOM_NO_ERR) {
+			box_construct_enter(ctx, node);
+			err = dom_node_get_parent_node(node, &parent);
+		}
+
+		if (err != DOM_NO_ERR) {
+			/* An incomplete filter would reject real ancestors */
+			nscss_ancestor_filter_destroy(ctx->ancestors);
+			ctx->ancestors = NULL;
+		}
+
+		dom_node_unref(node);
+		node = parent;
+	}
+
+	if (node != NULL)
+		dom_node_unref(node);
+}
+
+
+/**
+ * Note that construction has finished an element's children
+ *
+ * \param ctx  Tree construction context
+ */
+static void box_construct_leave(struct box_construct_ctx *ctx)
+{
+	if (ctx->ancestors != NULL)
+		nscss_ancestor_filter_pop(ctx->ancestors);
 }
 
 
@@ -793,15 +957,16 @@ static void box_construct_element_after(dom_node *n, html_content *content)
  * Find the next node in the DOM tree, completing element construction
  * where appropriate.
  *
+ * \param ctx               Tree construction context
  * \param n                 Current node
- * \param content           Containing content
  * \param convert_children  Whether to consider children of \a n
- * \return Next node to process, or NULL if complete
+ * \return Next node to process, or NULL if complete or construction failed
  *
  * \note \a n will be unreferenced
+ * \note Construction of the context's subtree root is not completed
  */
 static dom_node *
-next_node(dom_node *n, html_content *content, bool convert_children)
+next_node(struct box_construct_ctx *ctx, dom_node *n, bool convert_children)
 {
 	dom_node *next = NULL;
 	bool has_children;
@@ -819,6 +984,7 @@ next_node(dom_node *n, html_content *content, bool convert_children)
 			dom_node_unref(n);
 			return NULL;
 		}
+		box_construct_enter(ctx, n);
 		dom_node_unref(n);
 	} else {
 		err = dom_node_get_next_sibling(n, &next);
@@ -828,12 +994,17 @@ next_node(dom_node *n, html_content *content, bool convert_children)
 		}
 
 		if (next != NULL) {
-			if (box_for_node(n) != NULL)
-				box_construct_element_after(n, content);
+			if (box_construct_complete(n, ctx) == false) {
+				dom_node_unref(next);
+				dom_node_unref(n);
+				return NULL;
+			}
 			dom_node_unref(n);
 		} else {
-			if (box_for_node(n) != NULL)
-				box_construct_element_after(n, content);
+			if (box_construct_complete(n, ctx) == false) {
+				dom_node_unref(n);
+				return NULL;
+			}
 
 			while (box_is_root(n) == false) {
 				dom_node *parent = NULL;
@@ -847,6 +1018,13 @@ next_node(dom_node *n, html_content *content, bool convert_children)
 
 				assert(parent != NULL);
 
+				if (parent == ctx->stop) {
+					/* Finished the subtree */
+					dom_node_unref(parent);
+					dom_node_unref(n);
+					return NULL;
+				}
+
 				err = dom_node_get_next_sibling(parent,
 						&parent_next);
 				if (err != DOM_NO_ERR) {
@@ -865,9 +1043,11 @@ next_node(dom_node *n, html_content *content, bool convert_children)
 				n = parent;
 				parent = NULL;
 
-				if (box_for_node(n) != NULL) {
-					box_construct_element_after(
-							n, content);
+				box_construct_leave(ctx);
+
+				if (box_construct_complete(n, ctx) == false) {
+					dom_node_unref(n);
+					return NULL;
 				}
 			}
 
@@ -889,9 +1069,14 @@ next_node(dom_node *n, html_content *content, bool convert_children)
 					return NULL;
 				}
 
-				if (box_for_node(parent) != NULL) {
-					box_construct_element_after(parent,
-							content);
+				box_construct_leave(ctx);
+
+				if (box_construct_complete(parent, ctx) == false) {
+					if (next != NULL)
+						dom_node_unref(next);
+					dom_node_unref(parent);
+					dom_node_unref(n);
+					return NULL;
 				}
 
 				dom_node_unref(parent);
@@ -1012,18 +1197,16 @@ static bool box_construct_text(struct box_construct_ctx *ctx)
 		}
 
 		/** \todo Dropping const here is not clever */
-		box = box_create(NULL,
+		box = box_create_text(
 				(css_computed_style *) props.parent_style,
-				false, props.href, props.target, props.title,
-				NULL, ctx->bctx);
+				props.href, props.target, props.title,
+				ctx->bctx);
 		if (box == NULL) {
 			free(text);
 			return false;
 		}
 
-		box->type = BOX_TEXT;
-
-		box->text = talloc_strdup(ctx->bctx, text);
+		box->text = box_arena_strdup(ctx->bctx, text);
 		free(text);
 		if (box->text == NULL)
 			return false;
@@ -1131,18 +1314,16 @@ static bool box_construct_text(struct box_construct_ctx *ctx)
 			}
 
 			/** \todo Dropping const isn't clever */
-			box = box_create(NULL,
+			box = box_create_text(
 				(css_computed_style *) props.parent_style,
-				false, props.href, props.target, props.title,
-				NULL, ctx->bctx);
+				props.href, props.target, props.title,
+				ctx->bctx);
 			if (box == NULL) {
 				free(text);
 				return false;
 			}
 
-			box->type = BOX_TEXT;
-
-			box->text = talloc_strdup(ctx->bctx, current);
+			box->text = box_arena_strdup(ctx->bctx, current);
 			if (box->text == NULL) {
 				free(text);
 				return false;
@@ -1186,6 +1367,19 @@ static bool box_construct_text(struct box_construct_ctx *ctx)
 }
 
 
+/**
+ * Destroy a box tree construction context
+ *
+ * \param ctx  context to destroy
+ */
+static void box_construct_ctx_destroy(struct box_construct_ctx *ctx)
+{
+	nscss_style_cache_destroy(ctx->style_cache);
+	nscss_ancestor_filter_destroy(ctx->ancestors);
+	free(ctx);
+}
+
+
 /**
  * Convert an ELEMENT node to a box tree fragment,
  * then schedule conversion of the next ELEMENT node
@@ -1205,12 +1399,12 @@ static void convert_xml_to_box(struct box_construct_ctx *ctx)
 		if (box_construct_element(ctx, &convert_children) == false) {
 			ctx->cb(ctx->content, false);
 			dom_node_unref(ctx->n);
-			free(ctx);
+			box_construct_ctx_destroy(ctx);
 			return;
 		}
 
 		/* Find next element to process, converting text nodes as we go */
-		next = next_node(ctx->n, ctx->content, convert_children);
+		next = next_node(ctx, ctx->n, convert_children);
 		while (next != NULL) {
 			dom_node_type type;
 			dom_exception err;
@@ -1219,7 +1413,7 @@ static void convert_xml_to_box(struct box_construct_ctx *ctx)
 			if (err != DOM_NO_ERR) {
 				ctx->cb(ctx->content, false);
 				dom_node_unref(next);
-				free(ctx);
+				box_construct_ctx_destroy(ctx);
 				return;
 			}
 
@@ -1231,71 +1425,66 @@ static void convert_xml_to_box(struct box_construct_ctx *ctx)
 				if (box_construct_text(ctx) == false) {
 					ctx->cb(ctx->content, false);
 					dom_node_unref(ctx->n);
-					free(ctx);
+					box_construct_ctx_destroy(ctx);
 					return;
 				}
 			}
 
-			next = next_node(next, ctx->content, true);
+			next = next_node(ctx, next, true);
 		}
 
 		ctx->n = next;
 
 		if (next == NULL) {
-			/* Conversion complete */
-			struct box root;
-
-			memset(&root, 0, sizeof(root));
-
-			root.type = BOX_BLOCK;
-			root.children = root.last = ctx->root_box;
-			root.children->parent = &root;
-
-			/** \todo Remove box_normalise_block */
-			if (box_normalise_block(&root, ctx->root_box,
-					ctx->content) == false) {
+			/* Conversion complete; the tree was normalised as
+			 * each element was completed */
+			if (ctx->failed || ctx->root_box == NULL) {
 				ctx->cb(ctx->content, false);
 			} else {
-				ctx->content->layout = root.children;
-				ctx->content->layout->parent = NULL;
+				ctx->content->layout = ctx->root_box;
 
 				ctx->cb(ctx->content, true);
 			}
 
 			assert(ctx->n == NULL);
 
-			free(ctx);
+			box_construct_ctx_destroy(ctx);
 			return;
 		}
-	} while (++num_processed < max_processed_before_yield);
+	} while (ctx->synchronous ||
+		 ++num_processed < max_processed_before_yield);
 
 	/* More work to do: schedule a continuation */
 	guit->misc->schedule(0, (void *)convert_xml_to_box, ctx);
 }
 
 
-/* exported function documented in html/box_construct.h */
-nserror
-dom_to_box(dom_node *n,
-	   html_content *c,
-	   box_construct_complete_cb cb,
-	   void **box_conversion_context)
+/**
+ * Create a box tree construction context
+ *
+ * \param n    dom node to construct box tree from
+ * \param c    content of type CONTENT_HTML to construct box tree in
+ * \param cb   callback to report conversion completion
+ * \return construction context or NULL on memory exhaustion
+ */
+static struct box_construct_ctx *
+box_construct_ctx_create(dom_node *n,
+			 html_content *c,
+			 box_construct_complete_cb cb)
 {
 	struct box_construct_ctx *ctx;
 
-	assert(box_conversion_context != NULL);
-
 	if (c->bctx == NULL) {
 		/* create a context allocation for this box tree */
-		c->bctx = talloc_zero(0, int);
+		c->bctx = box_arena_create();
 		if (c->bctx == NULL) {
-			return NSERROR_NOMEM;
+			return NULL;
 		}
 	}
 
 	ctx = malloc(sizeof(*ctx));
 	if (ctx == NULL) {
-		return NSERROR_NOMEM;
+		return NULL;
 	}
 
 	ctx->content = c;
@@ -1303,6 +1492,33 @@ dom_to_box(dom_node *n,
 	ctx->root_box = NULL;
 	ctx->cb = cb;
 	ctx->bctx = c->bctx;
+	ctx->synchronous = false;
+	ctx->discard_node_data = c->progressive_conversion;
+	/* Failing to allocate these only makes selection slower */
+	ctx->style_cache = nscss_style_cache_create();
+	ctx->ancestors = nscss_ancestor_filter_create();
+	ctx->stop = NULL;
+	ctx->failed = false;
+
+	return ctx;
+}
+
+
+/* exported function documented in html/box_construct.h */
+nserror
+dom_to_box(dom_node *n,
+	   html_content *c,
+	   box_construct_complete_cb cb,
+	   void **box_conversion_context)
+{
+	struct box_construct_ctx *ctx;
+
+	assert(box_conversion_context != NULL);
+
+	ctx = box_construct_ctx_create(n, c, cb);
+	if (ctx == NULL) {
+		return NSERROR_NOMEM;
+	}
 
 	*box_conversion_context = ctx;
 
@@ -1310,6 +1526,151 @@ dom_to_box(dom_node *n,
 }
 
 
+/* exported function documented in html/box_construct.h */
+nserror
+dom_to_box_sync(dom_node *n, html_content *c, box_construct_complete_cb cb)
+{
+	struct box_construct_ctx *ctx;
+
+	ctx = box_construct_ctx_create(n, c, cb);
+	if (ctx == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	ctx->synchronous = true;
+	/* Cached node data may predate changes to the document */
+	ctx->discard_node_data = true;
+
+	/* The callback is invoked before this returns */
+	convert_xml_to_box(ctx);
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Discard the children of a box being reconstructed
+ *
+ * Freeing the boxes also detaches them from their DOM nodes, so
+ * construction can't find stale containing blocks.
+ *
+ * \param box  box to empty
+ */
+static void box_construct_discard_children(struct box *box)
+{
+	struct box *child, *next;
+
+	for (child = box->children; child != NULL; child = next) {
+		next = child->next;
+		box_free(child);
+	}
+
+	box->children = NULL;
+	box->last = NULL;
+}
+
+
+/* exported function documented in html/box_construct.h */
+nserror dom_to_box_update(dom_node *n, html_content *c)
+{
+	struct box_construct_ctx ctx;
+	struct box *box;
+	dom_node *node;
+	dom_exception err;
+
+	box = box_for_node(n);
+	if (box == NULL || c->layout == NULL || c->bctx == NULL) {
+		return NSERROR_BAD_PARAMETER;
+	}
+
+	assert(box->type == BOX_BLOCK || box->type == BOX_INLINE_BLOCK ||
+			box->type == BOX_TABLE_CELL);
+	assert((box->flags & IS_REPLACED) == 0);
+
+	box_construct_discard_children(box);
+
+	ctx.content = c;
+	ctx.n = NULL;
+	ctx.root_box = c->layout;
+	ctx.cb = NULL;
+	ctx.bctx = c->bctx;
+	ctx.synchronous = true;
+	/* Cached node data may predate the mutation */
+	ctx.discard_node_data = true;
+	ctx.style_cache = nscss_style_cache_create();
+	ctx.ancestors = nscss_ancestor_filter_create();
+	ctx.stop = n;
+	ctx.failed = false;
+
+	box_construct_enter_ancestors(&ctx, n);
+
+	/* Handle the :before pseudo element */
+	box_construct_generate(n, c, box,
+			box->styles->styles[CSS_PSEUDO_ELEMENT_BEFORE]);
+
+	err = dom_node_get_first_child(n, &node);
+	if (err != DOM_NO_ERR) {
+		nscss_style_cache_destroy(ctx.style_cache);
+		nscss_ancestor_filter_destroy(ctx.ancestors);
+		return NSERROR_DOM;
+	}
+
+	while (node != NULL) {
+		bool convert_children = true;
+		dom_node_type type;
+		bool ok = true;
+
+		err = dom_node_get_node_type(node, &type);
+		if (err != DOM_NO_ERR) {
+			dom_node_unref(node);
+			box_construct_discard_children(box);
+			nscss_style_cache_destroy(ctx.style_cache);
+			nscss_ancestor_filter_destroy(ctx.ancestors);
+			return NSERROR_DOM;
+		}
+
+		ctx.n = node;
+
+		if (type == DOM_ELEMENT_NODE) {
+			ok = box_construct_element(&ctx, &convert_children);
+		} else if (type == DOM_TEXT_NODE) {
+			ok = box_construct_text(&ctx);
+		}
+
+		if (ok == false) {
+			dom_node_unref(node);
+			box_construct_discard_children(box);
+			nscss_style_cache_destroy(ctx.style_cache);
+			nscss_ancestor_filter_destroy(ctx.ancestors);
+			return NSERROR_NOMEM;
+		}
+
+		node = next_node(&ctx, node, convert_children);
+	}
+
+	nscss_style_cache_destroy(ctx.style_cache);
+	nscss_ancestor_filter_destroy(ctx.ancestors);
+
+	if (ctx.failed) {
+		box_construct_discard_children(box);
+		return NSERROR_NOMEM;
+	}
+
+	/* Handle the :after pseudo element */
+	box_construct_generate(n, c, box,
+			box->styles->styles[CSS_PSEUDO_ELEMENT_AFTER]);
+
+	if (box_normalise_block(box, c->layout, c) == false) {
+		box_construct_discard_children(box);
+		return NSERROR_NOMEM;
+	}
+
+	box_mark_needs_layout(box);
+
+	return NSERROR_OK;
+}
+
+
 /* exported function documented in html/box_construct.h */
 nserror cancel_dom_to_box(void *box_conversion_context)
 {
@@ -1322,7 +1683,7 @@ nserror cancel_dom_to_box(void *box_conversion_context)
 	}
 
 	dom_node_unref(ctx->n);
-	free(ctx);
+	box_construct_ctx_destroy(ctx);
 
 	return NSERROR_OK;
 }
@@ -1343,6 +1704,45 @@ struct box *box_for_node(dom_node *n)
 }
 
 
+/* exported function documented in html/box_construct.h */
+void box_detach_nodes(struct box *box)
+{
+	struct box *child;
+
+	if (box->node != NULL && (box->flags & CLONE) == 0 &&
+			box_for_node(box->node) == box) {
+		struct box *old_box;
+
+		dom_node_set_user_data(box->node,
+				corestring_dom___ns_key_box_node_data,
+				NULL, NULL, (void *) &old_box);
+	}
+
+	for (child = box->children; child != NULL; child = child->next) {
+		box_detach_nodes(child);
+	}
+}
+
+
+/* exported function documented in html/box_construct.h */
+void box_attach_nodes(struct box *box)
+{
+	struct box *child;
+
+	if (box->node != NULL && (box->flags & CLONE) == 0) {
+		struct box *old_box;
+
+		dom_node_set_user_data(box->node,
+				corestring_dom___ns_key_box_node_data,
+				box, NULL, (void *) &old_box);
+	}
+
+	for (child = box->children; child != NULL; child = child->next) {
+		box_attach_nodes(child);
+	}
+}
+
+
 /* exported function documented in html/box_construct.h */
 bool
 box_extract_link(const html_content *content,
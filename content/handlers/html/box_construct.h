@@ -84,6 +84,36 @@
 nserror dom_to_box(struct dom_node *n, struct html_content *c, box_construct_complete_cb cb, void **box_conversion_context);
 
 
+/**
+ * Construct a box tree from a dom and html content without yielding
+ *
+ * The completion callback is called before this returns. Node data
+ * cached by earlier selection is not used, as the document may have
+ * changed since.
+ *
+ * \param n dom document
+ * \param c content of type CONTENT_HTML to construct box tree in
+ * \param cb callback to report conversion completion
+ * \return netsurf error code indicating status of call
+ */
+nserror dom_to_box_sync(struct dom_node *n, struct html_content *c, box_construct_complete_cb cb);
+
+
+/**
+ * Reconstruct the box tree below an element after its DOM subtree changed
+ *
+ * The children of the element's box are discarded and rebuilt from the
+ * current DOM, then normalised. The box is flagged as needing layout; the
+ * caller is responsible for reformatting the content.
+ *
+ * \param n element whose box is a block container and is not replaced
+ * \param c content of type CONTENT_HTML owning the box tree
+ * \return NSERROR_OK on success else appropriate error code; on failure
+ *         the box is left without children
+ */
+nserror dom_to_box_update(struct dom_node *n, struct html_content *c);
+
+
 /**
  * aborts any ongoing box construction
  */
@@ -98,6 +128,25 @@ nserror cancel_dom_to_box(void *box_conversion_context);
  */
 struct box *box_for_node(struct dom_node *node);
 
+/**
+ * Detach the boxes of a tree from their dom nodes
+ *
+ * Used before a replacement tree is constructed from the same nodes, so
+ * construction can't find boxes from the old tree.
+ *
+ * \param box root of the box tree
+ */
+void box_detach_nodes(struct box *box);
+
+/**
+ * Attach the boxes of a tree to their dom nodes
+ *
+ * Reverses box_detach_nodes().
+ *
+ * \param box root of the box tree
+ */
+void box_attach_nodes(struct box *box);
+
 /**
  * Extract a URL from a relative link, handling junk like whitespace and
  * attempting to read a real URL from "javascript:" links.
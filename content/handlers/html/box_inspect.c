@@ -53,30 +53,15 @@ enum box_walk_dir {
 #define box_is_float(box) (box->type == BOX_FLOAT_LEFT ||	\
 			   box->type == BOX_FLOAT_RIGHT)
 
-/**
- * Determine if a point lies within a box.
- *
- * \param[in]  unit_len_ctx     CSS length conversion context to use.
- * \param[in]  box         Box to consider
- * \param[in]  x           Coordinate relative to box
- * \param[in]  y           Coordinate relative to box
- * \param[out] physically  If function returning true, physically is set true
- *                         iff point is within the box's physical dimensions and
- *                         false if the point is not within the box's physical
- *                         dimensions but is in the area defined by the box's
- *                         descendants.  If function returns false, physically
- *                         is undefined.
- * \return  true if the point is within the box or a descendant box
- *
- * This is a helper function for box_at_point().
- */
-static bool
+/* Exported function documented in html/box_inspect.h */
+bool
 box_contains_point(const css_unit_ctx *unit_len_ctx,
 		   const struct box *box,
 		   int x,
 		   int y,
 		   bool *physically)
 {
+	const struct box *marker = box_get_list_marker(box);
 	css_computed_clip_rect css_rect;
 
 	if (box->style != NULL &&
@@ -84,14 +69,14 @@ box_contains_point(const css_unit_ctx *unit_len_ctx,
 	    css_computed_clip(box->style, &css_rect) == CSS_CLIP_RECT) {
 		/* We have an absolutly positioned box with a clip rect */
 		struct rect r = {
-				 .x0 = box->border[LEFT].width,
-				 .y0 = box->border[TOP].width,
-				 .x1 = box->padding[LEFT] + box->width +
-				 box->border[RIGHT].width +
-				 box->padding[RIGHT],
-				 .y1 = box->padding[TOP] + box->height +
-				 box->border[BOTTOM].width +
-				 box->padding[BOTTOM]
+				 .x0 = box->edges->border[LEFT].width,
+				 .y0 = box->edges->border[TOP].width,
+				 .x1 = box->edges->padding[LEFT] + box->width +
+				 box->edges->border[RIGHT].width +
+				 box->edges->padding[RIGHT],
+				 .y1 = box->edges->padding[TOP] + box->height +
+				 box->edges->border[BOTTOM].width +
+				 box->edges->padding[BOTTOM]
 		};
 		if (x >= r.x0 && x < r.x1 && y >= r.y0 && y < r.y1) {
 			*physically = true;
@@ -115,7 +100,7 @@ box_contains_point(const css_unit_ctx *unit_len_ctx,
 						css_rect.tunit));
 		}
 		if (css_rect.right_auto == false) {
-			r.x1 = box->border[LEFT].width +
+			r.x1 = box->edges->border[LEFT].width +
 				FIXTOINT(css_unit_len2device_px(
 						box->style,
 						unit_len_ctx,
@@ -123,7 +108,7 @@ box_contains_point(const css_unit_ctx *unit_len_ctx,
 						css_rect.runit));
 		}
 		if (css_rect.bottom_auto == false) {
-			r.y1 = box->border[TOP].width +
+			r.y1 = box->edges->border[TOP].width +
 				FIXTOINT(css_unit_len2device_px(
 						box->style,
 						unit_len_ctx,
@@ -140,29 +125,29 @@ box_contains_point(const css_unit_ctx *unit_len_ctx,
 		/* Not inside clip area */
 		return false;
 	}
-	if (x >= -box->border[LEFT].width &&
-	    x < box->padding[LEFT] + box->width +
-	    box->padding[RIGHT] + box->border[RIGHT].width &&
-	    y >= -box->border[TOP].width &&
-	    y < box->padding[TOP] + box->height +
-	    box->padding[BOTTOM] + box->border[BOTTOM].width) {
+	if (x >= -box->edges->border[LEFT].width &&
+	    x < box->edges->padding[LEFT] + box->width +
+	    box->edges->padding[RIGHT] + box->edges->border[RIGHT].width &&
+	    y >= -box->edges->border[TOP].width &&
+	    y < box->edges->padding[TOP] + box->height +
+	    box->edges->padding[BOTTOM] + box->edges->border[BOTTOM].width) {
 		*physically = true;
 		return true;
 	}
-	if (box->list_marker && box->list_marker->x - box->x <= x +
-	    box->list_marker->border[LEFT].width &&
-	    x < box->list_marker->x - box->x +
-	    box->list_marker->padding[LEFT] +
-	    box->list_marker->width +
-	    box->list_marker->border[RIGHT].width +
-	    box->list_marker->padding[RIGHT] &&
-	    box->list_marker->y - box->y <= y +
-	    box->list_marker->border[TOP].width &&
-	    y < box->list_marker->y - box->y +
-	    box->list_marker->padding[TOP] +
-	    box->list_marker->height +
-	    box->list_marker->border[BOTTOM].width +
-	    box->list_marker->padding[BOTTOM]) {
+	if (marker && marker->x - box->x <= x +
+	    marker->edges->border[LEFT].width &&
+	    x < marker->x - box->x +
+	    marker->edges->padding[LEFT] +
+	    marker->width +
+	    marker->edges->border[RIGHT].width +
+	    marker->edges->padding[RIGHT] &&
+	    marker->y - box->y <= y +
+	    marker->edges->border[TOP].width &&
+	    y < marker->y - box->y +
+	    marker->edges->padding[TOP] +
+	    marker->height +
+	    marker->edges->border[BOTTOM].width +
+	    marker->edges->padding[BOTTOM]) {
 		*physically = true;
 		return true;
 	}
@@ -400,8 +385,10 @@ box_nearer_text_box(struct box *box,
 		    int *tx, int *ty,
 		    int *nr_xd, int *nr_yd)
 {
-	int w = box->padding[LEFT] + box->width + box->padding[RIGHT];
-	int h = box->padding[TOP] + box->height + box->padding[BOTTOM];
+	int w = box->edges->padding[LEFT] + box->width +
+		box->edges->padding[RIGHT];
+	int h = box->edges->padding[TOP] + box->height +
+		box->edges->padding[BOTTOM];
 	int y1 = by + h;
 	int x1 = bx + w;
 	int yd = INT_MAX;
@@ -414,7 +401,7 @@ box_nearer_text_box(struct box *box,
 		return true;
 	}
 
-	if (box->parent->list_marker != box) {
+	if (box_get_list_marker(box->parent) != box) {
 		if (dir < 0) {
 			/* consider only those children (partly) above-left */
 			if (by <= y && bx < x) {
@@ -487,8 +474,10 @@ box_nearest_text_box(struct box *box,
 		*nr_yd = INT_MAX / 2;
 	}
 	if (box->type == BOX_INLINE_CONTAINER) {
-		int bw = box->padding[LEFT] + box->width + box->padding[RIGHT];
-		int bh = box->padding[TOP] + box->height + box->padding[BOTTOM];
+		int bw = box->edges->padding[LEFT] + box->width +
+			box->edges->padding[RIGHT];
+		int bh = box->edges->padding[TOP] + box->height +
+			box->edges->padding[BOTTOM];
 		int b_y1 = by + bh;
 		int b_x1 = bx + bw;
 		if (x >= bx && b_x1 > x && y >= by && b_y1 > y) {
@@ -500,14 +489,14 @@ box_nearest_text_box(struct box *box,
 		if (child->type == BOX_FLOAT_LEFT ||
 		    child->type == BOX_FLOAT_RIGHT) {
 			c_bx = fx + child->x -
-				scrollbar_get_offset(child->scroll_x);
+				scrollbar_get_offset(box_get_scroll_x(child));
 			c_by = fy + child->y -
-				scrollbar_get_offset(child->scroll_y);
+				scrollbar_get_offset(box_get_scroll_y(child));
 		} else {
 			c_bx = bx + child->x -
-				scrollbar_get_offset(child->scroll_x);
+				scrollbar_get_offset(box_get_scroll_x(child));
 			c_by = by + child->y -
-				scrollbar_get_offset(child->scroll_y);
+				scrollbar_get_offset(box_get_scroll_y(child));
 		}
 		if (child->float_children) {
 			c_fx = c_bx;
@@ -516,17 +505,18 @@ box_nearest_text_box(struct box *box,
 			c_fx = fx;
 			c_fy = fy;
 		}
-		if (in_box && child->text && !child->object) {
+		if (in_box && child->text && !box_get_object(child)) {
 			if (box_nearer_text_box(child,
 						c_bx, c_by, x, y, dir, nearest,
 						tx, ty, nr_xd, nr_yd))
 				return true;
 		} else {
-			if (child->list_marker) {
-				if (box_nearer_text_box(
-						child->list_marker,
-						c_bx + child->list_marker->x,
-						c_by + child->list_marker->y,
+			struct box *marker = box_get_list_marker(child);
+
+			if (marker) {
+				if (box_nearer_text_box(marker,
+						c_bx + marker->x,
+						c_by + marker->y,
 						x, y, dir, nearest,
 						tx, ty, nr_xd, nr_yd))
 					return true;
@@ -556,8 +546,8 @@ void box_coords(struct box *box, int *x, int *y)
 		} else {
 			box = box->parent;
 		}
-		*x += box->x - scrollbar_get_offset(box->scroll_x);
-		*y += box->y - scrollbar_get_offset(box->scroll_y);
+		*x += box->x - scrollbar_get_offset(box_get_scroll_x(box));
+		*y += box->y - scrollbar_get_offset(box_get_scroll_y(box));
 	}
 }
 
@@ -569,8 +559,10 @@ void box_bounds(struct box *box, struct rect *r)
 
 	box_coords(box, &r->x0, &r->y0);
 
-	width = box->padding[LEFT] + box->width + box->padding[RIGHT];
-	height = box->padding[TOP] + box->height + box->padding[BOTTOM];
+	width = box->edges->padding[LEFT] + box->width +
+		box->edges->padding[RIGHT];
+	height = box->edges->padding[TOP] + box->height +
+		box->edges->padding[BOTTOM];
 
 	r->x1 = r->x0 + width;
 	r->y1 = r->y0 + height;
@@ -593,13 +585,14 @@ box_at_point(const css_unit_ctx *unit_len_ctx,
 	while ((box = box_next_xy(box, box_x, box_y, skip_children))) {
 		if (box_contains_point(unit_len_ctx, box, x - *box_x, y - *box_y,
 				       &physically)) {
-			*box_x -= scrollbar_get_offset(box->scroll_x);
-			*box_y -= scrollbar_get_offset(box->scroll_y);
+			*box_x -= scrollbar_get_offset(box_get_scroll_x(box));
+			*box_y -= scrollbar_get_offset(box_get_scroll_y(box));
 
 			if (physically)
 				return box;
 
-			skip_children = false;
+			/* Children of a box awaiting layout aren't placed */
+			skip_children = (box->flags & DEFERRED) != 0;
 		} else {
 			skip_children = true;
 		}
@@ -665,8 +658,8 @@ void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
 		box->descendant_x1, box->descendant_y1);
 
 	fprintf(stream, "m(%i %i %i %i) ",
-		box->margin[TOP], box->margin[LEFT],
-		box->margin[BOTTOM], box->margin[RIGHT]);
+		box->edges->margin[TOP], box->edges->margin[LEFT],
+		box->edges->margin[BOTTOM], box->edges->margin[RIGHT]);
 
 	switch (box->type) {
 	case BOX_BLOCK:
@@ -690,7 +683,7 @@ void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
 		break;
 
 	case BOX_TABLE:
-		fprintf(stream, "TABLE [columns %i] ", box->columns);
+		fprintf(stream, "TABLE [columns %i] ", box_get_columns(box));
 		break;
 
 	case BOX_TABLE_ROW:
@@ -699,9 +692,9 @@ void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
 
 	case BOX_TABLE_CELL:
 		fprintf(stream, "TABLE_CELL [columns %i, start %i, rows %i] ",
-			box->columns,
-			box->start_column,
-			box->rows);
+			box_get_columns(box),
+			box_get_start_column(box),
+			box_get_rows(box));
 		break;
 
 	case BOX_TABLE_ROW_GROUP:
@@ -733,23 +726,23 @@ void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
 			(int) box->length, box->text);
 	if (box->space)
 		fprintf(stream, "space ");
-	if (box->object) {
-		fprintf(stream, "(object '%s') ",
-			nsurl_access(hlcache_handle_get_url(box->object)));
+	if (box_get_object(box)) {
+		fprintf(stream, "(object '%s') ", nsurl_access(
+				hlcache_handle_get_url(box_get_object(box))));
 	}
-	if (box->iframe) {
+	if (box_get_iframe(box)) {
 		fprintf(stream, "(iframe) ");
 	}
-	if (box->gadget)
+	if (box_get_gadget(box))
 		fprintf(stream, "(gadget) ");
 	if (style && box->style)
 		nscss_dump_computed_style(stream, box->style);
 	if (box->href)
 		fprintf(stream, " -> '%s'", nsurl_access(box->href));
-	if (box->target)
-		fprintf(stream, " |%s|", box->target);
-	if (box->title)
-		fprintf(stream, " [%s]", box->title);
+	if (box_get_target(box))
+		fprintf(stream, " |%s|", box_get_target(box));
+	if (box_get_title(box))
+		fprintf(stream, " [%s]", box_get_title(box));
 	if (box->id)
 		fprintf(stream, " ID:%s", lwc_string_data(box->id));
 	if (box->type == BOX_INLINE || box->type == BOX_INLINE_END)
@@ -760,9 +753,9 @@ void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
 		fprintf(stream, " next_float %p", box->next_float);
 	if (box->float_container)
 		fprintf(stream, " float_container %p", box->float_container);
-	if (box->col) {
+	if (box_get_col(box)) {
 		fprintf(stream, " (columns");
-		for (i = 0; i != box->columns; i++) {
+		for (i = 0; i != box_get_columns(box); i++) {
 			fprintf(stream, " (%s %s %i %i %i)",
 				((const char *[]) {
 					"UNKNOWN",
@@ -771,13 +764,14 @@ void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
 					"PERCENT",
 					"RELATIVE"
 						})
-				[box->col[i].type],
+				[box_get_col(box)[i].type],
 				((const char *[]) {
 					"normal",
 					"positioned"})
-				[box->col[i].positioned],
-				box->col[i].width,
-				box->col[i].min, box->col[i].max);
+				[box_get_col(box)[i].positioned],
+				box_get_col(box)[i].width,
+				box_get_col(box)[i].min,
+				box_get_col(box)[i].max);
 		}
 		fprintf(stream, ")");
 	}
@@ -790,11 +784,11 @@ void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
 	}
 	fprintf(stream, "\n");
 
-	if (box->list_marker) {
+	if (box_get_list_marker(box)) {
 		for (i = 0; i != depth; i++)
 			fprintf(stream, "  ");
 		fprintf(stream, "list_marker:\n");
-		box_dump(stream, box->list_marker, depth + 1, style);
+		box_dump(stream, box_get_list_marker(box), depth + 1, style);
 	}
 
 	for (c = box->children; c && c->next; c = c->next)
@@ -819,20 +813,20 @@ void box_dump(FILE *stream, struct box *box, unsigned int depth, bool style)
 /* exported interface documented in html/box.h */
 bool box_vscrollbar_present(const struct box * const box)
 {
-	return box->padding[TOP] +
+	return box->edges->padding[TOP] +
 		box->height +
-		box->padding[BOTTOM] +
-		box->border[BOTTOM].width < box->descendant_y1;
+		box->edges->padding[BOTTOM] +
+		box->edges->border[BOTTOM].width < box->descendant_y1;
 }
 
 
 /* exported interface documented in html/box.h */
 bool box_hscrollbar_present(const struct box * const box)
 {
-	return box->padding[LEFT] +
+	return box->edges->padding[LEFT] +
 		box->width +
-		box->padding[RIGHT] +
-		box->border[RIGHT].width < box->descendant_x1;
+		box->edges->padding[RIGHT] +
+		box->edges->border[RIGHT].width < box->descendant_x1;
 }
 
 
@@ -854,20 +848,20 @@ box_pick_text_box(struct html_content *html,
 		return NULL;
 
 	box = html->layout;
-	bx = box->margin[LEFT];
-	by = box->margin[TOP];
+	bx = box->edges->margin[LEFT];
+	by = box->edges->margin[TOP];
 	fx = bx;
 	fy = by;
 
 	if (!box_nearest_text_box(box, bx, by, fx, fy, x, y,
 				  dir, &text_box, &tx, &ty, &nr_xd, &nr_yd)) {
-		if (text_box && text_box->text && !text_box->object) {
-			int w = (text_box->padding[LEFT] +
+		if (text_box && text_box->text && !box_get_object(text_box)) {
+			int w = (text_box->edges->padding[LEFT] +
 				 text_box->width +
-				 text_box->padding[RIGHT]);
-			int h = (text_box->padding[TOP] +
+				 text_box->edges->padding[RIGHT]);
+			int h = (text_box->edges->padding[TOP] +
 				 text_box->height +
-				 text_box->padding[BOTTOM]);
+				 text_box->edges->padding[BOTTOM]);
 			int x1, y1;
 
 			y1 = ty + h;
@@ -43,6 +43,25 @@ void box_coords(struct box *box, int *x, int *y);
 void box_bounds(struct box *box, struct rect *r);
 
 
+/**
+ * Determine if a point lies within a box.
+ *
+ * \param[in]  unit_len_ctx     CSS length conversion context to use.
+ * \param[in]  box         Box to consider
+ * \param[in]  x           Coordinate relative to box
+ * \param[in]  y           Coordinate relative to box
+ * \param[out] physically  If function returning true, physically is set true
+ *                         iff point is within the box's physical dimensions and
+ *                         false if the point is not within the box's physical
+ *                         dimensions but is in the area defined by the box's
+ *                         descendants.  If function returns false, physically
+ *                         is undefined.
+ * \return  true if the point is within the box or a descendant box
+ */
+bool box_contains_point(const css_unit_ctx *unit_len_ctx,
+		const struct box *box, int x, int y, bool *physically);
+
+
 /**
  * Find the boxes at a point.
  *
@@ -140,4 +159,202 @@ static inline bool box_is_first_child(struct box *b)
 }
 
 
+/**
+ * Check if layout box is a strict descendant of another box.
+ *
+ * \param[in] b         Box to check.
+ * \param[in] ancestor  Possible ancestor of \a b.
+ * \return true iff \a ancestor is a parent, grandparent, etc of \a b.
+ */
+static inline bool
+box_is_descendant(const struct box *b, const struct box *ancestor)
+{
+	for (b = b->parent; b != NULL; b = b->parent) {
+		if (b == ancestor)
+			return true;
+	}
+	return false;
+}
+
+
+/**
+ * Get the link target of a box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return link target or NULL if none.
+ */
+static inline const char *box_get_target(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->target : NULL;
+}
+
+
+/**
+ * Get the title of a box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return title or NULL if none.
+ */
+static inline const char *box_get_title(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->title : NULL;
+}
+
+
+/**
+ * Get the horizontal scrollbar of a box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return scrollbar or NULL if none.
+ */
+static inline struct scrollbar *box_get_scroll_x(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->scroll_x : NULL;
+}
+
+
+/**
+ * Get the vertical scrollbar of a box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return scrollbar or NULL if none.
+ */
+static inline struct scrollbar *box_get_scroll_y(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->scroll_y : NULL;
+}
+
+
+/**
+ * Get the number of table columns a box spans.
+ *
+ * \param[in] b  Box to inspect.
+ * \return number of columns.
+ */
+static inline unsigned int box_get_columns(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->columns : 1;
+}
+
+
+/**
+ * Get the number of table rows a box spans.
+ *
+ * \param[in] b  Box to inspect.
+ * \return number of rows.
+ */
+static inline unsigned int box_get_rows(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->rows : 1;
+}
+
+
+/**
+ * Get the start column of a table cell box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return start column.
+ */
+static inline unsigned int box_get_start_column(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->start_column : 0;
+}
+
+
+/**
+ * Get the table column data of a box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return column array or NULL if none.
+ */
+static inline struct column *box_get_col(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->col : NULL;
+}
+
+
+/**
+ * Get the list marker of a box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return list marker box or NULL if none.
+ */
+static inline struct box *box_get_list_marker(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->list_marker : NULL;
+}
+
+
+/**
+ * Get the list item value of a box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return list item value.
+ */
+static inline int box_get_list_value(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->list_value : 1;
+}
+
+
+/**
+ * Get the form control of a box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return form control or NULL if none.
+ */
+static inline struct form_control *box_get_gadget(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->gadget : NULL;
+}
+
+
+/**
+ * Get the object of a box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return object or NULL if none.
+ */
+static inline struct hlcache_handle *box_get_object(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->object : NULL;
+}
+
+
+/**
+ * Get the image map name of a box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return image map name or NULL if none.
+ */
+static inline const char *box_get_usemap(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->usemap : NULL;
+}
+
+
+/**
+ * Get the object parameters of a box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return object parameters or NULL if none.
+ */
+static inline struct object_params *box_get_object_params(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->object_params : NULL;
+}
+
+
+/**
+ * Get the browser window of an iframe box.
+ *
+ * \param[in] b  Box to inspect.
+ * \return browser window or NULL if none.
+ */
+static inline struct browser_window *box_get_iframe(const struct box *b)
+{
+	return (b->ext != NULL) ? b->ext->iframe : NULL;
+}
+
+
 #endif
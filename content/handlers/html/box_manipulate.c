@@ -26,9 +26,15 @@
  */
 
 
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dom/dom.h>
+
 #include "utils/errors.h"
 #include "utils/talloc.h"
 #include "utils/nsurl.h"
+#include "utils/corestrings.h"
 #include "netsurf/types.h"
 #include "netsurf/mouse.h"
 #include "desktop/scrollbar.h"
@@ -37,16 +43,70 @@
 #include "html/form_internal.h"
 #include "html/interaction.h"
 #include "html/box.h"
+#include "html/box_inspect.h"
 #include "html/box_manipulate.h"
 
 
+/** Number of boxes in the first block of a box arena */
+#define BOX_ARENA_FIRST_BLOCK 32
+
+/** Maximum number of boxes in a box arena block */
+#define BOX_ARENA_MAX_BLOCK 1024
+
+/** Minimum size of a box arena data block */
+#define BOX_ARENA_DATA_BLOCK 8192
+
+/** Alignment of box arena data allocations other than strings */
+#define BOX_ARENA_DATA_ALIGN sizeof(void *)
+
 /**
- * Destructor for box nodes which own styles
+ * Block of boxes within a box arena
+ */
+struct box_arena_block {
+	struct box_arena_block *next; /**< Previously filled block */
+	unsigned int size; /**< Number of boxes block can hold */
+	unsigned int used; /**< Number of boxes allocated from block */
+	struct box boxes[]; /**< Box storage */
+};
+
+/**
+ * Block of text and other data within a box arena
+ */
+struct box_arena_data {
+	struct box_arena_data *next; /**< Previously filled block */
+	size_t size; /**< Number of bytes block can hold */
+	size_t used; /**< Number of bytes allocated from block */
+	union {
+		void *align; /**< Ensure data is pointer aligned */
+		char data[1]; /**< Data storage */
+	} u;
+};
+
+/**
+ * Allocation context for a box tree
+ */
+struct box_arena {
+	struct box_arena_block *blocks; /**< Block being filled, or NULL */
+	struct box_arena_data *data; /**< Data block being filled, or NULL */
+};
+
+/**
+ * Margins, padding and borders shared by every text box
  *
- * \param b The box being destroyed.
- * \return 0 to allow talloc to continue destroying the tree.
+ * Layout never sets these for text boxes, so they stay zero.
  */
-static int box_talloc_destructor(struct box *b)
+static struct box_edges box_no_edges;
+
+
+/**
+ * Release the resources held by a box
+ *
+ * Fields are cleared as they are released so a box may safely be
+ * released more than once.
+ *
+ * \param b The box to release.
+ */
+static void box_release(struct box *b)
 {
 	struct html_scrollbar_data *data;
 
@@ -56,30 +116,87 @@ static int box_talloc_destructor(struct box *b)
 	}
 
 	if (b->styles != NULL) {
-		css_select_results_destroy(b->styles);
+		if ((b->flags & STYLES_SHARED) == 0)
+			css_select_results_destroy(b->styles);
 		b->styles = NULL;
 	}
 
-	if (b->href != NULL)
+	if (b->href != NULL) {
 		nsurl_unref(b->href);
+		b->href = NULL;
+	}
 
 	if (b->id != NULL) {
 		lwc_string_unref(b->id);
+		b->id = NULL;
 	}
 
 	if (b->node != NULL) {
+		struct box *node_box = NULL;
+
+		/* Don't leave the DOM node referring to a freed box */
+		if (dom_node_get_user_data(b->node,
+				corestring_dom___ns_key_box_node_data,
+				(void *) &node_box) == DOM_NO_ERR &&
+				node_box == b) {
+			dom_node_set_user_data(b->node,
+					corestring_dom___ns_key_box_node_data,
+					NULL, NULL, (void *) &node_box);
+		}
+
 		dom_node_unref(b->node);
+		b->node = NULL;
+	}
+
+	if (b->ext == NULL)
+		return;
+
+	if (b->ext->scroll_x != NULL) {
+		data = scrollbar_get_data(b->ext->scroll_x);
+		scrollbar_destroy(b->ext->scroll_x);
+		free(data);
+		b->ext->scroll_x = NULL;
 	}
 
-	if (b->scroll_x != NULL) {
-		data = scrollbar_get_data(b->scroll_x);
-		scrollbar_destroy(b->scroll_x);
+	if (b->ext->scroll_y != NULL) {
+		data = scrollbar_get_data(b->ext->scroll_y);
+		scrollbar_destroy(b->ext->scroll_y);
 		free(data);
+		b->ext->scroll_y = NULL;
+	}
+}
+
+
+/**
+ * Destructor for box arenas
+ *
+ * Every box allocated from the arena is released in allocation order,
+ * then the blocks are freed.
+ *
+ * \param arena The box arena being destroyed.
+ * \return 0 to allow talloc to continue destroying the tree.
+ */
+static int box_arena_talloc_destructor(struct box_arena *arena)
+{
+	struct box_arena_block *block, *next_block;
+	struct box_arena_data *data, *next_data;
+	unsigned int i;
+
+	for (block = arena->blocks; block != NULL; block = next_block) {
+		next_block = block->next;
+
+		for (i = 0; i != block->used; i++) {
+			/* Clones share the resources of the box they
+			 * were cloned from */
+			if ((block->boxes[i].flags & CLONE) == 0)
+				box_release(&block->boxes[i]);
+		}
+
+		free(block);
 	}
 
-	if (b->scroll_y != NULL) {
-		data = scrollbar_get_data(b->scroll_y);
-		scrollbar_destroy(b->scroll_y);
+	for (data = arena->data; data != NULL; data = next_data) {
+		next_data = data->next;
 		free(data);
 	}
 
@@ -87,29 +204,200 @@ static int box_talloc_destructor(struct box *b)
 }
 
 
-/* Exported function documented in html/box.h */
-struct box *
-box_create(css_select_results *styles,
+/**
+ * Allocate storage for a box from a box arena
+ *
+ * \param arena  box arena to allocate from
+ * \return  uninitialised box, or NULL on memory exhaustion
+ */
+static struct box *box_arena_alloc(struct box_arena *arena)
+{
+	struct box_arena_block *block = arena->blocks;
+
+	if (block == NULL || block->used == block->size) {
+		unsigned int size = BOX_ARENA_FIRST_BLOCK;
+
+		if (block != NULL) {
+			size = block->size * 2;
+			if (size > BOX_ARENA_MAX_BLOCK)
+				size = BOX_ARENA_MAX_BLOCK;
+		}
+
+		block = malloc(sizeof(*block) + size * sizeof(struct box));
+		if (block == NULL)
+			return NULL;
+
+		block->next = arena->blocks;
+		block->size = size;
+		block->used = 0;
+		arena->blocks = block;
+	}
+
+	return &block->boxes[block->used++];
+}
+
+
+/* Exported function documented in html/box_manipulate.h */
+struct box_arena *box_arena_create(void)
+{
+	struct box_arena *arena;
+
+	arena = talloc(NULL, struct box_arena);
+	if (arena == NULL)
+		return NULL;
+
+	arena->blocks = NULL;
+	arena->data = NULL;
+
+	talloc_set_destructor(arena, box_arena_talloc_destructor);
+
+	return arena;
+}
+
+
+/**
+ * Allocate data from a box arena
+ *
+ * \param arena  box arena to allocate from
+ * \param len    number of bytes required
+ * \param align  required alignment of the allocation
+ * \return  uninitialised storage, or NULL on memory exhaustion
+ */
+static void *
+box_arena_data_alloc(struct box_arena *arena, size_t len, size_t align)
+{
+	struct box_arena_data *data = arena->data;
+	size_t offset = 0;
+	void *result;
+
+	if (data != NULL) {
+		offset = (data->used + align - 1) & ~(align - 1);
+	}
+
+	if (data == NULL || offset > data->size || data->size - offset < len) {
+		size_t size = BOX_ARENA_DATA_BLOCK;
+
+		if (len > size)
+			size = len;
+
+		data = malloc(offsetof(struct box_arena_data, u) + size);
+		if (data == NULL)
+			return NULL;
+
+		data->size = size;
+		data->used = 0;
+		offset = 0;
+
+		if (arena->data != NULL && len > BOX_ARENA_DATA_BLOCK) {
+			/* Dedicated block for a large allocation; keep
+			 * filling the current one */
+			data->next = arena->data->next;
+			arena->data->next = data;
+		} else {
+			data->next = arena->data;
+			arena->data = data;
+		}
+	}
+
+	result = data->u.data + offset;
+	data->used = offset + len;
+
+	return result;
+}
+
+
+/* Exported function documented in html/box_manipulate.h */
+char *box_arena_strdup(struct box_arena *arena, const char *s)
+{
+	size_t len = strlen(s) + 1;
+	char *result;
+
+	result = box_arena_data_alloc(arena, len, 1);
+	if (result == NULL)
+		return NULL;
+
+	memcpy(result, s, len);
+
+	return result;
+}
+
+
+/* Exported function documented in html/box_manipulate.h */
+struct box_ext *box_ensure_ext(struct box *box, struct box_arena *arena)
+{
+	struct box_ext *ext = box->ext;
+
+	if (ext != NULL)
+		return ext;
+
+	ext = box_arena_data_alloc(arena, sizeof(*ext), BOX_ARENA_DATA_ALIGN);
+	if (ext == NULL)
+		return NULL;
+
+	ext->target = NULL;
+	ext->title = NULL;
+	ext->scroll_x = ext->scroll_y = NULL;
+	ext->columns = 1;
+	ext->rows = 1;
+	ext->start_column = 0;
+	ext->col = NULL;
+	ext->list_marker = NULL;
+	ext->list_value = 1;
+	ext->gadget = NULL;
+	ext->object = NULL;
+	ext->usemap = NULL;
+	ext->object_params = NULL;
+	ext->iframe = NULL;
+	ext->breaks = NULL;
+
+	box->ext = ext;
+
+	return ext;
+}
+
+
+/* Exported function documented in html/box_manipulate.h */
+struct box *box_duplicate(const struct box *box, struct box_arena *arena)
+{
+	struct box *dup;
+
+	dup = box_arena_alloc(arena);
+	if (dup == NULL)
+		return NULL;
+
+	memcpy(dup, box, sizeof(*dup));
+
+	return dup;
+}
+
+
+/**
+ * Create a box, with or without margins, padding and borders of its own
+ *
+ * \param edges  true to allocate margins, padding and borders
+ * \return  allocated and initialised box, or NULL on memory exhaustion
+ *
+ * The other parameters are as for box_create().
+ */
+static struct box * box_create_common(css_select_results *styles,
 	   css_computed_style *style,
 	   bool style_owned,
 	   nsurl *href,
 	   const char *target,
 	   const char *title,
 	   lwc_string *id,
-	   void *context)
+	   bool edges,
+	   struct box_arena *arena)
 {
-	unsigned int i;
 	struct box *box;
 
-	box = talloc(context, struct box);
+	box = box_arena_alloc(arena);
 	if (!box) {
 		return 0;
 	}
 
-	talloc_set_destructor(box, box_talloc_destructor);
-
 	box->type = BOX_INLINE;
-	box->flags = 0;
+	box->flags = NEEDS_LAYOUT;
 	box->flags = style_owned ? (box->flags | STYLE_OWNED) : box->flags;
 	box->styles = styles;
 	box->style = style;
@@ -118,9 +406,6 @@ box_create(css_select_results *styles,
 	box->height = 0;
 	box->descendant_x0 = box->descendant_y0 = 0;
 	box->descendant_x1 = box->descendant_y1 = 0;
-	for (i = 0; i != 4; i++)
-		box->margin[i] = box->padding[i] = box->border[i].width = 0;
-	box->scroll_x = box->scroll_y = NULL;
 	box->min_width = 0;
 	box->max_width = UNKNOWN_MAX_WIDTH;
 	box->byte_offset = 0;
@@ -128,11 +413,6 @@ box_create(css_select_results *styles,
 	box->length = 0;
 	box->space = 0;
 	box->href = (href == NULL) ? NULL : nsurl_ref(href);
-	box->target = target;
-	box->title = title;
-	box->columns = 1;
-	box->rows = 1;
-	box->start_column = 0;
 	box->next = NULL;
 	box->prev = NULL;
 	box->children = NULL;
@@ -143,17 +423,70 @@ box_create(css_select_results *styles,
 	box->float_container = NULL;
 	box->next_float = NULL;
 	box->cached_place_below_level = 0;
-	box->list_value = 1;
-	box->list_marker = NULL;
-	box->col = NULL;
-	box->gadget = NULL;
-	box->usemap = NULL;
 	box->id = id;
 	box->background = NULL;
-	box->object = NULL;
-	box->object_params = NULL;
-	box->iframe = NULL;
 	box->node = NULL;
+	box->edges = &box_no_edges;
+	box->ext = NULL;
+
+	if (edges) {
+		box->edges = box_arena_data_alloc(arena, sizeof(*box->edges),
+				BOX_ARENA_DATA_ALIGN);
+		if (box->edges != NULL)
+			memset(box->edges, 0, sizeof(*box->edges));
+	}
+
+	if (box->edges == NULL || ((target != NULL || title != NULL) &&
+			box_ensure_ext(box, arena) == NULL)) {
+		/* The abandoned box stays in the arena, so it must not
+		 * release anything the caller owns */
+		box->styles = NULL;
+		box->flags &= ~STYLE_OWNED;
+		box->id = NULL;
+		if (box->href != NULL) {
+			nsurl_unref(box->href);
+			box->href = NULL;
+		}
+		return 0;
+	}
+
+	if (box->ext != NULL) {
+		box->ext->target = target;
+		box->ext->title = title;
+	}
+
+	return box;
+}
+
+
+/* Exported function documented in html/box.h */
+struct box * box_create(css_select_results *styles,
+	   css_computed_style *style,
+	   bool style_owned,
+	   nsurl *href,
+	   const char *target,
+	   const char *title,
+	   lwc_string *id,
+	   struct box_arena *arena)
+{
+	return box_create_common(styles, style, style_owned, href, target,
+			title, id, true, arena);
+}
+
+
+/* Exported function documented in html/box_manipulate.h */
+struct box * box_create_text(css_computed_style *style,
+		nsurl *href,
+		const char *target,
+		const char *title,
+		struct box_arena *arena)
+{
+	struct box *box;
+
+	box = box_create_common(NULL, style, false, href, target, title,
+			NULL, false, arena);
+	if (box != NULL)
+		box->type = BOX_TEXT;
 
 	return box;
 }
@@ -175,6 +508,8 @@ void box_add_child(struct box *parent, struct box *child)
 
 	parent->last = child;
 	child->parent = parent;
+
+	box_mark_needs_layout(child);
 }
 
 
@@ -189,6 +524,8 @@ void box_insert_sibling(struct box *box, struct box *new_box)
 		new_box->next->prev = new_box;
 	else if (new_box->parent)
 		new_box->parent->last = new_box;
+
+	box_mark_needs_layout(new_box);
 }
 
 
@@ -204,6 +541,7 @@ void box_unlink_and_free(struct box *box)
 			parent->children = next;
 		if (parent->last == box)
 			parent->last = next ? next : prev;
+		box_mark_needs_layout(parent);
 	}
 
 	if (prev)
@@ -215,6 +553,23 @@ void box_unlink_and_free(struct box *box)
 }
 
 
+/* Exported function documented in html/box_manipulate.h */
+void box_mark_needs_layout(struct box *box)
+{
+	box->flags |= NEEDS_LAYOUT;
+	box->max_width = UNKNOWN_MAX_WIDTH;
+
+	/* The ancestors of a marked box are always marked, so stop at the
+	 * first which is.  The cached minimum and maximum widths of each
+	 * ancestor may depend on the change too. */
+	for (box = box->parent; box != NULL && !(box->flags & NEEDS_LAYOUT);
+			box = box->parent) {
+		box->flags |= NEEDS_LAYOUT;
+		box->max_width = UNKNOWN_MAX_WIDTH;
+	}
+}
+
+
 /* Exported function documented in html/box.h */
 void box_free(struct box *box)
 {
@@ -235,17 +590,14 @@ void box_free(struct box *box)
 void box_free_box(struct box *box)
 {
 	if (!(box->flags & CLONE)) {
-		if (box->gadget)
-			form_free_control(box->gadget);
-		if (box->scroll_x != NULL)
-			scrollbar_destroy(box->scroll_x);
-		if (box->scroll_y != NULL)
-			scrollbar_destroy(box->scroll_y);
-		if (box->styles != NULL)
-			css_select_results_destroy(box->styles);
+		if (box_get_gadget(box) != NULL) {
+			form_free_control(box->ext->gadget);
+			box->ext->gadget = NULL;
+		}
+		box_release(box);
 	}
 
-	talloc_free(box);
+	/* The storage itself is reclaimed along with the box arena */
 }
 
 
@@ -257,42 +609,50 @@ box_handle_scrollbars(struct content *c,
 		      bool right)
 {
 	struct html_scrollbar_data *data;
+	struct box_ext *ext;
 	int visible_width, visible_height;
 	int full_width, full_height;
 	nserror res;
 
-	if (!bottom && box->scroll_x != NULL) {
-		data = scrollbar_get_data(box->scroll_x);
-		scrollbar_destroy(box->scroll_x);
+	if (!bottom && box_get_scroll_x(box) != NULL) {
+		data = scrollbar_get_data(box->ext->scroll_x);
+		scrollbar_destroy(box->ext->scroll_x);
 		free(data);
-		box->scroll_x = NULL;
+		box->ext->scroll_x = NULL;
 	}
 
-	if (!right && box->scroll_y != NULL) {
-		data = scrollbar_get_data(box->scroll_y);
-		scrollbar_destroy(box->scroll_y);
+	if (!right && box_get_scroll_y(box) != NULL) {
+		data = scrollbar_get_data(box->ext->scroll_y);
+		scrollbar_destroy(box->ext->scroll_y);
 		free(data);
-		box->scroll_y = NULL;
+		box->ext->scroll_y = NULL;
 	}
 
 	if (!bottom && !right) {
 		return NSERROR_OK;
 	}
 
-	visible_width = box->width + box->padding[RIGHT] + box->padding[LEFT];
-	visible_height = box->height + box->padding[TOP] + box->padding[BOTTOM];
+	ext = box_ensure_ext(box, ((html_content *) c)->bctx);
+	if (ext == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	visible_width = box->width + box->edges->padding[RIGHT] +
+		box->edges->padding[LEFT];
+	visible_height = box->height + box->edges->padding[TOP] +
+		box->edges->padding[BOTTOM];
 
-	full_width = ((box->descendant_x1 - box->border[RIGHT].width) >
-			visible_width) ?
-			box->descendant_x1 + box->padding[RIGHT] :
+	full_width = ((box->descendant_x1 -
+			box->edges->border[RIGHT].width) > visible_width) ?
+			box->descendant_x1 + box->edges->padding[RIGHT] :
 			visible_width;
-	full_height = ((box->descendant_y1 - box->border[BOTTOM].width) >
-			visible_height) ?
-			box->descendant_y1 + box->padding[BOTTOM] :
+	full_height = ((box->descendant_y1 -
+			box->edges->border[BOTTOM].width) > visible_height) ?
+			box->descendant_y1 + box->edges->padding[BOTTOM] :
 			visible_height;
 
 	if (right) {
-		if (box->scroll_y == NULL) {
+		if (ext->scroll_y == NULL) {
 			data = malloc(sizeof(struct html_scrollbar_data));
 			if (data == NULL) {
 				return NSERROR_NOMEM;
@@ -305,19 +665,19 @@ box_handle_scrollbars(struct content *c,
 					       visible_height,
 					       data,
 					       html_overflow_scroll_callback,
-					       &(box->scroll_y));
+					       &(ext->scroll_y));
 			if (res != NSERROR_OK) {
 				return res;
 			}
 		} else  {
-			scrollbar_set_extents(box->scroll_y,
+			scrollbar_set_extents(ext->scroll_y,
 					      visible_height,
 					      visible_height,
 					      full_height);
 		}
 	}
 	if (bottom) {
-		if (box->scroll_x == NULL) {
+		if (ext->scroll_x == NULL) {
 			data = malloc(sizeof(struct html_scrollbar_data));
 			if (data == NULL) {
 				return NSERROR_OK;
@@ -330,12 +690,12 @@ box_handle_scrollbars(struct content *c,
 					       visible_width,
 					       data,
 					       html_overflow_scroll_callback,
-					       &box->scroll_x);
+					       &ext->scroll_x);
 			if (res != NSERROR_OK) {
 				return res;
 			}
 		} else {
-			scrollbar_set_extents(box->scroll_x,
+			scrollbar_set_extents(ext->scroll_x,
 					visible_width -
 					(right ? SCROLLBAR_WIDTH : 0),
 					visible_width, full_width);
@@ -343,7 +703,7 @@ box_handle_scrollbars(struct content *c,
 	}
 
 	if (right && bottom) {
-		scrollbar_make_pair(box->scroll_x, box->scroll_y);
+		scrollbar_make_pair(ext->scroll_x, ext->scroll_y);
 	}
 
 	return NSERROR_OK;
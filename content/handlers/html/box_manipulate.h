@@ -25,6 +25,56 @@
 #ifndef NETSURF_HTML_BOX_MANIPULATE_H
 #define NETSURF_HTML_BOX_MANIPULATE_H
 
+struct box_arena;
+
+/**
+ * Create an allocation context for a box tree.
+ *
+ * Boxes are carved from blocks owned by the arena rather than being
+ * allocated individually, and are released together when the arena is
+ * freed with talloc_free(). The arena may also be used as the talloc
+ * context for other allocations belonging to the box tree.
+ *
+ * \return  new box arena, or NULL on memory exhaustion
+ */
+struct box_arena *box_arena_create(void);
+
+
+/**
+ * Copy a string into a box arena.
+ *
+ * The copy lives as long as the arena and must not be freed or
+ * reallocated with talloc.
+ *
+ * \param  arena  box arena to allocate from
+ * \param  s      string to copy
+ * \return  copy of the string, or NULL on memory exhaustion
+ */
+char *box_arena_strdup(struct box_arena *arena, const char *s);
+
+
+/**
+ * Copy a box within a box arena.
+ *
+ * The copy shares all resources with the original box, so it must be
+ * flagged as a CLONE by the caller.
+ *
+ * \param  box    box to copy
+ * \param  arena  box arena to allocate from
+ * \return  copy of the box, or NULL on memory exhaustion
+ */
+struct box *box_duplicate(const struct box *box, struct box_arena *arena);
+
+
+/**
+ * Get the extension data of a box, creating it if necessary.
+ *
+ * \param  box    box to get extension data for
+ * \param  arena  box arena the box was allocated from
+ * \return  extension data, or NULL on memory exhaustion
+ */
+struct box_ext *box_ensure_ext(struct box *box, struct box_arena *arena);
+
 
 /**
  * Create a box tree node.
@@ -36,13 +86,29 @@
  * \param  target       target for the box (not copied), or 0
  * \param  title        title for the box (not copied), or 0
  * \param  id           id for the box (not copied), or 0
- * \param  context      context for allocations
+ * \param  arena        box arena to allocate from
  * \return  allocated and initialised box, or 0 on memory exhaustion
  *
  * styles is always owned by the box, if it is set.
  * style is only owned by the box in the case of implied boxes.
  */
-struct box * box_create(css_select_results *styles, css_computed_style *style, bool style_owned, struct nsurl *href, const char *target, const char *title, lwc_string *id, void *context);
+struct box * box_create(css_select_results *styles, css_computed_style *style, bool style_owned, struct nsurl *href, const char *target, const char *title, lwc_string *id, struct box_arena *arena);
+
+
+/**
+ * Create a text box.
+ *
+ * Text boxes have no margins, padding or borders, so they share an empty
+ * set rather than each having their own.
+ *
+ * \param  style   computed style for the box (not copied), or 0
+ * \param  href    href for the box (copied), or 0
+ * \param  target  target for the box (not copied), or 0
+ * \param  title   title for the box (not copied), or 0
+ * \param  arena   box arena to allocate from
+ * \return  allocated and initialised box, or 0 on memory exhaustion
+ */
+struct box *box_create_text(css_computed_style *style, struct nsurl *href, const char *target, const char *title, struct box_arena *arena);
 
 
 /**
@@ -71,6 +137,22 @@ void box_insert_sibling(struct box *box, struct box *new_box);
 void box_unlink_and_free(struct box *box);
 
 
+/**
+ * Mark a box and all its ancestors as needing layout.
+ *
+ * Layout may keep the previous geometry and minimum and maximum widths of
+ * subtrees which are not marked, so this must be called whenever a change
+ * to a box would alter the layout of its contents.
+ *
+ * A marked box's ancestors are always marked, so marking stops at the
+ * first ancestor which already is.  New boxes start marked, so building
+ * a subtree costs nothing until it is attached to the laid out tree.
+ *
+ * \param box box which has changed
+ */
+void box_mark_needs_layout(struct box *box);
+
+
 /**
  * Free a box tree recursively.
  *
@@ -84,6 +166,8 @@ void box_free(struct box *box);
 /**
  * Free the data in a single box structure.
  *
+ * The box's storage remains part of its arena until the arena is freed.
+ *
  * \param box box to free
  */
 void box_free_box(struct box *box);
@@ -35,6 +35,7 @@
 #include "html/private.h"
 #include "html/table.h"
 #include "html/box.h"
+#include "html/box_inspect.h"
 #include "html/box_manipulate.h"
 #include "html/box_normalise.h"
 
@@ -156,6 +157,7 @@ box_normalise_table_row(struct box *row,
 	struct box *cell = NULL;
 	css_computed_style *style;
 	unsigned int i;
+	unsigned int start_column;
 	nscss_select_ctx ctx;
 
 	assert(row != NULL);
@@ -172,8 +174,10 @@ box_normalise_table_row(struct box *row,
 
 		switch (child->type) {
 		case BOX_TABLE_CELL:
-			/* ok */
-			if (box_normalise_block(child, root, c) == false)
+			/* ok; cells for elements were normalised on
+			 * construction */
+			if (child->node == NULL &&
+					box_normalise_block(child, root, c) == false)
 				return false;
 			cell = child;
 			break;
@@ -196,7 +200,8 @@ box_normalise_table_row(struct box *row,
 				return false;
 
 			cell = box_create(NULL, style, true, row->href,
-					row->target, NULL, NULL, c->bctx);
+					box_get_target(row), NULL, NULL,
+					c->bctx);
 			if (cell == NULL) {
 				css_computed_style_destroy(style);
 				return false;
@@ -251,9 +256,16 @@ box_normalise_table_row(struct box *row,
 			assert(0);
 		}
 
-		if (calculate_table_row(col_info, cell->columns, cell->rows,
-				&cell->start_column, cell) == false)
+		if (calculate_table_row(col_info, box_get_columns(cell),
+				box_get_rows(cell), &start_column,
+				cell) == false)
 			return false;
+
+		if (start_column != box_get_start_column(cell)) {
+			if (box_ensure_ext(cell, c->bctx) == NULL)
+				return false;
+			cell->ext->start_column = start_column;
+		}
 	}
 
 
@@ -333,7 +345,8 @@ box_normalise_table_row_group(struct box *row_group,
 				return false;
 
 			row = box_create(NULL, style, true, row_group->href,
-					row_group->target, NULL, NULL, c->bctx);
+					box_get_target(row_group), NULL, NULL,
+					c->bctx);
 			if (row == NULL) {
 				css_computed_style_destroy(style);
 				return false;
@@ -411,7 +424,7 @@ box_normalise_table_row_group(struct box *row_group,
 		}
 
 		row = box_create(NULL, style, true, row_group->href,
-				row_group->target, NULL, NULL, c->bctx);
+				box_get_target(row_group), NULL, NULL, c->bctx);
 		if (row == NULL) {
 			css_computed_style_destroy(style);
 			return false;
@@ -427,7 +440,9 @@ box_normalise_table_row_group(struct box *row_group,
 		col_info->num_rows++;
 	}
 
-	row_group->rows = group_row_count;
+	if (box_ensure_ext(row_group, c->bctx) == NULL)
+		return false;
+	row_group->ext->rows = group_row_count;
 
 #ifdef BOX_NORMALISE_DEBUG
 	NSLOG(netsurf, INFO, "row_group %p done", row_group);
@@ -443,7 +458,8 @@ box_normalise_table_row_group(struct box *row_group,
  *
  * \param table  Table to process
  * \param root   root box of document
- * \param spans  Array of length table->columns for use in empty cell detection
+ * \param spans  Array with an entry per table column for use in empty cell
+ *               detection
  * \param c      Content containing table
  * \return True on success, false on memory exhaustion.
  */
@@ -456,15 +472,16 @@ box_normalise_table_spans(struct box *table,
 	struct box *table_row_group;
 	struct box *table_row;
 	struct box *table_cell;
-	unsigned int rows_left = table->rows;
+	unsigned int rows_left = box_get_rows(table);
 	unsigned int group_rows_left;
+	unsigned int start_column;
 	unsigned int col;
 	nscss_select_ctx ctx;
 
 	ctx.root_style = root->style;
 
 	/* Clear span data */
-	memset(spans, 0, table->columns * sizeof(struct span_info));
+	memset(spans, 0, box_get_columns(table) * sizeof(struct span_info));
 
 	/* Scan table, filling in width and height of table cells with
 	 * colspan = 0 and rowspan = 0. Also generate empty cells */
@@ -472,7 +489,7 @@ box_normalise_table_spans(struct box *table,
 	     table_row_group != NULL;
 	     table_row_group = table_row_group->next) {
 
-		group_rows_left = table_row_group->rows;
+		group_rows_left = box_get_rows(table_row_group);
 
 		for (table_row = table_row_group->children;
 		     table_row != NULL;
@@ -483,33 +500,37 @@ box_normalise_table_spans(struct box *table,
 			     table_cell = table_cell->next) {
 
 				/* colspan = 0 -> colspan = 1 */
-				if (table_cell->columns == 0) {
-					table_cell->columns = 1;
+				if (box_get_columns(table_cell) == 0) {
+					table_cell->ext->columns = 1;
 				}
 
 				/* if rowspan is 0 it is expanded to
 				 * the number of rows left in the row
 				 * group
 				 */
-				if (table_cell->rows == 0) {
-					table_cell->rows = group_rows_left;
-				}
-
-				/* limit rowspans within group */
-				if (table_cell->rows > group_rows_left) {
-					table_cell->rows = group_rows_left;
+				if (box_get_rows(table_cell) == 0 ||
+						box_get_rows(table_cell) >
+						group_rows_left) {
+					/* limit rowspans within group */
+					if (box_ensure_ext(table_cell,
+							c->bctx) == NULL)
+						return false;
+					table_cell->ext->rows = group_rows_left;
 				}
 
 				/* Record span information */
-				for (col = table_cell->start_column;
-						col < table_cell->start_column +
-						table_cell->columns; col++) {
-					spans[col].row_span = table_cell->rows;
+				start_column = box_get_start_column(table_cell);
+				for (col = start_column;
+						col < start_column +
+						box_get_columns(table_cell);
+						col++) {
+					spans[col].row_span =
+						box_get_rows(table_cell);
 				}
 			}
 
 			/* Reduce span count of each column */
-			for (col = 0; col < table->columns; col++) {
+			for (col = 0; col < box_get_columns(table); col++) {
 				if (spans[col].row_span == 0) {
 					unsigned int start = col;
 					css_computed_style *style;
@@ -523,7 +544,7 @@ box_normalise_table_spans(struct box *table,
 					assert(table_row->style != NULL);
 
 					/* Find width of gap */
-					while (col < table->columns &&
+					while (col < box_get_columns(table) &&
 							spans[col].row_span ==
 							0) {
 						col++;
@@ -543,7 +564,7 @@ box_normalise_table_spans(struct box *table,
 
 					cell = box_create(NULL, style, true,
 							table_row->href,
-							table_row->target,
+							box_get_target(table_row),
 							NULL, NULL, c->bctx);
 					if (cell == NULL) {
 						css_computed_style_destroy(
@@ -552,16 +573,19 @@ box_normalise_table_spans(struct box *table,
 					}
 					cell->type = BOX_TABLE_CELL;
 
-					cell->rows = 1;
-					cell->columns = col - start;
-					cell->start_column = start;
+					if (box_ensure_ext(cell, c->bctx) ==
+							NULL)
+						return false;
+					cell->ext->rows = 1;
+					cell->ext->columns = col - start;
+					cell->ext->start_column = start;
 
 					/* Find place to insert cell */
 					for (prev = table_row->children;
 							prev != NULL;
 							prev = prev->next) {
-						if (prev->start_column +
-							prev->columns ==
+						if (box_get_start_column(prev) +
+							box_get_columns(prev) ==
 								start)
 							break;
 						if (prev->next == NULL)
@@ -607,8 +631,9 @@ box_normalise_table_spans(struct box *table,
 }
 
 
-static bool
-box_normalise_table(struct box *table, const struct box *root, html_content * c)
+/* Exported function documented in html/box_normalise.h */
+bool
+box_normalise_table(struct box *table, const struct box *root, html_content *c)
 {
 	struct box *child;
 	struct box *next_child;
@@ -669,7 +694,8 @@ box_normalise_table(struct box *table, const struct box *root, html_content * c)
 			}
 
 			row_group = box_create(NULL, style, true, table->href,
-					table->target, NULL, NULL, c->bctx);
+					box_get_target(table), NULL, NULL,
+					c->bctx);
 			if (row_group == NULL) {
 				css_computed_style_destroy(style);
 				free(col_info.spans);
@@ -731,8 +757,12 @@ box_normalise_table(struct box *table, const struct box *root, html_content * c)
 		}
 	}
 
-	table->columns = col_info.num_columns;
-	table->rows = col_info.num_rows;
+	if (box_ensure_ext(table, c->bctx) == NULL) {
+		free(col_info.spans);
+		return false;
+	}
+	table->ext->columns = col_info.num_columns;
+	table->ext->rows = col_info.num_rows;
 
 	if (table->children == NULL) {
 		struct box *row;
@@ -757,7 +787,7 @@ box_normalise_table(struct box *table, const struct box *root, html_content * c)
 		}
 
 		row_group = box_create(NULL, style, true, table->href,
-				table->target, NULL, NULL, c->bctx);
+				box_get_target(table), NULL, NULL, c->bctx);
 		if (row_group == NULL) {
 			css_computed_style_destroy(style);
 			free(col_info.spans);
@@ -774,7 +804,7 @@ box_normalise_table(struct box *table, const struct box *root, html_content * c)
 		}
 
 		row = box_create(NULL, style, true, row_group->href,
-				row_group->target, NULL, NULL, c->bctx);
+				box_get_target(row_group), NULL, NULL, c->bctx);
 		if (row == NULL) {
 			css_computed_style_destroy(style);
 			box_free(row_group);
@@ -789,7 +819,7 @@ box_normalise_table(struct box *table, const struct box *root, html_content * c)
 		row_group->parent = table;
 		table->children = table->last = row_group;
 
-		table->rows = 1;
+		table->ext->rows = 1;
 	}
 
 	if (box_normalise_table_spans(table, root, col_info.spans, c) == false) {
@@ -807,88 +837,6 @@ box_normalise_table(struct box *table, const struct box *root, html_content * c)
 }
 
 
-static bool
-box_normalise_inline_container(struct box *cont,
-			       const struct box *root,
-			       html_content * c)
-{
-	struct box *child;
-	struct box *next_child;
-
-	assert(cont != NULL);
-	assert(cont->type == BOX_INLINE_CONTAINER);
-
-#ifdef BOX_NORMALISE_DEBUG
-	NSLOG(netsurf, INFO, "cont %p", cont);
-#endif
-
-	for (child = cont->children; child != NULL; child = next_child) {
-		next_child = child->next;
-		switch (child->type) {
-		case BOX_INLINE:
-		case BOX_INLINE_END:
-		case BOX_BR:
-		case BOX_TEXT:
-			/* ok */
-			break;
-		case BOX_INLINE_BLOCK:
-			/* ok */
-			if (box_normalise_block(child, root, c) == false)
-				return false;
-			break;
-		case BOX_FLOAT_LEFT:
-		case BOX_FLOAT_RIGHT:
-			/* ok */
-			assert(child->children != NULL);
-
-			switch (child->children->type) {
-			case BOX_BLOCK:
-				if (box_normalise_block(child->children, root,
-						c) == false)
-					return false;
-				break;
-			case BOX_TABLE:
-				if (box_normalise_table(child->children, root,
-						c) == false)
-					return false;
-				break;
-			default:
-				assert(0);
-			}
-
-			if (child->children == NULL) {
-				/* the child has destroyed itself: remove float */
-				if (child->prev == NULL)
-					child->parent->children = child->next;
-				else
-					child->prev->next = child->next;
-				if (child->next != NULL)
-					child->next->prev = child->prev;
-				else
-					child->parent->last = child->prev;
-
-				box_free(child);
-			}
-			break;
-		case BOX_BLOCK:
-		case BOX_INLINE_CONTAINER:
-		case BOX_TABLE:
-		case BOX_TABLE_ROW_GROUP:
-		case BOX_TABLE_ROW:
-		case BOX_TABLE_CELL:
-		default:
-			assert(0);
-		}
-	}
-
-#ifdef BOX_NORMALISE_DEBUG
-	NSLOG(netsurf, INFO, "cont %p done", cont);
-#endif
-
-	return true;
-}
-
-
 /* Exported function documented in html/box_normalise.h */
 bool
 box_normalise_block(struct box *block, const struct box *root, html_content *c)
@@ -921,16 +869,19 @@ box_normalise_block(struct box *block, const struct box *root, html_content *c)
 
 		switch (child->type) {
 		case BOX_BLOCK:
-			/* ok */
-			if (box_normalise_block(child, root, c) == false)
+			/* ok; blocks for elements were normalised on
+			 * construction, leaving generated content */
+			if (child->node == NULL &&
+					box_normalise_block(child, root, c) == false)
 				return false;
 			break;
 		case BOX_INLINE_CONTAINER:
-			if (box_normalise_inline_container(child, root, c) == false)
-				return false;
+			/* ok; inline blocks and floats within were
+			 * normalised on construction */
 			break;
 		case BOX_TABLE:
-			if (box_normalise_table(child, root, c) == false)
+			if (child->node == NULL &&
+					box_normalise_table(child, root, c) == false)
 				return false;
 			break;
 		case BOX_INLINE:
@@ -961,7 +912,8 @@ box_normalise_block(struct box *block, const struct box *root, html_content *c)
 				return false;
 
 			table = box_create(NULL, style, true, block->href,
-					block->target, NULL, NULL, c->bctx);
+					box_get_target(block), NULL, NULL,
+					c->bctx);
 			if (table == NULL) {
 				css_computed_style_destroy(style);
 				return false;
@@ -34,13 +34,19 @@
  * FLOAT_(LEFT|RIGHT)   exactly 1 BLOCK or TABLE
  * \endcode
  *
+ * Box construction normalises the box for each element as soon as the
+ * element's children have been constructed, so the tree is normalised as
+ * it is built. Each call therefore only repairs the children of the box
+ * it is given, together with any anonymous boxes, and assumes the boxes
+ * of descendant elements are already normalised.
  */
 
 #ifndef NETSURF_HTML_BOX_NORMALISE_H
 #define NETSURF_HTML_BOX_NORMALISE_H
 
 /**
- * Ensure the box tree is correctly nested by adding and removing nodes.
+ * Ensure the children of a block container are correctly nested by
+ * adding anonymous boxes.
  *
  * \param block  box of type BLOCK, INLINE_BLOCK, or TABLE_CELL
  * \param root   root box of document
@@ -62,4 +68,15 @@
  */
 bool box_normalise_block(struct box *block, const struct box *root, struct html_content *c);
 
+/**
+ * Ensure a table's rows and cells are correctly nested by adding anonymous
+ * boxes, and compute its row and column counts.
+ *
+ * \param table  box of type TABLE
+ * \param root   root box of document
+ * \param c      content of boxes
+ * \return true on success, false on memory exhaustion
+ */
+bool box_normalise_table(struct box *table, const struct box *root, struct html_content *c);
+
 #endif
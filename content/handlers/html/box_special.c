@@ -47,6 +47,7 @@
 #include "html/private.h"
 #include "html/object.h"
 #include "html/box.h"
+#include "html/box_inspect.h"
 #include "html/box_manipulate.h"
 #include "html/box_construct.h"
 #include "html/box_special.h"
@@ -550,6 +551,35 @@ box_get_attribute(dom_node *n,
 }
 
 
+/**
+ * Set a box's image map from the element's usemap attribute.
+ *
+ * \param  n        dom element node
+ * \param  content  html content
+ * \param  box      box to set image map of
+ * \return  true on success, false on memory exhaustion
+ */
+static bool
+box_extract_usemap(dom_node *n, html_content *content, struct box *box)
+{
+	char *usemap = NULL;
+	struct box_ext *ext;
+
+	if (!box_get_attribute(n, "usemap", content->bctx, &usemap))
+		return false;
+	if (usemap == NULL)
+		return true;
+
+	ext = box_ensure_ext(box, content->bctx);
+	if (ext == NULL)
+		return false;
+
+	ext->usemap = (usemap[0] == '#') ? usemap + 1 : usemap;
+
+	return true;
+}
+
+
 /**
  * Helper function for adding textarea widget to box.
  *
@@ -567,7 +597,8 @@ box_input_text(html_content *html, struct box *box, struct dom_node *node)
 	if (!inline_container)
 		return false;
 	inline_container->type = BOX_INLINE_CONTAINER;
-	inline_box = box_create(NULL, box->style, false, 0, 0, box->title, 0,
+	inline_box = box_create(NULL, box->style, false, 0, 0,
+		box_get_title(box), 0,
 			html->bctx);
 	if (!inline_box)
 		return false;
@@ -715,26 +746,32 @@ box_a(dom_node *n,
 	/* target frame [16.3] */
 	err = dom_element_get_attribute(n, corestring_dom_target, &s);
 	if (err == DOM_NO_ERR && s != NULL) {
+		struct box_ext *ext = box_ensure_ext(box, content->bctx);
+		if (ext == NULL) {
+			dom_string_unref(s);
+			return false;
+		}
+
 		if (dom_string_caseless_lwc_isequal(s,
 				corestring_lwc__blank))
-			box->target = "_blank";
+			ext->target = "_blank";
 		else if (dom_string_caseless_lwc_isequal(s,
 				corestring_lwc__top))
-			box->target = "_top";
+			ext->target = "_top";
 		else if (dom_string_caseless_lwc_isequal(s,
 				corestring_lwc__parent))
-			box->target = "_parent";
+			ext->target = "_parent";
 		else if (dom_string_caseless_lwc_isequal(s,
 				corestring_lwc__self))
 			/* the default may have been overridden by a
 			 * <base target=...>, so this is different to 0 */
-			box->target = "_self";
+			ext->target = "_self";
 		else {
 			/* 6.16 says that frame names must begin with [a-zA-Z]
 			 * This doesn't match reality, so just take anything */
-			box->target = talloc_strdup(content->bctx,
+			ext->target = talloc_strdup(content->bctx,
 					dom_string_data(s));
-			if (!box->target) {
+			if (!ext->target) {
 				dom_string_unref(s);
 				return false;
 			}
@@ -793,12 +830,15 @@ box_button(dom_node *n,
 {
 	struct form_control *gadget;
 
+	if (box_ensure_ext(box, content->bctx) == NULL)
+		return false;
+
 	gadget = html_forms_get_control_for_node(content->forms, n);
 	if (!gadget)
 		return false;
 
 	gadget->html = content;
-	box->gadget = gadget;
+	box->ext->gadget = gadget;
 	box->flags |= IS_REPLACED;
 	gadget->box = box;
 
@@ -963,7 +1003,9 @@ box_embed(dom_node *n,
 
 	dom_namednodemap_unref(attrs);
 
-	box->object_params = params;
+	if (box_ensure_ext(box, content->bctx) == NULL)
+		return false;
+	box->ext->object_params = params;
 
 	/* start fetch */
 	box->flags |= IS_REPLACED;
@@ -1064,6 +1106,12 @@ box_iframe(dom_node *n,
 
 	talloc_set_destructor(iframe, box_iframes_talloc_destructor);
 
+	/* The browser window is attached to the box once it exists */
+	if (box_ensure_ext(box, content->bctx) == NULL) {
+		talloc_free(iframe);
+		return false;
+	}
+
 	iframe->box = box;
 	iframe->margin_width = 0;
 	iframe->margin_height = 0;
@@ -1177,10 +1225,8 @@ box_image(dom_node *n,
 	}
 
 	/* imagemap associated with this image */
-	if (!box_get_attribute(n, "usemap", content->bctx, &box->usemap))
+	if (!box_extract_usemap(n, content, box))
 		return false;
-	if (box->usemap && box->usemap[0] == '#')
-		box->usemap++;
 
 	/* get image URL */
 	err = dom_element_get_attribute(n, corestring_dom_src, &s);
@@ -1233,12 +1279,15 @@ box_input(dom_node *n,
 	nsurl *url;
 	nserror error;
 
+	if (box_ensure_ext(box, content->bctx) == NULL)
+		return false;
+
 	gadget = html_forms_get_control_for_node(content->forms, n);
 	if (gadget == NULL) {
 		return false;
 	}
 
-	box->gadget = gadget;
+	box->ext->gadget = gadget;
 	box->flags |= IS_REPLACED;
 	gadget->box = box;
 	gadget->html = content;
@@ -1290,19 +1339,19 @@ box_input(dom_node *n,
 		inline_container->type = BOX_INLINE_CONTAINER;
 
 		inline_box = box_create(NULL, box->style, false, 0, 0,
-				box->title, 0, content->bctx);
+				box_get_title(box), 0, content->bctx);
 		if (inline_box == NULL)
 			goto no_memory;
 
 		inline_box->type = BOX_TEXT;
 
-		if (box->gadget->value != NULL)
+		if (box_get_gadget(box)->value != NULL)
 			inline_box->text = talloc_strdup(content->bctx,
-					box->gadget->value);
-		else if (box->gadget->type == GADGET_SUBMIT)
+					box_get_gadget(box)->value);
+		else if (box_get_gadget(box)->type == GADGET_SUBMIT)
 			inline_box->text = talloc_strdup(content->bctx,
 					messages_get("Form_Submit"));
-		else if (box->gadget->type == GADGET_RESET)
+		else if (box_get_gadget(box)->type == GADGET_RESET)
 			inline_box->text = talloc_strdup(content->bctx,
 					messages_get("Form_Reset"));
 		else
@@ -1409,11 +1458,8 @@ box_object(dom_node *n,
 	    ns_computed_display(box->style, box_is_root(n)) == CSS_DISPLAY_NONE)
 		return true;
 
-	if (box_get_attribute(n, "usemap", content->bctx, &box->usemap) ==
-			false)
+	if (box_extract_usemap(n, content, box) == false)
 		return false;
-	if (box->usemap && box->usemap[0] == '#')
-		box->usemap++;
 
 	params = talloc(content->bctx, struct object_params);
 	if (params == NULL)
@@ -1617,7 +1663,9 @@ box_object(dom_node *n,
 		c = next;
 	}
 
-	box->object_params = params;
+	if (box_ensure_ext(box, content->bctx) == NULL)
+		return false;
+	box->ext->object_params = params;
 
 	/* start fetch (MIME type is ok or not specified) */
 	box->flags |= IS_REPLACED;
@@ -1663,6 +1711,9 @@ box_select(dom_node *n,
 	dom_node *next, *next2;
 	dom_exception err;
 
+	if (box_ensure_ext(box, content->bctx) == NULL)
+		return false;
+
 	gadget = html_forms_get_control_for_node(content->forms, n);
 	if (gadget == NULL)
 		return false;
@@ -1763,7 +1814,7 @@ box_select(dom_node *n,
 	}
 
 	box->type = BOX_INLINE_BLOCK;
-	box->gadget = gadget;
+	box->ext->gadget = gadget;
 	box->flags |= IS_REPLACED;
 	gadget->box = box;
 
@@ -1771,7 +1822,8 @@ box_select(dom_node *n,
 	if (inline_container == NULL)
 		goto no_memory;
 	inline_container->type = BOX_INLINE_CONTAINER;
-	inline_box = box_create(NULL, box->style, false, 0, 0, box->title, 0,
+	inline_box = box_create(NULL, box->style, false, 0, 0,
+		box_get_title(box), 0,
 			content->bctx);
 	if (inline_box == NULL)
 		goto no_memory;
@@ -1820,13 +1872,16 @@ static bool box_textarea(dom_node *n,
 			bool *convert_children)
 {
 	/* Get the form_control for the DOM node */
-	box->gadget = html_forms_get_control_for_node(content->forms, n);
-	if (box->gadget == NULL)
+	if (box_ensure_ext(box, content->bctx) == NULL)
+		return false;
+
+	box->ext->gadget = html_forms_get_control_for_node(content->forms, n);
+	if (box->ext->gadget == NULL)
 		return false;
 
 	box->flags |= IS_REPLACED;
-	box->gadget->html = content;
-	box->gadget->box = box;
+	box->ext->gadget->html = content;
+	box->ext->gadget->box = box;
 
 	if (!box_input_text(content, box, n))
 		return false;
@@ -1857,6 +1912,28 @@ convert_special_elements(dom_node *node,
 		tag_type = DOM_HTML_ELEMENT_TYPE__UNKNOWN;
 	}
 
+	if (content->progressive_conversion) {
+		/* Provisional box trees have no objects, frames or form
+		 * gadgets; leave such elements as empty boxes until the
+		 * document has finished loading. */
+		switch (tag_type) {
+		case DOM_HTML_ELEMENT_TYPE_BUTTON:
+		case DOM_HTML_ELEMENT_TYPE_CANVAS:
+		case DOM_HTML_ELEMENT_TYPE_EMBED:
+		case DOM_HTML_ELEMENT_TYPE_FRAMESET:
+		case DOM_HTML_ELEMENT_TYPE_IFRAME:
+		case DOM_HTML_ELEMENT_TYPE_INPUT:
+		case DOM_HTML_ELEMENT_TYPE_OBJECT:
+		case DOM_HTML_ELEMENT_TYPE_SELECT:
+		case DOM_HTML_ELEMENT_TYPE_TEXTAREA:
+			*convert_children = false;
+			return true;
+
+		default:
+			break;
+		}
+	}
+
 	switch (tag_type) {
 	case DOM_HTML_ELEMENT_TYPE_A:
 		res =  box_a(node, content, box, convert_children);
@@ -42,9 +42,9 @@
 
 nserror box_textarea_keypress(html_content *html, struct box *box, uint32_t key)
 {
-	struct form_control *gadget = box->gadget;
+	struct form_control *gadget = box_get_gadget(box);
 	struct textarea *ta = gadget->data.text.ta;
-	struct form* form = box->gadget->form;
+	struct form* form = box_get_gadget(box)->form;
 	struct content *c = (struct content *)html;
 	nserror res = NSERROR_OK;
 
@@ -271,7 +271,7 @@ bool box_textarea_create_textarea(html_content *html,
 	};
 	bool read_only = false;
 	bool disabled = false;
-	struct form_control *gadget = box->gadget;
+	struct form_control *gadget = box_get_gadget(box);
 	const char *text;
 
 	assert(gadget != NULL);
@@ -48,6 +48,37 @@ static nsurl *html_adblock_stylesheet_url;
 static nsurl *html_quirks_stylesheet_url;
 static nsurl *html_user_stylesheet_url;
 
+/**
+ * A stylesheet in a shared selection context
+ */
+struct html_css_select_sheet {
+	const css_stylesheet *sheet;	/**< libcss stylesheet */
+	css_origin origin;		/**< Origin it was added with */
+};
+
+/**
+ * A selection context shared by documents with the same stylesheets
+ *
+ * Documents loaded from the same site usually fetch the same shared
+ * stylesheet contents, so their contexts would be identical. Each
+ * document holds a reference; the sheets are kept alive by the
+ * documents themselves, so a context is destroyed as soon as its last
+ * document lets go of it and its key can never refer to a freed sheet.
+ */
+struct html_css_select_entry {
+	struct html_css_select_entry *next; /**< Next shared context */
+	unsigned int refcount;		/**< Documents using the context */
+	css_select_ctx *select_ctx;	/**< libcss selection context */
+	uint32_t sheet_count;		/**< Number of entries in sheets */
+	struct html_css_select_sheet sheets[]; /**< Sheets, in order */
+};
+
+/** Shared selection contexts */
+static struct html_css_select_entry *html_css_select_entries;
+
+/** Selection context statistics */
+static struct html_css_select_stats html_css_select_stats;
+
 /**
  * Convert css error to netsurf error.
  */
@@ -643,26 +674,53 @@ nserror html_css_new_stylesheets(html_content *c)
 }
 
 
+/**
+ * Check whether two selection contexts are for the same stylesheets
+ *
+ * \param a  first context
+ * \param b  second context
+ * \return true if both have the same sheets in the same order
+ */
+static bool
+html_css_select_entry_match(const struct html_css_select_entry *a,
+		const struct html_css_select_entry *b)
+{
+	uint32_t i;
+
+	if (a->sheet_count != b->sheet_count)
+		return false;
+
+	for (i = 0; i != a->sheet_count; i++) {
+		if (a->sheets[i].sheet != b->sheets[i].sheet ||
+				a->sheets[i].origin != b->sheets[i].origin)
+			return false;
+	}
+
+	return true;
+}
+
+
 /* exported function documented in html/css.h */
 nserror
 html_css_new_selection_context(html_content *c, css_select_ctx **ret_select_ctx)
 {
 	uint32_t i;
 	css_error css_ret;
-	css_select_ctx *select_ctx;
+	struct html_css_select_entry *entry, *shared;
+	uint32_t sheet_count = 0;
 
 	/* check that the base stylesheet loaded; layout fails without it */
 	if (c->stylesheets[STYLESHEET_BASE].sheet == NULL) {
 		return NSERROR_CSS_BASE;
 	}
 
-	/* Create selection context */
-	css_ret = css_select_ctx_create(&select_ctx);
-	if (css_ret != CSS_OK) {
-		return css_error_to_nserror(css_ret);
+	entry = malloc(sizeof(*entry) + (c->stylesheet_count - STYLESHEET_BASE) *
+			sizeof(struct html_css_select_sheet));
+	if (entry == NULL) {
+		return NSERROR_NOMEM;
 	}
 
-	/* Add sheets to it */
+	/* Determine the sheets to select with */
 	for (i = STYLESHEET_BASE; i != c->stylesheet_count; i++) {
 		const struct html_stylesheet *hsheet = &c->stylesheets[i];
 		css_stylesheet *sheet = NULL;
@@ -687,26 +745,104 @@ html_css_new_selection_context(html_content *c, css_select_ctx **ret_select_ctx)
 		}
 
 		if (sheet != NULL) {
-			/* TODO: Pass the sheet's full media query, instead of
-			 *       "screen".
-			 */
-			css_ret = css_select_ctx_append_sheet(select_ctx,
-							      sheet,
-							      origin,
-							      "screen");
-			if (css_ret != CSS_OK) {
-				css_select_ctx_destroy(select_ctx);
-				return css_error_to_nserror(css_ret);
-			}
+			entry->sheets[sheet_count].sheet = sheet;
+			entry->sheets[sheet_count].origin = origin;
+			sheet_count++;
+		}
+	}
+	entry->sheet_count = sheet_count;
+
+	/* Share an existing context for the same sheets, if any */
+	for (shared = html_css_select_entries; shared != NULL;
+			shared = shared->next) {
+		if (html_css_select_entry_match(shared, entry)) {
+			free(entry);
+			shared->refcount++;
+			html_css_select_stats.reused++;
+			*ret_select_ctx = shared->select_ctx;
+			return NSERROR_OK;
 		}
 	}
 
+	/* Create selection context */
+	css_ret = css_select_ctx_create(&entry->select_ctx);
+	if (css_ret != CSS_OK) {
+		free(entry);
+		return css_error_to_nserror(css_ret);
+	}
+
+	/* Add sheets to it */
+	for (i = 0; i != sheet_count; i++) {
+		/* TODO: Pass the sheet's full media query, instead of
+		 *       "screen".
+		 */
+		css_ret = css_select_ctx_append_sheet(entry->select_ctx,
+						      entry->sheets[i].sheet,
+						      entry->sheets[i].origin,
+						      "screen");
+		if (css_ret != CSS_OK) {
+			css_select_ctx_destroy(entry->select_ctx);
+			free(entry);
+			return css_error_to_nserror(css_ret);
+		}
+	}
+
+	entry->refcount = 1;
+	entry->next = html_css_select_entries;
+	html_css_select_entries = entry;
+
+	html_css_select_stats.created++;
+	html_css_select_stats.live++;
+
 	/* return new selection context to caller */
-	*ret_select_ctx = select_ctx;
+	*ret_select_ctx = entry->select_ctx;
 	return NSERROR_OK;
 }
 
 
+/* exported function documented in html/css.h */
+void html_css_release_selection_context(css_select_ctx *select_ctx)
+{
+	struct html_css_select_entry **prev = &html_css_select_entries;
+	struct html_css_select_entry *entry;
+
+	for (entry = html_css_select_entries; entry != NULL;
+			entry = entry->next) {
+		if (entry->select_ctx == select_ctx)
+			break;
+		prev = &entry->next;
+	}
+
+	assert(entry != NULL);
+	if (entry == NULL)
+		return;
+
+	if (--entry->refcount > 0)
+		return;
+
+	*prev = entry->next;
+	css_select_ctx_destroy(entry->select_ctx);
+	free(entry);
+
+	html_css_select_stats.live--;
+}
+
+
+/* exported function documented in html/css.h */
+void html_css_get_select_stats(struct html_css_select_stats *stats)
+{
+	const struct html_css_select_entry *entry;
+
+	*stats = html_css_select_stats;
+	stats->users = 0;
+
+	for (entry = html_css_select_entries; entry != NULL;
+			entry = entry->next) {
+		stats->users += entry->refcount;
+	}
+}
+
+
 /* exported function documented in html/css.h */
 nserror html_css_init(void)
 {
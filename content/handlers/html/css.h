@@ -37,14 +37,41 @@ nserror html_css_init(void);
 void html_css_fini(void);
 
 /**
- * create a new css selection context for an html content.
+ * get a css selection context for an html content.
+ *
+ * Documents with the same stylesheets share one context; release it
+ * with html_css_release_selection_context().
  *
  * \param c The html content to create css selction on.
- * \param select_ctx A pointer to receive the new context.
+ * \param select_ctx A pointer to receive the context.
  * \return NSERROR_OK on success and \a select_ctx updated else error code
  */
 nserror html_css_new_selection_context(struct html_content *c, css_select_ctx **select_ctx);
 
+/**
+ * release a css selection context.
+ *
+ * \param select_ctx context obtained from html_css_new_selection_context()
+ */
+void html_css_release_selection_context(css_select_ctx *select_ctx);
+
+/**
+ * Selection context statistics
+ */
+struct html_css_select_stats {
+	unsigned int created; /**< Contexts built since startup */
+	unsigned int reused; /**< Times an existing context was shared */
+	unsigned int live; /**< Contexts currently in use */
+	unsigned int users; /**< Documents using the live contexts */
+};
+
+/**
+ * get css selection context statistics.
+ *
+ * \param stats updated with the statistics
+ */
+void html_css_get_select_stats(struct html_css_select_stats *stats);
+
 /**
  * Initialise core stylesheets for a content
  *
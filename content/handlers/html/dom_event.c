@@ -32,6 +32,7 @@
 #include "utils/string.h"
 #include "utils/nsurl.h"
 #include "content/content.h"
+#include "css/select.h"
 #include "javascript/js.h"
 
 #include "netsurf/bitmap.h"
@@ -40,6 +41,7 @@
 #include "html/object.h"
 #include "html/css.h"
 #include "html/box.h"
+#include "html/box_inspect.h"
 #include "html/box_construct.h"
 #include "html/form_internal.h"
 #include "html/dom_event.h"
@@ -568,10 +570,10 @@ static void html_texty_element_update(html_content *htmlc, dom_node *node)
 	if (box == NULL) {
 		return; /* No Box (yet?) so no gadget to update */
 	}
-	if (box->gadget == NULL) {
+	if (box_get_gadget(box) == NULL) {
 		return; /* No gadget yet (under construction perhaps?) */
 	}
-	form_gadget_sync_with_dom(box->gadget);
+	form_gadget_sync_with_dom(box_get_gadget(box));
 	/* And schedule a redraw for the box */
 	html__redraw_a_box(htmlc, box);
 }
@@ -735,9 +737,40 @@ dom_default_action_DOMSubtreeModified_cb(struct dom_event *evt, void *pw)
 			case DOM_HTML_ELEMENT_TYPE_TEXTAREA:
 			case DOM_HTML_ELEMENT_TYPE_INPUT:
 				html_texty_element_update(htmlc, (dom_node *)node);
+				break;
 			default:
+				/* children changed; bring the boxes up to date */
+				html__dom_mutated(htmlc, (dom_node *)node, false);
 				break;
 			}
+		} else if (exc == DOM_NO_ERR && type == DOM_TEXT_NODE) {
+			html__dom_mutated(htmlc, (dom_node *)node, false);
+		}
+		dom_node_unref(node);
+	}
+}
+
+
+/**
+ * callback for DOMAttrModified end type
+ */
+static void
+dom_default_action_DOMAttrModified_cb(struct dom_event *evt, void *pw)
+{
+	dom_event_target *node;
+	dom_node_type type;
+	dom_exception exc;
+	html_content *htmlc = pw;
+
+	exc = dom_event_get_target(evt, &node);
+	if ((exc == DOM_NO_ERR) && (node != NULL)) {
+		exc = dom_node_get_node_type(node, &type);
+		if ((exc == DOM_NO_ERR) && (type == DOM_ELEMENT_NODE)) {
+			/* the id cached for selection may be stale */
+			nscss_node_attributes_changed((dom_node *)node);
+
+			/* attributes may change the element's own style */
+			html__dom_mutated(htmlc, (dom_node *)node, true);
 		}
 		dom_node_unref(node);
 	}
@@ -773,6 +806,8 @@ html_dom_event_fetcher(dom_string *type,
 			return dom_default_action_DOMNodeInsertedIntoDocument_cb;
 		} else if (dom_string_isequal(type, corestring_dom_DOMSubtreeModified)) {
 			return dom_default_action_DOMSubtreeModified_cb;
+		} else if (dom_string_isequal(type, corestring_dom_DOMAttrModified)) {
+			return dom_default_action_DOMAttrModified_cb;
 		}
 	} else if (phase == DOM_DEFAULT_ACTION_FINISHED) {
 		return dom_default_action_finished_cb;
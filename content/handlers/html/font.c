@@ -22,9 +22,17 @@
  * HTML internal font handling implementation.
  */
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/errors.h"
 #include "utils/nsoption.h"
 #include "netsurf/plot_style.h"
+#include "netsurf/layout.h"
 #include "css/utils.h"
+#include "desktop/gui_internal.h"
 
 #include "html/font.h"
 
@@ -163,3 +171,441 @@ void font_plot_style_from_css(
 	fstyle->foreground = nscss_color_to_ns(col);
 	fstyle->background = 0;
 }
+
+
+/** Number of entries in the measurement cache; must be a power of two */
+#define FONT_CACHE_SIZE 2048
+
+/** Length of the longest string whose measurements are cached */
+#define FONT_CACHE_TEXT_MAX 32
+
+/** Number of font families a cached style may have */
+#define FONT_CACHE_FAMILIES 4
+
+/** Cache entry flag: width is valid */
+#define FONT_CACHE_WIDTH (1 << 0)
+/** Cache entry flag: position result is valid */
+#define FONT_CACHE_POSITION (1 << 1)
+/** Cache entry flag: split result is valid */
+#define FONT_CACHE_SPLIT (1 << 2)
+
+/**
+ * Result of a frontend call which finds an offset for an x coordinate.
+ */
+struct font_cache_offset {
+	int x; /**< x coordinate searched for */
+	size_t char_offset; /**< offset found */
+	int actual_x; /**< x coordinate of offset */
+};
+
+/**
+ * Measurements of a string in a font style, as made by the frontend.
+ *
+ * The position and split results are only for the last x coordinate
+ * searched for, which is usually the same from one layout to the next.
+ */
+struct font_cache_entry {
+	/** Font families, NULL terminated unless all are used */
+	lwc_string *families[FONT_CACHE_FAMILIES];
+	plot_font_generic_family_t family; /**< Generic family */
+	plot_style_fixed size; /**< Font size */
+	int weight; /**< Font weight */
+	plot_font_flags_t flags; /**< Font flags */
+	unsigned int valid; /**< Which measurements are valid */
+	int width; /**< Measured width of text */
+	struct font_cache_offset position; /**< Last position result */
+	struct font_cache_offset split; /**< Last split result */
+	size_t length; /**< Length of text, or 0 if entry is unused */
+	char text[FONT_CACHE_TEXT_MAX]; /**< Measured text */
+};
+
+/** Measurement cache, allocated on first use */
+static struct font_cache_entry *font_cache;
+
+/** Font options the cached widths were measured with */
+static struct {
+	char *sans;
+	char *serif;
+	char *mono;
+	char *cursive;
+	char *fantasy;
+	int font_default;
+} font_cache_options;
+
+/** Number of times the font options have changed */
+static unsigned int font_cache_generation;
+
+
+/**
+ * Release the contents of a measurement cache entry.
+ *
+ * \param entry  entry to release
+ */
+static void font_cache_entry_release(struct font_cache_entry *entry)
+{
+	int i;
+
+	for (i = 0; i < FONT_CACHE_FAMILIES; i++) {
+		if (entry->families[i] == NULL)
+			break;
+		lwc_string_unref(entry->families[i]);
+		entry->families[i] = NULL;
+	}
+	entry->valid = 0;
+	entry->length = 0;
+}
+
+
+/**
+ * Empty the measurement cache.
+ */
+static void font_cache_flush(void)
+{
+	unsigned int i;
+
+	if (font_cache == NULL)
+		return;
+
+	for (i = 0; i < FONT_CACHE_SIZE; i++) {
+		font_cache_entry_release(&font_cache[i]);
+	}
+}
+
+
+/**
+ * Find the measurement cache entry for a string in a font style.
+ *
+ * \param fstyle  font style of text
+ * \param string  UTF-8 text
+ * \param length  length of text in bytes
+ * \return entry the string would be cached in, or NULL if it can't be
+ */
+static struct font_cache_entry *
+font_cache_find(const plot_font_style_t *fstyle,
+		const char *string,
+		size_t length)
+{
+	uint32_t hash = 0x811c9dc5;
+	size_t i;
+
+	if (length == 0 || length > FONT_CACHE_TEXT_MAX)
+		return NULL;
+
+	if (font_cache == NULL) {
+		font_cache = calloc(FONT_CACHE_SIZE, sizeof(*font_cache));
+		if (font_cache == NULL)
+			return NULL;
+	}
+
+	/* Family names are interned, so their addresses identify them */
+	if (fstyle->families != NULL) {
+		for (i = 0; fstyle->families[i] != NULL; i++) {
+			if (i == FONT_CACHE_FAMILIES)
+				return NULL;
+			hash = (hash ^ (uintptr_t) fstyle->families[i]) *
+					0x01000193;
+		}
+	}
+
+	hash = (hash ^ fstyle->family) * 0x01000193;
+	hash = (hash ^ fstyle->size) * 0x01000193;
+	hash = (hash ^ fstyle->weight) * 0x01000193;
+	hash = (hash ^ fstyle->flags) * 0x01000193;
+	for (i = 0; i < length; i++) {
+		hash = (hash ^ (uint8_t) string[i]) * 0x01000193;
+	}
+
+	return &font_cache[hash & (FONT_CACHE_SIZE - 1)];
+}
+
+
+/**
+ * Check whether a measurement cache entry holds a string in a font style.
+ *
+ * \param entry   entry to check
+ * \param fstyle  font style of text
+ * \param string  UTF-8 text
+ * \param length  length of text in bytes
+ * \return true if the entry matches
+ */
+static bool
+font_cache_entry_matches(const struct font_cache_entry *entry,
+		const plot_font_style_t *fstyle,
+		const char *string,
+		size_t length)
+{
+	int i;
+
+	if (entry->length != length ||
+			entry->family != fstyle->family ||
+			entry->size != fstyle->size ||
+			entry->weight != fstyle->weight ||
+			entry->flags != fstyle->flags ||
+			memcmp(entry->text, string, length) != 0)
+		return false;
+
+	for (i = 0; i < FONT_CACHE_FAMILIES; i++) {
+		lwc_string *family = NULL;
+
+		if (fstyle->families != NULL)
+			family = fstyle->families[i];
+		if (entry->families[i] != family)
+			return false;
+		if (family == NULL)
+			break;
+	}
+
+	return true;
+}
+
+
+/**
+ * Get the cache entry for a string in a font style.
+ *
+ * An entry holding anything else is emptied and given the string.
+ *
+ * \param fstyle  font style of text
+ * \param string  UTF-8 text
+ * \param length  length of text in bytes
+ * \return entry for the string, or NULL if it can't be cached
+ */
+static struct font_cache_entry *
+font_cache_get(const plot_font_style_t *fstyle,
+		const char *string,
+		size_t length)
+{
+	struct font_cache_entry *entry;
+	int i;
+
+	entry = font_cache_find(fstyle, string, length);
+	if (entry == NULL ||
+			font_cache_entry_matches(entry, fstyle, string, length))
+		return entry;
+
+	font_cache_entry_release(entry);
+	for (i = 0; fstyle->families != NULL &&
+			fstyle->families[i] != NULL; i++) {
+		entry->families[i] = lwc_string_ref(fstyle->families[i]);
+	}
+	entry->family = fstyle->family;
+	entry->size = fstyle->size;
+	entry->weight = fstyle->weight;
+	entry->flags = fstyle->flags;
+	entry->length = length;
+	memcpy(entry->text, string, length);
+
+	return entry;
+}
+
+
+/**
+ * Measure the width of a string, using the cache where possible.
+ *
+ * \param fstyle  font style of text
+ * \param string  UTF-8 text
+ * \param length  length of text in bytes
+ * \param width   updated to width of text
+ * \return NSERROR_OK and width updated or appropriate error code
+ */
+static nserror
+font_cache_width(const plot_font_style_t *fstyle,
+		const char *string,
+		size_t length,
+		int *width)
+{
+	struct font_cache_entry *entry;
+	nserror res;
+
+	entry = font_cache_get(fstyle, string, length);
+	if (entry == NULL)
+		return guit->layout->width(fstyle, string, length, width);
+
+	if (entry->valid & FONT_CACHE_WIDTH) {
+		*width = entry->width;
+		return NSERROR_OK;
+	}
+
+	res = guit->layout->width(fstyle, string, length, width);
+	if (res != NSERROR_OK)
+		return res;
+
+	entry->width = *width;
+	entry->valid |= FONT_CACHE_WIDTH;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Find the position in a string where an x coordinate falls, using the
+ * cache where possible.
+ *
+ * \param fstyle       font style of text
+ * \param string       UTF-8 text
+ * \param length       length of text in bytes
+ * \param x            coordinate to search for
+ * \param char_offset  updated to offset in string of actual_x
+ * \param actual_x     updated to x coordinate of character closest to x
+ * \return NSERROR_OK and results updated or appropriate error code
+ */
+static nserror
+font_cache_position(const plot_font_style_t *fstyle,
+		const char *string,
+		size_t length,
+		int x,
+		size_t *char_offset,
+		int *actual_x)
+{
+	struct font_cache_entry *entry;
+	nserror res;
+
+	entry = font_cache_get(fstyle, string, length);
+	if (entry == NULL)
+		return guit->layout->position(fstyle, string, length, x,
+				char_offset, actual_x);
+
+	if ((entry->valid & FONT_CACHE_POSITION) && entry->position.x == x) {
+		*char_offset = entry->position.char_offset;
+		*actual_x = entry->position.actual_x;
+		return NSERROR_OK;
+	}
+
+	res = guit->layout->position(fstyle, string, length, x,
+			char_offset, actual_x);
+	if (res != NSERROR_OK)
+		return res;
+
+	entry->position.x = x;
+	entry->position.char_offset = *char_offset;
+	entry->position.actual_x = *actual_x;
+	entry->valid |= FONT_CACHE_POSITION;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Find where to split a string to make it fit a width, using the cache
+ * where possible.
+ *
+ * \param fstyle       font style of text
+ * \param string       UTF-8 text
+ * \param length       length of text in bytes
+ * \param x            width available
+ * \param char_offset  updated to offset in string of actual_x
+ * \param actual_x     updated to x coordinate of character closest to x
+ * \return NSERROR_OK and results updated or appropriate error code
+ */
+static nserror
+font_cache_split(const plot_font_style_t *fstyle,
+		const char *string,
+		size_t length,
+		int x,
+		size_t *char_offset,
+		int *actual_x)
+{
+	struct font_cache_entry *entry;
+	nserror res;
+
+	entry = font_cache_get(fstyle, string, length);
+	if (entry == NULL)
+		return guit->layout->split(fstyle, string, length, x,
+				char_offset, actual_x);
+
+	if ((entry->valid & FONT_CACHE_SPLIT) && entry->split.x == x) {
+		*char_offset = entry->split.char_offset;
+		*actual_x = entry->split.actual_x;
+		return NSERROR_OK;
+	}
+
+	res = guit->layout->split(fstyle, string, length, x,
+			char_offset, actual_x);
+	if (res != NSERROR_OK)
+		return res;
+
+	entry->split.x = x;
+	entry->split.char_offset = *char_offset;
+	entry->split.actual_x = *actual_x;
+	entry->valid |= FONT_CACHE_SPLIT;
+
+	return NSERROR_OK;
+}
+
+
+static const struct gui_layout_table font_cache_table = {
+	.width = font_cache_width,
+	.position = font_cache_position,
+	.split = font_cache_split,
+};
+
+/* exported interface documented in html/font.h */
+const struct gui_layout_table *font_cache_layout = &font_cache_table;
+
+
+/**
+ * Check whether a font option string has changed, keeping a copy.
+ *
+ * \param copy    copy of the previous value, updated on change
+ * \param option  current value of the option
+ * \return true if the option has changed
+ */
+static bool font_cache_option_changed(char **copy, const char *option)
+{
+	if (*copy == NULL && option == NULL)
+		return false;
+	if (*copy != NULL && option != NULL && strcmp(*copy, option) == 0)
+		return false;
+
+	free(*copy);
+	*copy = (option != NULL) ? strdup(option) : NULL;
+	return true;
+}
+
+
+/* exported function documented in html/font.h */
+bool font_cache_validate(unsigned int *generation)
+{
+	bool changed = false;
+
+	/* Evaluate every option so that all the copies are updated */
+	changed |= font_cache_option_changed(&font_cache_options.sans,
+			nsoption_charp(font_sans));
+	changed |= font_cache_option_changed(&font_cache_options.serif,
+			nsoption_charp(font_serif));
+	changed |= font_cache_option_changed(&font_cache_options.mono,
+			nsoption_charp(font_mono));
+	changed |= font_cache_option_changed(&font_cache_options.cursive,
+			nsoption_charp(font_cursive));
+	changed |= font_cache_option_changed(&font_cache_options.fantasy,
+			nsoption_charp(font_fantasy));
+	if (font_cache_options.font_default != nsoption_int(font_default)) {
+		font_cache_options.font_default = nsoption_int(font_default);
+		changed = true;
+	}
+
+	if (changed) {
+		font_cache_flush();
+		font_cache_generation++;
+	}
+
+	changed = (*generation != font_cache_generation);
+	*generation = font_cache_generation;
+
+	return changed;
+}
+
+
+/* exported function documented in html/font.h */
+void font_cache_fini(void)
+{
+	font_cache_flush();
+	free(font_cache);
+	font_cache = NULL;
+
+	free(font_cache_options.sans);
+	free(font_cache_options.serif);
+	free(font_cache_options.mono);
+	free(font_cache_options.cursive);
+	free(font_cache_options.fantasy);
+	memset(&font_cache_options, 0, sizeof(font_cache_options));
+}
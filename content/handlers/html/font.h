@@ -28,6 +28,16 @@
 #define NETSURF_HTML_FONT_H
 
 struct plot_font_style;
+struct gui_layout_table;
+
+/**
+ * Layout table which remembers the measurements of short strings.
+ *
+ * Widths, and the last position and split found in each string, are
+ * remembered. Measuring is passed on to the frontend's layout table, so
+ * this may be used in its place wherever text is measured repeatedly.
+ */
+extern const struct gui_layout_table *font_cache_layout;
 
 /**
  * Populate a font style using data from a computed CSS style
@@ -40,4 +50,20 @@ void font_plot_style_from_css(const css_unit_ctx *unit_len_ctx,
 			      const css_computed_style *css,
 			      struct plot_font_style *fstyle);
 
+/**
+ * Discard remembered string widths if the font options have changed.
+ *
+ * Call before a layout, as frontends may change font options at any time.
+ *
+ * \param generation  font options generation the caller last measured
+ *                    text with, updated to the current one
+ * \return true if the font options have changed since \a generation
+ */
+bool font_cache_validate(unsigned int *generation);
+
+/**
+ * Discard all remembered string widths and release their storage.
+ */
+void font_cache_fini(void);
+
 #endif
@@ -56,6 +56,7 @@
 #include "html/layout.h"
 #include "html/box.h"
 #include "html/box_inspect.h"
+#include "html/box_manipulate.h"
 #include "html/font.h"
 #include "html/form_internal.h"
 
@@ -1382,6 +1383,7 @@ form__select_process_selection(html_content *html,
 		inline_box->length = strlen(inline_box->text);
 	}
 	inline_box->width = control->box->width;
+	box_mark_needs_layout(inline_box);
 
 	html__redraw_a_box(html, control->box);
 
@@ -1591,8 +1593,10 @@ form_open_select_menu(void *client_data,
 		box = control->box;
 
 		menu->width = box->width +
-			box->border[RIGHT].width + box->padding[RIGHT] +
-			box->border[LEFT].width + box->padding[LEFT];
+			box->edges->border[RIGHT].width +
+			box->edges->padding[RIGHT] +
+			box->edges->border[LEFT].width +
+			box->edges->padding[LEFT];
 
 		font_plot_style_from_css(&html->unit_len_ctx,
 				control->box->style, &fstyle);
@@ -1756,7 +1760,8 @@ form_redraw_select_menu(struct form_control *control,
 	item_y -= line_height_with_spacing;
 	text_pos_offset = y - scroll +
 			(int) (line_height * (0.75 + SELECT_LINE_SPACING));
-	text_x = x + (box->border[LEFT].width + box->padding[LEFT]) * scale;
+	text_x = x + (box->edges->border[LEFT].width +
+		box->edges->padding[LEFT]) * scale;
 
 	plot_fstyle_entry.size = menu->f_size;
 
@@ -1933,9 +1938,9 @@ form_select_mouse_drag_end(struct form_control *control,
 
 	/* Get global coords of scrollbar */
 	box_coords(box, &box_x, &box_y);
-	box_x -= box->border[LEFT].width;
-	box_y += box->height + box->border[BOTTOM].width +
-			box->padding[BOTTOM] + box->padding[TOP];
+	box_x -= box->edges->border[LEFT].width;
+	box_y += box->height + box->edges->border[BOTTOM].width +
+			box->edges->padding[BOTTOM] + box->edges->padding[TOP];
 
 	/* Get drag end coords relative to scrollbar */
 	x = x - box_x;
@@ -1980,10 +1985,10 @@ void form_select_menu_callback(void *client_data,
 	box = html->visible_select_menu->box;
 	box_coords(box, &menu_x, &menu_y);
 
-	menu_x -= box->border[LEFT].width;
-	menu_y += box->height + box->border[BOTTOM].width +
-			box->padding[BOTTOM] +
-			box->padding[TOP];
+	menu_x -= box->edges->border[LEFT].width;
+	menu_y += box->height + box->edges->border[BOTTOM].width +
+			box->edges->padding[BOTTOM] +
+			box->edges->padding[TOP];
 	content__request_redraw((struct content *)html, menu_x + x, menu_y + y,
 			width, height);
 }
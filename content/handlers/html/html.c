@@ -23,6 +23,7 @@
  */
 
 #include <assert.h>
+#include <limits.h>
 #include <stdint.h>
 #include <string.h>
 #include <strings.h>
@@ -47,6 +48,7 @@
 #include "netsurf/keypress.h"
 #include "netsurf/layout.h"
 #include "netsurf/misc.h"
+#include "netsurf/inttypes.h"
 #include "content/hlcache.h"
 #include "content/content_factory.h"
 #include "content/textsearch.h"
@@ -56,6 +58,8 @@
 #include "netsurf/bitmap.h"
 #include "javascript/js.h"
 #include "desktop/gui_internal.h"
+#include "desktop/browser_private.h"
+#include "desktop/frames.h"
 
 #include "html/html.h"
 #include "html/private.h"
@@ -70,10 +74,28 @@
 #include "html/form_internal.h"
 #include "html/imagemap.h"
 #include "html/layout.h"
+#include "html/font.h"
 #include "html/textselection.h"
+#include "html/redraw_list.h"
 
 #define CHUNK 4096
 
+/* Minimum amount of source data before a partially loaded document
+ * is laid out for display.
+ */
+#define PROGRESSIVE_MIN_SIZE (8 * CHUNK)
+
+/* Delay before retrying an update of mutated elements while the box
+ * tree is in use, in ms.
+ */
+#define MUTATED_RETRY_DELAY 10
+
+/* Time spent on each slice of a deferred layout, and the delay between
+ * slices so that the front end can redraw, in ms.
+ */
+#define LAYOUT_SLICE_TIME 20
+#define LAYOUT_SLICE_DELAY 10
+
 /* Change these to 1 to cause a dump to stderr of the frameset or box
  * when the trees have been built.
  */
@@ -207,6 +229,47 @@ bool fire_dom_keyboard_event(dom_string *type, dom_node *target,
 	return result;
 }
 
+/**
+ * Forget interaction state which may refer to boxes being discarded
+ *
+ * \param c   HTML content whose box tree is changing
+ * \param box Box whose descendants are being replaced, or NULL if the
+ *            whole box tree is being replaced
+ */
+static void html_forget_box_state(html_content *c, const struct box *box)
+{
+	html_redraw_list_free(c);
+
+	c->drag_type = HTML_DRAG_NONE;
+	c->drag_owner.no_owner = true;
+
+	switch (c->selection_type) {
+	case HTML_SELECTION_TEXTAREA:
+	case HTML_SELECTION_CONTENT:
+		if (box != NULL && !box_is_descendant(
+				c->selection_owner.content, box))
+			break;
+		/* Fall through */
+	default:
+		selection_clear(c->sel, false);
+		c->selection_type = HTML_SELECTION_NONE;
+		c->selection_owner.none = true;
+		break;
+	}
+
+	if (c->focus_type != HTML_FOCUS_SELF &&
+			(box == NULL || box_is_descendant(
+					c->focus_owner.content, box))) {
+		c->focus_type = HTML_FOCUS_SELF;
+		c->focus_owner.self = true;
+	}
+
+	if (c->base.textsearch.context != NULL) {
+		content_textsearch_destroy(c->base.textsearch.context);
+		c->base.textsearch.context = NULL;
+	}
+}
+
 /**
  * Perform post-box-creation conversion of a document
  *
@@ -273,6 +336,20 @@ static void html_box_convert_done(html_content *c, bool success)
 	dom_hubbub_parser_destroy(c->parser);
 	c->parser = NULL;
 
+	if (c->progressive_bctx != NULL) {
+		/* Discard the provisional box tree */
+		html_forget_box_state(c, NULL);
+		talloc_free(c->progressive_bctx);
+		c->progressive_bctx = NULL;
+	}
+
+	if (c->base.progressive && c->bw != NULL) {
+		/* The browser window was opened on the provisional box
+		 * tree which had no frames; create them now. */
+		browser_window_create_frameset(c->bw);
+		browser_window_create_iframes(c->bw);
+	}
+
 	content_set_ready(&c->base);
 
 	html_proceed_to_done(c);
@@ -401,6 +478,13 @@ void html_finish_conversion(html_content *htmlc)
 
 	html_get_dimensions(htmlc);
 
+	if (htmlc->bctx != NULL) {
+		/* Keep the provisional box tree for display until the
+		 * final one is complete */
+		htmlc->progressive_bctx = htmlc->bctx;
+		htmlc->bctx = NULL;
+	}
+
 	error = dom_to_box(html, htmlc, html_box_convert_done, &htmlc->box_conversion_context);
 	if (error != NSERROR_OK) {
 		NSLOG(netsurf, INFO, "box conversion failed");
@@ -470,9 +554,20 @@ html_create_html_data(html_content *c, const http_parameter *params)
 	c->aborted = false;
 	c->refresh = false;
 	c->reflowing = false;
+	c->layout_deferred = false;
+	c->layout_completing = false;
+	c->object_reflow = false;
 	c->title = NULL;
 	c->bctx = NULL;
+	c->progressive_conversion = false;
+	c->progressive_size = 0;
+	c->progressive_bctx = NULL;
 	c->layout = NULL;
+	c->redraw_list = NULL;
+	c->mouse_hover = NULL;
+	c->mouse_track_bw = NULL;
+	c->mutated_count = 0;
+	c->mutated_overflow = false;
 	c->background_colour = NS_TRANSPARENT;
 	c->stylesheet_count = 0;
 	c->stylesheets = NULL;
@@ -487,7 +582,7 @@ html_create_html_data(html_content *c, const http_parameter *params)
 	c->frameset = NULL;
 	c->iframe = NULL;
 	c->page = NULL;
-	c->font_func = guit->layout;
+	c->font_func = font_cache_layout;
 	c->drag_type = HTML_DRAG_NONE;
 	c->drag_owner.no_owner = true;
 	c->selection_type = HTML_SELECTION_NONE;
@@ -713,6 +808,135 @@ html_process_encoding_change(struct content *c,
 }
 
 
+/**
+ * Complete construction of a provisional box tree
+ *
+ * \param c        HTML content the box tree was built for
+ * \param success  Whether box tree construction was successful
+ */
+static void html_progressive_box_convert_done(html_content *c, bool success)
+{
+	if (success == false) {
+		/* Discard the partial tree, keeping any previous one */
+		NSLOG(netsurf, INFO, "provisional box tree failed (%p)", c);
+		talloc_free(c->bctx);
+		c->bctx = c->progressive_bctx;
+		c->progressive_bctx = NULL;
+		return;
+	}
+
+	if (c->progressive_bctx != NULL) {
+		/* The previous provisional tree has been replaced */
+		html_forget_box_state(c, NULL);
+		talloc_free(c->progressive_bctx);
+		c->progressive_bctx = NULL;
+	}
+}
+
+
+/**
+ * Lay out a partially loaded document for display
+ *
+ * A provisional box tree is constructed from the document parsed so far
+ * once the source has grown sufficiently since the last such tree was
+ * built. Objects, frames and form gadgets are omitted; they are created
+ * when the final box tree is constructed at the end of loading.
+ *
+ * \param c HTML content being loaded
+ */
+static void html_progressive_convert(html_content *c)
+{
+	dom_exception exc; /* returned by libdom functions */
+	dom_node *html;
+	dom_html_element *body = NULL;
+	size_t size;
+	unsigned int i;
+	nserror error;
+
+	if (nsoption_bool(progressive_render) == false)
+		return;
+
+	/* Only while still receiving data and before real conversion */
+	if (c->aborted || c->conversion_begun ||
+	    (c->base.status != CONTENT_STATUS_LOADING &&
+	     c->base.progressive == false))
+		return;
+
+	/* Waiting on stylesheets or scripts; the layout would be wrong */
+	if (c->base.active != 1)
+		return;
+	for (i = 0; i != c->stylesheet_count; i++) {
+		if (c->stylesheets[i].modified)
+			return;
+	}
+
+	/* Rebuild only when the source has doubled, which bounds the
+	 * total work to that of building the final tree twice */
+	(void) content__get_source_data(&c->base, &size);
+	if (size < PROGRESSIVE_MIN_SIZE || size < c->progressive_size * 2)
+		return;
+
+	/* Nothing to show until the body has begun */
+	exc = dom_html_document_get_body(c->document, &body);
+	if ((exc != DOM_NO_ERR) || (body == NULL))
+		return;
+	dom_node_unref(body);
+
+	exc = dom_document_get_document_element(c->document, (void *) &html);
+	if ((exc != DOM_NO_ERR) || (html == NULL))
+		return;
+
+	exc = dom_document_get_quirks_mode(c->document, &c->quirks);
+	if (exc != DOM_NO_ERR) {
+		c->quirks = DOM_DOCUMENT_QUIRKS_MODE_NONE;
+	}
+
+	error = html_css_new_selection_context(c, &c->select_ctx);
+	if (error != NSERROR_OK) {
+		dom_node_unref(html);
+		return;
+	}
+
+	html_get_dimensions(c);
+
+	NSLOG(netsurf, INFO, "provisional box tree at %"PRIsizet" bytes (%p)",
+	      size, c);
+
+	c->progressive_size = size;
+	c->progressive_bctx = c->bctx;
+	c->bctx = NULL;
+
+	c->progressive_conversion = true;
+	error = dom_to_box_sync(html, c, html_progressive_box_convert_done);
+	c->progressive_conversion = false;
+
+	if (error != NSERROR_OK) {
+		if (c->bctx != NULL) {
+			talloc_free(c->bctx);
+		}
+		c->bctx = c->progressive_bctx;
+		c->progressive_bctx = NULL;
+	}
+
+	dom_node_unref(html);
+
+	/* The selection context is rebuilt when conversion finishes, as
+	 * the set of stylesheets may yet change */
+	html_css_release_selection_context(c->select_ctx);
+	c->select_ctx = NULL;
+
+	if (c->layout == NULL)
+		return;
+
+	if (c->base.status == CONTENT_STATUS_LOADING) {
+		content_set_ready_progressive(&c->base);
+	} else {
+		content__reformat(&c->base, false, c->base.available_width,
+				  c->base.available_height);
+	}
+}
+
+
 /**
  * Process data for CONTENT_HTML.
  */
@@ -741,6 +965,8 @@ html_process_data(struct content *c, const char *data, unsigned int size)
 		return false;
 	}
 
+	html_progressive_convert(html);
+
 	return true;
 }
 
@@ -996,8 +1222,14 @@ html_begin_conversion(html_content *htmlc)
 static void html_stop(struct content *c)
 {
 	html_content *htmlc = (html_content *) c;
+	content_status status = c->status;
+
+	if (c->progressive) {
+		/* Displayed early, but still loading */
+		status = CONTENT_STATUS_LOADING;
+	}
 
-	switch (c->status) {
+	switch (status) {
 	case CONTENT_STATUS_LOADING:
 		/* Still loading; simply flag that we've been aborted
 		 * html_convert/html_finish_conversion will do the rest */
@@ -1031,8 +1263,83 @@ static void html_stop(struct content *c)
 }
 
 
+/**
+ * Scheduled callback to continue a deferred layout
+ *
+ * \param p HTML content
+ */
+static void html_layout_continue(void *p)
+{
+	html_content *htmlc = p;
+	int old_width, old_height;
+	int y0, y1;
+
+	if ((htmlc->base.status != CONTENT_STATUS_READY &&
+			htmlc->base.status != CONTENT_STATUS_DONE) ||
+			htmlc->layout == NULL)
+		return;
+
+	if (htmlc->base.locked || htmlc->reflowing) {
+		guit->misc->schedule(LAYOUT_SLICE_DELAY,
+				html_layout_continue, htmlc);
+		return;
+	}
+
+	old_width = htmlc->base.width;
+	old_height = htmlc->base.height;
+
+	/* Only the text laid out, and what it moved, needs redrawing */
+	htmlc->layout_completing = true;
+	content__reformat(&htmlc->base, true, htmlc->base.available_width,
+			htmlc->base.available_height);
+	htmlc->layout_completing = false;
+
+	if (htmlc->layout_changed_y0 > htmlc->layout_changed_y1)
+		return;
+
+	y0 = htmlc->layout->y + htmlc->layout_changed_y0;
+	if (htmlc->layout_changed_y1 == INT_MAX) {
+		y1 = max(old_height, htmlc->base.height);
+	} else {
+		y1 = htmlc->layout->y + htmlc->layout_changed_y1;
+	}
+
+	content__request_redraw(&htmlc->base, 0, y0,
+			max(old_width, htmlc->base.width), y1 - y0);
+}
+
+
+/**
+ * Find the y below which text is first laid out later
+ *
+ * Text within the viewport, or the viewport below it, is laid out at
+ * once. Content which isn't being displayed is laid out completely.
+ *
+ * \param htmlc HTML content
+ * \param height viewport height
+ * \return limit of the first layout, in px
+ */
+static int html_layout_limit(html_content *htmlc, int height)
+{
+	int sx, sy;
+
+	if (htmlc->bw == NULL || height <= 0 ||
+			browser_window_get_scroll(htmlc->bw, &sx, &sy) !=
+			NSERROR_OK)
+		return INT_MAX;
+
+	if (sy > INT_MAX - 2 * height)
+		return INT_MAX;
+
+	return sy + 2 * height;
+}
+
+
 /**
  * Reformat a CONTENT_HTML to a new width.
+ *
+ * Text well below the viewport may be given an estimated height, and
+ * laid out in time slices afterwards.
  */
 
 static void html_reformat(struct content *c, int width, int height)
@@ -1053,16 +1360,46 @@ static void html_reformat(struct content *c, int width, int height)
 			INTTOFIX(height), htmlc->unit_len_ctx.device_dpi);
 	htmlc->unit_len_ctx.root_style = htmlc->layout->style;
 
+	if (htmlc->layout_completing) {
+		htmlc->layout_limit = INT_MAX;
+		htmlc->layout_deadline = ms_before + LAYOUT_SLICE_TIME;
+	} else if (nsoption_bool(deferred_layout)) {
+		htmlc->layout_limit = html_layout_limit(htmlc, height);
+		htmlc->layout_deadline = 0;
+	} else {
+		htmlc->layout_limit = INT_MAX;
+		htmlc->layout_deadline = 0;
+	}
+	htmlc->layout_deferred = false;
+	htmlc->layout_changed_y0 = INT_MAX;
+	htmlc->layout_changed_y1 = INT_MIN;
+
+	/* This includes any reflow objects have asked for */
+	htmlc->object_reflow = false;
+
+	/* Box positions are about to change */
+	html_redraw_list_relayout(htmlc);
+
 	layout_document(htmlc, width, height);
 	layout = htmlc->layout;
 
+	if (htmlc->layout_deferred) {
+		/* Estimated heights are used for the rest until then */
+		guit->misc->schedule(LAYOUT_SLICE_DELAY,
+				html_layout_continue, htmlc);
+	} else {
+		guit->misc->schedule(-1, html_layout_continue, htmlc);
+	}
+
 	/* width and height are at least margin box of document */
-	c->width = layout->x + layout->padding[LEFT] + layout->width +
-		layout->padding[RIGHT] + layout->border[RIGHT].width +
-		layout->margin[RIGHT];
-	c->height = layout->y + layout->padding[TOP] + layout->height +
-		layout->padding[BOTTOM] + layout->border[BOTTOM].width +
-		layout->margin[BOTTOM];
+	c->width = layout->x + layout->edges->padding[LEFT] + layout->width +
+		layout->edges->padding[RIGHT] +
+		layout->edges->border[RIGHT].width +
+		layout->edges->margin[RIGHT];
+	c->height = layout->y + layout->edges->padding[TOP] + layout->height +
+		layout->edges->padding[BOTTOM] +
+		layout->edges->border[BOTTOM].width +
+		layout->edges->margin[BOTTOM];
 
 	/* if boxes overflow right or bottom edge, expand to contain it */
 	if (c->width < layout->x + layout->descendant_x1)
@@ -1100,8 +1437,465 @@ void html_redraw_a_box(hlcache_handle *h, struct box *box)
 	box_coords(box, &x, &y);
 
 	content_request_redraw(h, x, y,
-			box->padding[LEFT] + box->width + box->padding[RIGHT],
-			box->padding[TOP] + box->height + box->padding[BOTTOM]);
+			box->edges->padding[LEFT] + box->width +
+			box->edges->padding[RIGHT],
+			box->edges->padding[TOP] + box->height +
+			box->edges->padding[BOTTOM]);
+}
+
+
+/**
+ * Check whether a box tree may be patched after DOM mutation
+ *
+ * \param htmlc HTML content
+ * \return true if the content has a complete box tree which is not about
+ *         to be replaced
+ */
+static bool html_box_tree_patchable(html_content *htmlc)
+{
+	if (htmlc->base.status != CONTENT_STATUS_READY &&
+			htmlc->base.status != CONTENT_STATUS_DONE)
+		return false;
+
+	/* A provisional box tree will be replaced anyway */
+	if (htmlc->base.progressive || htmlc->progressive_conversion)
+		return false;
+
+	return htmlc->layout != NULL;
+}
+
+
+/**
+ * Check whether a box tree is in use by an ongoing conversion or layout
+ *
+ * \param htmlc HTML content
+ * \return true if the box tree may not be changed yet
+ */
+static bool html_box_tree_busy(html_content *htmlc)
+{
+	return (htmlc->box_conversion_context != NULL ||
+			htmlc->reflowing ||
+			htmlc->base.locked);
+}
+
+
+/**
+ * Check whether the descendants of a box may be discarded and rebuilt
+ *
+ * Form gadgets and iframes own state which outlives a single box tree,
+ * so subtrees containing them are only rebuilt along with the whole
+ * tree.
+ *
+ * \param box Box to check the descendants of
+ * \return true if the descendants may be rebuilt
+ */
+static bool html_box_children_replaceable(const struct box *box)
+{
+	const struct box *child;
+
+	for (child = box->children; child != NULL; child = child->next) {
+		if (box_get_gadget(child) != NULL || (child->flags & IFRAME) ||
+				box_get_iframe(child) != NULL)
+			return false;
+
+		if (!html_box_children_replaceable(child))
+			return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * Detach form gadgets from the boxes of the current box tree
+ *
+ * \param htmlc HTML content
+ */
+static void html_forms_detach_boxes(html_content *htmlc)
+{
+	struct form *f;
+	struct form_control *control;
+
+	for (f = htmlc->forms; f != NULL; f = f->prev) {
+		for (control = f->controls; control != NULL;
+				control = control->next) {
+			control->box = NULL;
+		}
+	}
+}
+
+
+/**
+ * Attach form gadgets to the boxes of a box tree
+ *
+ * \param box Root of the box tree
+ */
+static void html_box_attach_gadgets(struct box *box)
+{
+	struct form_control *gadget = box_get_gadget(box);
+	struct box *child;
+
+	if (gadget != NULL && (box->flags & CLONE) == 0)
+		gadget->box = box;
+
+	for (child = box->children; child != NULL; child = child->next) {
+		html_box_attach_gadgets(child);
+	}
+}
+
+
+/**
+ * Free the gadgets of a discarded box tree which belong to no form
+ *
+ * Gadgets within a form are found again by their DOM node when a box
+ * tree is constructed; the others are created afresh.
+ *
+ * \param box Root of the discarded box tree
+ */
+static void html_box_free_formless_gadgets(struct box *box)
+{
+	struct form_control *gadget = box_get_gadget(box);
+	struct box *child;
+
+	if (gadget != NULL && (box->flags & CLONE) == 0 &&
+			gadget->form == NULL) {
+		form_free_control(gadget);
+		box->ext->gadget = NULL;
+	}
+
+	for (child = box->children; child != NULL; child = child->next) {
+		html_box_free_formless_gadgets(child);
+	}
+}
+
+
+/**
+ * Check whether two lists of iframes open the same documents
+ *
+ * \param a First iframe list
+ * \param b Second iframe list
+ * \return true if the lists have the same URLs and names in the same order
+ */
+static bool
+html_iframes_match(const struct content_html_iframe *a,
+		const struct content_html_iframe *b)
+{
+	for (; a != NULL && b != NULL; a = a->next, b = b->next) {
+		if (nsurl_compare(a->url, b->url, NSURL_COMPLETE) == false)
+			return false;
+
+		if ((a->name == NULL) != (b->name == NULL))
+			return false;
+
+		if (a->name != NULL && strcmp(a->name, b->name) != 0)
+			return false;
+	}
+
+	return (a == NULL && b == NULL);
+}
+
+
+/**
+ * Callback for completion of a box tree rebuild
+ *
+ * \param c       HTML content
+ * \param success Whether box tree construction was successful
+ */
+static void html_box_rebuild_done(html_content *c, bool success)
+{
+	if (success == false) {
+		NSLOG(netsurf, INFO, "box tree rebuild failed (%p)", c);
+	}
+}
+
+
+/**
+ * Rebuild the whole box tree after DOM mutation
+ *
+ * Used when changes can't be confined to the descendants of a few blocks.
+ * Form gadgets and iframes are carried over to the new tree. The old tree
+ * is kept if construction fails.
+ *
+ * \param htmlc HTML content
+ * \return NSERROR_OK on success else appropriate error code
+ */
+static nserror html_box_rebuild(html_content *htmlc)
+{
+	struct box_arena *old_bctx = htmlc->bctx;
+	struct box *old_layout = htmlc->layout;
+	struct content_html_iframe *old_iframe = htmlc->iframe;
+	struct content_html_object *old_objects = htmlc->object_list;
+	colour old_background = htmlc->background_colour;
+	dom_exception exc;
+	dom_node *html;
+	nserror err;
+
+	if (htmlc->frameset != NULL) {
+		/* The frames are laid out by the browser window */
+		return NSERROR_OK;
+	}
+
+	exc = dom_document_get_document_element(htmlc->document,
+			(void *) &html);
+	if ((exc != DOM_NO_ERR) || (html == NULL))
+		return NSERROR_DOM;
+
+	/* Construction must not find the old boxes */
+	box_detach_nodes(old_layout);
+	html_forms_detach_boxes(htmlc);
+
+	htmlc->bctx = NULL;
+	htmlc->layout = NULL;
+	htmlc->iframe = NULL;
+
+	err = dom_to_box_sync(html, htmlc, html_box_rebuild_done);
+	dom_node_unref(html);
+
+	if (err == NSERROR_OK && htmlc->layout == NULL)
+		err = NSERROR_BOX_CONVERT;
+
+	if (err != NSERROR_OK) {
+		/* Discard the partial tree, keeping the old one */
+		html_object_release_since(htmlc, old_objects);
+		if (htmlc->bctx != NULL)
+			talloc_free(htmlc->bctx);
+
+		htmlc->bctx = old_bctx;
+		htmlc->layout = old_layout;
+		htmlc->iframe = old_iframe;
+		htmlc->background_colour = old_background;
+
+		html_forms_detach_boxes(htmlc);
+		html_box_attach_gadgets(old_layout);
+		box_attach_nodes(old_layout);
+
+		return err;
+	}
+
+	html_forget_box_state(htmlc, NULL);
+	htmlc->visible_select_menu = NULL;
+
+	html_object_release_descendants(htmlc, old_layout);
+
+	if (htmlc->bw != NULL && (old_iframe != NULL || htmlc->iframe != NULL)) {
+		if (html_iframes_match(old_iframe, htmlc->iframe)) {
+			/* Keep the documents open in the iframes */
+			browser_window_relink_iframes(htmlc->bw);
+		} else {
+			browser_window_destroy_iframes(htmlc->bw);
+			browser_window_create_iframes(htmlc->bw);
+		}
+	}
+
+	/* The old iframe list is freed along with its box arena */
+	html_box_free_formless_gadgets(old_layout);
+	talloc_free(old_bctx);
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Find the box to rebuild for a change to the DOM below a node
+ *
+ * \param node DOM node from which to search upwards
+ * \return The nearest non-replaced block container box for \a node or
+ *         one of its ancestors, or NULL if none
+ */
+static struct box *html_mutated_block(dom_node *node)
+{
+	dom_node *n = dom_node_ref(node);
+
+	while (n != NULL) {
+		struct box *box = box_for_node(n);
+		dom_node *parent;
+		dom_exception exc;
+
+		if (box != NULL &&
+				(box->type == BOX_BLOCK ||
+				 box->type == BOX_INLINE_BLOCK ||
+				 box->type == BOX_TABLE_CELL) &&
+				(box->flags & IS_REPLACED) == 0 &&
+				(box->flags & CONVERT_CHILDREN)) {
+			dom_node_unref(n);
+			return box;
+		}
+
+		exc = dom_node_get_parent_node(n, &parent);
+		dom_node_unref(n);
+		if (exc != DOM_NO_ERR)
+			return NULL;
+
+		n = parent;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Drop all pending DOM mutations
+ *
+ * \param htmlc HTML content
+ */
+static void html_mutated_clear(html_content *htmlc)
+{
+	unsigned int i;
+
+	for (i = 0; i < htmlc->mutated_count; i++) {
+		dom_node_unref(htmlc->mutated[i]);
+	}
+
+	htmlc->mutated_count = 0;
+	htmlc->mutated_overflow = false;
+}
+
+
+/**
+ * Scheduled callback to bring the box tree up to date with the DOM
+ *
+ * Each changed block container has its descendants rebuilt, unless it
+ * lies within another block that is being rebuilt. If that isn't
+ * possible, the whole box tree is rebuilt. The document is then
+ * reformatted.
+ *
+ * \param p HTML content
+ */
+static void html_mutated_update(void *p)
+{
+	html_content *htmlc = p;
+	struct box *blocks[HTML_MUTATED_MAX];
+	bool skip[HTML_MUTATED_MAX];
+	unsigned int count = 0;
+	unsigned int i, j;
+	bool rebuild;
+	nserror err;
+
+	if (html_box_tree_patchable(htmlc) == false) {
+		/* The box tree will be replaced anyway */
+		html_mutated_clear(htmlc);
+		return;
+	}
+
+	if (html_box_tree_busy(htmlc)) {
+		/* Keep the changes until the tree may be altered */
+		guit->misc->schedule(MUTATED_RETRY_DELAY,
+				html_mutated_update, htmlc);
+		return;
+	}
+
+	/* If too much changed to track, rebuild everything */
+	rebuild = htmlc->mutated_overflow;
+
+	for (i = 0; i < htmlc->mutated_count && rebuild == false; i++) {
+		struct box *box = box_for_node(htmlc->mutated[i]);
+		if (box != NULL)
+			blocks[count++] = box;
+	}
+
+	html_mutated_clear(htmlc);
+
+	/* Decide what to rebuild before any boxes are discarded */
+	for (i = 0; i < count && rebuild == false; i++) {
+		if (html_box_children_replaceable(blocks[i]) == false) {
+			rebuild = true;
+			break;
+		}
+
+		skip[i] = false;
+
+		for (j = 0; j < count && skip[i] == false; j++) {
+			if (box_is_descendant(blocks[i], blocks[j]))
+				skip[i] = true;
+		}
+	}
+
+	if (count == 0 && rebuild == false)
+		return;
+
+	for (i = 0; i < count && rebuild == false; i++) {
+		if (skip[i])
+			continue;
+
+		html_forget_box_state(htmlc, blocks[i]);
+		html_object_release_descendants(htmlc, blocks[i]);
+
+		err = dom_to_box_update(blocks[i]->node, htmlc);
+		if (err != NSERROR_OK) {
+			/* The block was left empty */
+			NSLOG(netsurf, INFO, "box tree update failed (%p)",
+			      htmlc);
+			rebuild = true;
+		}
+	}
+
+	if (rebuild) {
+		err = html_box_rebuild(htmlc);
+		if (err != NSERROR_OK) {
+			/* Try again when the document next changes */
+			htmlc->mutated_overflow = true;
+		}
+	}
+
+	content__reformat(&htmlc->base, false, htmlc->base.available_width,
+			htmlc->base.available_height);
+
+	if (htmlc->base.status == CONTENT_STATUS_READY &&
+			htmlc->base.active == 0) {
+		/* The outstanding fetches were for discarded boxes */
+		content_set_done(&htmlc->base);
+	}
+}
+
+
+/* exported interface documented in html/private.h */
+void html__dom_mutated(html_content *htmlc, dom_node *node, bool restyle)
+{
+	struct box *block;
+	dom_node_type type;
+	dom_exception exc;
+	unsigned int i;
+
+	if (html_box_tree_patchable(htmlc) == false)
+		return;
+
+	exc = dom_node_get_node_type(node, &type);
+	if (exc != DOM_NO_ERR)
+		return;
+
+	if (restyle || type != DOM_ELEMENT_NODE) {
+		/* The node's own box changes, so rebuild its container */
+		dom_node *parent;
+
+		exc = dom_node_get_parent_node(node, &parent);
+		if (exc != DOM_NO_ERR || parent == NULL)
+			return;
+
+		block = html_mutated_block(parent);
+		dom_node_unref(parent);
+	} else {
+		block = html_mutated_block(node);
+	}
+
+	if (block == NULL)
+		return;
+
+	if (htmlc->mutated_overflow == false) {
+		for (i = 0; i < htmlc->mutated_count; i++) {
+			if (htmlc->mutated[i] == block->node)
+				return;
+		}
+
+		if (htmlc->mutated_count == HTML_MUTATED_MAX) {
+			html_mutated_clear(htmlc);
+			htmlc->mutated_overflow = true;
+		} else {
+			htmlc->mutated[htmlc->mutated_count++] =
+					dom_node_ref(block->node);
+		}
+	}
+
+	guit->misc->schedule(0, html_mutated_update, htmlc);
 }
 
 
@@ -1119,8 +1913,10 @@ void html__redraw_a_box(struct html_content *html, struct box *box)
 	box_coords(box, &x, &y);
 
 	content__request_redraw((struct content *)html, x, y,
-			box->padding[LEFT] + box->width + box->padding[RIGHT],
-			box->padding[TOP] + box->height + box->padding[BOTTOM]);
+			box->edges->padding[LEFT] + box->width +
+			box->edges->padding[RIGHT],
+			box->edges->padding[TOP] + box->height +
+			box->edges->padding[BOTTOM]);
 }
 
 static void html_destroy_frameset(struct content_html_frames *frameset)
@@ -1178,6 +1974,10 @@ static void html_free_layout(html_content *htmlc)
 		 */
 		talloc_free(htmlc->bctx);
 	}
+
+	if (htmlc->progressive_bctx != NULL) {
+		talloc_free(htmlc->progressive_bctx);
+	}
 }
 
 /**
@@ -1198,6 +1998,18 @@ static void html_destroy(struct content *c)
 		}
 	}
 
+	/* Drop any pending box tree update */
+	guit->misc->schedule(-1, html_mutated_update, html);
+	html_mutated_clear(html);
+
+	/* Drop any deferred layout */
+	guit->misc->schedule(-1, html_layout_continue, html);
+
+	html_redraw_list_free(html);
+	html_mouse_track_cancel(html);
+	free(html->mouse_hover);
+	html->mouse_hover = NULL;
+
 	selection_destroy(html->sel);
 
 	/* Destroy forms */
@@ -1265,7 +2077,7 @@ static void html_destroy(struct content *c)
 
 	/* Destroy selection context */
 	if (html->select_ctx != NULL) {
-		css_select_ctx_destroy(html->select_ctx);
+		html_css_release_selection_context(html->select_ctx);
 		html->select_ctx = NULL;
 	}
 
@@ -1341,6 +2153,9 @@ static nserror html_close(struct content *c)
 
 	selection_clear(htmlc->sel, false);
 
+	/* drop pointer movement meant for the browser window */
+	html_mouse_track_cancel(htmlc);
+
 	/* clear the html content reference to the browser window */
 	htmlc->bw = NULL;
 
@@ -1370,15 +2185,16 @@ static void html_clear_selection(struct content *c)
 		assert(html->selection_owner.none == true);
 		break;
 	case HTML_SELECTION_TEXTAREA:
-		textarea_clear_selection(html->selection_owner.textarea->
-				gadget->data.text.ta);
+		textarea_clear_selection(box_get_gadget(
+				html->selection_owner.textarea)->data.text.ta);
 		break;
 	case HTML_SELECTION_SELF:
 		assert(html->selection_owner.none == false);
 		selection_clear(html->sel, true);
 		break;
 	case HTML_SELECTION_CONTENT:
-		content_clear_selection(html->selection_owner.content->object);
+		content_clear_selection(
+				box_get_object(html->selection_owner.content));
 		break;
 	default:
 		break;
@@ -1400,14 +2216,14 @@ static char *html_get_selection(struct content *c)
 
 	switch (html->selection_type) {
 	case HTML_SELECTION_TEXTAREA:
-		return textarea_get_selection(html->selection_owner.textarea->
-				gadget->data.text.ta);
+		return textarea_get_selection(box_get_gadget(
+				html->selection_owner.textarea)->data.text.ta);
 	case HTML_SELECTION_SELF:
 		assert(html->selection_owner.none == false);
 		return selection_get_copy(html->sel);
 	case HTML_SELECTION_CONTENT:
 		return content_get_selection(
-				html->selection_owner.content->object);
+				box_get_object(html->selection_owner.content));
 	case HTML_SELECTION_NONE:
 		/* Nothing to do */
 		assert(html->selection_owner.none == true);
@@ -1451,35 +2267,36 @@ html_get_contextual_content(struct content *c, int x, int y,
 			continue;
 		}
 
-		if (box->iframe) {
-			float scale = browser_window_get_scale(box->iframe);
-			browser_window_get_features(box->iframe,
+		if (box_get_iframe(box)) {
+			float scale = browser_window_get_scale(box_get_iframe(box));
+			browser_window_get_features(box_get_iframe(box),
 						    (x - box_x) * scale,
 						    (y - box_y) * scale,
 						    data);
 		}
 
-		if (box->object)
-			content_get_contextual_content(box->object,
+		if (box_get_object(box))
+			content_get_contextual_content(box_get_object(box),
 					x - box_x, y - box_y, data);
 
-		if (box->object)
-			data->object = box->object;
+		if (box_get_object(box))
+			data->object = box_get_object(box);
 
 		if (box->href)
 			data->link = box->href;
 
-		if (box->usemap) {
+		if (box_get_usemap(box)) {
 			const char *target = NULL;
-			nsurl *url = imagemap_get(html, box->usemap, box_x,
+			nsurl *url = imagemap_get(html, box_get_usemap(box),
+				box_x,
 					box_y, x, y, &target);
 			/* Box might have imagemap, but no actual link area
 			 * at point */
 			if (url != NULL)
 				data->link = url;
 		}
-		if (box->gadget) {
-			switch (box->gadget->type) {
+		if (box_get_gadget(box)) {
+			switch (box_get_gadget(box)->type) {
 			case GADGET_TEXTBOX:
 			case GADGET_TEXTAREA:
 			case GADGET_PASSWORD:
@@ -1517,6 +2334,7 @@ html_scroll_at_point(struct content *c, int x, int y, int scrx, int scry)
 
 	struct box *box = html->layout;
 	struct box *next;
+	struct form_control *gadget;
 	int box_x = 0, box_y = 0;
 	bool handled_scroll = false;
 
@@ -1531,10 +2349,10 @@ html_scroll_at_point(struct content *c, int x, int y, int scrx, int scry)
 			continue;
 
 		/* Pass into iframe */
-		if (box->iframe) {
-			float scale = browser_window_get_scale(box->iframe);
+		if (box_get_iframe(box)) {
+			float scale = browser_window_get_scale(box_get_iframe(box));
 
-			if (browser_window_scroll_at_point(box->iframe,
+			if (browser_window_scroll_at_point(box_get_iframe(box),
 							   (x - box_x) * scale,
 							   (y - box_y) * scale,
 							   scrx, scry) == true)
@@ -1542,24 +2360,27 @@ html_scroll_at_point(struct content *c, int x, int y, int scrx, int scry)
 		}
 
 		/* Pass into textarea widget */
-		if (box->gadget && (box->gadget->type == GADGET_TEXTAREA ||
-				box->gadget->type == GADGET_PASSWORD ||
-				box->gadget->type == GADGET_TEXTBOX) &&
-				textarea_scroll(box->gadget->data.text.ta,
+		gadget = box_get_gadget(box);
+		if (gadget && (gadget->type == GADGET_TEXTAREA ||
+				gadget->type == GADGET_PASSWORD ||
+				gadget->type == GADGET_TEXTBOX) &&
+				textarea_scroll(gadget->data.text.ta,
 						scrx, scry) == true)
 			return true;
 
 		/* Pass into object */
-		if (box->object != NULL && content_scroll_at_point(
-				box->object, x - box_x, y - box_y,
+		if (box_get_object(box) != NULL && content_scroll_at_point(
+				box_get_object(box), x - box_x, y - box_y,
 				scrx, scry) == true)
 			return true;
 
 		/* Handle box scrollbars */
-		if (box->scroll_y && scrollbar_scroll(box->scroll_y, scry))
+		if (box_get_scroll_y(box) &&
+				scrollbar_scroll(box_get_scroll_y(box), scry))
 			handled_scroll = true;
 
-		if (box->scroll_x && scrollbar_scroll(box->scroll_x, scrx))
+		if (box_get_scroll_x(box) &&
+				scrollbar_scroll(box_get_scroll_x(box), scrx))
 			handled_scroll = true;
 
 		if (handled_scroll == true)
@@ -1631,7 +2452,7 @@ static void html__set_file_gadget_filename(struct content *c,
 	form_gadget_update_value(gadget, utf8_fn);
 
 	/* corestring_dom___ns_key_file_name_node_data */
-	if (dom_node_set_user_data((dom_node *)file_box->gadget->node,
+	if (dom_node_set_user_data((dom_node *)box_get_gadget(file_box)->node,
 				   corestring_dom___ns_key_file_name_node_data,
 				   strdup(fn), html__dom_user_data_handler,
 				   &oldfile) == DOM_NO_ERR) {
@@ -1679,22 +2500,22 @@ static bool html_drop_file_at_point(struct content *c, int x, int y, char *file)
 		    css_computed_visibility(box->style) == CSS_VISIBILITY_HIDDEN)
 			continue;
 
-		if (box->iframe) {
-			float scale = browser_window_get_scale(box->iframe);
+		if (box_get_iframe(box)) {
+			float scale = browser_window_get_scale(box_get_iframe(box));
 			return browser_window_drop_file_at_point(
-				box->iframe,
+				box_get_iframe(box),
 				(x - box_x) * scale,
 				(y - box_y) * scale,
 				file);
 		}
 
-		if (box->object &&
-		    content_drop_file_at_point(box->object,
+		if (box_get_object(box) &&
+		    content_drop_file_at_point(box_get_object(box),
 					x - box_x, y - box_y, file) == true)
 			return true;
 
-		if (box->gadget) {
-			switch (box->gadget->type) {
+		if (box_get_gadget(box)) {
+			switch (box_get_gadget(box)->type) {
 				case GADGET_FILE:
 					file_box = box;
 				break;
@@ -1722,7 +2543,8 @@ static bool html_drop_file_at_point(struct content *c, int x, int y, char *file)
 	/* Handle the drop */
 	if (file_box) {
 		/* File dropped on file input */
-		html__set_file_gadget_filename(c, file_box->gadget, file);
+		html__set_file_gadget_filename(c, box_get_gadget(file_box),
+			file);
 
 	} else {
 		/* File dropped on text input */
@@ -1797,11 +2619,11 @@ static bool html_drop_file_at_point(struct content *c, int x, int y, char *file)
 
 		/* Simulate a click over the input box, to place caret */
 		box_coords(text_box, &bx, &by);
-		textarea_mouse_action(text_box->gadget->data.text.ta,
+		textarea_mouse_action(box_get_gadget(text_box)->data.text.ta,
 				BROWSER_MOUSE_PRESS_1, x - bx, y - by);
 
 		/* Paste the file as text */
-		textarea_drop_text(text_box->gadget->data.text.ta,
+		textarea_drop_text(box_get_gadget(text_box)->data.text.ta,
 				utf8_buff, size);
 
 		free(utf8_buff);
@@ -2194,6 +3016,7 @@ static content_type html_content_type(void)
 static void html_fini(void)
 {
 	html_css_fini();
+	font_cache_fini();
 }
 
 /**
@@ -2217,7 +3040,7 @@ find_occurrences_html_box(const char *pattern,
 	nserror res = NSERROR_OK;
 
 	/* ignore this box, if there's no visible text */
-	if (!cur->object && cur->text) {
+	if (!box_get_object(cur) && cur->text) {
 		const char *text = cur->text;
 		unsigned length = cur->length;
 
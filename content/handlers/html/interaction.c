@@ -26,6 +26,7 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <dom/dom.h>
@@ -58,6 +59,7 @@
 #include "html/private.h"
 #include "html/imagemap.h"
 #include "html/interaction.h"
+#include "html/redraw_list.h"
 
 /**
  * Get pointer shape for given box
@@ -85,16 +87,16 @@ static browser_pointer_shape get_pointer_shape(struct box *box, bool imagemap)
 
 	switch (cursor) {
 	case CSS_CURSOR_AUTO:
-		if (box->href || (box->gadget &&
-				(box->gadget->type == GADGET_IMAGE ||
-				box->gadget->type == GADGET_SUBMIT)) ||
+		if (box->href || (box_get_gadget(box) &&
+				(box_get_gadget(box)->type == GADGET_IMAGE ||
+				box_get_gadget(box)->type == GADGET_SUBMIT)) ||
 				imagemap) {
 			/* link */
 			pointer = BROWSER_POINTER_POINT;
-		} else if (box->gadget &&
-				(box->gadget->type == GADGET_TEXTBOX ||
-				box->gadget->type == GADGET_PASSWORD ||
-				box->gadget->type == GADGET_TEXTAREA)) {
+		} else if (box_get_gadget(box) &&
+				(box_get_gadget(box)->type == GADGET_TEXTBOX ||
+				box_get_gadget(box)->type == GADGET_PASSWORD ||
+				box_get_gadget(box)->type == GADGET_TEXTAREA)) {
 			/* text input */
 			pointer = BROWSER_POINTER_CARET;
 		} else {
@@ -171,20 +173,20 @@ static void html_box_drag_start(struct box *box, int x, int y)
 
 	box_coords(box, &box_x, &box_y);
 
-	if (box->scroll_x != NULL) {
+	if (box_get_scroll_x(box) != NULL) {
 		scroll_mouse_x = x - box_x ;
-		scroll_mouse_y = y - (box_y + box->padding[TOP] +
-				box->height + box->padding[BOTTOM] -
+		scroll_mouse_y = y - (box_y + box->edges->padding[TOP] +
+				box->height + box->edges->padding[BOTTOM] -
 				SCROLLBAR_WIDTH);
-		scrollbar_start_content_drag(box->scroll_x,
+		scrollbar_start_content_drag(box_get_scroll_x(box),
 				scroll_mouse_x, scroll_mouse_y);
-	} else if (box->scroll_y != NULL) {
-		scroll_mouse_x = x - (box_x + box->padding[LEFT] +
-				box->width + box->padding[RIGHT] -
+	} else if (box_get_scroll_y(box) != NULL) {
+		scroll_mouse_x = x - (box_x + box->edges->padding[LEFT] +
+				box->width + box->edges->padding[RIGHT] -
 				SCROLLBAR_WIDTH);
 		scroll_mouse_y = y - box_y;
 
-		scrollbar_start_content_drag(box->scroll_y,
+		scrollbar_start_content_drag(box_get_scroll_y(box),
 				scroll_mouse_x, scroll_mouse_y);
 	}
 }
@@ -304,14 +306,14 @@ html_overflow_scroll_drag_end(struct scrollbar *scrollbar,
 
 	if (scrollbar_is_horizontal(scrollbar)) {
 		scroll_mouse_x = x - box_x;
-		scroll_mouse_y = y - (box_y + box->padding[TOP] +
-				box->height + box->padding[BOTTOM] -
+		scroll_mouse_y = y - (box_y + box->edges->padding[TOP] +
+				box->height + box->edges->padding[BOTTOM] -
 				SCROLLBAR_WIDTH);
 		scrollbar_mouse_drag_end(scrollbar, mouse,
 				scroll_mouse_x, scroll_mouse_y);
 	} else {
-		scroll_mouse_x = x - (box_x + box->padding[LEFT] +
-				box->width + box->padding[RIGHT] -
+		scroll_mouse_x = x - (box_x + box->edges->padding[LEFT] +
+				box->width + box->edges->padding[RIGHT] -
 				SCROLLBAR_WIDTH);
 		scroll_mouse_y = y - box_y;
 		scrollbar_mouse_drag_end(scrollbar, mouse,
@@ -349,9 +351,9 @@ mouse_action_select_menu(html_content *html,
 	box = html->visible_select_menu->box;
 	box_coords(box, &box_x, &box_y);
 
-	box_x -= box->border[LEFT].width;
-	box_y += box->height + box->border[BOTTOM].width +
-		box->padding[BOTTOM] + box->padding[TOP];
+	box_x -= box->edges->border[LEFT].width;
+	box_y += box->height + box->edges->border[BOTTOM].width +
+		box->edges->padding[BOTTOM] + box->edges->padding[TOP];
 
 	status = form_select_mouse_action(html->visible_select_menu,
 					  mouse,
@@ -473,16 +475,17 @@ mouse_action_drag_scrollbar(html_content *html,
 
 	if (scrollbar_is_horizontal(scr)) {
 		scroll_mouse_x = x - box_x ;
-		scroll_mouse_y = y - (box_y + box->padding[TOP] +
-				      box->height + box->padding[BOTTOM] -
+		scroll_mouse_y = y - (box_y + box->edges->padding[TOP] +
+				      box->height +
+				      box->edges->padding[BOTTOM] -
 				      SCROLLBAR_WIDTH);
 		scrollbar_status = scrollbar_mouse_action(scr,
 							  mouse,
 							  scroll_mouse_x,
 							  scroll_mouse_y);
 	} else {
-		scroll_mouse_x = x - (box_x + box->padding[LEFT] +
-				      box->width + box->padding[RIGHT] -
+		scroll_mouse_x = x - (box_x + box->edges->padding[LEFT] +
+				      box->width + box->edges->padding[RIGHT] -
 				      SCROLLBAR_WIDTH);
 		scroll_mouse_y = y - box_y;
 
@@ -521,13 +524,13 @@ mouse_action_drag_textarea(html_content *html,
 
 	box = html->drag_owner.textarea;
 
-	assert(box->gadget != NULL);
-	assert(box->gadget->type == GADGET_TEXTAREA ||
-	       box->gadget->type == GADGET_PASSWORD ||
-	       box->gadget->type == GADGET_TEXTBOX);
+	assert(box_get_gadget(box) != NULL);
+	assert(box_get_gadget(box)->type == GADGET_TEXTAREA ||
+	       box_get_gadget(box)->type == GADGET_PASSWORD ||
+	       box_get_gadget(box)->type == GADGET_TEXTBOX);
 
 	box_coords(box, &box_x, &box_y);
-	textarea_mouse_action(box->gadget->data.text.ta,
+	textarea_mouse_action(box_get_gadget(box)->data.text.ta,
 			      mouse,
 			      x - box_x,
 			      y - box_y);
@@ -551,10 +554,10 @@ mouse_action_drag_content(html_content *html,
 	int box_y = 0;
 
 	box = html->drag_owner.content;
-	assert(box->object != NULL);
+	assert(box_get_object(box) != NULL);
 
 	box_coords(box, &box_x, &box_y);
-	content_mouse_track(box->object,
+	content_mouse_track(box_get_object(box),
 			    bw, mouse,
 			    x - box_x,
 			    y - box_y);
@@ -672,14 +675,14 @@ get_mouse_action_node(html_content *html,
 		      int x, int y,
 		      struct mouse_action_state *man)
 {
+	const struct html_redraw_hit *hits;
+	struct html_redraw_list *list;
+	unsigned int count;
+	unsigned int i = 0;
 	struct box *box;
 	int box_x = 0;
 	int box_y = 0;
-
-	/* initialise the mouse action state data */
-	memset(man, 0, sizeof(struct mouse_action_state));
-	man->node = html->layout->node; /* Default dom node to the <HTML> */
-	man->result.pointer = BROWSER_POINTER_DEFAULT;
+	nserror res;
 
 	/* search the box tree for a link, imagemap, form control, or
 	 * box with scrollbars
@@ -687,8 +690,27 @@ get_mouse_action_node(html_content *html,
 	box = html->layout;
 
 	/* Consider the margins of the html page now */
-	box_x = box->margin[LEFT];
-	box_y = box->margin[TOP];
+	box_x = box->edges->margin[LEFT];
+	box_y = box->edges->margin[TOP];
+
+	res = html_redraw_list_boxes_at_point(html, x, y, box_x, box_y,
+			&hits, &count);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+	list = html->redraw_list;
+
+	if (html->mouse_hover != NULL &&
+	    html_redraw_list_is_hover(list, hits, count)) {
+		/* pointer is still over the same boxes */
+		*man = *html->mouse_hover;
+		return NSERROR_OK;
+	}
+
+	/* initialise the mouse action state data */
+	memset(man, 0, sizeof(struct mouse_action_state));
+	man->node = html->layout->node; /* Default dom node to the <HTML> */
+	man->result.pointer = BROWSER_POINTER_DEFAULT;
 
 	do {
 		/* skip hidden boxes */
@@ -702,30 +724,31 @@ get_mouse_action_node(html_content *html,
 			man->node = box->node;
 		}
 
-		if (box->object) {
-			if (content_get_type(box->object) == CONTENT_HTML) {
+		if (box_get_object(box)) {
+			if (content_get_type(box_get_object(box)) ==
+					CONTENT_HTML) {
 				man->html_object.box = box;
 				man->html_object.pos_x = box_x;
 				man->html_object.pos_y = box_y;
 			} else {
-				man->object = box->object;
+				man->object = box_get_object(box);
 			}
 		}
 
-		if (box->iframe) {
-			man->iframe = box->iframe;
+		if (box_get_iframe(box)) {
+			man->iframe = box_get_iframe(box);
 		}
 
 		if (box->href) {
 			man->link.url = box->href;
-			man->link.target = box->target;
+			man->link.target = box_get_target(box);
 			man->link.box = box;
 			man->link.is_imagemap = false;
 		}
 
-		if (box->usemap) {
+		if (box_get_usemap(box)) {
 			man->link.url = imagemap_get(html,
-						     box->usemap,
+						     box_get_usemap(box),
 						     box_x,
 						     box_y,
 						     x, y,
@@ -734,24 +757,25 @@ get_mouse_action_node(html_content *html,
 			man->link.is_imagemap = true;
 		}
 
-		if (box->gadget) {
-			man->gadget.control = box->gadget;
+		if (box_get_gadget(box)) {
+			man->gadget.control = box_get_gadget(box);
 			man->gadget.box = box;
 			man->gadget.box_x = box_x;
 			man->gadget.box_y = box_y;
-			if (box->gadget->form) {
-				man->gadget.target = box->gadget->form->target;
+			if (man->gadget.control->form) {
+				man->gadget.target =
+					man->gadget.control->form->target;
 			}
 		}
 
-		if (box->title) {
-			man->title = box->title;
+		if (box_get_title(box)) {
+			man->title = box_get_title(box);
 		}
 
 		man->result.pointer = get_pointer_shape(box, false);
 
-		if ((box->scroll_x != NULL) ||
-		    (box->scroll_y != NULL)) {
+		if ((box_get_scroll_x(box) != NULL) ||
+		    (box_get_scroll_y(box) != NULL)) {
 			int padding_left;
 			int padding_right;
 			int padding_top;
@@ -762,13 +786,15 @@ get_mouse_action_node(html_content *html,
 			}
 
 			padding_left = box_x +
-					scrollbar_get_offset(box->scroll_x);
-			padding_right = padding_left + box->padding[LEFT] +
-					box->width + box->padding[RIGHT];
+				scrollbar_get_offset(box_get_scroll_x(box));
+			padding_right = padding_left +
+				box->edges->padding[LEFT] + box->width +
+				box->edges->padding[RIGHT];
 			padding_top = box_y +
-					scrollbar_get_offset(box->scroll_y);
-			padding_bottom = padding_top + box->padding[TOP] +
-					box->height + box->padding[BOTTOM];
+				scrollbar_get_offset(box_get_scroll_y(box));
+			padding_bottom = padding_top +
+				box->edges->padding[TOP] + box->height +
+				box->edges->padding[BOTTOM];
 
 			if ((x > padding_left) &&
 			    (x < padding_right) &&
@@ -776,21 +802,21 @@ get_mouse_action_node(html_content *html,
 			    (y < padding_bottom)) {
 				/* mouse inside padding box */
 
-				if ((box->scroll_y != NULL) &&
+				if ((box_get_scroll_y(box) != NULL) &&
 				    (x > (padding_right - SCROLLBAR_WIDTH))) {
 					/* mouse above vertical box scroll */
 
-					man->scroll.bar = box->scroll_y;
+					man->scroll.bar = box_get_scroll_y(box);
 					man->scroll.mouse_x = x - (padding_right - SCROLLBAR_WIDTH);
 					man->scroll.mouse_y = y - padding_top;
 					break;
 
-				} else if ((box->scroll_x != NULL) &&
+				} else if ((box_get_scroll_x(box) != NULL) &&
 					   (y > (padding_bottom -
 							SCROLLBAR_WIDTH))) {
 					/* mouse above horizontal box scroll */
 
-					man->scroll.bar = box->scroll_x;
+					man->scroll.bar = box_get_scroll_x(box);
 					man->scroll.mouse_x = x - padding_left;
 					man->scroll.mouse_y = y - (padding_bottom - SCROLLBAR_WIDTH);
 					break;
@@ -798,21 +824,40 @@ get_mouse_action_node(html_content *html,
 			}
 		}
 
-		if (box->text && !box->object) {
+		if (box->text && !box_get_object(box)) {
 			man->text.box = box;
 			man->text.box_x = box_x;
 		}
 
 	next_box:
 		/* iterate to next box */
-		box = box_at_point(&html->unit_len_ctx, box, x, y, &box_x, &box_y);
+		if (i == count) {
+			break;
+		}
+		box = hits[i].box;
+		box_x = hits[i].x;
+		box_y = hits[i].y;
+		i++;
 	} while (box != NULL);
 
 	/* use of box_x, box_y, or content below this point is probably a
-	 * mistake; they will refer to the last box returned by box_at_point */
+	 * mistake; they will refer to the last box found */
 
 	assert(man->node != NULL);
 
+	/* keep the state for as long as the pointer is over the same boxes,
+	 * unless it depends on where the pointer is within them */
+	if (html->mouse_hover == NULL) {
+		html->mouse_hover = malloc(sizeof(*html->mouse_hover));
+	}
+	if (html->mouse_hover == NULL ||
+	    man->link.is_imagemap || man->drag_candidate != NULL ||
+	    !html_redraw_list_set_hover(list, hits, count)) {
+		html_redraw_list_set_hover(list, NULL, 0);
+	} else {
+		*html->mouse_hover = *man;
+	}
+
 	return NSERROR_OK;
 }
 
@@ -1041,13 +1086,13 @@ html_object_mouse_action(html_content *html,
 
 	if (mouse & BROWSER_MOUSE_CLICK_1 ||
 	    mouse & BROWSER_MOUSE_CLICK_2) {
-		content_mouse_action(mas->html_object.box->object,
+		content_mouse_action(box_get_object(mas->html_object.box),
 				     bw,
 				     mouse,
 				     x - mas->html_object.pos_x,
 				     y - mas->html_object.pos_y);
 	} else {
-		content_mouse_track(mas->html_object.box->object,
+		content_mouse_track(box_get_object(mas->html_object.box),
 				    bw,
 				    mouse,
 				    x - mas->html_object.pos_x,
@@ -1447,12 +1492,70 @@ mouse_action_drag_none(html_content *html,
 }
 
 
+/**
+ * Callback to handle the latest pointer movement over an HTML content
+ *
+ * \param p html content
+ */
+static void html_mouse_track_callback(void *p)
+{
+	html_content *html = p;
+	struct browser_window *bw = html->mouse_track_bw;
+
+	html->mouse_track_bw = NULL;
+
+	if (bw == NULL || html->bw == NULL) {
+		return;
+	}
+
+	html_mouse_action(&html->base, bw, BROWSER_MOUSE_HOVER,
+			  html->mouse_track_x, html->mouse_track_y);
+}
+
+
+/* exported interface documented in html/interaction.h */
+void html_mouse_track_cancel(html_content *html)
+{
+	if (html->mouse_track_bw != NULL) {
+		guit->misc->schedule(-1, html_mouse_track_callback, html);
+		html->mouse_track_bw = NULL;
+	}
+}
+
+
+/* exported interface documented in html/interaction.h */
+void html_mouse_forget_hover(html_content *html)
+{
+	if (html->redraw_list != NULL) {
+		html_redraw_list_set_hover(html->redraw_list, NULL, 0);
+	}
+}
+
+
 /* exported interface documented in html/interaction.h */
 nserror html_mouse_track(struct content *c,
 			 struct browser_window *bw,
 			 browser_mouse_state mouse,
 			 int x, int y)
 {
+	html_content *html = (html_content *)c;
+
+	if (mouse == BROWSER_MOUSE_HOVER &&
+	    html->drag_type == HTML_DRAG_NONE &&
+	    html->visible_select_menu == NULL) {
+		/* Handle the pointer at most once per frame, wherever it
+		 * has got to by then */
+		html->mouse_track_x = x;
+		html->mouse_track_y = y;
+		if (html->mouse_track_bw == NULL) {
+			guit->misc->schedule(HTML_MOUSE_TRACK_DELAY,
+					     html_mouse_track_callback,
+					     html);
+		}
+		html->mouse_track_bw = bw;
+		return NSERROR_OK;
+	}
+
 	return html_mouse_action(c, bw, mouse, x, y);
 }
 
@@ -1467,6 +1570,9 @@ html_mouse_action(struct content *c,
 	html_content *html = (html_content *)c;
 	nserror res;
 
+	/* anything waiting is superseded by this */
+	html_mouse_track_cancel(html);
+
 	/* handle open select menu */
 	if (html->visible_select_menu != NULL) {
 		return mouse_action_select_menu(html, bw, mouse, x, y);
@@ -1559,7 +1665,8 @@ bool html_keypress(struct content *c, uint32_t key)
 
 	switch (html->focus_type) {
 	case HTML_FOCUS_CONTENT:
-		return content_keypress(html->focus_owner.content->object, key);
+		return content_keypress(
+				box_get_object(html->focus_owner.content), key);
 
 	case HTML_FOCUS_TEXTAREA:
 		if (box_textarea_keypress(html, html->focus_owner.textarea, key) == NSERROR_OK) {
@@ -1771,14 +1878,15 @@ void html_set_selection(html_content *html, html_selection_type selection_type,
 					selection_owner.textarea)
 				break;
 			box = html->selection_owner.textarea;
-			textarea_clear_selection(box->gadget->data.text.ta);
+			textarea_clear_selection(
+					box_get_gadget(box)->data.text.ta);
 			break;
 		case HTML_SELECTION_CONTENT:
 			if (same_type && html->selection_owner.content ==
 					selection_owner.content)
 				break;
 			box = html->selection_owner.content;
-			content_clear_selection(box->object);
+			content_clear_selection(box_get_object(box));
 			break;
 		default:
 			break;
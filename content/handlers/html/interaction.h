@@ -26,6 +26,11 @@
 
 #include "desktop/search.h" /* search flags enum */
 
+/**
+ * Interval at which pointer movement is handled, in ms
+ */
+#define HTML_MOUSE_TRACK_DELAY 20
+
 /**
  * Context for scrollbar
  */
@@ -47,6 +52,29 @@ nserror html_mouse_track(struct content *c, struct browser_window *bw,
 			browser_mouse_state mouse, int x, int y);
 
 
+/**
+ * Drop any pointer movement waiting to be handled.
+ *
+ * Movement without buttons held is handled by html_mouse_track at most
+ * once every HTML_MOUSE_TRACK_DELAY ms.
+ *
+ * \param html html content
+ */
+void html_mouse_track_cancel(html_content *html);
+
+
+/**
+ * Forget the mouse action state found for the boxes under the pointer.
+ *
+ * The state is kept while the pointer stays over the same boxes, so
+ * must be forgotten if a box's object, link, gadget or title changes
+ * without the content being reformatted.
+ *
+ * \param html html content
+ */
+void html_mouse_forget_hover(html_content *html);
+
+
 /**
  * Handle mouse clicks and movements in an HTML content window.
  *
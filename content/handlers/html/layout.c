@@ -42,6 +42,7 @@
 #include <string.h>
 #include <math.h>
 #include <dom/dom.h>
+#include <nsutils/time.h>
 
 #include "utils/log.h"
 #include "utils/talloc.h"
@@ -49,6 +50,7 @@
 #include "utils/nsoption.h"
 #include "utils/corestrings.h"
 #include "utils/nsurl.h"
+#include "utils/utf8.h"
 #include "netsurf/inttypes.h"
 #include "netsurf/content.h"
 #include "netsurf/browser_window.h"
@@ -64,6 +66,7 @@
 #include "html/private.h"
 #include "html/box.h"
 #include "html/box_inspect.h"
+#include "html/box_manipulate.h"
 #include "html/font.h"
 #include "html/form_internal.h"
 #include "html/layout.h"
@@ -153,15 +156,15 @@ layout_get_object_dimensions(struct box *box,
 			     int min_width, int max_width,
 			     int min_height, int max_height)
 {
-	assert(box->object != NULL);
+	assert(box_get_object(box) != NULL);
 	assert(width != NULL && height != NULL);
 
 	if (*width == AUTO && *height == AUTO) {
 		/* No given dimensions */
 
 		bool scaled = false;
-		int intrinsic_width = content_get_width(box->object);
-		int intrinsic_height = content_get_height(box->object);
+		int intrinsic_width = content_get_width(box_get_object(box));
+		int intrinsic_height = content_get_height(box_get_object(box));
 
 		/* use intrinsic dimensions */
 		*width = intrinsic_width;
@@ -203,8 +206,8 @@ layout_get_object_dimensions(struct box *box,
 	} else if (*width == AUTO) {
 		/* Have given height; width is calculated from the given height
 		 * and ratio of intrinsic dimensions */
-		int intrinsic_width = content_get_width(box->object);
-		int intrinsic_height = content_get_height(box->object);
+		int intrinsic_width = content_get_width(box_get_object(box));
+		int intrinsic_height = content_get_height(box_get_object(box));
 
 		if (intrinsic_height != 0)
 			*width = (*height * intrinsic_width) /
@@ -220,8 +223,8 @@ layout_get_object_dimensions(struct box *box,
 	} else if (*height == AUTO) {
 		/* Have given width; height is calculated from the given width
 		 * and ratio of intrinsic dimensions */
-		int intrinsic_width = content_get_width(box->object);
-		int intrinsic_height = content_get_height(box->object);
+		int intrinsic_width = content_get_width(box_get_object(box));
+		int intrinsic_height = content_get_height(box_get_object(box));
 
 		if (min_width >  0 && min_width > *width)
 			*width = min_width;
@@ -359,15 +362,16 @@ static void layout_minmax_table(struct box *table,
 	if (table->max_width != UNKNOWN_MAX_WIDTH)
 		return;
 
-	if (table_calculate_column_types(&content->unit_len_ctx, table) == false) {
+	if (table_calculate_column_types(&content->unit_len_ctx, table,
+			content->bctx) == false) {
 		NSLOG(netsurf, WARNING,
 				"Could not establish table column types.");
 		return;
 	}
-	col = table->col;
+	col = box_get_col(table);
 
 	/* start with 0 except for fixed-width columns */
-	for (i = 0; i != table->columns; i++) {
+	for (i = 0; i != box_get_columns(table); i++) {
 		if (col[i].type == COLUMN_WIDTH_FIXED)
 			col[i].min = col[i].max = col[i].width;
 		else
@@ -388,6 +392,11 @@ static void layout_minmax_table(struct box *table,
 				h, hu));
 	}
 
+	/* with fixed layout, cell content does not affect column widths,
+	 * and cells find their own min/max widths as they are laid out */
+	if (table_is_fixed_layout(table))
+		goto column_widths_found;
+
 	/* 1st pass: consider cells with colspan 1 only */
 	for (row_group = table->children; row_group; row_group =row_group->next)
 	for (row = row_group->children; row; row = row->next)
@@ -396,13 +405,13 @@ static void layout_minmax_table(struct box *table,
 		assert(cell->style);
 		/** TODO: Handle colspan="0" correctly.
 		 *        It's currently converted to 1 in box normaisation */
-		assert(cell->columns != 0);
+		assert(box_get_columns(cell) != 0);
 
-		if (cell->columns != 1)
+		if (box_get_columns(cell) != 1)
 			continue;
 
 		layout_minmax_block(cell, font_func, content);
-		i = cell->start_column;
+		i = box_get_start_column(cell);
 
 		if (col[i].positioned)
 			continue;
@@ -421,29 +430,29 @@ static void layout_minmax_table(struct box *table,
 		unsigned int flexible_columns = 0;
 		int min = 0, max = 0, fixed_width = 0, extra;
 
-		if (cell->columns == 1)
+		if (box_get_columns(cell) == 1)
 			continue;
 
 		layout_minmax_block(cell, font_func, content);
-		i = cell->start_column;
+		i = box_get_start_column(cell);
 
 		/* find min width so far of spanned columns, and count
 		 * number of non-fixed spanned columns and total fixed width */
-		for (j = 0; j != cell->columns; j++) {
+		for (j = 0; j != box_get_columns(cell); j++) {
 			min += col[i + j].min;
 			if (col[i + j].type == COLUMN_WIDTH_FIXED)
 				fixed_width += col[i + j].width;
 			else
 				flexible_columns++;
 		}
-		min += (cell->columns - 1) * border_spacing_h;
+		min += (box_get_columns(cell) - 1) * border_spacing_h;
 
 		/* distribute extra min to spanned columns */
 		if (min < cell->min_width) {
 			if (flexible_columns == 0) {
 				extra = 1 + (cell->min_width - min) /
-						cell->columns;
-				for (j = 0; j != cell->columns; j++) {
+						box_get_columns(cell);
+				for (j = 0; j != box_get_columns(cell); j++) {
 					col[i + j].min += extra;
 					if (col[i + j].max < col[i + j].min)
 						col[i + j].max = col[i + j].min;
@@ -451,7 +460,7 @@ static void layout_minmax_table(struct box *table,
 			} else {
 				extra = 1 + (cell->min_width - min) /
 						flexible_columns;
-				for (j = 0; j != cell->columns; j++) {
+				for (j = 0; j != box_get_columns(cell); j++) {
 					if (col[i + j].type !=
 							COLUMN_WIDTH_FIXED) {
 						col[i + j].min += extra;
@@ -465,20 +474,21 @@ static void layout_minmax_table(struct box *table,
 		}
 
 		/* find max width so far of spanned columns */
-		for (j = 0; j != cell->columns; j++)
+		for (j = 0; j != box_get_columns(cell); j++)
 			max += col[i + j].max;
-		max += (cell->columns - 1) * border_spacing_h;
+		max += (box_get_columns(cell) - 1) * border_spacing_h;
 
 		/* distribute extra max to spanned columns */
 		if (max < cell->max_width && flexible_columns) {
 			extra = 1 + (cell->max_width - max) / flexible_columns;
-			for (j = 0; j != cell->columns; j++)
+			for (j = 0; j != box_get_columns(cell); j++)
 				if (col[i + j].type != COLUMN_WIDTH_FIXED)
 					col[i + j].max += extra;
 		}
 	}
 
-	for (i = 0; i != table->columns; i++) {
+column_widths_found:
+	for (i = 0; i != box_get_columns(table); i++) {
 		if (col[i].max < col[i].min) {
 			box_dump(stderr, table, 0, true);
 			assert(0);
@@ -515,8 +525,8 @@ static void layout_minmax_table(struct box *table,
 		extra_frac = 0.9;
 	table->min_width = (table_min + extra_fixed) / (1.0 - extra_frac);
 	table->max_width = (table_max + extra_fixed) / (1.0 - extra_frac);
-	table->min_width += (table->columns + 1) * border_spacing_h;
-	table->max_width += (table->columns + 1) * border_spacing_h;
+	table->min_width += (box_get_columns(table) + 1) * border_spacing_h;
+	table->max_width += (box_get_columns(table) + 1) * border_spacing_h;
 
 	assert(0 <= table->min_width && table->min_width <= table->max_width);
 }
@@ -539,6 +549,500 @@ static inline bool box_has_percentage_max_width(struct box *b)
 	return ((type == CSS_MAX_WIDTH_SET) && (unit == CSS_UNIT_PCT));
 }
 
+/** Text boxes shorter than this, in bytes, don't keep their line break
+ * opportunities between layouts */
+#define LAYOUT_TEXT_BREAKS_MIN 128
+
+/**
+ * Line breaking classes, a subset of those of UAX #14.
+ */
+enum layout_break_class {
+	LAYOUT_BREAK_AL, /**< ordinary character */
+	LAYOUT_BREAK_NU, /**< digit */
+	LAYOUT_BREAK_SP, /**< space, break after a run of them */
+	LAYOUT_BREAK_HY, /**< hyphen, break after one within a word */
+	LAYOUT_BREAK_ID, /**< ideograph, break before or after */
+	LAYOUT_BREAK_OP, /**< opening punctuation, no break after */
+	LAYOUT_BREAK_CL  /**< closing punctuation, no break before */
+};
+
+/**
+ * Run of text up to a line break opportunity.
+ */
+struct layout_text_segment {
+	size_t start; /**< offset of first byte */
+	size_t end; /**< offset after last byte that isn't a trailing space */
+	int x; /**< width of the text before the segment */
+};
+
+/**
+ * Line break opportunities in the text of a box.
+ *
+ * Kept for a long text box the first time it is measured or split, and
+ * reached from the box extension data, so the clones split from the box,
+ * which hold suffixes of the same text, share it.  The segments depend
+ * only on the text; their widths are measured again when the font style
+ * or font options change.
+ */
+struct layout_text_breaks {
+	const char *text; /**< text the segments were found in */
+	size_t length; /**< length of text in bytes */
+	plot_font_style_t fstyle; /**< style the widths were measured in */
+	unsigned int generation; /**< font options the widths were measured
+				  * with */
+	bool measured; /**< segment widths are valid for fstyle */
+	int space; /**< width of a space */
+	unsigned int count; /**< number of segments */
+	/** segments, followed by one starting at length */
+	struct layout_text_segment *segment;
+};
+
+
+/**
+ * Get the line breaking class of a character.
+ *
+ * \param  c  unicode character
+ * \return  line breaking class of c
+ */
+static enum layout_break_class layout_break_class(uint32_t c)
+{
+	if (c >= '0' && c <= '9')
+		return LAYOUT_BREAK_NU;
+
+	switch (c) {
+	case ' ':
+		return LAYOUT_BREAK_SP;
+	case '-': case 0x2010: /* hyphen */
+		return LAYOUT_BREAK_HY;
+	case '(': case '[': case '{':
+	case 0x3008: case 0x300a: case 0x300c: case 0x300e: case 0x3010:
+	case 0x3014: case 0x3016: case 0x3018: case 0x301a:
+	case 0xff08: case 0xff3b: case 0xff5b:
+		return LAYOUT_BREAK_OP;
+	case ')': case ']': case '}': case '!': case ',': case '.':
+	case ':': case ';': case '?':
+	case 0x3001: case 0x3002: case 0x3005: case 0x3009: case 0x300b:
+	case 0x300d: case 0x300f: case 0x3011: case 0x3015: case 0x3017:
+	case 0x3019: case 0x301b: case 0x309d: case 0x309e: case 0x30fb:
+	case 0x30fc: case 0x30fd: case 0x30fe:
+	case 0xff01: case 0xff09: case 0xff0c: case 0xff0e: case 0xff1a:
+	case 0xff1b: case 0xff1f: case 0xff3d: case 0xff5d:
+		return LAYOUT_BREAK_CL;
+	}
+
+	if ((0x2e80 <= c && c <= 0x2fff) || /* radicals */
+			(0x3000 <= c && c <= 0x31ff) || /* punctuation, kana */
+			(0x3400 <= c && c <= 0x4dbf) || /* ideographs */
+			(0x4e00 <= c && c <= 0x9fff) ||
+			(0xa000 <= c && c <= 0xa4cf) || /* yi */
+			(0xac00 <= c && c <= 0xd7a3) || /* hangul */
+			(0xf900 <= c && c <= 0xfaff) || /* compatibility */
+			(0xff01 <= c && c <= 0xff60) || /* fullwidth forms */
+			(0x20000 <= c && c <= 0x3fffd))
+		return LAYOUT_BREAK_ID;
+
+	return LAYOUT_BREAK_AL;
+}
+
+
+/**
+ * Find whether a line may be broken between two characters.
+ *
+ * \param  before  class of the character before prev
+ * \param  prev    class of the character before the opportunity
+ * \param  next    class of the character after the opportunity
+ * \return  true if the line may be broken between prev and next
+ */
+static bool
+layout_break_between(enum layout_break_class before,
+		enum layout_break_class prev,
+		enum layout_break_class next)
+{
+	if (next == LAYOUT_BREAK_SP || next == LAYOUT_BREAK_CL ||
+			prev == LAYOUT_BREAK_OP)
+		return false;
+
+	if (prev == LAYOUT_BREAK_SP ||
+			prev == LAYOUT_BREAK_ID ||
+			next == LAYOUT_BREAK_ID)
+		return true;
+
+	/* break after a hyphen joining two words, but not in "-1" */
+	return prev == LAYOUT_BREAK_HY &&
+			(before == LAYOUT_BREAK_AL ||
+			 before == LAYOUT_BREAK_NU) &&
+			next == LAYOUT_BREAK_AL;
+}
+
+
+/**
+ * Find the end of a segment of text.
+ *
+ * \param  text    UTF-8 text
+ * \param  length  length of text in bytes
+ * \param  start   offset of the start of the segment
+ * \param  end     updated to offset after the last character of the
+ *                 segment that isn't a trailing space
+ * \return  offset of the start of the next segment, or length
+ */
+static size_t
+layout_text_segment_end(const char *text,
+		size_t length,
+		size_t start,
+		size_t *end)
+{
+	enum layout_break_class before = LAYOUT_BREAK_SP;
+	enum layout_break_class prev = LAYOUT_BREAK_SP;
+	size_t offset = start;
+
+	*end = start;
+
+	while (offset < length) {
+		size_t next = utf8_next(text, length, offset);
+		enum layout_break_class class = layout_break_class(
+				utf8_to_ucs4(text + offset, next - offset));
+
+		/* segments never consist only of spaces */
+		if (*end != start && layout_break_between(before, prev, class))
+			return offset;
+
+		if (class != LAYOUT_BREAK_SP)
+			*end = next;
+		before = prev;
+		prev = class;
+		offset = next;
+	}
+
+	return length;
+}
+
+
+/**
+ * Find the segments of a text.
+ *
+ * \param  text     UTF-8 text
+ * \param  length   length of text in bytes
+ * \param  segment  updated to the segments, followed by one starting at
+ *                  length, or NULL to only count them
+ * \return  number of segments
+ */
+static unsigned int
+layout_text_segments(const char *text,
+		size_t length,
+		struct layout_text_segment *segment)
+{
+	unsigned int count = 0;
+	size_t offset = 0;
+	size_t end;
+
+	while (offset < length) {
+		size_t next = layout_text_segment_end(text, length, offset,
+				&end);
+
+		if (segment != NULL) {
+			segment[count].start = offset;
+			segment[count].end = end;
+		}
+		count++;
+		offset = next;
+	}
+
+	if (segment != NULL) {
+		segment[count].start = length;
+		segment[count].end = length;
+	}
+
+	return count;
+}
+
+
+/**
+ * Find the line break opportunities in the text of a box.
+ *
+ * \param  content  html content the box belongs to
+ * \param  box      text box
+ * \return  line break opportunities, or NULL on memory exhaustion
+ */
+static struct layout_text_breaks *
+layout_text_breaks_create(const html_content *content, struct box *box)
+{
+	struct layout_text_breaks *breaks;
+	struct box_ext *ext;
+	unsigned int count;
+
+	ext = box_ensure_ext(box, content->bctx);
+	if (ext == NULL)
+		return NULL;
+
+	count = layout_text_segments(box->text, box->length, NULL);
+
+	breaks = talloc(content->bctx, struct layout_text_breaks);
+	if (breaks == NULL)
+		return NULL;
+
+	breaks->segment = talloc_array(breaks, struct layout_text_segment,
+			count + 1);
+	if (breaks->segment == NULL) {
+		talloc_free(breaks);
+		return NULL;
+	}
+
+	layout_text_segments(box->text, box->length, breaks->segment);
+
+	breaks->text = box->text;
+	breaks->length = box->length;
+	breaks->measured = false;
+	breaks->count = count;
+
+	ext->breaks = breaks;
+
+	return breaks;
+}
+
+
+/**
+ * Measure the segments of a text for a font style.
+ *
+ * \param  breaks     line break opportunities to measure
+ * \param  fstyle     font style of the text
+ * \param  content    html content the text belongs to
+ * \return  NSERROR_OK or appropriate error code on failure
+ */
+static nserror
+layout_text_breaks_measure(struct layout_text_breaks *breaks,
+		const plot_font_style_t *fstyle,
+		const html_content *content)
+{
+	const struct gui_layout_table *font_func = content->font_func;
+	struct layout_text_segment *segment = breaks->segment;
+	nserror res;
+	unsigned int i;
+	int x = 0;
+
+	if (breaks->measured &&
+			breaks->generation == content->font_generation &&
+			breaks->fstyle.families == fstyle->families &&
+			breaks->fstyle.family == fstyle->family &&
+			breaks->fstyle.size == fstyle->size &&
+			breaks->fstyle.weight == fstyle->weight &&
+			breaks->fstyle.flags == fstyle->flags)
+		return NSERROR_OK;
+
+	breaks->measured = false;
+
+	res = font_func->width(fstyle, " ", 1, &breaks->space);
+	if (res != NSERROR_OK)
+		return res;
+
+	for (i = 0; i != breaks->count; i++) {
+		int width = 0;
+
+		segment[i].x = x;
+		if (segment[i].end != segment[i].start) {
+			res = font_func->width(fstyle,
+					breaks->text + segment[i].start,
+					segment[i].end - segment[i].start,
+					&width);
+			if (res != NSERROR_OK)
+				return res;
+		}
+		x += width + (segment[i + 1].start - segment[i].end) *
+				breaks->space;
+	}
+	segment[breaks->count].x = x;
+
+	breaks->fstyle = *fstyle;
+	breaks->generation = content->font_generation;
+	breaks->measured = true;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Find the segment of a text starting at an offset.
+ *
+ * \param  breaks  line break opportunities of the text
+ * \param  offset  offset in text
+ * \param  index   updated to index of the last segment starting at or
+ *                 before offset
+ * \return  true if a segment starts at offset
+ */
+static bool
+layout_text_breaks_find(const struct layout_text_breaks *breaks,
+		size_t offset,
+		unsigned int *index)
+{
+	unsigned int lo = 0;
+	unsigned int hi = breaks->count;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo + 1) / 2;
+
+		if (breaks->segment[mid].start <= offset)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	*index = lo;
+
+	return breaks->segment[lo].start == offset;
+}
+
+
+/**
+ * Find where to split a text box using its line break opportunities.
+ *
+ * The break is chosen from the summed widths of the segments, which
+ * leave out any kerning between them, so the text before it is then
+ * measured in one go to confirm it fits.
+ *
+ * \param  breaks     measured line break opportunities of the box's text
+ * \param  content    html content the box belongs to
+ * \param  fstyle     font style of the box's text
+ * \param  split_box  text box to split
+ * \param  available  width available
+ * \param  split      updated to offset in the box's text of split point
+ * \param  width      updated to width of the text before split point
+ * \return  true on success, false if the box's text isn't covered
+ */
+static bool
+layout_text_breaks_split(const struct layout_text_breaks *breaks,
+		const html_content *content,
+		const plot_font_style_t *fstyle,
+		const struct box *split_box,
+		int available,
+		size_t *split,
+		int *width)
+{
+	const struct gui_layout_table *font_func = content->font_func;
+	const struct layout_text_segment *segment = breaks->segment;
+	size_t start, end;
+	unsigned int first, last, lo, hi;
+	int x0;
+
+	if (split_box->length == 0 ||
+			split_box->text < breaks->text ||
+			split_box->text > breaks->text + breaks->length ||
+			split_box->length >
+			breaks->length - (split_box->text - breaks->text))
+		return false;
+
+	start = split_box->text - breaks->text;
+	end = start + split_box->length;
+
+	/* the box must start at a segment, and end at the end of one */
+	if (!layout_text_breaks_find(breaks, start, &first) ||
+			first == breaks->count)
+		return false;
+	layout_text_breaks_find(breaks, end - 1, &last);
+	if (end != segment[last].end && end != segment[last + 1].start)
+		return false;
+
+	/* find the last segment ending within the available width; the
+	 * width to the end of a segment only increases along the text */
+	x0 = segment[first].x;
+	lo = first;
+	hi = last;
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo + 1) / 2;
+		int x = segment[mid + 1].x - x0 -
+				(segment[mid + 1].start - segment[mid].end) *
+				breaks->space;
+
+		if (x <= available)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	while (true) {
+		if (lo == last) {
+			/* no split needed, or the text can't be split */
+			*split = split_box->length;
+		} else {
+			*split = segment[lo].end - start;
+		}
+
+		if (font_func->width(fstyle, split_box->text, *split,
+				width) != NSERROR_OK)
+			return false;
+
+		if (*width <= available || lo == first)
+			break;
+
+		/* kerning made the text too wide, use the break before */
+		lo--;
+	}
+
+	return true;
+}
+
+
+/**
+ * Find the width of the widest segment of the text of a box.
+ *
+ * The text is divided as it would be to split the box, so this is the
+ * narrowest the box can be broken to.
+ *
+ * \param  content  html content the box belongs to
+ * \param  fstyle   font style of the box's text
+ * \param  box      text box
+ * \return  width of the widest segment
+ */
+static int
+layout_text_min_width(const html_content *content,
+		const plot_font_style_t *fstyle,
+		struct box *box)
+{
+	const struct gui_layout_table *font_func = content->font_func;
+	struct layout_text_breaks *breaks = NULL;
+	size_t offset = 0;
+	size_t end;
+	int min = 0;
+	int width;
+
+	if (box->ext != NULL)
+		breaks = box->ext->breaks;
+
+	if (breaks == NULL && box->length >= LAYOUT_TEXT_BREAKS_MIN)
+		breaks = layout_text_breaks_create(content, box);
+
+	if (breaks != NULL && breaks->text == box->text &&
+			breaks->length == box->length &&
+			layout_text_breaks_measure(breaks, fstyle,
+					content) == NSERROR_OK) {
+		const struct layout_text_segment *segment = breaks->segment;
+		unsigned int i;
+
+		for (i = 0; i != breaks->count; i++) {
+			width = segment[i + 1].x - segment[i].x -
+					(segment[i + 1].start -
+					 segment[i].end) * breaks->space;
+			if (min < width)
+				min = width;
+		}
+
+		return min;
+	}
+
+	while (offset < box->length) {
+		size_t next = layout_text_segment_end(box->text, box->length,
+				offset, &end);
+
+		font_func->width(fstyle, box->text + offset, end - offset,
+				&width);
+		if (min < width)
+			min = width;
+
+		offset = next;
+	}
+
+	return min;
+}
+
+
 /**
  * Calculate minimum and maximum width of a line.
  *
@@ -562,7 +1066,6 @@ layout_minmax_line(struct box *first,
 {
 	int min = 0, max = 0, width, height, fixed;
 	float frac;
-	size_t i, j;
 	struct box *b;
 	struct box *block;
 	plot_font_style_t fstyle;
@@ -631,7 +1134,7 @@ layout_minmax_line(struct box *first,
 		assert(b->style);
 		font_plot_style_from_css(&content->unit_len_ctx, b->style, &fstyle);
 
-		if (b->type == BOX_INLINE && !b->object &&
+		if (b->type == BOX_INLINE && !box_get_object(b) &&
 				!(b->flags & REPLACE_DIM) &&
 				!(b->flags & IFRAME)) {
 			fixed = frac = 0;
@@ -668,7 +1171,8 @@ layout_minmax_line(struct box *first,
 			continue;
 		}
 
-		if (!b->object && !(b->flags & IFRAME) && !b->gadget &&
+		if (!box_get_object(b) && !(b->flags & IFRAME) &&
+				!box_get_gadget(b) &&
 				!(b->flags & REPLACE_DIM)) {
 			/* inline non-replaced, 10.3.1 and 10.6.1 */
 			bool no_wrap_box;
@@ -681,18 +1185,18 @@ layout_minmax_line(struct box *first,
 					CSS_WHITE_SPACE_PRE);
 
 			if (b->width == UNKNOWN_WIDTH) {
+				struct form_control *gadget =
+					box_get_gadget(b->parent->parent);
+
 				/** \todo handle errors */
 
 				/* If it's a select element, we must use the
 				 * width of the widest option text */
-				if (b->parent->parent->gadget &&
-						b->parent->parent->gadget->type
-						== GADGET_SELECT) {
+				if (gadget && gadget->type == GADGET_SELECT) {
 					int opt_maxwidth = 0;
 					struct form_option *o;
 
-					for (o = b->parent->parent->gadget->
-							data.select.items; o;
+					for (o = gadget->data.select.items; o;
 							o = o->next) {
 						int opt_width;
 						font_func->width(&fstyle,
@@ -738,18 +1242,11 @@ layout_minmax_line(struct box *first,
 				/* If we care what the minimum width is,
 				 * calculate it.  (It's only needed if we're
 				 * shrinking-to-fit.) */
-				/* min = widest single word */
-				i = 0;
-				do {
-					for (j = i; j != b->length &&
-							b->text[j] != ' '; j++)
-						;
-					font_func->width(&fstyle, b->text + i,
-							 j - i, &width);
-					if (min < width)
-						min = width;
-					i = j + 1;
-				} while (j != b->length);
+				/* min = widest text between line breaks */
+				width = layout_text_min_width(content,
+						&fstyle, b);
+				if (min < width)
+					min = width;
 			}
 
 			*line_has_height = true;
@@ -804,8 +1301,8 @@ layout_minmax_line(struct box *first,
 			height = AUTO;
 		}
 
-		if (b->object || (b->flags & REPLACE_DIM)) {
-			if (b->object) {
+		if (box_get_object(b) || (b->flags & REPLACE_DIM)) {
+			if (box_get_object(b)) {
 				int temp_height = height;
 				layout_get_object_dimensions(b,
 						&width, &temp_height,
@@ -966,6 +1463,8 @@ static void layout_minmax_block(
 		const struct gui_layout_table *font_func,
 		const html_content *content)
 {
+	struct form_control *gadget = box_get_gadget(block);
+	struct hlcache_handle *object = box_get_object(block);
 	struct box *child;
 	int min = 0, max = 0;
 	int extra_fixed = 0;
@@ -1009,10 +1508,10 @@ static void layout_minmax_block(
 		block->flags |= NEED_MIN;
 	}
 
-	if (block->gadget && (block->gadget->type == GADGET_TEXTBOX ||
-			block->gadget->type == GADGET_PASSWORD ||
-			block->gadget->type == GADGET_FILE ||
-			block->gadget->type == GADGET_TEXTAREA) &&
+	if (gadget && (gadget->type == GADGET_TEXTBOX ||
+			gadget->type == GADGET_PASSWORD ||
+			gadget->type == GADGET_FILE ||
+			gadget->type == GADGET_TEXTAREA) &&
 			block->style && wtype == CSS_WIDTH_AUTO) {
 		css_fixed size = INTTOFIX(10);
 		css_unit unit = CSS_UNIT_EM;
@@ -1023,8 +1522,8 @@ static void layout_minmax_block(
 		block->flags |= HAS_HEIGHT;
 	}
 
-	if (block->gadget && (block->gadget->type == GADGET_RADIO ||
-			block->gadget->type == GADGET_CHECKBOX) &&
+	if (gadget && (gadget->type == GADGET_RADIO ||
+			gadget->type == GADGET_CHECKBOX) &&
 			block->style && wtype == CSS_WIDTH_AUTO) {
 		css_fixed size = INTTOFIX(1);
 		css_unit unit = CSS_UNIT_EM;
@@ -1037,14 +1536,14 @@ static void layout_minmax_block(
 		block->flags |= HAS_HEIGHT;
 	}
 
-	if (block->object) {
-		if (content_get_type(block->object) == CONTENT_HTML) {
-			layout_minmax_block(html_get_box_tree(block->object),
+	if (object) {
+		if (content_get_type(object) == CONTENT_HTML) {
+			layout_minmax_block(html_get_box_tree(object),
 					font_func, content);
-			min = html_get_box_tree(block->object)->min_width;
-			max = html_get_box_tree(block->object)->max_width;
+			min = html_get_box_tree(object)->min_width;
+			max = html_get_box_tree(object)->max_width;
 		} else {
-			min = max = content_get_width(block->object);
+			min = max = content_get_width(object);
 		}
 
 		block->flags |= HAS_HEIGHT;
@@ -1587,21 +2086,25 @@ layout_next_margin_block(const css_unit_ctx *unit_len_ctx,
 						viewport_height, box,
 						box->style,
 						NULL, NULL, NULL, NULL,
-						NULL, NULL, box->margin,
-						box->padding, box->border);
+						NULL, NULL, box->edges->margin,
+						box->edges->padding,
+						box->edges->border);
 
 				/* Apply top margin */
-				if (*max_pos_margin < box->margin[TOP])
-					*max_pos_margin = box->margin[TOP];
-				else if (*max_neg_margin < -box->margin[TOP])
-					*max_neg_margin = -box->margin[TOP];
+				if (*max_pos_margin < box->edges->margin[TOP])
+					*max_pos_margin =
+						box->edges->margin[TOP];
+				else if (*max_neg_margin <
+						-box->edges->margin[TOP])
+					*max_neg_margin =
+						-box->edges->margin[TOP];
 			}
 
 			/* Check whether box is the box current margin collapses
 			 * to */
 			if (box->flags & MAKE_HEIGHT ||
-					box->border[TOP].width ||
-					box->padding[TOP] ||
+					box->edges->border[TOP].width ||
+					box->edges->padding[TOP] ||
 					(box->style &&
 					css_computed_overflow_y(box->style) !=
 					CSS_OVERFLOW_VISIBLE) ||
@@ -1614,7 +2117,8 @@ layout_next_margin_block(const css_unit_ctx *unit_len_ctx,
 
 
 		/* Find next box */
-		if (box->type == BOX_BLOCK && !box->object && box->children &&
+		if (box->type == BOX_BLOCK && !box_get_object(box) &&
+				box->children &&
 				box->style &&
 				css_computed_overflow_y(box->style) ==
 				CSS_OVERFLOW_VISIBLE) {
@@ -1625,15 +2129,13 @@ layout_next_margin_block(const css_unit_ctx *unit_len_ctx,
 				/* No more siblings:
 				 * Go up to first ancestor with a sibling. */
 				do {
+					int bottom = box->edges->margin[BOTTOM];
+
 					/* Apply bottom margin */
-					if (*max_pos_margin <
-							box->margin[BOTTOM])
-						*max_pos_margin =
-							box->margin[BOTTOM];
-					else if (*max_neg_margin <
-							-box->margin[BOTTOM])
-						*max_neg_margin =
-							-box->margin[BOTTOM];
+					if (*max_pos_margin < bottom)
+						*max_pos_margin = bottom;
+					else if (*max_neg_margin < -bottom)
+						*max_neg_margin = -bottom;
 
 					box = box->parent;
 				} while (box != block && !box->next);
@@ -1647,10 +2149,11 @@ layout_next_margin_block(const css_unit_ctx *unit_len_ctx,
 			}
 
 			/* Apply bottom margin */
-			if (*max_pos_margin < box->margin[BOTTOM])
-				*max_pos_margin = box->margin[BOTTOM];
-			else if (*max_neg_margin < -box->margin[BOTTOM])
-				*max_neg_margin = -box->margin[BOTTOM];
+			if (*max_pos_margin < box->edges->margin[BOTTOM])
+				*max_pos_margin = box->edges->margin[BOTTOM];
+			else if (*max_neg_margin <
+					-box->edges->margin[BOTTOM])
+				*max_neg_margin = -box->edges->margin[BOTTOM];
 
 			/* To next sibling. */
 			box = box->next;
@@ -1662,8 +2165,9 @@ layout_next_margin_block(const css_unit_ctx *unit_len_ctx,
 						viewport_height, box,
 						box->style,
 						NULL, NULL, NULL, NULL,
-						NULL, NULL, box->margin,
-						box->padding, box->border);
+						NULL, NULL, box->edges->margin,
+						box->edges->padding,
+						box->edges->border);
 			}
 		}
 	}
@@ -1672,17 +2176,293 @@ layout_next_margin_block(const css_unit_ctx *unit_len_ctx,
 }
 
 
+/**
+ * Vertical extent of a range of floats in a float index.
+ */
+struct layout_float_range {
+	int y0; /**< Highest top edge */
+	int y1; /**< Lowest bottom edge */
+};
+
+/**
+ * Index of the floats in a block formatting context.
+ *
+ * Floats are kept in the order they were placed, which is close to top
+ * to bottom order, at the leaves of an implicit binary tree.  Each tree
+ * node holds the vertical extent of the floats below it, so finding the
+ * floats beside a band of the context only visits floats near the band.
+ */
+struct layout_float_index {
+	struct box *cont; /**< Block formatting context box */
+	struct box **floats; /**< Floats in placement order */
+	struct layout_float_range *tree; /**< Tree, with root at index 1 */
+	unsigned int count; /**< Number of floats */
+	unsigned int size; /**< Number of tree leaves, a power of two */
+	int left_bottom; /**< Lowest bottom edge of a left float, or 0 */
+	int right_bottom; /**< Lowest bottom edge of a right float, or 0 */
+	bool failed; /**< Index is incomplete due to memory exhaustion */
+};
+
+
+/**
+ * Initialise a float index for a block formatting context.
+ *
+ * \param  index  float index to initialise
+ * \param  cont   block formatting context box
+ */
+static void
+layout_float_index_init(struct layout_float_index *index, struct box *cont)
+{
+	index->cont = cont;
+	index->floats = NULL;
+	index->tree = NULL;
+	index->count = 0;
+	index->size = 0;
+	index->left_bottom = 0;
+	index->right_bottom = 0;
+	index->failed = false;
+}
+
+
+/**
+ * Release the storage of a float index.
+ *
+ * \param  index  float index to finalise
+ */
+static void layout_float_index_fini(struct layout_float_index *index)
+{
+	free(index->floats);
+	free(index->tree);
+}
+
+
+/**
+ * Get the float index for a block formatting context, if there is one.
+ *
+ * \param  content  content being laid out
+ * \param  cont     block formatting context box
+ * \return float index of cont, or NULL if the float list must be used
+ */
+static const struct layout_float_index *
+layout_float_index_get(const html_content *content, const struct box *cont)
+{
+	const struct layout_float_index *index = content->float_index;
+
+	if (index == NULL || index->cont != cont || index->failed)
+		return NULL;
+
+	return index;
+}
+
+
+/**
+ * Recalculate the vertical extent of a float index tree node.
+ *
+ * \param  tree  float index tree
+ * \param  node  node to update from its children
+ */
+static inline void
+layout_float_index_update(struct layout_float_range *tree, unsigned int node)
+{
+	const struct layout_float_range *l = &tree[2 * node];
+	const struct layout_float_range *r = &tree[2 * node + 1];
+
+	tree[node].y0 = l->y0 < r->y0 ? l->y0 : r->y0;
+	tree[node].y1 = l->y1 > r->y1 ? l->y1 : r->y1;
+}
+
+
+/**
+ * Add a positioned float to a float index.
+ *
+ * \param  content  content being laid out
+ * \param  cont     block formatting context box of the float
+ * \param  b        float box, with its final position
+ */
+static void
+layout_float_index_add(html_content *content,
+		struct box *cont,
+		struct box *b)
+{
+	struct layout_float_index *index = content->float_index;
+	unsigned int node;
+
+	if (index == NULL || index->cont != cont || index->failed)
+		return;
+
+	if (b->type == BOX_FLOAT_LEFT) {
+		if (index->left_bottom < b->y + b->height)
+			index->left_bottom = b->y + b->height;
+	} else {
+		if (index->right_bottom < b->y + b->height)
+			index->right_bottom = b->y + b->height;
+	}
+
+	if (index->count == index->size) {
+		/* Grow the tree, and rebuild it above the leaves */
+		unsigned int size = index->size ? index->size * 2 : 16;
+		struct layout_float_range *tree;
+		struct box **floats;
+		unsigned int i;
+
+		floats = realloc(index->floats, size * sizeof(*floats));
+		if (floats == NULL) {
+			index->failed = true;
+			return;
+		}
+		index->floats = floats;
+
+		tree = malloc(2 * size * sizeof(*tree));
+		if (tree == NULL) {
+			index->failed = true;
+			return;
+		}
+
+		for (i = 0; i < size; i++) {
+			if (i < index->count) {
+				tree[size + i].y0 = floats[i]->y;
+				tree[size + i].y1 = floats[i]->y +
+						floats[i]->height;
+			} else {
+				tree[size + i].y0 = INT_MAX;
+				tree[size + i].y1 = INT_MIN;
+			}
+		}
+		for (i = size - 1; i > 0; i--) {
+			layout_float_index_update(tree, i);
+		}
+
+		free(index->tree);
+		index->tree = tree;
+		index->size = size;
+	}
+
+	index->floats[index->count] = b;
+	node = index->size + index->count;
+	index->tree[node].y0 = b->y;
+	index->tree[node].y1 = b->y + b->height;
+	for (node /= 2; node > 0; node /= 2) {
+		layout_float_index_update(index->tree, node);
+	}
+	index->count++;
+}
+
+
+/**
+ * Check if one float comes before another in a float_children list.
+ *
+ * Lists are sorted by decreasing bottom edge, with later floats first
+ * where the bottom edges are equal.
+ *
+ * \param  a        float to test
+ * \param  a_order  placement order of a
+ * \param  b        float to test against
+ * \param  b_order  placement order of b
+ * \return  true if a comes before b
+ */
+static inline bool
+layout_float_precedes(const struct box *a, unsigned int a_order,
+		const struct box *b, unsigned int b_order)
+{
+	int a_bottom = a->y + a->height;
+	int b_bottom = b->y + b->height;
+
+	return a_bottom > b_bottom || (a_bottom == b_bottom &&
+			a_order > b_order);
+}
+
+
+/**
+ * Find left and right edges in a vertical range from a float index.
+ *
+ * Gives the same result as walking the float_children list.
+ *
+ * \param  index  float index
+ * \param  node   tree node to search below
+ * \param  y0	  start of y range to search
+ * \param  y1	  end of y range to search
+ * \param  x0	  left edge, updated to available left edge
+ * \param  x1	  right edge, updated to available right edge
+ * \param  left	  float on left, updated if another is found
+ * \param  l_order placement order of left
+ * \param  right  float on right, updated if another is found
+ * \param  r_order placement order of right
+ */
+static void
+layout_float_index_sides(const struct layout_float_index *index,
+		unsigned int node,
+		int y0, int y1,
+		int *x0, int *x1,
+		struct box **left, unsigned int *l_order,
+		struct box **right, unsigned int *r_order)
+{
+	struct box *fl;
+	unsigned int order;
+
+	if (index->tree[node].y1 <= y0 || index->tree[node].y0 > y1)
+		return;
+
+	if (node < index->size) {
+		layout_float_index_sides(index, 2 * node, y0, y1,
+				x0, x1, left, l_order, right, r_order);
+		layout_float_index_sides(index, 2 * node + 1, y0, y1,
+				x0, x1, left, l_order, right, r_order);
+		return;
+	}
+
+	/* Leaf in use, which overlaps the range */
+	order = node - index->size;
+	fl = index->floats[order];
+	if (fl->type == BOX_FLOAT_LEFT) {
+		int fx1 = fl->x + fl->width;
+		if (*x0 < fx1 || (*x0 == fx1 && *left != NULL &&
+				layout_float_precedes(fl, order,
+						*left, *l_order))) {
+			*x0 = fx1;
+			*left = fl;
+			*l_order = order;
+		}
+	} else {
+		int fx0 = fl->x;
+		if (fx0 < *x1 || (fx0 == *x1 && *right != NULL &&
+				layout_float_precedes(fl, order,
+						*right, *r_order))) {
+			*x1 = fx0;
+			*right = fl;
+			*r_order = order;
+		}
+	}
+}
+
+
 /**
  * Find y coordinate which clears all floats on left and/or right.
  *
- * \param  fl	  first float in float list
- * \param  clear  type of clear
+ * \param  cont	    block formatting context box
+ * \param  clear    type of clear
+ * \param  content  content being laid out
  * \return  y coordinate relative to ancestor box for floats
  */
-static int layout_clear(struct box *fl, enum css_clear_e clear)
+static int
+layout_clear(struct box *cont,
+	     enum css_clear_e clear,
+	     const html_content *content)
 {
+	const struct layout_float_index *index;
+	struct box *fl;
 	int y = 0;
-	for (; fl; fl = fl->next_float) {
+
+	index = layout_float_index_get(content, cont);
+	if (index != NULL) {
+		if (clear == CSS_CLEAR_LEFT || clear == CSS_CLEAR_BOTH)
+			y = index->left_bottom;
+		if ((clear == CSS_CLEAR_RIGHT || clear == CSS_CLEAR_BOTH) &&
+				y < index->right_bottom)
+			y = index->right_bottom;
+		return y;
+	}
+
+	for (fl = cont->float_children; fl; fl = fl->next_float) {
 		if ((clear == CSS_CLEAR_LEFT || clear == CSS_CLEAR_BOTH) &&
 				fl->type == BOX_FLOAT_LEFT)
 			if (y < fl->y + fl->height)
@@ -1699,27 +2479,45 @@ static int layout_clear(struct box *fl, enum css_clear_e clear)
 /**
  * Find left and right edges in a vertical range.
  *
- * \param  fl	  first float in float list
- * \param  y0	  start of y range to search
- * \param  y1	  end of y range to search
- * \param  x0	  start left edge, updated to available left edge
- * \param  x1	  start right edge, updated to available right edge
- * \param  left	  returns float on left if present
- * \param  right  returns float on right if present
+ * \param  cont	    block formatting context box
+ * \param  content  content being laid out
+ * \param  y0	    start of y range to search
+ * \param  y1	    end of y range to search
+ * \param  x0	    start left edge, updated to available left edge
+ * \param  x1	    start right edge, updated to available right edge
+ * \param  left	    returns float on left if present
+ * \param  right    returns float on right if present
  */
 static void
-find_sides(struct box *fl,
+find_sides(struct box *cont,
+	   const html_content *content,
 	   int y0, int y1,
 	   int *x0, int *x1,
 	   struct box **left,
 	   struct box **right)
 {
+	const struct layout_float_index *index;
+	struct box *fl;
 	int fy0, fy1, fx0, fx1;
 
 	NSLOG(layout, DEBUG, "y0 %i, y1 %i, x0 %i, x1 %i", y0, y1, *x0, *x1);
 
 	*left = *right = 0;
-	for (; fl; fl = fl->next_float) {
+
+	index = layout_float_index_get(content, cont);
+	if (index != NULL) {
+		unsigned int l_order = 0, r_order = 0;
+
+		if (index->count != 0)
+			layout_float_index_sides(index, 1, y0, y1, x0, x1,
+					left, &l_order, right, &r_order);
+
+		NSLOG(layout, DEBUG, "x0 %i, x1 %i, left %p, right %p",
+		      *x0, *x1, *left, *right);
+		return;
+	}
+
+	for (fl = cont->float_children; fl; fl = fl->next_float) {
 		fy1 = fl->y + fl->height;
 		if (fy1 < y0) {
 			/* Floats are sorted in order of decreasing bottom pos.
@@ -1777,20 +2575,23 @@ layout_solve_width(struct box *box,
 		   int max_width,
 		   int min_width)
 {
+	int *margin = box->edges->margin;
+	int *padding = box->edges->padding;
+	struct box_border *border = box->edges->border;
 	bool auto_width = false;
 
 	/* Increase specified left/right margins */
-	if (box->margin[LEFT] != AUTO && box->margin[LEFT] < lm &&
-			box->margin[LEFT] >= 0)
-		box->margin[LEFT] = lm;
-	if (box->margin[RIGHT] != AUTO && box->margin[RIGHT] < rm &&
-			box->margin[RIGHT] >= 0)
-		box->margin[RIGHT] = rm;
+	if (margin[LEFT] != AUTO && margin[LEFT] < lm &&
+			margin[LEFT] >= 0)
+		margin[LEFT] = lm;
+	if (margin[RIGHT] != AUTO && margin[RIGHT] < rm &&
+			margin[RIGHT] >= 0)
+		margin[RIGHT] = rm;
 
 	/* Find width */
 	if (width == AUTO) {
-		int margin_left = box->margin[LEFT];
-		int margin_right = box->margin[RIGHT];
+		int margin_left = margin[LEFT];
+		int margin_right = margin[RIGHT];
 
 		if (margin_left == AUTO) {
 			margin_left = lm;
@@ -1800,9 +2601,9 @@ layout_solve_width(struct box *box,
 		}
 
 		width = available_width -
-				(margin_left + box->border[LEFT].width +
-				box->padding[LEFT] + box->padding[RIGHT] +
-				box->border[RIGHT].width + margin_right);
+				(margin_left + border[LEFT].width +
+				padding[LEFT] + padding[RIGHT] +
+				border[RIGHT].width + margin_right);
 		width = width < 0 ? 0 : width;
 		auto_width = true;
 	}
@@ -1822,11 +2623,11 @@ layout_solve_width(struct box *box,
 	/* Width was auto, and unconstrained by min/max width, so we're done */
 	if (auto_width) {
 		/* any other 'auto' become 0 or the minimum required values */
-		if (box->margin[LEFT] == AUTO) {
-			box->margin[LEFT] = lm;
+		if (margin[LEFT] == AUTO) {
+			margin[LEFT] = lm;
 		}
-		if (box->margin[RIGHT] == AUTO) {
-			box->margin[RIGHT] = rm;
+		if (margin[RIGHT] == AUTO) {
+			margin[RIGHT] = rm;
 		}
 		return width;
 	}
@@ -1835,19 +2636,19 @@ layout_solve_width(struct box *box,
 	 * Need to compute left/right margins */
 
 	/* HTML alignment (only applies to over-constrained boxes) */
-	if (box->margin[LEFT] != AUTO && box->margin[RIGHT] != AUTO &&
+	if (margin[LEFT] != AUTO && margin[RIGHT] != AUTO &&
 			box->parent != NULL && box->parent->style != NULL) {
 		switch (css_computed_text_align(box->parent->style)) {
 		case CSS_TEXT_ALIGN_LIBCSS_RIGHT:
-			box->margin[LEFT] = AUTO;
-			box->margin[RIGHT] = 0;
+			margin[LEFT] = AUTO;
+			margin[RIGHT] = 0;
 			break;
 		case CSS_TEXT_ALIGN_LIBCSS_CENTER:
-			box->margin[LEFT] = box->margin[RIGHT] = AUTO;
+			margin[LEFT] = margin[RIGHT] = AUTO;
 			break;
 		case CSS_TEXT_ALIGN_LIBCSS_LEFT:
-			box->margin[LEFT] = 0;
-			box->margin[RIGHT] = AUTO;
+			margin[LEFT] = 0;
+			margin[RIGHT] = AUTO;
 			break;
 		default:
 			/* Leave it alone; no HTML alignment */
@@ -1855,35 +2656,35 @@ layout_solve_width(struct box *box,
 		}
 	}
 
-	if (box->margin[LEFT] == AUTO && box->margin[RIGHT] == AUTO) {
+	if (margin[LEFT] == AUTO && margin[RIGHT] == AUTO) {
 		/* make the margins equal, centering the element */
-		box->margin[LEFT] = box->margin[RIGHT] =
+		margin[LEFT] = margin[RIGHT] =
 				(available_width - lm - rm -
-				(box->border[LEFT].width + box->padding[LEFT] +
-				width + box->padding[RIGHT] +
-				box->border[RIGHT].width)) / 2;
+				(border[LEFT].width + padding[LEFT] +
+				width + padding[RIGHT] +
+				border[RIGHT].width)) / 2;
 
-		if (box->margin[LEFT] < 0) {
-			box->margin[RIGHT] += box->margin[LEFT];
-			box->margin[LEFT] = 0;
+		if (margin[LEFT] < 0) {
+			margin[RIGHT] += margin[LEFT];
+			margin[LEFT] = 0;
 		}
 
-		box->margin[LEFT] += lm;
+		margin[LEFT] += lm;
 
-	} else if (box->margin[LEFT] == AUTO) {
-		box->margin[LEFT] = available_width - lm -
-				(box->border[LEFT].width + box->padding[LEFT] +
-				width + box->padding[RIGHT] +
-				box->border[RIGHT].width + box->margin[RIGHT]);
-		box->margin[LEFT] = box->margin[LEFT] < lm
-				? lm : box->margin[LEFT];
+	} else if (margin[LEFT] == AUTO) {
+		margin[LEFT] = available_width - lm -
+				(border[LEFT].width + padding[LEFT] +
+				width + padding[RIGHT] +
+				border[RIGHT].width + margin[RIGHT]);
+		margin[LEFT] = margin[LEFT] < lm
+				? lm : margin[LEFT];
 	} else {
 		/* margin-right auto or "over-constrained" */
-		box->margin[RIGHT] = available_width - rm -
-				(box->margin[LEFT] + box->border[LEFT].width +
-				 box->padding[LEFT] + width +
-				 box->padding[RIGHT] +
-				 box->border[RIGHT].width);
+		margin[RIGHT] = available_width - rm -
+				(margin[LEFT] + border[LEFT].width +
+				 padding[LEFT] + width +
+				 padding[RIGHT] +
+				 border[RIGHT].width);
 	}
 
 	return width;
@@ -1916,17 +2717,17 @@ layout_block_find_dimensions(const css_unit_ctx *unit_len_ctx,
 {
 	int width, max_width, min_width;
 	int height, max_height, min_height;
-	int *margin = box->margin;
-	int *padding = box->padding;
-	struct box_border *border = box->border;
+	int *margin = box->edges->margin;
+	int *padding = box->edges->padding;
+	struct box_border *border = box->edges->border;
 	const css_computed_style *style = box->style;
 
 	layout_find_dimensions(unit_len_ctx, available_width, viewport_height, box,
 			style, &width, &height, &max_width, &min_width,
 			&max_height, &min_height, margin, padding, border);
 
-	if (box->object && !(box->flags & REPLACE_DIM) &&
-			content_get_type(box->object) != CONTENT_HTML) {
+	if (box_get_object(box) && !(box->flags & REPLACE_DIM) &&
+			content_get_type(box_get_object(box)) != CONTENT_HTML) {
 		/* block-level replaced element, see 10.3.4 and 10.6.2 */
 		layout_get_object_dimensions(box, &width, &height,
 				min_width, max_width, min_height, max_height);
@@ -1964,20 +2765,22 @@ static void layout_block_add_scrollbar(struct box *box, int which)
 	if (which == BOTTOM &&
 			(overflow_x == CSS_OVERFLOW_SCROLL ||
 			 overflow_x == CSS_OVERFLOW_AUTO ||
-			(box->object &&
-			 content_get_type(box->object) == CONTENT_HTML))) {
+			(box_get_object(box) &&
+			 content_get_type(box_get_object(box)) ==
+			 CONTENT_HTML))) {
 		/* make space for scrollbar, unless height is AUTO */
 		if (box->height != AUTO &&
 				(overflow_x == CSS_OVERFLOW_SCROLL ||
 				box_hscrollbar_present(box))) {
-			box->padding[BOTTOM] += SCROLLBAR_WIDTH;
+			box->edges->padding[BOTTOM] += SCROLLBAR_WIDTH;
 		}
 
 	} else if (which == RIGHT &&
 			(overflow_y == CSS_OVERFLOW_SCROLL ||
 			 overflow_y == CSS_OVERFLOW_AUTO ||
-			(box->object &&
-			 content_get_type(box->object) == CONTENT_HTML))) {
+			(box_get_object(box) &&
+			 content_get_type(box_get_object(box)) ==
+			 CONTENT_HTML))) {
 		/* make space for scrollbars, unless width is AUTO */
 		enum css_height_e htype;
 		css_fixed height = 0;
@@ -1989,7 +2792,7 @@ static void layout_block_add_scrollbar(struct box *box, int which)
 				(overflow_y == CSS_OVERFLOW_SCROLL ||
 				box_vscrollbar_present(box))) {
 			box->width -= SCROLLBAR_WIDTH;
-			box->padding[RIGHT] += SCROLLBAR_WIDTH;
+			box->edges->padding[RIGHT] += SCROLLBAR_WIDTH;
 		}
 	}
 }
@@ -2024,8 +2827,9 @@ static void layout_move_children(struct box *box, int x, int y)
 static bool layout_table(struct box *table, int available_width,
 		html_content *content)
 {
-	unsigned int columns = table->columns;  /* total columns */
+	unsigned int columns = box_get_columns(table);  /* total columns */
 	unsigned int i;
+	bool fixed = table_is_fixed_layout(table);
 	unsigned int *row_span;
 	int *excess_y;
 	int table_width, min_width = 0, max_width = 0;
@@ -2072,12 +2876,13 @@ static bool layout_table(struct box *table, int available_width,
 		return false;
 	}
 
-	memcpy(col, table->col, sizeof(col[0]) * columns);
+	memcpy(col, box_get_col(table), sizeof(col[0]) * columns);
 
 	/* find margins, paddings, and borders for table and cells */
 	layout_find_dimensions(&content->unit_len_ctx, available_width, -1, table,
-			style, 0, 0, 0, 0, 0, 0, table->margin, table->padding,
-			table->border);
+			style, 0, 0, 0, 0, 0, 0, table->edges->margin,
+			table->edges->padding,
+			table->edges->border);
 	for (row_group = table->children; row_group;
 			row_group = row_group->next) {
 		for (row = row_group->children; row; row = row->next) {
@@ -2091,7 +2896,8 @@ static bool layout_table(struct box *table, int available_width,
 				layout_find_dimensions(&content->unit_len_ctx,
 						available_width, -1, c,
 						c->style, 0, 0, 0, 0, 0, 0,
-						0, c->padding, c->border);
+						0, c->edges->padding,
+						c->edges->border);
 
 				overflow_x = css_computed_overflow_x(c->style);
 				overflow_y = css_computed_overflow_y(c->style);
@@ -2099,12 +2905,14 @@ static bool layout_table(struct box *table, int available_width,
 				if (overflow_x == CSS_OVERFLOW_SCROLL ||
 						overflow_x ==
 						CSS_OVERFLOW_AUTO) {
-					c->padding[BOTTOM] += SCROLLBAR_WIDTH;
+					c->edges->padding[BOTTOM] +=
+							SCROLLBAR_WIDTH;
 				}
 				if (overflow_y == CSS_OVERFLOW_SCROLL ||
 						overflow_y ==
 						CSS_OVERFLOW_AUTO) {
-					c->padding[RIGHT] += SCROLLBAR_WIDTH;
+					c->edges->padding[RIGHT] +=
+							SCROLLBAR_WIDTH;
 				}
 			}
 		}
@@ -2137,22 +2945,22 @@ static bool layout_table(struct box *table, int available_width,
 		}
 
 		/* specified width includes border */
-		table_width -= table->border[LEFT].width +
-				table->border[RIGHT].width;
+		table_width -= table->edges->border[LEFT].width +
+				table->edges->border[RIGHT].width;
 		table_width = table_width < 0 ? 0 : table_width;
 
 		auto_width = table_width;
 	} else {
 		table_width = AUTO;
 		auto_width = available_width -
-				((table->margin[LEFT] == AUTO ? 0 :
-						table->margin[LEFT]) +
-				 table->border[LEFT].width +
-				 table->padding[LEFT] +
-				 table->padding[RIGHT] +
-				 table->border[RIGHT].width +
-				 (table->margin[RIGHT] == AUTO ? 0 :
-						table->margin[RIGHT]));
+				((table->edges->margin[LEFT] == AUTO ? 0 :
+						table->edges->margin[LEFT]) +
+				 table->edges->border[LEFT].width +
+				 table->edges->padding[LEFT] +
+				 table->edges->padding[RIGHT] +
+				 table->edges->border[RIGHT].width +
+				 (table->edges->margin[RIGHT] == AUTO ? 0 :
+						table->edges->margin[RIGHT]));
 	}
 
 	/* Find any table height specified within CSS/HTML */
@@ -2410,16 +3218,25 @@ static bool layout_table(struct box *table, int available_width,
 			}
 			for (c = row->children; c; c = c->next) {
 				assert(c->style);
-				c->width = xs[c->start_column + c->columns] -
-						xs[c->start_column] -
+				c->width = xs[box_get_start_column(c) +
+					box_get_columns(c)] -
+						xs[box_get_start_column(c)] -
 						border_spacing_h -
-						c->border[LEFT].width -
-						c->padding[LEFT] -
-						c->padding[RIGHT] -
-						c->border[RIGHT].width;
+						c->edges->border[LEFT].width -
+						c->edges->padding[LEFT] -
+						c->edges->padding[RIGHT] -
+						c->edges->border[RIGHT].width;
 				c->float_children = 0;
 				c->cached_place_below_level = 0;
 
+				if (fixed) {
+					/* skipped by layout_minmax_table(),
+					 * but needed for the cell's content */
+					layout_minmax_block(c,
+							content->font_func,
+							content);
+				}
+
 				c->height = AUTO;
 				if (!layout_block_context(c, -1, content)) {
 					free(col);
@@ -2433,7 +3250,7 @@ static bool layout_table(struct box *table, int available_width,
 				 * c->descendant_y1 used as temporary storage
 				 * until after vertical alignment is complete */
 				c->descendant_y0 = c->height;
-				c->descendant_y1 = c->padding[BOTTOM];
+				c->descendant_y1 = c->edges->padding[BOTTOM];
 
 				htype = css_computed_height(c->style,
 						&value, &unit);
@@ -2454,25 +3271,28 @@ static bool layout_table(struct box *table, int available_width,
 				 */
 				if (c->height < row_height)
 					c->height = row_height;
-				c->x = xs[c->start_column] +
-						c->border[LEFT].width;
-				c->y = c->border[TOP].width;
-				for (i = 0; i != c->columns; i++) {
-					row_span[c->start_column + i] = c->rows;
-					excess_y[c->start_column + i] =
-							c->border[TOP].width +
-							c->padding[TOP] +
-							c->height +
-							c->padding[BOTTOM] +
-							c->border[BOTTOM].width;
-					row_span_cell[c->start_column + i] = 0;
+				c->x = xs[box_get_start_column(c)] +
+						c->edges->border[LEFT].width;
+				c->y = c->edges->border[TOP].width;
+				for (i = 0; i != box_get_columns(c); i++) {
+					unsigned int span =
+						box_get_start_column(c) + i;
+
+					row_span[span] = box_get_rows(c);
+					excess_y[span] =
+						c->edges->border[TOP].width +
+						c->edges->padding[TOP] +
+						c->height +
+						c->edges->padding[BOTTOM] +
+						c->edges->border[BOTTOM].width;
+					row_span_cell[span] = 0;
 				}
-				row_span_cell[c->start_column] = c;
-				c->padding[BOTTOM] = -border_spacing_v -
-						c->border[TOP].width -
-						c->padding[TOP] -
+				row_span_cell[box_get_start_column(c)] = c;
+				c->edges->padding[BOTTOM] = -border_spacing_v -
+						c->edges->border[TOP].width -
+						c->edges->padding[TOP] -
 						c->height -
-						c->border[BOTTOM].width;
+						c->edges->border[BOTTOM].width;
 			}
 			for (i = 0; i != columns; i++)
 				if (row_span[i] != 0)
@@ -2498,7 +3318,8 @@ static bool layout_table(struct box *table, int available_width,
 				else
 					excess_y[i] = 0;
 				if (row_span_cell[i] != 0)
-					row_span_cell[i]->padding[BOTTOM] +=
+					row_span_cell[i]->edges->
+							padding[BOTTOM] +=
 							row_height +
 							border_spacing_v;
 			}
@@ -2530,7 +3351,7 @@ static bool layout_table(struct box *table, int available_width,
 				/* unextended bottom padding is in
 				 * c->descendant_y1, and unextended
 				 * cell height is in c->descendant_y0 */
-				spare_height = (c->padding[BOTTOM] -
+				spare_height = (c->edges->padding[BOTTOM] -
 						c->descendant_y1) +
 						(c->height - c->descendant_y0);
 
@@ -2549,14 +3370,17 @@ static bool layout_table(struct box *table, int available_width,
 				case CSS_VERTICAL_ALIGN_TOP:
 					break;
 				case CSS_VERTICAL_ALIGN_MIDDLE:
-					c->padding[TOP] += spare_height / 2;
-					c->padding[BOTTOM] -= spare_height / 2;
+					c->edges->padding[TOP] +=
+							spare_height / 2;
+					c->edges->padding[BOTTOM] -=
+							spare_height / 2;
 					layout_move_children(c, 0,
 							spare_height / 2);
 					break;
 				case CSS_VERTICAL_ALIGN_BOTTOM:
-					c->padding[TOP] += spare_height;
-					c->padding[BOTTOM] -= spare_height;
+					c->edges->padding[TOP] += spare_height;
+					c->edges->padding[BOTTOM] -=
+							spare_height;
 					layout_move_children(c, 0,
 							spare_height);
 					break;
@@ -2569,10 +3393,10 @@ static bool layout_table(struct box *table, int available_width,
 	}
 
 	/* Top and bottom margins of 'auto' are set to 0.  CSS2.1 10.6.3 */
-	if (table->margin[TOP] == AUTO)
-		table->margin[TOP] = 0;
-	if (table->margin[BOTTOM] == AUTO)
-		table->margin[BOTTOM] = 0;
+	if (table->edges->margin[TOP] == AUTO)
+		table->edges->margin[TOP] = 0;
+	if (table->edges->margin[BOTTOM] == AUTO)
+		table->edges->margin[BOTTOM] = 0;
 
 	free(col);
 	free(excess_y);
@@ -2716,13 +3540,13 @@ static bool layout_block_object(struct box *block)
 			block->type == BOX_INLINE_BLOCK ||
 			block->type == BOX_TABLE ||
 			block->type == BOX_TABLE_CELL);
-	assert(block->object);
+	assert(box_get_object(block));
 
 	NSLOG(layout, DEBUG,  "block %p, object %p, width %i", block,
-	      hlcache_handle_get_url(block->object), block->width);
+	      hlcache_handle_get_url(box_get_object(block)), block->width);
 
-	if (content_get_type(block->object) == CONTENT_HTML) {
-		content_reformat(block->object, false, block->width, 1);
+	if (content_get_type(box_get_object(block)) == CONTENT_HTML) {
+		content_reformat(box_get_object(block), false, block->width, 1);
 	} else {
 		/* Non-HTML objects */
 		/* this case handled already in
@@ -2771,6 +3595,134 @@ static void add_float_to_container(struct box *cont, struct box *b)
 }
 
 
+/**
+ * Find where to split a short text box to make it fit a width.
+ *
+ * The frontend finds the split, which is at a space.  Text which also
+ * has other line break opportunities, after hyphens or around
+ * ideographs, is then broken at the last of them before the available
+ * width if that is later, or at the first of them if nothing fits.
+ *
+ * \param  content    html content the box belongs to
+ * \param  fstyle     font style of the box's text
+ * \param  split_box  text box to split
+ * \param  available  width available
+ * \param  split      updated to offset in the box's text of split point
+ * \param  width      updated to width of the text before split point
+ * \return  NSERROR_OK or appropriate error code on failure
+ */
+static nserror
+layout_text_split_short(html_content *content,
+		const plot_font_style_t *fstyle,
+		struct box *split_box,
+		int available,
+		size_t *split,
+		int *width)
+{
+	const struct gui_layout_table *font_func = content->font_func;
+	const char *text = split_box->text;
+	size_t length = split_box->length;
+	size_t offset, next, end;
+	size_t position;
+	size_t best = 0;
+	int x;
+	nserror res;
+
+	res = font_func->split(fstyle, text, length, available, split, width);
+	if (res != NSERROR_OK || (*split == length && *width <= available))
+		return res;
+
+	/* only spaces can break text without hyphens or non-ASCII text */
+	for (offset = 0; offset != length; offset++) {
+		if (text[offset] == '-' || (text[offset] & 0x80))
+			break;
+	}
+	if (offset == length)
+		return NSERROR_OK;
+
+	if (font_func->position(fstyle, text, length, available,
+			&position, &x) != NSERROR_OK)
+		return NSERROR_OK;
+
+	/* find the last break no later than the position, or the first */
+	offset = 0;
+	while (offset < length) {
+		next = layout_text_segment_end(text, length, offset, &end);
+		if (next == length || (best != 0 && end > position))
+			break;
+		best = end;
+		offset = next;
+	}
+
+	if (best == 0 ||
+			(*width <= available && best <= *split) ||
+			(*width > available && best >= *split))
+		return NSERROR_OK;
+
+	/* measure the text before the break in one go to confirm it */
+	if (font_func->width(fstyle, text, best, &x) != NSERROR_OK ||
+			(x > available && *width <= available))
+		return NSERROR_OK;
+
+	*split = best;
+	*width = x;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Find where to split a text box to make it fit a width.
+ *
+ * Long text boxes are split at their line break opportunities, which are
+ * kept with their widths from the first time the box or the box it was
+ * split from is measured or split, so laying out a long paragraph doesn't
+ * measure the rest of its text again for every line.  Short ones, and
+ * text which can't be measured that way, are split by the frontend.
+ *
+ * \param  content    html content the box belongs to
+ * \param  fstyle     font style of the box's text
+ * \param  split_box  text box to split
+ * \param  available  width available
+ * \param  split      updated to offset in the box's text of split point
+ * \param  width      updated to width of the text before split point
+ * \return  NSERROR_OK or appropriate error code on failure
+ *
+ * The split point and width are as for the frontend's split function.
+ */
+static nserror
+layout_text_split(html_content *content,
+		const plot_font_style_t *fstyle,
+		struct box *split_box,
+		int available,
+		size_t *split,
+		int *width)
+{
+	const struct gui_layout_table *font_func = content->font_func;
+	struct layout_text_breaks *breaks = NULL;
+
+	if (split_box->ext != NULL)
+		breaks = split_box->ext->breaks;
+
+	if (breaks == NULL && split_box->length < LAYOUT_TEXT_BREAKS_MIN)
+		return layout_text_split_short(content, fstyle, split_box,
+				available, split, width);
+
+	if (breaks == NULL)
+		breaks = layout_text_breaks_create(content, split_box);
+
+	if (breaks != NULL &&
+			layout_text_breaks_measure(breaks, fstyle,
+					content) == NSERROR_OK &&
+			layout_text_breaks_split(breaks, content, fstyle,
+					split_box, available, split, width))
+		return NSERROR_OK;
+
+	return font_func->split(fstyle, split_box->text, split_box->length,
+			available, split, width);
+}
+
+
 /**
  * Split a text box.
  *
@@ -2810,7 +3762,7 @@ layout_text_box_split(html_content *content,
 		space_width = 0;
 
 	/* Create clone of split_box, c2 */
-	c2 = talloc_memdup(content->bctx, split_box, sizeof *c2);
+	c2 = box_duplicate(split_box, content->bctx);
 	if (!c2)
 		return false;
 	c2->flags |= CLONE;
@@ -2874,9 +3826,9 @@ layout_float_find_dimensions(
 		struct box *box)
 {
 	int width, height, max_width, min_width, max_height, min_height;
-	int *margin = box->margin;
-	int *padding = box->padding;
-	struct box_border *border = box->border;
+	int *margin = box->edges->margin;
+	int *padding = box->edges->padding;
+	struct box_border *border = box->edges->border;
 	enum css_overflow_e overflow_x = css_computed_overflow_x(style);
 	enum css_overflow_e overflow_y = css_computed_overflow_y(style);
 	int scrollbar_width_x =
@@ -2897,21 +3849,22 @@ layout_float_find_dimensions(
 	if (margin[RIGHT] == AUTO)
 		margin[RIGHT] = 0;
 
-	if (box->gadget == NULL) {
+	if (box_get_gadget(box) == NULL) {
 		padding[RIGHT] += scrollbar_width_y;
 		padding[BOTTOM] += scrollbar_width_x;
 	}
 
-	if (box->object && !(box->flags & REPLACE_DIM) &&
-			content_get_type(box->object) != CONTENT_HTML) {
+	if (box_get_object(box) && !(box->flags & REPLACE_DIM) &&
+			content_get_type(box_get_object(box)) != CONTENT_HTML) {
 		/* Floating replaced element, with intrinsic width or height.
 		 * See 10.3.6 and 10.6.2 */
 		layout_get_object_dimensions(box, &width, &height,
 				min_width, max_width, min_height, max_height);
-	} else if (box->gadget && (box->gadget->type == GADGET_TEXTBOX ||
-			box->gadget->type == GADGET_PASSWORD ||
-			box->gadget->type == GADGET_FILE ||
-			box->gadget->type == GADGET_TEXTAREA)) {
+	} else if (box_get_gadget(box) &&
+			(box_get_gadget(box)->type == GADGET_TEXTBOX ||
+			box_get_gadget(box)->type == GADGET_PASSWORD ||
+			box_get_gadget(box)->type == GADGET_FILE ||
+			box_get_gadget(box)->type == GADGET_TEXTAREA)) {
 		css_fixed size = 0;
 		css_unit unit = CSS_UNIT_EM;
 
@@ -2919,16 +3872,16 @@ layout_float_find_dimensions(
 		 * that don't shrink to fit contained text. */
 		assert(box->style);
 
-		if (box->gadget->type == GADGET_TEXTBOX ||
-				box->gadget->type == GADGET_PASSWORD ||
-				box->gadget->type == GADGET_FILE) {
+		if (box_get_gadget(box)->type == GADGET_TEXTBOX ||
+				box_get_gadget(box)->type == GADGET_PASSWORD ||
+				box_get_gadget(box)->type == GADGET_FILE) {
 			if (width == AUTO) {
 				size = INTTOFIX(10);
 				width = FIXTOINT(css_unit_len2device_px(
 						box->style, unit_len_ctx,
 						size, unit));
 			}
-			if (box->gadget->type == GADGET_FILE &&
+			if (box_get_gadget(box)->type == GADGET_FILE &&
 					height == AUTO) {
 				size = FLTTOFIX(1.5);
 				height = FIXTOINT(css_unit_len2device_px(
@@ -2936,7 +3889,7 @@ layout_float_find_dimensions(
 						size, unit));
 			}
 		}
-		if (box->gadget->type == GADGET_TEXTAREA) {
+		if (box_get_gadget(box)->type == GADGET_TEXTAREA) {
 			if (width == AUTO) {
 				size = INTTOFIX(10);
 				width = FIXTOINT(css_unit_len2device_px(
@@ -2957,11 +3910,12 @@ layout_float_find_dimensions(
 
 		/* width includes margin, borders and padding */
 		if (width == available_width) {
-			width -= box->margin[LEFT] + box->border[LEFT].width +
-					box->padding[LEFT] +
-					box->padding[RIGHT] +
-					box->border[RIGHT].width +
-					box->margin[RIGHT];
+			width -= box->edges->margin[LEFT] +
+				box->edges->border[LEFT].width +
+					box->edges->padding[LEFT] +
+					box->edges->padding[RIGHT] +
+					box->edges->border[RIGHT].width +
+					box->edges->margin[RIGHT];
 		} else {
 			/* width was obtained from a min_width or max_width
 			 * value, so need to use the same method for calculating
@@ -2997,6 +3951,39 @@ layout_float_find_dimensions(
 }
 
 
+/**
+ * Keep the previous layout of a block formatting context if possible.
+ *
+ * Descendants are positioned relative to the block, so a block which
+ * has not changed since the last layout, and whose dimensions are the
+ * same, can be moved without laying out its contents again.
+ *
+ * \param  block    block with its dimensions found for this layout
+ * \param  width    width of block at the previous layout
+ * \param  height   height of block at the previous layout
+ * \param  content  content being laid out
+ * \return  true if the previous layout was kept
+ */
+static bool
+layout_block_context_reuse(struct box *block,
+		int width, int height,
+		const html_content *content)
+{
+	if (!content->layout_reuse || (block->flags & NEEDS_LAYOUT))
+		return false;
+
+	if (block->width != width ||
+			(block->height != AUTO && block->height != height))
+		return false;
+
+	NSLOG(layout, DEBUG, "block %p unchanged, keeping layout", block);
+
+	block->height = height;
+	block->flags |= LAYOUT_KEPT;
+	return true;
+}
+
+
 /**
  * Layout the contents of a float or inline block.
  *
@@ -3007,20 +3994,26 @@ layout_float_find_dimensions(
  */
 static bool layout_float(struct box *b, int width, html_content *content)
 {
+	int old_width = b->width;
+	int old_height = b->height;
+
 	assert(b->type == BOX_TABLE || b->type == BOX_BLOCK ||
 			b->type == BOX_INLINE_BLOCK);
 	layout_float_find_dimensions(&content->unit_len_ctx, width, b->style, b);
 	if (b->type == BOX_TABLE) {
 		if (!layout_table(b, width, content))
 			return false;
-		if (b->margin[LEFT] == AUTO)
-			b->margin[LEFT] = 0;
-		if (b->margin[RIGHT] == AUTO)
-			b->margin[RIGHT] = 0;
-		if (b->margin[TOP] == AUTO)
-			b->margin[TOP] = 0;
-		if (b->margin[BOTTOM] == AUTO)
-			b->margin[BOTTOM] = 0;
+		if (b->edges->margin[LEFT] == AUTO)
+			b->edges->margin[LEFT] = 0;
+		if (b->edges->margin[RIGHT] == AUTO)
+			b->edges->margin[RIGHT] = 0;
+		if (b->edges->margin[TOP] == AUTO)
+			b->edges->margin[TOP] = 0;
+		if (b->edges->margin[BOTTOM] == AUTO)
+			b->edges->margin[BOTTOM] = 0;
+	} else if (layout_block_context_reuse(b, old_width, old_height,
+			content)) {
+		return true;
 	} else
 		return layout_block_context(b, -1, content);
 	return true;
@@ -3035,9 +4028,11 @@ static bool layout_float(struct box *b, int width, html_content *content)
  * \param  cx	  x coordinate relative to cont to place float right of
  * \param  y	  y coordinate relative to cont to place float below
  * \param  cont	  ancestor box which defines horizontal space, for floats
+ * \param  content  content being laid out
  */
 static void
-place_float_below(struct box *c, int width, int cx, int y, struct box *cont)
+place_float_below(struct box *c, int width, int cx, int y, struct box *cont,
+		const html_content *content)
 {
 	int x0, x1, yy;
 	struct box *left;
@@ -3054,7 +4049,7 @@ place_float_below(struct box *c, int width, int cx, int y, struct box *cont)
 		y = yy;
 		x0 = cx;
 		x1 = cx + width;
-		find_sides(cont->float_children, y, y + c->height, &x0, &x1,
+		find_sides(cont, content, y, y + c->height, &x0, &x1,
 				&left, &right);
 		if (left != 0 && right != 0) {
 			yy = (left->y + left->height <
@@ -3177,7 +4172,7 @@ layout_line(struct box *first,
 	/* find sides at top of line */
 	x0 += cx;
 	x1 += cx;
-	find_sides(cont->float_children, cy, cy, &x0, &x1, &left, &right);
+	find_sides(cont, content, cy, cy, &x0, &x1, &left, &right);
 	x0 -= cx;
 	x1 -= cx;
 
@@ -3191,7 +4186,7 @@ layout_line(struct box *first,
 	/* get minimum line height from containing block.
 	 * this is the line-height if there are text children and also in the
 	 * case of an initially empty text input */
-	if (has_text_children || first->parent->parent->gadget)
+	if (has_text_children || box_get_gadget(first->parent->parent))
 		used_height = height = line_height(&content->unit_len_ctx,
 				first->parent->parent->style);
 	else
@@ -3240,16 +4235,18 @@ layout_line(struct box *first,
 			if (b->max_width != UNKNOWN_WIDTH)
 				if (!layout_float(b, *width, content))
 					return false;
-			h = b->border[TOP].width + b->padding[TOP] + b->height +
-					b->padding[BOTTOM] +
-					b->border[BOTTOM].width;
+			h = b->edges->border[TOP].width +
+				b->edges->padding[TOP] + b->height +
+					b->edges->padding[BOTTOM] +
+					b->edges->border[BOTTOM].width;
 			if (height < h)
 				height = h;
-			x += b->margin[LEFT] + b->border[LEFT].width +
-					b->padding[LEFT] + b->width +
-					b->padding[RIGHT] +
-					b->border[RIGHT].width +
-					b->margin[RIGHT];
+			x += b->edges->margin[LEFT] +
+				b->edges->border[LEFT].width +
+					b->edges->padding[LEFT] + b->width +
+					b->edges->padding[RIGHT] +
+					b->edges->border[RIGHT].width +
+					b->edges->margin[RIGHT];
 			space_after = 0;
 			continue;
 		}
@@ -3258,22 +4255,25 @@ layout_line(struct box *first,
 			/* calculate borders, margins, and padding */
 			layout_find_dimensions(&content->unit_len_ctx,
 					*width, -1, b, b->style, 0, 0, 0, 0,
-					0, 0, b->margin, b->padding, b->border);
+					0, 0, b->edges->margin,
+					b->edges->padding, b->edges->border);
 			for (i = 0; i != 4; i++)
-				if (b->margin[i] == AUTO)
-					b->margin[i] = 0;
-			x += b->margin[LEFT] + b->border[LEFT].width +
-					b->padding[LEFT];
+				if (b->edges->margin[i] == AUTO)
+					b->edges->margin[i] = 0;
+			x += b->edges->margin[LEFT] +
+					b->edges->border[LEFT].width +
+					b->edges->padding[LEFT];
 			if (b->inline_end) {
-				b->inline_end->margin[RIGHT] = b->margin[RIGHT];
-				b->inline_end->padding[RIGHT] =
-						b->padding[RIGHT];
-				b->inline_end->border[RIGHT] =
-						b->border[RIGHT];
+				b->inline_end->edges->margin[RIGHT] =
+						b->edges->margin[RIGHT];
+				b->inline_end->edges->padding[RIGHT] =
+						b->edges->padding[RIGHT];
+				b->inline_end->edges->border[RIGHT] =
+						b->edges->border[RIGHT];
 			} else {
-				x += b->padding[RIGHT] +
-						b->border[RIGHT].width +
-						b->margin[RIGHT];
+				x += b->edges->padding[RIGHT] +
+						b->edges->border[RIGHT].width +
+						b->edges->margin[RIGHT];
 			}
 		} else if (b->type == BOX_INLINE_END) {
 			b->width = 0;
@@ -3283,12 +4283,14 @@ layout_line(struct box *first,
 			}
 			space_after = b->space;
 
-			x += b->padding[RIGHT] + b->border[RIGHT].width +
-					b->margin[RIGHT];
+			x += b->edges->padding[RIGHT] +
+				b->edges->border[RIGHT].width +
+					b->edges->margin[RIGHT];
 			continue;
 		}
 
-		if (!b->object && !(b->flags & IFRAME) && !b->gadget &&
+		if (!box_get_object(b) && !(b->flags & IFRAME) &&
+				!box_get_gadget(b) &&
 				!(b->flags & REPLACE_DIM)) {
 			/* inline non-replaced, 10.3.1 and 10.6.1 */
 			b->height = line_height(&content->unit_len_ctx,
@@ -3304,18 +4306,18 @@ layout_line(struct box *first,
 			}
 
 			if (b->width == UNKNOWN_WIDTH) {
+				struct form_control *gadget =
+					box_get_gadget(b->parent->parent);
+
 				/** \todo handle errors */
 
 				/* If it's a select element, we must use the
 				 * width of the widest option text */
-				if (b->parent->parent->gadget &&
-						b->parent->parent->gadget->type
-						== GADGET_SELECT) {
+				if (gadget && gadget->type == GADGET_SELECT) {
 					int opt_maxwidth = 0;
 					struct form_option *o;
 
-					for (o = b->parent->parent->gadget->
-							data.select.items; o;
+					for (o = gadget->data.select.items; o;
 							o = o->next) {
 						int opt_width;
 						font_func->width(&fstyle,
@@ -3369,7 +4371,7 @@ layout_line(struct box *first,
 				&max_height, &min_height,
 				NULL, NULL, NULL);
 
-		if (b->object && !(b->flags & REPLACE_DIM)) {
+		if (box_get_object(b) && !(b->flags & REPLACE_DIM)) {
 			layout_get_object_dimensions(b, &b->width, &b->height,
 					min_width, max_width,
 					min_height, max_height);
@@ -3397,18 +4399,22 @@ layout_line(struct box *first,
 		}
 
 		/* Reformat object to new box size */
-		if (b->object && content_get_type(b->object) == CONTENT_HTML &&
-				b->width !=
-				content_get_available_width(b->object)) {
+		if (box_get_object(b) &&
+				content_get_type(box_get_object(b)) ==
+				CONTENT_HTML &&
+				b->width != content_get_available_width(
+						box_get_object(b))) {
 			css_fixed value = 0;
 			css_unit unit = CSS_UNIT_PX;
 			enum css_height_e htype = css_computed_height(b->style,
 					&value, &unit);
 
-			content_reformat(b->object, false, b->width, b->height);
+			content_reformat(box_get_object(b), false, b->width,
+					b->height);
 
 			if (htype == CSS_HEIGHT_AUTO)
-				b->height = content_get_height(b->object);
+				b->height = content_get_height(
+						box_get_object(b));
 		}
 
 		if (height < b->height)
@@ -3420,7 +4426,7 @@ layout_line(struct box *first,
 	/* find new sides using this height */
 	x0 = cx;
 	x1 = cx + *width;
-	find_sides(cont->float_children, cy, cy + height, &x0, &x1,
+	find_sides(cont, content, cy, cy + height, &x0, &x1,
 			&left, &right);
 	x0 -= cx;
 	x1 -= cx;
@@ -3461,25 +4467,27 @@ layout_line(struct box *first,
 
 			if ((b->type == BOX_INLINE && !b->inline_end) ||
 					b->type == BOX_INLINE_BLOCK) {
-				b->x += b->margin[LEFT] + b->border[LEFT].width;
-				x = b->x + b->padding[LEFT] + b->width +
-						b->padding[RIGHT] +
-						b->border[RIGHT].width +
-						b->margin[RIGHT];
+				b->x += b->edges->margin[LEFT] +
+					b->edges->border[LEFT].width;
+				x = b->x + b->edges->padding[LEFT] + b->width +
+						b->edges->padding[RIGHT] +
+						b->edges->border[RIGHT].width +
+						b->edges->margin[RIGHT];
 			} else if (b->type == BOX_INLINE) {
-				b->x += b->margin[LEFT] + b->border[LEFT].width;
-				x = b->x + b->padding[LEFT] + b->width;
+				b->x += b->edges->margin[LEFT] +
+					b->edges->border[LEFT].width;
+				x = b->x + b->edges->padding[LEFT] + b->width;
 			} else if (b->type == BOX_INLINE_END) {
 				b->height = b->inline_end->height;
-				x += b->padding[RIGHT] +
-						b->border[RIGHT].width +
-						b->margin[RIGHT];
+				x += b->edges->padding[RIGHT] +
+						b->edges->border[RIGHT].width +
+						b->edges->margin[RIGHT];
 			} else {
 				x += b->width;
 			}
 
 			space_before = space_after;
-			if (b->object || b->flags & REPLACE_DIM ||
+			if (box_get_object(b) || b->flags & REPLACE_DIM ||
 					b->flags & IFRAME)
 				space_after = 0;
 			else if (b->text || b->type == BOX_INLINE_END) {
@@ -3522,21 +4530,25 @@ layout_line(struct box *first,
 			NSLOG(layout, DEBUG,
 			      "%p : %d %d",
 			      d,
-			      d->margin[TOP],
-			      d->border[TOP].width);
-
-			d->x = d->margin[LEFT] + d->border[LEFT].width;
-			d->y = d->margin[TOP] + d->border[TOP].width;
-			b->width = d->margin[LEFT] + d->border[LEFT].width +
-					d->padding[LEFT] + d->width +
-					d->padding[RIGHT] +
-					d->border[RIGHT].width +
-					d->margin[RIGHT];
-			b->height = d->margin[TOP] + d->border[TOP].width +
-					d->padding[TOP] + d->height +
-					d->padding[BOTTOM] +
-					d->border[BOTTOM].width +
-					d->margin[BOTTOM];
+			      d->edges->margin[TOP],
+			      d->edges->border[TOP].width);
+
+			d->x = d->edges->margin[LEFT] +
+				d->edges->border[LEFT].width;
+			d->y = d->edges->margin[TOP] +
+				d->edges->border[TOP].width;
+			b->width = d->edges->margin[LEFT] +
+				d->edges->border[LEFT].width +
+					d->edges->padding[LEFT] + d->width +
+					d->edges->padding[RIGHT] +
+					d->edges->border[RIGHT].width +
+					d->edges->margin[RIGHT];
+			b->height = d->edges->margin[TOP] +
+				d->edges->border[TOP].width +
+					d->edges->padding[TOP] + d->height +
+					d->edges->padding[BOTTOM] +
+					d->edges->border[BOTTOM].width +
+					d->edges->margin[BOTTOM];
 
 			if (b->width > (x1 - x0) - x)
 				place_below = true;
@@ -3584,7 +4596,8 @@ layout_line(struct box *first,
 				fy = (fy > fcy) ? fy : fcy;
 				fy = (fy == cy) ? fy + height : fy;
 
-				place_float_below(b, *width, cx, fy, cont);
+				place_float_below(b, *width, cx, fy, cont,
+						content);
 				fy = b->y;
 				if (d->style && (
 						(css_computed_clear(d->style) ==
@@ -3602,8 +4615,9 @@ layout_line(struct box *first,
 					else
 						b->x = cx + *width - b->width;
 
-					fcy = layout_clear(cont->float_children,
-						css_computed_clear(d->style));
+					fcy = layout_clear(cont,
+						css_computed_clear(d->style),
+						content);
 					if (fcy > cont->clear_level)
 						cont->clear_level = fcy;
 					if (b->y < fcy)
@@ -3615,6 +4629,7 @@ layout_line(struct box *first,
 					right = b;
 			}
 			add_float_to_container(cont, b);
+			layout_float_index_add(content, cont, b);
 
 			split_box = 0;
 		}
@@ -3634,20 +4649,17 @@ layout_line(struct box *first,
 		if (!no_wrap &&
 		    (split_box->type == BOX_INLINE ||
 		     split_box->type == BOX_TEXT) &&
-		    !split_box->object &&
+		    !box_get_object(split_box) &&
 		    !(split_box->flags & REPLACE_DIM) &&
 		    !(split_box->flags & IFRAME) &&
-		    !split_box->gadget && split_box->text) {
+		    !box_get_gadget(split_box) && split_box->text) {
 
 			font_plot_style_from_css(&content->unit_len_ctx,
 					split_box->style, &fstyle);
 			/** \todo handle errors */
-			font_func->split(&fstyle,
-					 split_box->text,
-					 split_box->length,
-					 x1 - x0 - x - space_before,
-					 &split,
-					 &w);
+			layout_text_split(content, &fstyle, split_box,
+					x1 - x0 - x - space_before,
+					&split, &w);
 		}
 
 		/* split == 0 implies that text can't be split */
@@ -3791,7 +4803,8 @@ layout_line(struct box *first,
 			d->y = *y;
 			continue;
 		} else if ((d->type == BOX_INLINE &&
-				((d->object || d->gadget) == false) &&
+				((box_get_object(d) ||
+				box_get_gadget(d)) == false) &&
 				!(d->flags & IFRAME) &&
 				!(d->flags & REPLACE_DIM)) ||
 				d->type == BOX_BR ||
@@ -3799,7 +4812,7 @@ layout_line(struct box *first,
 				d->type == BOX_INLINE_END) {
 			/* regular (non-replaced) inlines */
 			d->x += x0;
-			d->y = *y - d->padding[TOP];
+			d->y = *y - d->edges->padding[TOP];
 
 			if (d->type == BOX_TEXT && d->height > used_height) {
 				/* text */
@@ -3809,12 +4822,14 @@ layout_line(struct box *first,
 				d->type == BOX_INLINE_BLOCK) {
 			/* replaced inlines and inline-blocks */
 			d->x += x0;
-			d->y = *y + d->border[TOP].width + d->margin[TOP];
-			h = d->margin[TOP] + d->border[TOP].width +
-					d->padding[TOP] + d->height +
-					d->padding[BOTTOM] +
-					d->border[BOTTOM].width +
-					d->margin[BOTTOM];
+			d->y = *y + d->edges->border[TOP].width +
+				d->edges->margin[TOP];
+			h = d->edges->margin[TOP] +
+				d->edges->border[TOP].width +
+					d->edges->padding[TOP] + d->height +
+					d->edges->padding[BOTTOM] +
+					d->edges->border[BOTTOM].width +
+					d->edges->margin[BOTTOM];
 			if (used_height < h)
 				used_height = h;
 		}
@@ -3855,8 +4870,8 @@ layout_line(struct box *first,
 
 	/* handle clearance for br */
 	if (br_box && css_computed_clear(br_box->style) != CSS_CLEAR_NONE) {
-		int clear_y = layout_clear(cont->float_children,
-				css_computed_clear(br_box->style));
+		int clear_y = layout_clear(cont,
+				css_computed_clear(br_box->style), content);
 		if (used_height < clear_y - cy)
 			used_height = clear_y - cy;
 	}
@@ -3914,7 +4929,7 @@ static bool layout_inline_container(struct box *inline_container, int width,
 				whitespace == CSS_WHITE_SPACE_PRE_WRAP);
 		}
 
-		if ((!c->object && !(c->flags & REPLACE_DIM) &&
+		if ((!box_get_object(c) && !(c->flags & REPLACE_DIM) &&
 				!(c->flags & IFRAME) &&
 				c->text && (c->length || is_pre)) ||
 				c->type == BOX_BR)
@@ -3946,7 +4961,167 @@ static bool layout_inline_container(struct box *inline_container, int width,
 
 
 /**
- * Layout a block formatting context.
+ * Find whether any float of a block formatting context reaches below a y.
+ *
+ * \param  cont  block formatting context
+ * \param  y     y coordinate relative to cont
+ * \return  true if a float in cont would be beside a line at y
+ */
+static bool layout_floats_below(const struct box *cont, int y)
+{
+	/* Floats are sorted in order of decreasing bottom pos */
+	return cont->float_children != NULL &&
+			cont->float_children->y +
+			cont->float_children->height > y;
+}
+
+
+/**
+ * Keep the previous layout of an inline container if possible.
+ *
+ * Lines are positioned relative to their inline container, so one which
+ * has not changed, is the same width, and has had no floats beside it
+ * either time can be moved without breaking its lines again.
+ *
+ * \param  box      inline container with its width found for this layout
+ * \param  width    width of box at the previous layout
+ * \param  cont     block formatting context containing box
+ * \param  cy       top of box, relative to cont
+ * \param  content  content being laid out
+ * \return  true if the previous layout was kept
+ */
+static bool
+layout_inline_container_reuse(struct box *box,
+		int width,
+		const struct box *cont,
+		int cy,
+		const html_content *content)
+{
+	if (!content->layout_reuse || box->width != width ||
+			(box->flags & (NEEDS_LAYOUT | DEFERRED)) ||
+			!(box->flags & FLOAT_FREE) ||
+			layout_floats_below(cont, cy))
+		return false;
+
+	box->flags |= LAYOUT_KEPT;
+	return true;
+}
+
+
+/**
+ * Estimate the height of an inline container without laying it out.
+ *
+ * \param  box      inline container with its width found for this layout
+ * \param  width    width of box at the previous layout
+ * \param  content  content being laid out
+ * \return  estimated height of box
+ */
+static int
+layout_inline_container_estimate(const struct box *box,
+		int width,
+		const html_content *content)
+{
+	const struct box *child;
+	size_t length = 0;
+	int line;
+
+	if (box->width <= 0)
+		return 0;
+
+	if (width != UNKNOWN_WIDTH && width > 0 && box->height > 0) {
+		/* Scale the height it had at the previous width */
+		return (int64_t) box->height * width / box->width;
+	}
+
+	/* Assume characters are two fifths of the line height wide */
+	line = line_height(&content->unit_len_ctx, box->parent->style);
+	for (child = box->children; child != NULL; child = child->next)
+		length += child->length;
+
+	return ((int64_t) length * line * 2 / 5 / box->width + 1) * line;
+}
+
+
+/**
+ * Put off laying out an inline container in the root block.
+ *
+ * Text below the layout limit, or reached once the layout deadline has
+ * passed, is given an estimated height and left for a later layout.  A
+ * container which floats would be beside is always laid out, as they
+ * could change its lines.
+ *
+ * \param  box      inline container with its width found for this layout
+ * \param  width    width of box at the previous layout
+ * \param  cont     block formatting context containing box
+ * \param  cy       top of box, relative to cont
+ * \param  content  content being laid out
+ * \return  true if the layout of box was deferred
+ */
+static bool
+layout_inline_container_defer(struct box *box,
+		int width,
+		const struct box *cont,
+		int cy,
+		html_content *content)
+{
+	if (cont != content->layout || box->parent->style == NULL ||
+			layout_floats_below(cont, cy))
+		return false;
+
+	/* Lay out at least the first container put off last time, so
+	 * that each layout makes progress */
+	if ((box->flags & DEFERRED) && !content->layout_deferred)
+		return false;
+
+	if (cy <= content->layout_limit) {
+		uint64_t now;
+
+		if (content->layout_deadline == 0)
+			return false;
+
+		nsu_getmonotonic_ms(&now);
+		if (now < content->layout_deadline)
+			return false;
+	}
+
+	NSLOG(layout, DEBUG, "inline container %p at %i deferred", box, cy);
+
+	box->height = layout_inline_container_estimate(box, width, content);
+	box->flags |= DEFERRED;
+	content->layout_deferred = true;
+
+	return true;
+}
+
+
+/**
+ * Record the area changed by laying out a deferred inline container.
+ *
+ * If its estimated height was wrong, everything below it moved too.
+ *
+ * \param  box       inline container which has been laid out
+ * \param  estimate  height box was given while deferred
+ * \param  cy        top of box, relative to the root block
+ * \param  content   content being laid out
+ */
+static void
+layout_inline_container_done(const struct box *box,
+		int estimate,
+		int cy,
+		html_content *content)
+{
+	if (cy < content->layout_changed_y0)
+		content->layout_changed_y0 = cy;
+
+	if (box->height != estimate)
+		content->layout_changed_y1 = INT_MAX;
+	else if (cy + box->height > content->layout_changed_y1)
+		content->layout_changed_y1 = cy + box->height;
+}
+
+
+/**
+ * Layout a block formatting context, with its float index in place.
  *
  * \param  block	    BLOCK, INLINE_BLOCK, or TABLE_CELL to layout
  * \param  viewport_height  Height of viewport in pixels or -ve if unknown
@@ -3957,7 +5132,7 @@ static bool layout_inline_container(struct box *inline_container, int width,
  * in CSS 2.1 9.4.1.
  */
 static bool
-layout_block_context(struct box *block,
+layout_block_context_flow(struct box *block,
 		     int viewport_height,
 		     html_content *content)
 {
@@ -3971,6 +5146,7 @@ layout_block_context(struct box *block,
 	bool in_margin = false;
 	css_fixed gadget_size;
 	css_unit gadget_unit; /* Checkbox / radio buttons */
+	int old_width = 0, old_height = 0; /* previous layout of a child */
 
 	assert(block->type == BOX_BLOCK ||
 			block->type == BOX_INLINE_BLOCK ||
@@ -3983,7 +5159,7 @@ layout_block_context(struct box *block,
 	block->clear_level = 0;
 
 	/* special case if the block contains an object */
-	if (block->object) {
+	if (box_get_object(block)) {
 		int temp_width = block->width;
 		if (!layout_block_object(block))
 			return false;
@@ -3996,8 +5172,9 @@ layout_block_context(struct box *block,
 	}
 
 	/* special case if the block contains an radio button or checkbox */
-	if (block->gadget && (block->gadget->type == GADGET_RADIO ||
-			block->gadget->type == GADGET_CHECKBOX)) {
+	if (box_get_gadget(block) &&
+			(box_get_gadget(block)->type == GADGET_RADIO ||
+			box_get_gadget(block)->type == GADGET_CHECKBOX)) {
 		/* form checkbox or radio button
 		 * if width or height is AUTO, set it to 1em */
 		gadget_unit = CSS_UNIT_EM;
@@ -4012,9 +5189,9 @@ layout_block_context(struct box *block,
 	box = block->children;
 	/* set current coordinates to top-left of the block */
 	cx = 0;
-	y = cy = block->padding[TOP];
+	y = cy = block->edges->padding[TOP];
 	if (box)
-		box->y = block->padding[TOP];
+		box->y = block->edges->padding[TOP];
 
 	/* Step through the descendants of the block in depth-first order, but
 	 * not into the children of boxes which aren't blocks. For example, if
@@ -4059,7 +5236,7 @@ layout_block_context(struct box *block,
 					CSS_POSITION_ABSOLUTE ||
 				 css_computed_position(box->style) ==
 					CSS_POSITION_FIXED)) {
-			box->x = box->parent->padding[LEFT];
+			box->x = box->parent->edges->padding[LEFT];
 			/* absolute positioned; this element will establish
 			 * its own block context when it gets laid out later,
 			 * so no need to look at its children now. */
@@ -4081,8 +5258,9 @@ layout_block_context(struct box *block,
 		y = 0;
 		if (box->style && css_computed_clear(box->style) !=
 				CSS_CLEAR_NONE)
-			y = layout_clear(block->float_children,
-					css_computed_clear(box->style));
+			y = layout_clear(block,
+					css_computed_clear(box->style),
+					content);
 
 		/* Find box's overflow properties */
 		if (box->style) {
@@ -4095,7 +5273,9 @@ layout_block_context(struct box *block,
 		lm = rm = 0;
 
 		if (box->type == BOX_BLOCK || box->flags & IFRAME) {
-			if (!box->object && !(box->flags & IFRAME) &&
+			old_width = box->width;
+			old_height = box->height;
+			if (!box_get_object(box) && !(box->flags & IFRAME) &&
 					!(box->flags & REPLACE_DIM) &&
 					box->style &&
 					(overflow_x != CSS_OVERFLOW_VISIBLE ||
@@ -4109,17 +5289,17 @@ layout_block_context(struct box *block,
 				top = (top > y) ? top : y;
 				x0 = cx;
 				x1 = cx + box->parent->width -
-						box->parent->padding[LEFT] -
-						box->parent->padding[RIGHT];
-				find_sides(block->float_children, top, top,
+					box->parent->edges->padding[LEFT] -
+					box->parent->edges->padding[RIGHT];
+				find_sides(block, content, top, top,
 						&x0, &x1, &left, &right);
 				/* calculate min required left & right margins
 				 * needed to avoid floats */
 				lm = x0 - cx;
 				rm = cx + box->parent->width -
-						box->parent->padding[LEFT] -
-						box->parent->padding[RIGHT] -
-						x1;
+					box->parent->edges->padding[LEFT] -
+					box->parent->edges->padding[RIGHT] -
+					x1;
 			}
 			layout_block_find_dimensions(&content->unit_len_ctx,
 					box->parent->width,
@@ -4147,17 +5327,17 @@ layout_block_context(struct box *block,
 					top = (top > y) ? top : y;
 					x0 = cx;
 					x1 = cx + box->parent->width -
-						box->parent->padding[LEFT] -
-						box->parent->padding[RIGHT];
-					find_sides(block->float_children,
+						box->parent->edges->padding[LEFT] -
+						box->parent->edges->padding[RIGHT];
+					find_sides(block, content,
 						top, top, &x0, &x1,
 						&left, &right);
 					/* calculate min required left & right
 					 * margins needed to avoid floats */
 					lm = x0 - cx;
 					rm = cx + box->parent->width -
-						box->parent->padding[LEFT] -
-						box->parent->padding[RIGHT] -
+						box->parent->edges->padding[LEFT] -
+						box->parent->edges->padding[RIGHT] -
 						x1;
 				}
 			}
@@ -4169,14 +5349,15 @@ layout_block_context(struct box *block,
 		}
 
 		/* Position box: horizontal. */
-		box->x = box->parent->padding[LEFT] + box->margin[LEFT] +
-				box->border[LEFT].width;
+		box->x = box->parent->edges->padding[LEFT] +
+			box->edges->margin[LEFT] +
+				box->edges->border[LEFT].width;
 		cx += box->x;
 
 		/* Position box: vertical. */
-		if (box->border[TOP].width) {
-			box->y += box->border[TOP].width;
-			cy += box->border[TOP].width;
+		if (box->edges->border[TOP].width) {
+			box->y += box->edges->border[TOP].width;
+			cy += box->edges->border[TOP].width;
 		}
 
 		/* Vertical margin */
@@ -4209,9 +5390,12 @@ layout_block_context(struct box *block,
 				(overflow_x != CSS_OVERFLOW_VISIBLE ||
 				 overflow_y != CSS_OVERFLOW_VISIBLE)) {
 
-			layout_block_context(box, viewport_height, content);
+			if (!layout_block_context_reuse(box, old_width,
+					old_height, content))
+				layout_block_context(box, viewport_height,
+						content);
 
-			cy += box->padding[TOP];
+			cy += box->edges->padding[TOP];
 
 			if (box->height == AUTO) {
 				box->height = 0;
@@ -4219,11 +5403,11 @@ layout_block_context(struct box *block,
 			}
 
 			cx -= box->x;
-			cy += box->height + box->padding[BOTTOM] +
-					box->border[BOTTOM].width;
-			y = box->y + box->padding[TOP] + box->height +
-					box->padding[BOTTOM] +
-					box->border[BOTTOM].width;
+			cy += box->height + box->edges->padding[BOTTOM] +
+					box->edges->border[BOTTOM].width;
+			y = box->y + box->edges->padding[TOP] + box->height +
+					box->edges->padding[BOTTOM] +
+					box->edges->border[BOTTOM].width;
 
 			/* Skip children, because they are done in the new
 			 * block context */
@@ -4233,15 +5417,33 @@ layout_block_context(struct box *block,
 		NSLOG(layout, DEBUG,  "box %p, cx %i, cy %i", box, cx, cy);
 
 		/* Layout (except tables). */
-		if (box->object) {
+		if (box_get_object(box)) {
 			if (!layout_block_object(box))
 				return false;
 
 		} else if (box->type == BOX_INLINE_CONTAINER) {
+			old_width = box->width;
 			box->width = box->parent->width;
-			if (!layout_inline_container(box, box->width, block,
-					cx, cy, content))
-				return false;
+			if (layout_inline_container_reuse(box, old_width,
+					block, cy, content) ||
+					layout_inline_container_defer(box,
+					old_width, block, cy, content)) {
+				/* Lines kept, or left for a later layout */
+			} else {
+				old_height = box->height;
+				if (!layout_inline_container(box, box->width,
+						block, cx, cy, content))
+					return false;
+				if (box->flags & DEFERRED)
+					layout_inline_container_done(box,
+							old_height, cy,
+							content);
+				box->flags &= ~DEFERRED;
+				if (layout_floats_below(block, cy))
+					box->flags &= ~FLOAT_FREE;
+				else
+					box->flags |= FLOAT_FREE;
+			}
 
 		} else if (box->type == BOX_TABLE) {
 			/* Move down to avoid floats if necessary. */
@@ -4258,7 +5460,7 @@ layout_block_context(struct box *block,
 
 				x0 = cx;
 				x1 = cx + box->parent->width;
-				find_sides(block->float_children, y,
+				find_sides(block, content, y,
 						y + box->height,
 						&x0, &x1, &left, &right);
 				if (wtype == CSS_WIDTH_AUTO)
@@ -4284,7 +5486,8 @@ layout_block_context(struct box *block,
 		}
 
 		/* Advance to next box. */
-		if (box->type == BOX_BLOCK && !box->object && !(box->iframe) &&
+		if (box->type == BOX_BLOCK && !box_get_object(box) &&
+				!(box_get_iframe(box)) &&
 				box->children) {
 			/* Down into children. */
 
@@ -4294,26 +5497,26 @@ layout_block_context(struct box *block,
 				margin_collapse = NULL;
 			}
 
-			y = box->padding[TOP];
+			y = box->edges->padding[TOP];
 			box = box->children;
 			box->y = y;
 			cy += y;
 			continue;
-		} else if (box->type == BOX_BLOCK || box->object ||
+		} else if (box->type == BOX_BLOCK || box_get_object(box) ||
 				box->flags & IFRAME)
-			cy += box->padding[TOP];
+			cy += box->edges->padding[TOP];
 
 		if (box->type == BOX_BLOCK && box->height == AUTO) {
 			box->height = 0;
 			layout_block_add_scrollbar(box, BOTTOM);
 		}
 
-		cy += box->height + box->padding[BOTTOM] +
-				box->border[BOTTOM].width;
+		cy += box->height + box->edges->padding[BOTTOM] +
+				box->edges->border[BOTTOM].width;
 		cx -= box->x;
-		y = box->y + box->padding[TOP] + box->height +
-				box->padding[BOTTOM] +
-				box->border[BOTTOM].width;
+		y = box->y + box->edges->padding[TOP] + box->height +
+				box->edges->padding[BOTTOM] +
+				box->edges->border[BOTTOM].width;
 
 	advance_to_next_box:
 		if (!box->next) {
@@ -4328,10 +5531,14 @@ layout_block_context(struct box *block,
 				}
 
 				/* Apply bottom margin */
-				if (max_pos_margin < box->margin[BOTTOM])
-					max_pos_margin = box->margin[BOTTOM];
-				else if (max_neg_margin < -box->margin[BOTTOM])
-					max_neg_margin = -box->margin[BOTTOM];
+				if (max_pos_margin <
+						box->edges->margin[BOTTOM])
+					max_pos_margin =
+						box->edges->margin[BOTTOM];
+				else if (max_neg_margin <
+						-box->edges->margin[BOTTOM])
+					max_neg_margin =
+						-box->edges->margin[BOTTOM];
 
 				box = box->parent;
 				if (box == block)
@@ -4347,14 +5554,15 @@ layout_block_context(struct box *block,
 				}
 
 				if (box->height == AUTO) {
-					box->height = y - box->padding[TOP];
+					box->height = y -
+						box->edges->padding[TOP];
 
 					if (box->type == BOX_BLOCK)
 						layout_block_add_scrollbar(box,
 								BOTTOM);
 				} else
 					cy += box->height -
-							(y - box->padding[TOP]);
+						(y - box->edges->padding[TOP]);
 
 				/* Apply any min-height and max-height to
 				 * boxes in normal flow */
@@ -4367,15 +5575,16 @@ layout_block_context(struct box *block,
 					/* Height altered */
 					/* Set current cy */
 					cy += box->height -
-							(y - box->padding[TOP]);
+						(y - box->edges->padding[TOP]);
 				}
 
-				cy += box->padding[BOTTOM] +
-						box->border[BOTTOM].width;
+				cy += box->edges->padding[BOTTOM] +
+					box->edges->border[BOTTOM].width;
 				cx -= box->x;
-				y = box->y + box->padding[TOP] + box->height +
-						box->padding[BOTTOM] +
-						box->border[BOTTOM].width;
+				y = box->y + box->edges->padding[TOP] +
+					box->height +
+					box->edges->padding[BOTTOM] +
+					box->edges->border[BOTTOM].width;
 
 			} while (box->next == NULL);
 			if (box == block)
@@ -4390,10 +5599,10 @@ layout_block_context(struct box *block,
 			margin_collapse = NULL;
 		}
 
-		if (max_pos_margin < box->margin[BOTTOM])
-			max_pos_margin = box->margin[BOTTOM];
-		else if (max_neg_margin < -box->margin[BOTTOM])
-			max_neg_margin = -box->margin[BOTTOM];
+		if (max_pos_margin < box->edges->margin[BOTTOM])
+			max_pos_margin = box->edges->margin[BOTTOM];
+		else if (max_neg_margin < -box->edges->margin[BOTTOM])
+			max_neg_margin = -box->edges->margin[BOTTOM];
 
 		box = box->next;
 		box->y = y;
@@ -4404,14 +5613,15 @@ layout_block_context(struct box *block,
 
 	/* Increase height to contain any floats inside (CSS 2.1 10.6.7). */
 	for (box = block->float_children; box; box = box->next_float) {
-		y = box->y + box->height + box->padding[BOTTOM] +
-				box->border[BOTTOM].width + box->margin[BOTTOM];
+		y = box->y + box->height + box->edges->padding[BOTTOM] +
+				box->edges->border[BOTTOM].width +
+				box->edges->margin[BOTTOM];
 		if (cy < y)
 			cy = y;
 	}
 
 	if (block->height == AUTO) {
-		block->height = cy - block->padding[TOP];
+		block->height = cy - block->edges->padding[TOP];
 		if (block->type == BOX_BLOCK)
 			layout_block_add_scrollbar(block, BOTTOM);
 	}
@@ -4422,27 +5632,60 @@ layout_block_context(struct box *block,
 		layout_apply_minmax_height(&content->unit_len_ctx, block, NULL);
 	}
 
-	if (block->gadget &&
-			(block->gadget->type == GADGET_TEXTAREA ||
-			block->gadget->type == GADGET_PASSWORD ||
-			block->gadget->type == GADGET_TEXTBOX)) {
+	if (box_get_gadget(block) &&
+			(box_get_gadget(block)->type == GADGET_TEXTAREA ||
+			box_get_gadget(block)->type == GADGET_PASSWORD ||
+			box_get_gadget(block)->type == GADGET_TEXTBOX)) {
 		plot_font_style_t fstyle;
-		int ta_width = block->padding[LEFT] + block->width +
-				block->padding[RIGHT];
-		int ta_height = block->padding[TOP] + block->height +
-				block->padding[BOTTOM];
+		int ta_width = block->edges->padding[LEFT] + block->width +
+				block->edges->padding[RIGHT];
+		int ta_height = block->edges->padding[TOP] + block->height +
+				block->edges->padding[BOTTOM];
 		font_plot_style_from_css(&content->unit_len_ctx,
 				block->style, &fstyle);
 		fstyle.background = NS_TRANSPARENT;
-		textarea_set_layout(block->gadget->data.text.ta,
+		textarea_set_layout(box_get_gadget(block)->data.text.ta,
 				&fstyle, ta_width, ta_height,
-				block->padding[TOP], block->padding[RIGHT],
-				block->padding[BOTTOM], block->padding[LEFT]);
+				block->edges->padding[TOP],
+				block->edges->padding[RIGHT],
+				block->edges->padding[BOTTOM],
+				block->edges->padding[LEFT]);
 	}
 
 	return true;
 }
 
+
+/**
+ * Layout a block formatting context.
+ *
+ * \param  block	    BLOCK, INLINE_BLOCK, or TABLE_CELL to layout
+ * \param  viewport_height  Height of viewport in pixels or -ve if unknown
+ * \param  content	    Memory pool for any new boxes
+ * \return  true on success, false on memory exhaustion
+ *
+ * The floats placed in the context are indexed while it is laid out.
+ */
+static bool
+layout_block_context(struct box *block,
+		     int viewport_height,
+		     html_content *content)
+{
+	struct layout_float_index *outer = content->float_index;
+	struct layout_float_index floats;
+	bool ret;
+
+	layout_float_index_init(&floats, block);
+	content->float_index = &floats;
+
+	ret = layout_block_context_flow(block, viewport_height, content);
+
+	content->float_index = outer;
+	layout_float_index_fini(&floats);
+
+	return ret;
+}
+
 /**
  * Get a dom node's element tag type.
  *
@@ -4647,7 +5890,7 @@ layout__get_list_item_count(
 			}
 
 			if (child_box != NULL &&
-			    child_box->list_marker != NULL) {
+			    box_get_list_marker(child_box) != NULL) {
 				count++;
 			}
 		}
@@ -4669,10 +5912,12 @@ layout__get_list_item_count(
 /**
  * Handle list item counting, if this is a list owner box.
  *
- * \param[in]  box  Box to do list item counting for.
+ * \param[in]  content  The HTML content owning the box tree.
+ * \param[in]  box      Box to do list item counting for.
  */
 static void
 layout__ordered_list_count(
+		const html_content *content,
 		struct box *box)
 {
 	dom_html_element_type tag_type;
@@ -4728,14 +5973,23 @@ layout__ordered_list_count(
 			}
 
 			if (child_box != NULL &&
-			    child_box->list_marker != NULL) {
+			    box_get_list_marker(child_box) != NULL) {
 				dom_long value;
-				struct box *marker = child_box->list_marker;
+				struct box *marker =
+						box_get_list_marker(child_box);
+				struct box_ext *ext;
+
+				ext = box_ensure_ext(marker, content->bctx);
+				if (ext == NULL) {
+					dom_node_unref(child);
+					return;
+				}
+
 				if (layout__get_li_value(child, &value)) {
-					marker->list_value = value;
-					next = marker->list_value;
+					ext->list_value = value;
+					next = ext->list_value;
 				} else {
-					marker->list_value = next;
+					ext->list_value = next;
 				}
 				next += step;
 			}
@@ -4762,7 +6016,7 @@ layout__set_numerical_marker_text(
 		const html_content *content,
 		struct box *box)
 {
-	struct box *marker = box->list_marker;
+	struct box *marker = box_get_list_marker(box);
 	size_t counter_len;
 	css_error css_res;
 	enum {
@@ -4780,7 +6034,8 @@ layout__set_numerical_marker_text(
 		return;
 	}
 
-	css_res = css_computed_format_list_style(box->style, marker->list_value,
+	css_res = css_computed_format_list_style(box->style,
+			box_get_list_value(marker),
 			marker->text, LIST_MARKER_SIZE, &counter_len);
 	if (css_res == CSS_OK) {
 		if (counter_len > LIST_MARKER_SIZE) {
@@ -4794,7 +6049,8 @@ layout__set_numerical_marker_text(
 				return;
 			}
 			css_computed_format_list_style(box->style,
-					marker->list_value, marker->text,
+					box_get_list_value(marker),
+					marker->text,
 					counter_len, &counter_len);
 		}
 		marker->length = counter_len;
@@ -4833,11 +6089,11 @@ layout_lists(const html_content *content, struct box *box)
 {
 	struct box *child;
 
-	layout__ordered_list_count(box);
+	layout__ordered_list_count(content, box);
 
 	for (child = box->children; child; child = child->next) {
-		if (child->list_marker) {
-			struct box *marker = child->list_marker;
+		if (box_get_list_marker(child)) {
+			struct box *marker = box_get_list_marker(child);
 
 			if (layout__list_item_is_numerical(child)) {
 				if (marker->text == NULL) {
@@ -4845,12 +6101,12 @@ layout_lists(const html_content *content, struct box *box)
 							content, child);
 				}
 			}
-			if (marker->object) {
-				marker->width =
-					content_get_width(marker->object);
+			if (box_get_object(marker)) {
+				marker->width = content_get_width(
+						box_get_object(marker));
 				marker->x = -marker->width;
-				marker->height =
-					content_get_height(marker->object);
+				marker->height = content_get_height(
+						box_get_object(marker));
 				marker->y = (line_height(
 						&content->unit_len_ctx,
 						marker->style) -
@@ -4999,9 +6255,9 @@ layout_absolute(struct box *box,
 	int static_left, static_top;  /* static position */
 	int top, right, bottom, left;
 	int width, height, max_width, min_width;
-	int *margin = box->margin;
-	int *padding = box->padding;
-	struct box_border *border = box->border;
+	int *margin = box->edges->margin;
+	int *padding = box->edges->padding;
+	struct box_border *border = box->edges->border;
 	int available_width = containing_block->width;
 	int space;
 
@@ -5020,10 +6276,12 @@ layout_absolute(struct box *box,
 		/* Block level container => temporarily increase containing
 		 * block dimensions to include padding (we restore this
 		 * again at the end) */
-		containing_block->width += containing_block->padding[LEFT] +
-				containing_block->padding[RIGHT];
-		containing_block->height += containing_block->padding[TOP] +
-				containing_block->padding[BOTTOM];
+		containing_block->width +=
+				containing_block->edges->padding[LEFT] +
+				containing_block->edges->padding[RIGHT];
+		containing_block->height +=
+				containing_block->edges->padding[TOP] +
+				containing_block->edges->padding[BOTTOM];
 	} else {
 		/** \todo inline containers */
 	}
@@ -5058,9 +6316,11 @@ layout_absolute(struct box *box,
 
 		width = min(max(box->min_width, available_width),
 			box->max_width);
-		width -= box->margin[LEFT] + box->border[LEFT].width +
-			box->padding[LEFT] + box->padding[RIGHT] +
-			box->border[RIGHT].width + box->margin[RIGHT];
+		width -= box->edges->margin[LEFT] +
+			box->edges->border[LEFT].width +
+			box->edges->padding[LEFT] + box->edges->padding[RIGHT] +
+			box->edges->border[RIGHT].width +
+			box->edges->margin[RIGHT];
 
 		/* Adjust for {min|max}-width */
 		if (max_width >= 0 && width > max_width) width = max_width;
@@ -5118,9 +6378,12 @@ layout_absolute(struct box *box,
 
 			width = min(max(box->min_width, available_width),
 				box->max_width);
-			width -= box->margin[LEFT] + box->border[LEFT].width +
-				box->padding[LEFT] + box->padding[RIGHT] +
-				box->border[RIGHT].width + box->margin[RIGHT];
+			width -= box->edges->margin[LEFT] +
+				box->edges->border[LEFT].width +
+				box->edges->padding[LEFT] +
+				box->edges->padding[RIGHT] +
+				box->edges->border[RIGHT].width +
+				box->edges->margin[RIGHT];
 
 			/* Adjust for {min|max}-width */
 			if (max_width >= 0 && width > max_width)
@@ -5152,9 +6415,12 @@ layout_absolute(struct box *box,
 
 			width = min(max(box->min_width, available_width),
 				box->max_width);
-			width -= box->margin[LEFT] + box->border[LEFT].width +
-				box->padding[LEFT] + box->padding[RIGHT] +
-				box->border[RIGHT].width + box->margin[RIGHT];
+			width -= box->edges->margin[LEFT] +
+				box->edges->border[LEFT].width +
+				box->edges->padding[LEFT] +
+				box->edges->padding[RIGHT] +
+				box->edges->border[RIGHT].width +
+				box->edges->margin[RIGHT];
 
 			/* Adjust for {min|max}-width */
 			if (max_width >= 0 && width > max_width)
@@ -5221,8 +6487,9 @@ layout_absolute(struct box *box,
 			containing_block->type == BOX_INLINE_BLOCK ||
 			containing_block->type == BOX_TABLE_CELL) {
 		/* Block-level ancestor => reset container's width */
-		containing_block->width -= containing_block->padding[LEFT] +
-				containing_block->padding[RIGHT];
+		containing_block->width -=
+				containing_block->edges->padding[LEFT] +
+				containing_block->edges->padding[RIGHT];
 	} else {
 		/** \todo inline ancestors */
 	}
@@ -5230,7 +6497,7 @@ layout_absolute(struct box *box,
 	box->height = height;
 
 	if (box->type == BOX_BLOCK || box->type == BOX_INLINE_BLOCK ||
-			box->object || box->flags & IFRAME) {
+			box_get_object(box) || box->flags & IFRAME) {
 		if (!layout_block_context(box, -1, content))
 			return false;
 	} else if (box->type == BOX_TABLE) {
@@ -5347,8 +6614,9 @@ layout_absolute(struct box *box,
 			containing_block->type == BOX_INLINE_BLOCK ||
 			containing_block->type == BOX_TABLE_CELL) {
 		/* Block-level ancestor => reset container's height */
-		containing_block->height -= containing_block->padding[TOP] +
-				containing_block->padding[BOTTOM];
+		containing_block->height -=
+				containing_block->edges->padding[TOP] +
+				containing_block->edges->padding[BOTTOM];
 	} else {
 		/** \todo Inline ancestors */
 	}
@@ -5625,19 +6893,21 @@ layout_get_box_bbox(
 		int *desc_x0, int *desc_y0,
 		int *desc_x1, int *desc_y1)
 {
-	*desc_x0 = -box->border[LEFT].width;
-	*desc_y0 = -box->border[TOP].width;
-	*desc_x1 = box->padding[LEFT] + box->width + box->padding[RIGHT] +
-			box->border[RIGHT].width;
-	*desc_y1 = box->padding[TOP] + box->height + box->padding[BOTTOM] +
-			box->border[BOTTOM].width;
+	*desc_x0 = -box->edges->border[LEFT].width;
+	*desc_y0 = -box->edges->border[TOP].width;
+	*desc_x1 = box->edges->padding[LEFT] + box->width +
+			box->edges->padding[RIGHT] +
+			box->edges->border[RIGHT].width;
+	*desc_y1 = box->edges->padding[TOP] + box->height +
+			box->edges->padding[BOTTOM] +
+			box->edges->border[BOTTOM].width;
 
 	/* To stop the top of text getting clipped when css line-height is
 	 * reduced, we increase the top of the descendant bbox. */
 	if (box->type == BOX_BLOCK && box->style != NULL &&
 			css_computed_overflow_y(box->style) ==
 					CSS_OVERFLOW_VISIBLE &&
-			box->object == NULL) {
+			box_get_object(box) == NULL) {
 		css_fixed font_size = 0;
 		css_unit font_unit = CSS_UNIT_PT;
 		int text_height;
@@ -5674,8 +6944,9 @@ layout_update_descendant_bbox(
 	int child_x = child->x - off_x;
 	int child_y = child->y - off_y;
 
-	bool html_object = (child->object &&
-			content_get_type(child->object) == CONTENT_HTML);
+	bool html_object = (box_get_object(child) &&
+			content_get_type(box_get_object(child)) ==
+					CONTENT_HTML);
 
 	enum css_overflow_e overflow_x = CSS_OVERFLOW_VISIBLE;
 	enum css_overflow_e overflow_y = CSS_OVERFLOW_VISIBLE;
@@ -5720,10 +6991,33 @@ layout_update_descendant_bbox(
 }
 
 
+/**
+ * Clear NEEDS_LAYOUT from a box tree which is not laid out.
+ *
+ * Only marked boxes can have marked descendants, so unmarked subtrees
+ * are skipped.
+ *
+ * \param  box  root of the box tree
+ */
+static void layout_clear_needs_layout(struct box *box)
+{
+	struct box *child;
+
+	box->flags &= ~NEEDS_LAYOUT;
+
+	for (child = box->children; child; child = child->next) {
+		if (child->flags & NEEDS_LAYOUT)
+			layout_clear_needs_layout(child);
+	}
+}
+
+
 /**
  * Recursively calculate the descendant_[xy][01] values for a laid-out box tree
  * and inform iframe browser windows of their size and position.
  *
+ * This is the last pass over the tree, so it also clears NEEDS_LAYOUT.
+ *
  * \param  unit_len_ctx  Length conversion context
  * \param  box      tree of boxes to update
  */
@@ -5731,39 +7025,61 @@ static void layout_calculate_descendant_bboxes(
 		const css_unit_ctx *unit_len_ctx,
 		struct box *box)
 {
+	struct hlcache_handle *object = box_get_object(box);
 	struct box *child;
 
 	assert(box->width != UNKNOWN_WIDTH);
 	assert(box->height != AUTO);
 	/* assert((box->width >= 0) && (box->height >= 0)); */
 
+	/* Layout of this box is complete.  Boxes which are moved after
+	 * flow layout have their static position overwritten, so their
+	 * ancestors can't keep their layout next time. */
+	box->flags &= ~NEEDS_LAYOUT;
+	if (box->style != NULL && box->parent != NULL &&
+			css_computed_position(box->style) !=
+				CSS_POSITION_STATIC)
+		box_mark_needs_layout(box->parent);
+
 	/* Initialise box's descendant box to border edge box */
 	layout_get_box_bbox(unit_len_ctx, box,
 			&box->descendant_x0, &box->descendant_y0,
 			&box->descendant_x1, &box->descendant_y1);
 
 	/* Extend it to contain HTML contents if box is replaced */
-	if (box->object && content_get_type(box->object) == CONTENT_HTML) {
-		if (box->descendant_x1 < content_get_width(box->object))
-			box->descendant_x1 = content_get_width(box->object);
-		if (box->descendant_y1 < content_get_height(box->object))
-			box->descendant_y1 = content_get_height(box->object);
+	if (object && content_get_type(object) == CONTENT_HTML) {
+		if (box->descendant_x1 < content_get_width(object))
+			box->descendant_x1 = content_get_width(object);
+		if (box->descendant_y1 < content_get_height(object))
+			box->descendant_y1 = content_get_height(object);
 	}
 
-	if (box->iframe != NULL) {
+	if (box_get_iframe(box) != NULL) {
 		int x, y;
 		box_coords(box, &x, &y);
 
-		browser_window_set_position(box->iframe, x, y);
-		browser_window_set_dimensions(box->iframe,
+		browser_window_set_position(box_get_iframe(box), x, y);
+		browser_window_set_dimensions(box_get_iframe(box),
 				box->width, box->height);
-		browser_window_reformat(box->iframe, true,
+		browser_window_reformat(box_get_iframe(box), true,
 				box->width, box->height);
 	}
 
 	if (box->type == BOX_INLINE || box->type == BOX_TEXT)
 		return;
 
+	if (box->flags & DEFERRED) {
+		/* Box's children haven't been laid out yet, so any which
+		 * changed are still marked and so must box be */
+		for (child = box->children; child; child = child->next) {
+			if (child->flags & NEEDS_LAYOUT) {
+				box_mark_needs_layout(box);
+				break;
+			}
+		}
+		return;
+	}
+
 	if (box->type == BOX_INLINE_END) {
 		box = box->inline_end;
 		for (child = box->next; child;
@@ -5781,9 +7097,11 @@ static void layout_calculate_descendant_bboxes(
 		return;
 	}
 
-	if (box->flags & REPLACE_DIM)
+	if (box->flags & REPLACE_DIM) {
 		/* Box's children aren't displayed if the box is replaced */
+		layout_clear_needs_layout(box);
 		return;
+	}
 
 	for (child = box->children; child; child = child->next) {
 		if (child->type == BOX_FLOAT_LEFT ||
@@ -5810,8 +7128,8 @@ static void layout_calculate_descendant_bboxes(
 		layout_update_descendant_bbox(unit_len_ctx, box, child, 0, 0);
 	}
 
-	if (box->list_marker) {
-		child = box->list_marker;
+	if (box_get_list_marker(box)) {
+		child = box_get_list_marker(box);
 		layout_calculate_descendant_bboxes(unit_len_ctx, child);
 
 		layout_update_descendant_bbox(unit_len_ctx, box, child, 0, 0);
@@ -5819,10 +7137,130 @@ static void layout_calculate_descendant_bboxes(
 }
 
 
+/**
+ * Discard the minimum and maximum widths found for a box tree.
+ *
+ * \param  box  root of the box tree
+ */
+static void layout_forget_minmax(struct box *box)
+{
+	struct box *child;
+
+	box->max_width = UNKNOWN_MAX_WIDTH;
+
+	for (child = box->children; child != NULL; child = child->next) {
+		layout_forget_minmax(child);
+	}
+}
+
+
+/** Access functions for computed style lengths which may be viewport
+ * relative, in addition to the per-side ones. */
+static const css_len_func viewport_len_funcs[] = {
+	css_computed_width,
+	css_computed_height,
+	css_computed_min_width,
+	css_computed_max_width,
+	css_computed_min_height,
+	css_computed_max_height,
+	css_computed_top,
+	css_computed_right,
+	css_computed_bottom,
+	css_computed_left,
+	css_computed_text_indent,
+	css_computed_line_height,
+	css_computed_vertical_align,
+};
+
+
+/**
+ * Check whether a css unit is relative to the viewport.
+ *
+ * \param  unit  css unit
+ * \return  true if lengths in unit depend on the viewport dimensions
+ */
+static inline bool layout_unit_viewport_relative(css_unit unit)
+{
+	return unit == CSS_UNIT_VW || unit == CSS_UNIT_VH ||
+			unit == CSS_UNIT_VI || unit == CSS_UNIT_VB ||
+			unit == CSS_UNIT_VMIN || unit == CSS_UNIT_VMAX;
+}
+
+
+/**
+ * Check whether a computed style has lengths relative to the viewport.
+ *
+ * \param  style  computed style
+ * \return  true if the lengths used by layout depend on the viewport
+ */
+static bool layout_style_viewport_relative(const css_computed_style *style)
+{
+	css_fixed value;
+	css_unit unit, vunit;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(viewport_len_funcs) /
+			sizeof(viewport_len_funcs[0]); i++) {
+		unit = CSS_UNIT_PX;
+		viewport_len_funcs[i](style, &value, &unit);
+		if (layout_unit_viewport_relative(unit))
+			return true;
+	}
+
+	for (i = 0; i < 4; i++) {
+		unit = CSS_UNIT_PX;
+		margin_funcs[i](style, &value, &unit);
+		if (layout_unit_viewport_relative(unit))
+			return true;
+
+		unit = CSS_UNIT_PX;
+		padding_funcs[i](style, &value, &unit);
+		if (layout_unit_viewport_relative(unit))
+			return true;
+
+		unit = CSS_UNIT_PX;
+		border_width_funcs[i](style, &value, &unit);
+		if (layout_unit_viewport_relative(unit))
+			return true;
+	}
+
+	unit = vunit = CSS_UNIT_PX;
+	css_computed_border_spacing(style, &value, &unit, &value, &vunit);
+
+	return layout_unit_viewport_relative(unit) ||
+			layout_unit_viewport_relative(vunit);
+}
+
+
+/**
+ * Mark the boxes whose layout depends on the viewport dimensions.
+ *
+ * Boxes with viewport relative lengths are marked, so that unchanged
+ * subtrees elsewhere can keep their layout when the viewport is resized.
+ *
+ * \param  box  root of the box tree
+ */
+static void layout_mark_viewport_relative(struct box *box)
+{
+	struct box *child;
+
+	if (box->style != NULL && layout_style_viewport_relative(box->style))
+		box_mark_needs_layout(box);
+
+	for (child = box->children; child != NULL; child = child->next) {
+		layout_mark_viewport_relative(child);
+	}
+
+	if (box_get_list_marker(box) != NULL)
+		layout_mark_viewport_relative(box_get_list_marker(box));
+}
+
+
 /* exported function documented in html/layout.h */
 bool layout_document(html_content *content, int width, int height)
 {
 	bool ret;
+	bool fonts_changed;
 	struct box *doc = content->layout;
 	const struct gui_layout_table *font_func = content->font_func;
 
@@ -5830,15 +7268,39 @@ bool layout_document(html_content *content, int width, int height)
 			width, height, nsurl_access(content_get_url(
 					&content->base)));
 
+	/* Text must be measured again if the font options changed */
+	fonts_changed = font_cache_validate(&content->font_generation);
+	if (fonts_changed)
+		layout_forget_minmax(doc);
+
+	content->layout_reuse = content->had_initial_layout &&
+			fonts_changed == false;
+
+	/* Viewport relative lengths may resolve differently, as may
+	 * percentage heights of the root element's children */
+	if (content->layout_reuse && (width != content->layout_width ||
+			height != content->layout_height)) {
+		struct box *child;
+
+		layout_mark_viewport_relative(doc);
+		for (child = doc->children; child != NULL;
+				child = child->next) {
+			box_mark_needs_layout(child);
+		}
+	}
+	content->layout_width = width;
+	content->layout_height = height;
+
 	layout_minmax_block(doc, font_func, content);
 
 	layout_block_find_dimensions(&content->unit_len_ctx,
 			width, height, 0, 0, doc);
-	doc->x = doc->margin[LEFT] + doc->border[LEFT].width;
-	doc->y = doc->margin[TOP] + doc->border[TOP].width;
-	width -= doc->margin[LEFT] + doc->border[LEFT].width +
-			doc->padding[LEFT] + doc->padding[RIGHT] +
-			doc->border[RIGHT].width + doc->margin[RIGHT];
+	doc->x = doc->edges->margin[LEFT] + doc->edges->border[LEFT].width;
+	doc->y = doc->edges->margin[TOP] + doc->edges->border[TOP].width;
+	width -= doc->edges->margin[LEFT] + doc->edges->border[LEFT].width +
+			doc->edges->padding[LEFT] + doc->edges->padding[RIGHT] +
+			doc->edges->border[RIGHT].width +
+			doc->edges->margin[RIGHT];
 	if (width < 0) {
 		width = 0;
 	}
@@ -5847,21 +7309,26 @@ bool layout_document(html_content *content, int width, int height)
 	ret = layout_block_context(doc, height, content);
 
 	/* make <html> and <body> fill available height */
-	if (doc->y + doc->padding[TOP] + doc->height + doc->padding[BOTTOM] +
-			doc->border[BOTTOM].width + doc->margin[BOTTOM] <
+	if (doc->y + doc->edges->padding[TOP] + doc->height +
+			doc->edges->padding[BOTTOM] +
+			doc->edges->border[BOTTOM].width +
+			doc->edges->margin[BOTTOM] <
 			height) {
-		doc->height = height - (doc->y + doc->padding[TOP] +
-				doc->padding[BOTTOM] +
-				doc->border[BOTTOM].width +
-				doc->margin[BOTTOM]);
-		if (doc->children)
+		doc->height = height - (doc->y + doc->edges->padding[TOP] +
+				doc->edges->padding[BOTTOM] +
+				doc->edges->border[BOTTOM].width +
+				doc->edges->margin[BOTTOM]);
+		if (doc->children) {
+			struct box_edges *edges = doc->children->edges;
+
 			doc->children->height = doc->height -
-					(doc->children->margin[TOP] +
-					 doc->children->border[TOP].width +
-					 doc->children->padding[TOP] +
-					 doc->children->padding[BOTTOM] +
-					 doc->children->border[BOTTOM].width +
-					 doc->children->margin[BOTTOM]);
+					(edges->margin[TOP] +
+					 edges->border[TOP].width +
+					 edges->padding[TOP] +
+					 edges->padding[BOTTOM] +
+					 edges->border[BOTTOM].width +
+					 edges->margin[BOTTOM]);
+		}
 	}
 
 	layout_lists(content, doc);
@@ -45,7 +45,9 @@
 #include "html/interaction.h"
 #include "html/box.h"
 #include "html/box_inspect.h"
+#include "html/box_manipulate.h"
 #include "html/object.h"
+#include "html/redraw_list.h"
 
 /* break reference loop */
 static void html_object_refresh(void *p);
@@ -89,18 +91,30 @@ html_object_failed(struct box *box, html_content *content, bool background)
  */
 
 static void
-html_object_done(struct box *box,
+html_object_done(html_content *c,
+		 struct box *box,
 		 hlcache_handle *object,
 		 bool background)
 {
-	struct box *b;
+	/* The box is drawn differently, even if its layout is kept */
+	html_redraw_list_invalidate(c, box);
 
 	if (background) {
 		box->background = object;
 		return;
 	}
 
-	box->object = object;
+	box->ext->object = object;
+
+	/* The object changes what the pointer is over */
+	html_mouse_forget_hover(c);
+
+	/* A box with given dimensions is laid out the same with its object,
+	 * unless it changes type below */
+	if (!(box->flags & REPLACE_DIM) || box->type == BOX_TABLE) {
+		/* invalidate layout and parent min, max widths */
+		box_mark_needs_layout(box);
+	}
 
 	/* Normalise the box type, now it has been replaced. */
 	switch (box->type) {
@@ -113,10 +127,6 @@ html_object_done(struct box *box,
 	}
 
 	if (!(box->flags & REPLACE_DIM)) {
-		/* invalidate parent min, max widths */
-		for (b = box; b; b = b->parent)
-			b->max_width = UNKNOWN_MAX_WIDTH;
-
 		/* delete any clones of this box */
 		while (box->next && (box->next->flags & CLONE)) {
 			/* box_free_box(box->next); */
@@ -126,6 +136,66 @@ html_object_done(struct box *box,
 }
 
 
+/**
+ * Scheduled callback to reflow a document after objects change size.
+ *
+ * \param p HTML content
+ */
+static void html_object_reflow(void *p)
+{
+	html_content *c = p;
+
+	if (c->object_reflow == false) {
+		/* The document has been reformatted since */
+		return;
+	}
+
+	if (c->base.status != CONTENT_STATUS_READY &&
+	    c->base.status != CONTENT_STATUS_DONE) {
+		/* The document will be reformatted when it becomes ready */
+		c->object_reflow = false;
+		return;
+	}
+
+	if (c->base.locked || c->reflowing) {
+		/* Try again after the current operation */
+		guit->misc->schedule(10, html_object_reflow, c);
+		return;
+	}
+
+	content__reformat(&c->base, false, c->base.available_width,
+			c->base.available_height);
+}
+
+
+/**
+ * Request a reflow of a document whose objects have changed size.
+ *
+ * Requests are gathered into a single reflow, which happens no sooner
+ * than the content's next reformat time.
+ *
+ * \param c  document of type CONTENT_HTML
+ */
+static void html_object_request_reflow(html_content *c)
+{
+	uint64_t ms_now;
+	int delay = 0;
+
+	if (c->object_reflow) {
+		/* Already scheduled */
+		return;
+	}
+	c->object_reflow = true;
+
+	nsu_getmonotonic_ms(&ms_now);
+	if (c->base.reformat_time > ms_now) {
+		delay = c->base.reformat_time - ms_now;
+	}
+
+	guit->misc->schedule(delay, html_object_reflow, c);
+}
+
+
 /**
  * Callback for hlcache_handle_retrieve() for objects with no box.
  */
@@ -171,7 +241,7 @@ html_object_callback(hlcache_handle *object,
 		if (c->base.status != CONTENT_STATUS_LOADING && c->bw != NULL)
 			content_open(object,
 					c->bw, &c->base,
-					box->object_params);
+					box_get_object_params(box));
 		break;
 
 	case CONTENT_MSG_READY:
@@ -184,12 +254,18 @@ html_object_callback(hlcache_handle *object,
 							box->height : 0);
 
 			/* Adjust parent content for new object size */
-			html_object_done(box, object, o->background);
-			if (c->base.status == CONTENT_STATUS_READY ||
-					c->base.status == CONTENT_STATUS_DONE)
-				content__reformat(&c->base, false,
-						c->base.available_width,
-						c->base.available_height);
+			html_object_done(c, box, object, o->background);
+			if (c->base.status != CONTENT_STATUS_READY &&
+					c->base.status != CONTENT_STATUS_DONE)
+				break;
+
+			if (box->flags & REPLACE_DIM) {
+				/* Object was formatted to the box's size */
+				if (c->had_initial_layout)
+					html__redraw_a_box(c, box);
+			} else {
+				html_object_request_reflow(c);
+			}
 		}
 		break;
 
@@ -197,7 +273,7 @@ html_object_callback(hlcache_handle *object,
 		c->base.active--;
 		NSLOG(netsurf, INFO, "%d fetches active", c->base.active);
 
-		html_object_done(box, object, o->background);
+		html_object_done(c, box, object, o->background);
 
 		if (c->base.status != CONTENT_STATUS_LOADING &&
 				box->flags & REPLACE_DIM) {
@@ -212,8 +288,8 @@ html_object_callback(hlcache_handle *object,
 
 			box_coords(box, &x, &y);
 
-			data.redraw.x = x + box->padding[LEFT];
-			data.redraw.y = y + box->padding[TOP];
+			data.redraw.x = x + box->edges->padding[LEFT];
+			data.redraw.y = y + box->edges->padding[TOP];
 			data.redraw.width = box->width;
 			data.redraw.height = box->height;
 
@@ -251,10 +327,12 @@ html_object_callback(hlcache_handle *object,
 				css_fixed hpos = 0, vpos = 0;
 				css_unit hunit = CSS_UNIT_PX;
 				css_unit vunit = CSS_UNIT_PX;
-				int width = box->padding[LEFT] + box->width +
-						box->padding[RIGHT];
-				int height = box->padding[TOP] + box->height +
-						box->padding[BOTTOM];
+				int width = box->edges->padding[LEFT] +
+					box->width +
+						box->edges->padding[RIGHT];
+				int height = box->edges->padding[TOP] +
+					box->height +
+						box->edges->padding[BOTTOM];
 				int t, h, l, w;
 
 				/* Need to know background-position */
@@ -343,8 +421,8 @@ html_object_callback(hlcache_handle *object,
 							box->height / h;
 				}
 
-				data.redraw.x += x + box->padding[LEFT];
-				data.redraw.y += y + box->padding[TOP];
+				data.redraw.x += x + box->edges->padding[LEFT];
+				data.redraw.y += y + box->edges->padding[TOP];
 			}
 
 			content_broadcast(&c->base, CONTENT_MSG_REDRAW, &data);
@@ -377,11 +455,13 @@ html_object_callback(hlcache_handle *object,
 		break;
 
 	case CONTENT_MSG_SCROLL:
-		if (box->scroll_x != NULL)
-			scrollbar_set(box->scroll_x, event->data.scroll.x0,
+		if (box_get_scroll_x(box) != NULL)
+			scrollbar_set(box_get_scroll_x(box),
+			event->data.scroll.x0,
 					false);
-		if (box->scroll_y != NULL)
-			scrollbar_set(box->scroll_y, event->data.scroll.y0,
+		if (box_get_scroll_y(box) != NULL)
+			scrollbar_set(box_get_scroll_y(box),
+			event->data.scroll.y0,
 					false);
 		break;
 
@@ -475,6 +555,7 @@ html_object_callback(hlcache_handle *object,
 
 	if (c->base.status == CONTENT_STATUS_READY &&
 	    c->base.active == 0 &&
+	    c->box_conversion_context == NULL &&
 	    (event->type == CONTENT_MSG_LOADING ||
 	     event->type == CONTENT_MSG_DONE ||
 	     event->type == CONTENT_MSG_ERROR)) {
@@ -493,20 +574,10 @@ html_object_callback(hlcache_handle *object,
 		 * 2) an object is newly fetched & converted,
 		 * 3) the box's dimensions need to change due to being replaced
 		 * 4) the object's parent HTML is ready for reformat,
+		 * so reflow the page to display newly fetched objects, along
+		 * with any others which arrive before the reflow happens.
 		 */
-		uint64_t ms_now;
-		nsu_getmonotonic_ms(&ms_now);
-		if (ms_now > c->base.reformat_time) {
-			/* The time since the previous reformat is
-			 *  more than the configured minimum time
-			 *  between reformats so reformat the page to
-			 *  display newly fetched objects
-			 */
-			content__reformat(&c->base,
-					  false,
-					  c->base.available_width,
-					  c->base.available_height);
-		}
+		html_object_request_reflow(c);
 	}
 
 	return NSERROR_OK;
@@ -546,7 +617,10 @@ static bool html_replace_object(struct content_html_object *object, nsurl *url)
 		hlcache_handle_release(object->content);
 		object->content = NULL;
 
-		object->box->object = NULL;
+		if (object->box->ext != NULL)
+			object->box->ext->object = NULL;
+		html_redraw_list_invalidate(c, object->box);
+		html_mouse_forget_hover(c);
 	}
 
 	/* initialise fetch */
@@ -611,7 +685,7 @@ nserror html_object_open_objects(html_content *html, struct browser_window *bw)
 		content_open(object->content,
 			     bw,
 			     &html->base,
-			     object->box->object_params);
+			     box_get_object_params(object->box));
 	}
 	return NSERROR_OK;
 }
@@ -683,9 +757,85 @@ nserror html_object_close_objects(html_content *html)
 }
 
 
+/**
+ * Release a content object which has been unlinked from the object list
+ *
+ * \param html The html content the object belonged to.
+ * \param victim The object to release.
+ */
+static void
+html_object_release(html_content *html, struct content_html_object *victim)
+{
+	html->num_objects--;
+
+	if (victim->content != NULL) {
+		if (content_get_status(victim->content) !=
+				CONTENT_STATUS_DONE) {
+			/* Still counted as an active fetch */
+			html->base.active--;
+			NSLOG(netsurf, INFO, "%d fetches active",
+			      html->base.active);
+		}
+
+		if (content_get_type(victim->content) == CONTENT_HTML) {
+			guit->misc->schedule(-1, html_object_refresh, victim);
+		}
+
+		if (html->bw != NULL && content_get_type(
+				victim->content) != CONTENT_NONE) {
+			content_close(victim->content);
+		}
+
+		hlcache_handle_release(victim->content);
+	}
+
+	free(victim);
+}
+
+
+/* exported interface documented in html/object.h */
+nserror html_object_release_descendants(html_content *html, struct box *box)
+{
+	struct content_html_object **link = &html->object_list;
+
+	while (*link != NULL) {
+		struct content_html_object *victim = *link;
+
+		if (victim->box == NULL ||
+				!box_is_descendant(victim->box, box)) {
+			link = &victim->next;
+			continue;
+		}
+
+		*link = victim->next;
+		html_object_release(html, victim);
+	}
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in html/object.h */
+nserror
+html_object_release_since(html_content *html, struct content_html_object *mark)
+{
+	while (html->object_list != NULL && html->object_list != mark) {
+		struct content_html_object *victim = html->object_list;
+
+		html->object_list = victim->next;
+		html_object_release(html, victim);
+	}
+
+	return NSERROR_OK;
+}
+
+
 /* exported interface documented in html/object.h */
 nserror html_object_free_objects(html_content *html)
 {
+	guit->misc->schedule(-1, html_object_reflow, html);
+	html->object_reflow = false;
+
 	while (html->object_list != NULL) {
 		struct content_html_object *victim = html->object_list;
 
@@ -722,6 +872,15 @@ html_fetch_object(html_content *c,
 	if (c->aborted)
 		return true;
 
+	/* Provisional box trees don't fetch objects; the final box tree
+	 * will fetch them once the document has loaded */
+	if (c->progressive_conversion)
+		return true;
+
+	/* The box holds the object in its extension block */
+	if (box != NULL && !background && box_ensure_ext(box, c->bctx) == NULL)
+		return false;
+
 	child.charset = c->encoding;
 	child.quirks = c->base.quirks;
 
@@ -27,6 +27,7 @@
 struct html_content;
 struct browser_window;
 struct box;
+struct content_html_object;
 struct nsurl;
 
 /**
@@ -56,6 +57,30 @@ bool html_fetch_object(struct html_content *c, struct nsurl *url, struct box *bo
  */
 nserror html_object_free_objects(struct html_content *html);
 
+/**
+ * release content objects belonging to boxes below a box
+ *
+ * Used when part of the box tree is about to be discarded. Fetches still
+ * in progress are abandoned.
+ *
+ * \param html The html content to release the objects from.
+ * \param box The box whose descendants' objects are released.
+ * \return NSERROR_OK on success else appropriate error code.
+ */
+nserror html_object_release_descendants(struct html_content *html, struct box *box);
+
+/**
+ * release content objects fetched since a point in the object list
+ *
+ * Used when a box tree under construction is abandoned. Objects are
+ * added to the front of the list, so those before the mark are released.
+ *
+ * \param html The html content to release the objects from.
+ * \param mark The head of the object list at that point.
+ * \return NSERROR_OK on success else appropriate error code.
+ */
+nserror html_object_release_since(struct html_content *html, struct content_html_object *mark);
+
 /**
  * close content of content objects associated with a HTML content
  *
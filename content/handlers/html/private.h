@@ -35,6 +35,15 @@ struct gui_layout_table;
 struct scrollbar_msg_data;
 struct content_redraw_data;
 struct selection;
+struct box_arena;
+struct layout_float_index;
+struct html_redraw_list;
+struct mouse_action_state;
+
+/**
+ * Number of mutated elements tracked before the whole box tree is rebuilt
+ */
+#define HTML_MUTATED_MAX 16
 
 typedef enum {
 	HTML_DRAG_NONE,			/** No drag */
@@ -124,20 +133,77 @@ typedef struct html_content {
 	/** Whether an initial layout has been done */
 	bool had_initial_layout;
 
+	/** Viewport dimensions of the most recent layout */
+	int layout_width, layout_height;
+
+	/** Whether the current layout may keep unchanged subtrees */
+	bool layout_reuse;
+
+	/** Font options generation of the most recent layout */
+	unsigned int font_generation;
+
+	/** Text in the root block's normal flow below this y is laid out
+	 * later */
+	int layout_limit;
+
+	/** Time after which the layout of text is put off, in ms, or 0 */
+	uint64_t layout_deadline;
+
+	/** Whether the most recent layout put off laying out some text */
+	bool layout_deferred;
+
+	/** Whether the layout is continuing a deferred layout */
+	bool layout_completing;
+
+	/** Vertical extent, relative to the root block, of text laid out
+	 * by a continuing layout and of anything that moved as a result */
+	int layout_changed_y0, layout_changed_y1;
+
+	/** Whether a reflow is scheduled for objects which changed size */
+	bool object_reflow;
+
+	/** Float index of the block formatting context being laid out */
+	struct layout_float_index *float_index;
+
 	/** Whether scripts are enabled for this content */
 	bool enable_scripting;
 
 	/* Title element node */
 	dom_node *title;
 
-	/** A talloc context purely for the render box tree */
-	int *bctx;
+	/** Allocation context purely for the render box tree */
+	struct box_arena *bctx;
 	/** A context pointer for the box conversion, NULL if no conversion
 	 * is in progress.
 	 */
 	void *box_conversion_context;
+	/** Whether a provisional box tree is being built from a partially
+	 * parsed document. Objects, frames and form gadgets are not created
+	 * for such trees.
+	 */
+	bool progressive_conversion;
+	/** Source size when the provisional box tree was last built */
+	size_t progressive_size;
+	/** talloc context of a provisional box tree being replaced */
+	struct box_arena *progressive_bctx;
 	/** Box tree, or NULL. */
 	struct box *layout;
+	/** Redraw list built from the laid out box tree, or NULL */
+	struct html_redraw_list *redraw_list;
+	/** Mouse action state found for the hover boxes of the redraw list,
+	 * or NULL if none has been allocated */
+	struct mouse_action_state *mouse_hover;
+	/** Browser window of pointer movement waiting to be handled, or
+	 * NULL if none is waiting */
+	struct browser_window *mouse_track_bw;
+	/** Position of pointer movement waiting to be handled */
+	int mouse_track_x, mouse_track_y;
+	/** Elements whose box subtrees are out of date with the DOM */
+	dom_node *mutated[HTML_MUTATED_MAX];
+	/** Number of entries in mutated */
+	unsigned int mutated_count;
+	/** Whether more elements changed than mutated can hold */
+	bool mutated_overflow;
 	/** Document background colour. */
 	colour background_colour;
 
@@ -229,6 +295,20 @@ extern bool html_redraw_debug;
 void html__redraw_a_box(html_content *htmlc, struct box *box);
 
 
+/**
+ * Note that the DOM below a node changed after box tree construction
+ *
+ * The affected part of the box tree is rebuilt and the document
+ * reformatted from a scheduled callback, so several mutations made by a
+ * script are handled together.
+ *
+ * \param htmlc HTML content
+ * \param node The node whose children or text changed
+ * \param restyle Whether the style of \a node itself may have changed
+ */
+void html__dom_mutated(html_content *htmlc, dom_node *node, bool restyle);
+
+
 /**
  * Complete conversion of an HTML document
  *
@@ -63,6 +63,7 @@
 #include "html/form_internal.h"
 #include "html/private.h"
 #include "html/layout.h"
+#include "html/redraw_list.h"
 
 
 bool html_redraw_debug = false;
@@ -547,8 +548,8 @@ static bool html_redraw_file(int x, int y, int width, int height,
 	font_plot_style_from_css(unit_len_ctx, box->style, &fstyle);
 	fstyle.background = background_colour;
 
-	if (box->gadget->value) {
-		text = box->gadget->value;
+	if (box_get_gadget(box)->value) {
+		text = box_get_gadget(box)->value;
 	} else {
 		text = messages_get("Form_Drop");
 	}
@@ -573,6 +574,30 @@ static bool html_redraw_file(int x, int y, int width, int height,
 }
 
 
+/**
+ * Plot a background image, or record it if recording a redraw list
+ *
+ * \param  image  background image content
+ * \param  data   redraw data for the image
+ * \param  clip   clip rectangle of the image
+ * \param  ctx    current redraw context
+ * \return true if successful, false otherwise
+ */
+
+static bool html_redraw_background_image(struct hlcache_handle *image,
+		struct content_redraw_data *data,
+		const struct rect *clip, const struct redraw_context *ctx)
+{
+	if (html_redraw_list_recording(ctx))
+		return html_redraw_list_record_background(ctx, image, data);
+
+	/* We just continue if redraw fails */
+	content_redraw(image, data, clip, ctx);
+
+	return true;
+}
+
+
 /**
  * Plot background images.
  *
@@ -598,6 +623,8 @@ static bool html_redraw_background(int x, int y, struct box *box, float scale,
 		const css_unit_ctx *unit_len_ctx,
 		const struct redraw_context *ctx)
 {
+	int *margin = box->edges->margin;
+	int *padding = box->edges->padding;
 	bool repeat_x = false;
 	bool repeat_y = false;
 	bool plot_colour = true;
@@ -626,19 +653,19 @@ static bool html_redraw_background(int x, int y, struct box *box, float scale,
 		if (!box->parent) {
 			/* Root element, special case:
 			 * background origin calc. is based on margin box */
-			x -= box->margin[LEFT] * scale;
-			y -= box->margin[TOP] * scale;
-			width = box->margin[LEFT] + box->padding[LEFT] +
-					box->width + box->padding[RIGHT] +
-					box->margin[RIGHT];
-			height = box->margin[TOP] + box->padding[TOP] +
-					box->height + box->padding[BOTTOM] +
-					box->margin[BOTTOM];
+			x -= margin[LEFT] * scale;
+			y -= margin[TOP] * scale;
+			width = margin[LEFT] + padding[LEFT] +
+					box->width + padding[RIGHT] +
+					margin[RIGHT];
+			height = margin[TOP] + padding[TOP] +
+					box->height + padding[BOTTOM] +
+					margin[BOTTOM];
 		} else {
-			width = box->padding[LEFT] + box->width +
-					box->padding[RIGHT];
-			height = box->padding[TOP] + box->height +
-					box->padding[BOTTOM];
+			width = padding[LEFT] + box->width +
+					padding[RIGHT];
+			height = padding[TOP] + box->height +
+					padding[BOTTOM];
 		}
 		/* handle background-repeat */
 		switch (css_computed_background_repeat(background->style)) {
@@ -715,12 +742,14 @@ static bool html_redraw_background(int x, int y, struct box *box, float scale,
 			/* update clip.* to the child cell */
 			r.x0 = ox + (clip_box->x * scale);
 			r.y0 = oy + (clip_box->y * scale);
-			r.x1 = r.x0 + (clip_box->padding[LEFT] +
+			r.x1 = r.x0 + (clip_box->edges->padding[LEFT] +
 					clip_box->width +
-					clip_box->padding[RIGHT]) * scale;
-			r.y1 = r.y0 + (clip_box->padding[TOP] +
+					clip_box->edges->padding[RIGHT]) *
+					scale;
+			r.y1 = r.y0 + (clip_box->edges->padding[TOP] +
 					clip_box->height +
-					clip_box->padding[BOTTOM]) * scale;
+					clip_box->edges->padding[BOTTOM]) *
+					scale;
 
 			if (r.x0 < clip->x0) r.x0 = clip->x0;
 			if (r.y0 < clip->y0) r.y0 = clip->y0;
@@ -790,9 +819,10 @@ static bool html_redraw_background(int x, int y, struct box *box, float scale,
 				bg_data.repeat_x = repeat_x;
 				bg_data.repeat_y = repeat_y;
 
-				/* We just continue if redraw fails */
-				content_redraw(background->background,
-						&bg_data, &r, ctx);
+				if (!html_redraw_background_image(
+						background->background,
+						&bg_data, &r, ctx))
+					return false;
 			}
 		}
 
@@ -950,8 +980,9 @@ static bool html_redraw_inline_background(int x, int y, struct box *box,
 			bg_data.repeat_x = repeat_x;
 			bg_data.repeat_y = repeat_y;
 
-			/* We just continue if redraw fails */
-			content_redraw(box->background, &bg_data, &r, ctx);
+			if (!html_redraw_background_image(box->background,
+					&bg_data, &r, ctx))
+				return false;
 		}
 	}
 
@@ -1121,31 +1152,27 @@ static bool html_redraw_text_decoration(struct box *box,
  *
  * \param html The html content to redraw text within.
  * \param  box      box with text content
+ * \param  fstyle   text style of box, with current background colour
  * \param  x        x co-ord of box
  * \param  y        y co-ord of box
  * \param  clip     current clip rectangle
  * \param  scale    current scale setting (1.0 = 100%)
- * \param  current_background_color
  * \param  ctx	    current redraw context
  * \return true iff successful and redraw should proceed
  */
 
 static bool html_redraw_text_box(const html_content *html, struct box *box,
+		const plot_font_style_t *fstyle,
 		int x, int y, const struct rect *clip, float scale,
-		colour current_background_color,
 		const struct redraw_context *ctx)
 {
-	bool excluded = (box->object != NULL);
-	plot_font_style_t fstyle;
-
-	font_plot_style_from_css(&html->unit_len_ctx, box->style, &fstyle);
-	fstyle.background = current_background_color;
+	bool excluded = (box_get_object(box) != NULL);
 
 	if (!text_redraw(box->text,
 			 box->length,
 			 box->byte_offset,
 			 box->space,
-			 &fstyle,
+			 fstyle,
 			 x, y,
 			 clip,
 			 box->height,
@@ -1159,17 +1186,91 @@ static bool html_redraw_text_box(const html_content *html, struct box *box,
 	return true;
 }
 
-bool html_redraw_box(const html_content *html, struct box *box,
+static bool html_redraw_box(const html_content *html,
+		const struct html_redraw_item *item,
 		int x_parent, int y_parent,
 		const struct rect *clip, float scale,
 		colour current_background_color,
 		const struct redraw_context *ctx);
 
+static bool html_redraw_replay(const html_content *html,
+		const struct html_redraw_item *item,
+		int x_parent, int y_parent,
+		const struct rect *clip, float scale,
+		const struct redraw_context *ctx);
+
+/**
+ * Draw a run of children from the redraw list.
+ *
+ * Only the children whose descendant boxes may intersect the clip
+ * rectangle are visited.
+ *
+ * \param  html	     html content
+ * \param  first     index of first child in the child table
+ * \param  count     number of children
+ * \param  x         coordinate of children's parent, less scroll offset
+ * \param  y         coordinate of children's parent, less scroll offset
+ * \param  clip      clip rectangle
+ * \param  scale     scale for redraw
+ * \param  current_background_color  background colour under the children
+ * \param  replay    replay the children's recorded operations
+ * \param  ctx	     current redraw context
+ * \return true if successful, false otherwise
+ */
+
+static bool html_redraw_box_run(const html_content *html,
+		unsigned int first, unsigned int count,
+		int x, int y,
+		const struct rect *clip, float scale,
+		colour current_background_color, bool replay,
+		const struct redraw_context *ctx)
+{
+	const struct html_redraw_list *list = html->redraw_list;
+	const struct html_redraw_item *child;
+	unsigned int end = first + count;
+	unsigned int last = end;
+	unsigned int mid;
+	int clip_y0, clip_y1;
+
+	/* clip rectangle relative to the children, allowing for rounding */
+	clip_y0 = clip->y0 / scale - y - 2;
+	clip_y1 = clip->y1 / scale - y + 2;
+
+	/* find the first child which reaches down to the clip rectangle */
+	while (first < last) {
+		mid = first + (last - first) / 2;
+		if (list->item[list->child[mid]].y1 < clip_y0)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+
+	for (; first < end; first++) {
+		child = &list->item[list->child[first]];
+
+		if (clip_y1 < child->y0)
+			/* neither it nor any later child reaches up to the
+			 * clip rectangle */
+			break;
+
+		if (replay) {
+			if (!html_redraw_replay(html, child, x, y, clip,
+					scale, ctx))
+				return false;
+		} else if (!html_redraw_box(html, child, x, y, clip, scale,
+				current_background_color, ctx)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /**
  * Draw the various children of a box.
  *
  * \param  html	     html content
- * \param  box	     box to draw children of
+ * \param  item	     redraw list entry of box to draw children of
  * \param  x_parent  coordinate of parent box
  * \param  y_parent  coordinate of parent box
  * \param  clip      clip rectangle
@@ -1179,35 +1280,257 @@ bool html_redraw_box(const html_content *html, struct box *box,
  * \return true if successful, false otherwise
  */
 
-static bool html_redraw_box_children(const html_content *html, struct box *box,
+static bool html_redraw_box_children(const html_content *html,
+		const struct html_redraw_item *item,
 		int x_parent, int y_parent,
 		const struct rect *clip, float scale,
 		colour current_background_color,
 		const struct redraw_context *ctx)
 {
-	struct box *c;
+	struct box *box = item->box;
+	int x, y;
 
-	for (c = box->children; c; c = c->next) {
+	x = x_parent + box->x - scrollbar_get_offset(box_get_scroll_x(box));
+	y = y_parent + box->y - scrollbar_get_offset(box_get_scroll_y(box));
 
-		if (c->type != BOX_FLOAT_LEFT && c->type != BOX_FLOAT_RIGHT)
-			if (!html_redraw_box(html, c,
-					x_parent + box->x -
-					scrollbar_get_offset(box->scroll_x),
-					y_parent + box->y -
-					scrollbar_get_offset(box->scroll_y),
-					clip, scale, current_background_color,
-					ctx))
+	/* normal flow children, then floats */
+	if (!html_redraw_box_run(html, item->children, item->child_count,
+			x, y, clip, scale, current_background_color, false,
+			ctx))
+		return false;
+
+	return html_redraw_box_run(html, item->children + item->child_count,
+			item->float_count, x, y, clip, scale,
+			current_background_color, false, ctx);
+}
+
+/**
+ * Determine if a box is drawn with its contents rather than its children
+ *
+ * \param  item    redraw list entry of box
+ * \param  width   scaled width of box's content edge
+ * \param  height  scaled height of box's content edge
+ * \return true if box has replaced content, a form control or text
+ */
+
+static bool html_redraw_box_has_content(const struct html_redraw_item *item,
+		int width, int height)
+{
+	struct box *box = item->box;
+	struct form_control *gadget = box_get_gadget(box);
+
+	if (box_get_object(box) && width != 0 && height != 0)
+		return true;
+
+	/* an iframe box has no children, so is treated as content
+	 * before the browser window for it exists */
+	if ((item->canvas && box->flags & REPLACE_DIM) ||
+			box->flags & IFRAME)
+		return true;
+
+	if (gadget && (gadget->type == GADGET_CHECKBOX ||
+			gadget->type == GADGET_RADIO ||
+			gadget->type == GADGET_FILE ||
+			gadget->type == GADGET_TEXTAREA ||
+			gadget->type == GADGET_PASSWORD ||
+			gadget->type == GADGET_TEXTBOX))
+		return true;
+
+	return box->text != NULL;
+}
+
+/**
+ * Draw the replaced content, form control or text of a box.
+ *
+ * \param  html	     html content
+ * \param  content   contents to draw
+ * \param  x         coordinate of box
+ * \param  y         coordinate of box
+ * \param  r         clip rectangle of contents
+ * \param  scale     scale for redraw
+ * \param  ctx	     current redraw context
+ * \return true if successful, false otherwise
+ *
+ * x, y, r are in target coordinates.
+ */
+
+static bool html_redraw_box_content(const html_content *html,
+		const struct html_redraw_content *content,
+		int x, int y, const struct rect *r, float scale,
+		const struct redraw_context *ctx)
+{
+	struct box *box = content->box;
+	struct form_control *gadget = box_get_gadget(box);
+	struct hlcache_handle *object = box_get_object(box);
+	int width = content->width;
+	int height = content->height;
+	int padding_left = content->padding_left;
+	int padding_top = content->padding_top;
+	colour current_background_color = content->background;
+	int x_scrolled, y_scrolled;
+	struct rect rect;
+	dom_exception exc;
+
+	if (object && width != 0 && height != 0) {
+		struct content_redraw_data obj_data;
+
+		x_scrolled = x - scrollbar_get_offset(
+				box_get_scroll_x(box)) * scale;
+		y_scrolled = y - scrollbar_get_offset(
+				box_get_scroll_y(box)) * scale;
+
+		obj_data.x = x_scrolled + padding_left;
+		obj_data.y = y_scrolled + padding_top;
+		obj_data.width = width;
+		obj_data.height = height;
+		obj_data.background_colour = current_background_color;
+		obj_data.scale = scale;
+		obj_data.repeat_x = false;
+		obj_data.repeat_y = false;
+
+		if (content_get_type(object) == CONTENT_HTML) {
+			obj_data.x /= scale;
+			obj_data.y /= scale;
+		}
+
+		if (!content_redraw(object, &obj_data, r, ctx)) {
+			/* Show image fail */
+			/* Unicode (U+FFFC) 'OBJECT REPLACEMENT CHARACTER' */
+			const char *obj = "\xef\xbf\xbc";
+			int obj_width;
+			int obj_x = x + padding_left;
+			nserror res;
+
+			rect.x0 = x + padding_left;
+			rect.y0 = y + padding_top;
+			rect.x1 = x + padding_left + width - 1;
+			rect.y1 = y + padding_top + height - 1;
+			res = ctx->plot->rectangle(ctx, plot_style_broken_object, &rect);
+			if (res != NSERROR_OK) {
 				return false;
-	}
-	for (c = box->float_children; c; c = c->next_float)
-		if (!html_redraw_box(html, c,
-				x_parent + box->x -
-				scrollbar_get_offset(box->scroll_x),
-				y_parent + box->y -
-				scrollbar_get_offset(box->scroll_y),
-				clip, scale, current_background_color,
+			}
+
+			res = guit->layout->width(plot_fstyle_broken_object,
+						  obj,
+						  sizeof(obj) - 1,
+						  &obj_width);
+			if (res != NSERROR_OK) {
+				obj_x += 1;
+			} else {
+				obj_x += width / 2 - obj_width / 2;
+			}
+
+			if (ctx->plot->text(ctx,
+					    plot_fstyle_broken_object,
+					    obj_x, y + padding_top + (int)(height * 0.75),
+					    obj, sizeof(obj) - 1) != NSERROR_OK)
+				return false;
+		}
+	} else if (content->canvas && box->flags & REPLACE_DIM) {
+		/* Canvas to draw */
+		struct bitmap *bitmap = NULL;
+		exc = dom_node_get_user_data(box->node,
+					     corestring_dom___ns_key_canvas_node_data,
+					     &bitmap);
+		if (exc != DOM_NO_ERR) {
+			bitmap = NULL;
+		}
+		if (bitmap != NULL &&
+		    ctx->plot->bitmap(ctx, bitmap, x + padding_left, y + padding_top,
+				      width, height, current_background_color,
+				      BITMAPF_NONE) != NSERROR_OK)
+			return false;
+	} else if (box->flags & IFRAME) {
+		/* Offset is passed to browser window redraw unscaled */
+		if (box_get_iframe(box))
+			browser_window_redraw(box_get_iframe(box),
+					x + padding_left,
+					y + padding_top, r, ctx);
+
+	} else if (gadget && gadget->type == GADGET_CHECKBOX) {
+		if (!html_redraw_checkbox(x + padding_left, y + padding_top,
+				width, height, gadget->selected, ctx))
+			return false;
+
+	} else if (gadget && gadget->type == GADGET_RADIO) {
+		if (!html_redraw_radio(x + padding_left, y + padding_top,
+				width, height, gadget->selected, ctx))
+			return false;
+
+	} else if (gadget && gadget->type == GADGET_FILE) {
+		if (!html_redraw_file(x + padding_left, y + padding_top,
+				width, height, box, scale,
+				current_background_color, &html->unit_len_ctx, ctx))
+			return false;
+
+	} else if (gadget &&
+			(gadget->type == GADGET_TEXTAREA ||
+			gadget->type == GADGET_PASSWORD ||
+			gadget->type == GADGET_TEXTBOX)) {
+		textarea_redraw(gadget->data.text.ta, x, y,
+				current_background_color, scale, r, ctx);
+
+	} else if (box->text) {
+		plot_font_style_t fstyle = content->fstyle;
+
+		fstyle.background = current_background_color;
+		if (!html_redraw_text_box(html, box, &fstyle, x, y, r, scale,
 				ctx))
 			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Draw the scrollbars of a box, creating or removing them as needed.
+ *
+ * \param  html	     html content
+ * \param  item	     redraw list entry of box to draw scrollbars of
+ * \param  x_parent  coordinate of parent box
+ * \param  y_parent  coordinate of parent box
+ * \param  clip      clip rectangle
+ * \param  scale     scale for redraw
+ * \param  ctx	     current redraw context
+ * \return true if successful, false otherwise
+ */
+
+static bool html_redraw_box_scrollbars(const html_content *html,
+		const struct html_redraw_item *item,
+		int x_parent, int y_parent,
+		const struct rect *clip, float scale,
+		const struct redraw_context *ctx)
+{
+	struct box *box = item->box;
+	int *padding = box->edges->padding;
+	bool has_x_scroll = (item->overflow_x == CSS_OVERFLOW_SCROLL);
+	bool has_y_scroll = (item->overflow_y == CSS_OVERFLOW_SCROLL);
+	nserror res;
+
+	has_x_scroll |= (item->overflow_x == CSS_OVERFLOW_AUTO) &&
+			box_hscrollbar_present(box);
+	has_y_scroll |= (item->overflow_y == CSS_OVERFLOW_AUTO) &&
+			box_vscrollbar_present(box);
+
+	res = box_handle_scrollbars((struct content *)html,
+				    box, has_x_scroll, has_y_scroll);
+	if (res != NSERROR_OK) {
+		NSLOG(netsurf, INFO, "%s", messages_get_errorcode(res));
+		return false;
+	}
+
+	if (box_get_scroll_x(box) != NULL)
+		scrollbar_redraw(box_get_scroll_x(box),
+				x_parent + box->x,
+				y_parent + box->y + padding[TOP] +
+				box->height + padding[BOTTOM] -
+				SCROLLBAR_WIDTH, clip, scale, ctx);
+	if (box_get_scroll_y(box) != NULL)
+		scrollbar_redraw(box_get_scroll_y(box),
+				x_parent + box->x + padding[LEFT] +
+				box->width + padding[RIGHT] -
+				SCROLLBAR_WIDTH,
+				y_parent + box->y, clip, scale, ctx);
 
 	return true;
 }
@@ -1216,7 +1539,7 @@ static bool html_redraw_box_children(const html_content *html, struct box *box,
  * Recursively draw a box.
  *
  * \param  html	     html content
- * \param  box	     box to draw
+ * \param  item	     redraw list entry of box to draw
  * \param  x_parent  coordinate of parent box
  * \param  y_parent  coordinate of parent box
  * \param  clip      clip rectangle
@@ -1228,51 +1551,50 @@ static bool html_redraw_box_children(const html_content *html, struct box *box,
  * x, y, clip_[xy][01] are in target coordinates.
  */
 
-bool html_redraw_box(const html_content *html, struct box *box,
+static bool html_redraw_box(const html_content *html,
+		const struct html_redraw_item *item,
 		int x_parent, int y_parent,
 		const struct rect *clip, const float scale,
 		colour current_background_color,
 		const struct redraw_context *ctx)
 {
 	const struct plotter_table *plot = ctx->plot;
+	struct box *box = item->box;
+	int *margin = box->edges->margin;
+	int *padding = box->edges->padding;
+	struct box_border *border = box->edges->border;
+	struct form_control *gadget = box_get_gadget(box);
+	struct hlcache_handle *object = box_get_object(box);
 	int x, y;
 	int width, height;
 	int padding_left, padding_top, padding_width, padding_height;
 	int border_left, border_top, border_right, border_bottom;
 	struct rect r;
 	struct rect rect;
-	int x_scrolled, y_scrolled;
 	struct box *bg_box = NULL;
 	css_computed_clip_rect css_rect;
-	enum css_overflow_e overflow_x = CSS_OVERFLOW_VISIBLE;
-	enum css_overflow_e overflow_y = CSS_OVERFLOW_VISIBLE;
-	dom_exception exc;
-	dom_html_element_type tag_type;
+	enum css_overflow_e overflow_x = item->overflow_x;
+	enum css_overflow_e overflow_y = item->overflow_y;
 
 
 	if (html_redraw_printing && (box->flags & PRINTED))
 		return true;
 
-	if (box->style != NULL) {
-		overflow_x = css_computed_overflow_x(box->style);
-		overflow_y = css_computed_overflow_y(box->style);
-	}
-
 	/* avoid trivial FP maths */
 	if (scale == 1.0) {
 		x = x_parent + box->x;
 		y = y_parent + box->y;
 		width = box->width;
 		height = box->height;
-		padding_left = box->padding[LEFT];
-		padding_top = box->padding[TOP];
-		padding_width = padding_left + box->width + box->padding[RIGHT];
+		padding_left = padding[LEFT];
+		padding_top = padding[TOP];
+		padding_width = padding_left + box->width + padding[RIGHT];
 		padding_height = padding_top + box->height +
-				box->padding[BOTTOM];
-		border_left = box->border[LEFT].width;
-		border_top = box->border[TOP].width;
-		border_right = box->border[RIGHT].width;
-		border_bottom = box->border[BOTTOM].width;
+				padding[BOTTOM];
+		border_left = border[LEFT].width;
+		border_top = border[TOP].width;
+		border_right = border[RIGHT].width;
+		border_bottom = border[BOTTOM].width;
 	} else {
 		x = (x_parent + box->x) * scale;
 		y = (y_parent + box->y) * scale;
@@ -1280,18 +1602,18 @@ bool html_redraw_box(const html_content *html, struct box *box,
 		height = box->height * scale;
 		/* left and top padding values are normally zero,
 		 * so avoid trivial FP maths */
-		padding_left = box->padding[LEFT] ? box->padding[LEFT] * scale
+		padding_left = padding[LEFT] ? padding[LEFT] * scale
 				: 0;
-		padding_top = box->padding[TOP] ? box->padding[TOP] * scale
+		padding_top = padding[TOP] ? padding[TOP] * scale
 				: 0;
-		padding_width = (box->padding[LEFT] + box->width +
-				box->padding[RIGHT]) * scale;
-		padding_height = (box->padding[TOP] + box->height +
-				box->padding[BOTTOM]) * scale;
-		border_left = box->border[LEFT].width * scale;
-		border_top = box->border[TOP].width * scale;
-		border_right = box->border[RIGHT].width * scale;
-		border_bottom = box->border[BOTTOM].width * scale;
+		padding_width = (padding[LEFT] + box->width +
+				padding[RIGHT]) * scale;
+		padding_height = (padding[TOP] + box->height +
+				padding[BOTTOM]) * scale;
+		border_left = border[LEFT].width * scale;
+		border_top = border[TOP].width * scale;
+		border_right = border[RIGHT].width * scale;
+		border_bottom = border[BOTTOM].width * scale;
 	}
 
 	/* calculate rectangle covering this box and descendants */
@@ -1313,11 +1635,11 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			/* root element */
 			int margin_left, margin_right;
 			if (scale == 1.0) {
-				margin_left = box->margin[LEFT];
-				margin_right = box->margin[RIGHT];
+				margin_left = margin[LEFT];
+				margin_right = margin[RIGHT];
 			} else {
-				margin_left = box->margin[LEFT] * scale;
-				margin_right = box->margin[RIGHT] * scale;
+				margin_left = margin[LEFT] * scale;
+				margin_right = margin[RIGHT] * scale;
 			}
 			r.x0 = x - border_left - margin_left < r.x0 ?
 					x - border_left - margin_left : r.x0;
@@ -1347,11 +1669,11 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			/* root element */
 			int margin_top, margin_bottom;
 			if (scale == 1.0) {
-				margin_top = box->margin[TOP];
-				margin_bottom = box->margin[BOTTOM];
+				margin_top = margin[TOP];
+				margin_bottom = margin[BOTTOM];
 			} else {
-				margin_top = box->margin[TOP] * scale;
-				margin_bottom = box->margin[BOTTOM] * scale;
+				margin_top = margin[TOP] * scale;
+				margin_bottom = margin[BOTTOM] * scale;
 			}
 			r.y0 = y - border_top - margin_top < r.y0 ?
 					y - border_top - margin_top : r.y0;
@@ -1363,6 +1685,8 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	}
 
 	/* return if the rectangle is completely outside the clip rectangle */
+	if (!html_redraw_list_record_test(ctx, HTML_REDRAW_OP_CULL, &r))
+		return false;
 	if (clip->y1 < r.y0 || r.y1 < clip->y0 ||
 			clip->x1 < r.x0 || r.x1 < clip->x0)
 		return true;
@@ -1374,7 +1698,7 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			if (r.y1 - r.y0 <= html_redraw_printing_border &&
 					(box->type == BOX_TEXT ||
 					box->type == BOX_TABLE_CELL
-					|| box->object || box->gadget)) {
+					|| object || gadget)) {
 				/*remember the highest of all points from the
 				not printed elements*/
 				if (r.y0 < html_redraw_printing_top_cropped)
@@ -1386,14 +1710,19 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	}
 
 	/* if visibility is hidden render children only */
-	if (box->style && css_computed_visibility(box->style) ==
-			CSS_VISIBILITY_HIDDEN) {
+	if (item->hidden) {
 		if ((ctx->plot->group_start) &&
 		    (ctx->plot->group_start(ctx, "hidden box") != NSERROR_OK))
 			return false;
-		if (!html_redraw_box_children(html, box, x_parent, y_parent,
-				&r, scale, current_background_color, ctx))
+		if (html_redraw_list_recording(ctx)) {
+			if (!html_redraw_list_record_children(ctx, &r,
+					current_background_color))
+				return false;
+		} else if (!html_redraw_box_children(html, item,
+				x_parent, y_parent, &r, scale,
+				current_background_color, ctx)) {
 			return false;
+		}
 		return ((!ctx->plot->group_end) || (ctx->plot->group_end(ctx) == NSERROR_OK));
 	}
 
@@ -1428,6 +1757,10 @@ bool html_redraw_box(const html_content *html, struct box *box,
 					box->style, &html->unit_len_ctx,
 					css_rect.bottom, css_rect.bunit));
 
+		if (!html_redraw_list_record_test(ctx, HTML_REDRAW_OP_EMPTY,
+				&r))
+			return false;
+
 		/* find intersection of clip rectangle and box */
 		if (r.x0 < clip->x0) r.x0 = clip->x0;
 		if (r.y0 < clip->y0) r.y0 = clip->y0;
@@ -1443,7 +1776,11 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			return false;
 
 	} else if (box->type == BOX_BLOCK || box->type == BOX_INLINE_BLOCK ||
-			box->type == BOX_TABLE_CELL || box->object) {
+			box->type == BOX_TABLE_CELL || object) {
+		if (!html_redraw_list_record_test(ctx, HTML_REDRAW_OP_ZERO,
+				&r))
+			return false;
+
 		/* find intersection of clip rectangle and box */
 		if (r.x0 < clip->x0) r.x0 = clip->x0;
 		if (r.y0 < clip->y0) r.y0 = clip->y0;
@@ -1476,12 +1813,12 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	if (bg_box && bg_box->type != BOX_BR &&
 			bg_box->type != BOX_TEXT &&
 			bg_box->type != BOX_INLINE_END &&
-			(bg_box->type != BOX_INLINE || bg_box->object ||
+			(bg_box->type != BOX_INLINE || box_get_object(bg_box) ||
 			bg_box->flags & IFRAME || box->flags & REPLACE_DIM ||
-			(bg_box->gadget != NULL &&
-			(bg_box->gadget->type == GADGET_TEXTAREA ||
-			bg_box->gadget->type == GADGET_TEXTBOX ||
-			bg_box->gadget->type == GADGET_PASSWORD)))) {
+			(box_get_gadget(bg_box) != NULL &&
+			(box_get_gadget(bg_box)->type == GADGET_TEXTAREA ||
+			box_get_gadget(bg_box)->type == GADGET_TEXTBOX ||
+			box_get_gadget(bg_box)->type == GADGET_PASSWORD)))) {
 		/* find intersection of clip box and border edge */
 		struct rect p;
 		p.x0 = x - border_left < r.x0 ? r.x0 : x - border_left;
@@ -1495,15 +1832,15 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			 * background covers margins too */
 			int m_left, m_top, m_right, m_bottom;
 			if (scale == 1.0) {
-				m_left = box->margin[LEFT];
-				m_top = box->margin[TOP];
-				m_right = box->margin[RIGHT];
-				m_bottom = box->margin[BOTTOM];
+				m_left = margin[LEFT];
+				m_top = margin[TOP];
+				m_right = margin[RIGHT];
+				m_bottom = margin[BOTTOM];
 			} else {
-				m_left = box->margin[LEFT] * scale;
-				m_top = box->margin[TOP] * scale;
-				m_right = box->margin[RIGHT] * scale;
-				m_bottom = box->margin[BOTTOM] * scale;
+				m_left = margin[LEFT] * scale;
+				m_top = margin[TOP] * scale;
+				m_right = margin[RIGHT] * scale;
+				m_bottom = margin[BOTTOM] * scale;
 			}
 			p.x0 = p.x0 - m_left < r.x0 ? r.x0 : p.x0 - m_left;
 			p.y0 = p.y0 - m_top < r.y0 ? r.y0 : p.y0 - m_top;
@@ -1527,12 +1864,12 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	if (box->style &&
 	    box->type != BOX_TEXT &&
 	    box->type != BOX_INLINE_END &&
-	    (box->type != BOX_INLINE || box->object ||
+	    (box->type != BOX_INLINE || object ||
 	     box->flags & IFRAME || box->flags & REPLACE_DIM ||
-	     (box->gadget != NULL &&
-	      (box->gadget->type == GADGET_TEXTAREA ||
-	       box->gadget->type == GADGET_TEXTBOX ||
-	       box->gadget->type == GADGET_PASSWORD))) &&
+	     (gadget != NULL &&
+	      (gadget->type == GADGET_TEXTAREA ||
+	       gadget->type == GADGET_TEXTBOX ||
+	       gadget->type == GADGET_PASSWORD))) &&
 	    (border_top || border_right || border_bottom || border_left)) {
 		if (!html_redraw_borders(box, x_parent, y_parent,
 				padding_width, padding_height, &r,
@@ -1575,17 +1912,22 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			if (scale == 1.0) {
 				ib_x = x_parent + ib->x;
 				ib_y = y_parent + ib->y;
-				ib_p_width = ib->padding[LEFT] + ib->width +
-						ib->padding[RIGHT];
-				ib_b_left = ib->border[LEFT].width;
-				ib_b_right = ib->border[RIGHT].width;
+				ib_p_width = ib->edges->padding[LEFT] +
+						ib->width +
+						ib->edges->padding[RIGHT];
+				ib_b_left = ib->edges->border[LEFT].width;
+				ib_b_right = ib->edges->border[RIGHT].width;
 			} else {
 				ib_x = (x_parent + ib->x) * scale;
 				ib_y = (y_parent + ib->y) * scale;
-				ib_p_width = (ib->padding[LEFT] + ib->width +
-						ib->padding[RIGHT]) * scale;
-				ib_b_left = ib->border[LEFT].width * scale;
-				ib_b_right = ib->border[RIGHT].width * scale;
+				ib_p_width = (ib->edges->padding[LEFT] +
+						ib->width +
+						ib->edges->padding[RIGHT]) *
+						scale;
+				ib_b_left = ib->edges->border[LEFT].width *
+						scale;
+				ib_b_right = ib->edges->border[RIGHT].width *
+						scale;
 			}
 
 			if ((ib->flags & NEW_LINE) && ib != box) {
@@ -1645,15 +1987,15 @@ bool html_redraw_box(const html_content *html, struct box *box,
 		int margin_top, margin_bottom;
 		if (scale == 1.0) {
 			/* avoid trivial fp maths */
-			margin_left = box->margin[LEFT];
-			margin_top = box->margin[TOP];
-			margin_right = box->margin[RIGHT];
-			margin_bottom = box->margin[BOTTOM];
+			margin_left = margin[LEFT];
+			margin_top = margin[TOP];
+			margin_right = margin[RIGHT];
+			margin_bottom = margin[BOTTOM];
 		} else {
-			margin_left = box->margin[LEFT] * scale;
-			margin_top = box->margin[TOP] * scale;
-			margin_right = box->margin[RIGHT] * scale;
-			margin_bottom = box->margin[BOTTOM] * scale;
+			margin_left = margin[LEFT] * scale;
+			margin_top = margin[TOP] * scale;
+			margin_right = margin[RIGHT] * scale;
+			margin_bottom = margin[BOTTOM] * scale;
 		}
 		/* Content edge -- blue */
 		rect.x0 = x + padding_left;
@@ -1684,13 +2026,16 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	 * or scroll, unless it's the root element */
 	if (box->parent != NULL) {
 		bool need_clip = false;
-		if (box->object || box->flags & IFRAME ||
+		if (object || box->flags & IFRAME ||
 				(overflow_x != CSS_OVERFLOW_VISIBLE &&
 				 overflow_y != CSS_OVERFLOW_VISIBLE)) {
 			r.x0 = x;
 			r.y0 = y;
 			r.x1 = x + padding_width;
 			r.y1 = y + padding_height;
+			if (!html_redraw_list_record_test(ctx,
+					HTML_REDRAW_OP_EMPTY, &r))
+				return false;
 			if (r.x0 < clip->x0) r.x0 = clip->x0;
 			if (r.y0 < clip->y0) r.y0 = clip->y0;
 			if (clip->x1 < r.x1) r.x1 = clip->x1;
@@ -1706,6 +2051,9 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			r.y0 = clip->y0;
 			r.x1 = x + padding_width;
 			r.y1 = clip->y1;
+			if (!html_redraw_list_record_test(ctx,
+					HTML_REDRAW_OP_EMPTY, &r))
+				return false;
 			if (r.x0 < clip->x0) r.x0 = clip->x0;
 			if (clip->x1 < r.x1) r.x1 = clip->x1;
 			if (r.x1 <= r.x0) {
@@ -1719,6 +2067,9 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			r.y0 = y;
 			r.x1 = clip->x1;
 			r.y1 = y + padding_height;
+			if (!html_redraw_list_record_test(ctx,
+					HTML_REDRAW_OP_EMPTY, &r))
+				return false;
 			if (r.y0 < clip->y0) r.y0 = clip->y0;
 			if (clip->y1 < r.y1) r.y1 = clip->y1;
 			if (r.y1 <= r.y0) {
@@ -1731,136 +2082,51 @@ bool html_redraw_box(const html_content *html, struct box *box,
 		if (need_clip &&
 		    (box->type == BOX_BLOCK ||
 		     box->type == BOX_INLINE_BLOCK ||
-		     box->type == BOX_TABLE_CELL || box->object)) {
+		     box->type == BOX_TABLE_CELL || object)) {
 			if (ctx->plot->clip(ctx, &r) != NSERROR_OK)
 				return false;
 		}
 	}
 
 	/* text decoration */
-	if ((box->type != BOX_TEXT) &&
-	    box->style &&
-	    css_computed_text_decoration(box->style) !=	CSS_TEXT_DECORATION_NONE) {
+	if (item->decorated) {
 		if (!html_redraw_text_decoration(box, x_parent, y_parent,
 				scale, current_background_color, ctx))
 			return false;
 	}
 
-	if (box->node != NULL) {
-		exc = dom_html_element_get_tag_type(box->node, &tag_type);
-		if (exc != DOM_NO_ERR) {
-			tag_type = DOM_HTML_ELEMENT_TYPE__UNKNOWN;
-		}
-	} else {
-		tag_type = DOM_HTML_ELEMENT_TYPE__UNKNOWN;
-	}
-
-	if (box->object && width != 0 && height != 0) {
-		struct content_redraw_data obj_data;
-
-		x_scrolled = x - scrollbar_get_offset(box->scroll_x) * scale;
-		y_scrolled = y - scrollbar_get_offset(box->scroll_y) * scale;
-
-		obj_data.x = x_scrolled + padding_left;
-		obj_data.y = y_scrolled + padding_top;
-		obj_data.width = width;
-		obj_data.height = height;
-		obj_data.background_colour = current_background_color;
-		obj_data.scale = scale;
-		obj_data.repeat_x = false;
-		obj_data.repeat_y = false;
-
-		if (content_get_type(box->object) == CONTENT_HTML) {
-			obj_data.x /= scale;
-			obj_data.y /= scale;
-		}
-
-		if (!content_redraw(box->object, &obj_data, &r, ctx)) {
-			/* Show image fail */
-			/* Unicode (U+FFFC) 'OBJECT REPLACEMENT CHARACTER' */
-			const char *obj = "\xef\xbf\xbc";
-			int obj_width;
-			int obj_x = x + padding_left;
-			nserror res;
-
-			rect.x0 = x + padding_left;
-			rect.y0 = y + padding_top;
-			rect.x1 = x + padding_left + width - 1;
-			rect.y1 = y + padding_top + height - 1;
-			res = ctx->plot->rectangle(ctx, plot_style_broken_object, &rect);
-			if (res != NSERROR_OK) {
-				return false;
-			}
-
-			res = guit->layout->width(plot_fstyle_broken_object,
-						  obj,
-						  sizeof(obj) - 1,
-						  &obj_width);
-			if (res != NSERROR_OK) {
-				obj_x += 1;
-			} else {
-				obj_x += width / 2 - obj_width / 2;
-			}
-
-			if (ctx->plot->text(ctx,
-					    plot_fstyle_broken_object,
-					    obj_x, y + padding_top + (int)(height * 0.75),
-					    obj, sizeof(obj) - 1) != NSERROR_OK)
+	if (html_redraw_box_has_content(item, width, height)) {
+		struct html_redraw_content content = {
+			.box = box,
+			.width = width,
+			.height = height,
+			.padding_left = padding_left,
+			.padding_top = padding_top,
+			.background = current_background_color,
+			.canvas = item->canvas,
+		};
+
+		if (box->text)
+			font_plot_style_from_css(&html->unit_len_ctx,
+					box->style, &content.fstyle);
+
+		if (html_redraw_list_recording(ctx)) {
+			if (!html_redraw_list_record_content(ctx, &content,
+					&r))
 				return false;
-		}
-	} else if (tag_type == DOM_HTML_ELEMENT_TYPE_CANVAS &&
-		   box->node != NULL &&
-		   box->flags & REPLACE_DIM) {
-		/* Canvas to draw */
-		struct bitmap *bitmap = NULL;
-		exc = dom_node_get_user_data(box->node,
-					     corestring_dom___ns_key_canvas_node_data,
-					     &bitmap);
-		if (exc != DOM_NO_ERR) {
-			bitmap = NULL;
-		}
-		if (bitmap != NULL &&
-		    ctx->plot->bitmap(ctx, bitmap, x + padding_left, y + padding_top,
-				      width, height, current_background_color,
-				      BITMAPF_NONE) != NSERROR_OK)
+		} else if (!html_redraw_box_content(html, &content, x, y, &r,
+				scale, ctx)) {
 			return false;
-	} else if (box->iframe) {
-		/* Offset is passed to browser window redraw unscaled */
-		browser_window_redraw(box->iframe,
-				x + padding_left,
-				y + padding_top, &r, ctx);
-
-	} else if (box->gadget && box->gadget->type == GADGET_CHECKBOX) {
-		if (!html_redraw_checkbox(x + padding_left, y + padding_top,
-				width, height, box->gadget->selected, ctx))
-			return false;
-
-	} else if (box->gadget && box->gadget->type == GADGET_RADIO) {
-		if (!html_redraw_radio(x + padding_left, y + padding_top,
-				width, height, box->gadget->selected, ctx))
-			return false;
-
-	} else if (box->gadget && box->gadget->type == GADGET_FILE) {
-		if (!html_redraw_file(x + padding_left, y + padding_top,
-				width, height, box, scale,
-				current_background_color, &html->unit_len_ctx, ctx))
-			return false;
-
-	} else if (box->gadget &&
-			(box->gadget->type == GADGET_TEXTAREA ||
-			box->gadget->type == GADGET_PASSWORD ||
-			box->gadget->type == GADGET_TEXTBOX)) {
-		textarea_redraw(box->gadget->data.text.ta, x, y,
-				current_background_color, scale, &r, ctx);
+		}
 
-	} else if (box->text) {
-		if (!html_redraw_text_box(html, box, x, y, &r, scale,
-				current_background_color, ctx))
+	} else if (html_redraw_list_recording(ctx)) {
+		if (!html_redraw_list_record_children(ctx, &r,
+				current_background_color))
 			return false;
 
 	} else {
-		if (!html_redraw_box_children(html, box, x_parent, y_parent, &r,
-				scale, current_background_color, ctx))
+		if (!html_redraw_box_children(html, item, x_parent, y_parent,
+				&r, scale, current_background_color, ctx))
 			return false;
 	}
 
@@ -1870,12 +2136,17 @@ bool html_redraw_box(const html_content *html, struct box *box,
 			return false;
 
 	/* list marker */
-	if (box->list_marker) {
-		if (!html_redraw_box(html, box->list_marker,
+	if (item->marker != 0 && html_redraw_list_recording(ctx)) {
+		if (!html_redraw_list_record_marker(ctx,
+				current_background_color))
+			return false;
+	} else if (item->marker != 0) {
+		if (!html_redraw_box(html,
+				&html->redraw_list->item[item->marker],
 				x_parent + box->x -
-				scrollbar_get_offset(box->scroll_x),
+				scrollbar_get_offset(box_get_scroll_x(box)),
 				y_parent + box->y -
-				scrollbar_get_offset(box->scroll_y),
+				scrollbar_get_offset(box_get_scroll_y(box)),
 				clip, scale, current_background_color, ctx))
 			return false;
 	}
@@ -1883,41 +2154,20 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	/* scrollbars */
 	if (((box->style && box->type != BOX_BR &&
 	      box->type != BOX_TABLE && box->type != BOX_INLINE &&
-	      (box->gadget == NULL || box->gadget->type != GADGET_TEXTAREA) &&
+	      (gadget == NULL || gadget->type != GADGET_TEXTAREA) &&
 	      (overflow_x == CSS_OVERFLOW_SCROLL ||
 	       overflow_x == CSS_OVERFLOW_AUTO ||
 	       overflow_y == CSS_OVERFLOW_SCROLL ||
 	       overflow_y == CSS_OVERFLOW_AUTO)) ||
-	     (box->object && content_get_type(box->object) ==
+	     (object && content_get_type(object) ==
 	      CONTENT_HTML)) && box->parent != NULL) {
-		nserror res;
-		bool has_x_scroll = (overflow_x == CSS_OVERFLOW_SCROLL);
-		bool has_y_scroll = (overflow_y == CSS_OVERFLOW_SCROLL);
-
-		has_x_scroll |= (overflow_x == CSS_OVERFLOW_AUTO) &&
-				box_hscrollbar_present(box);
-		has_y_scroll |= (overflow_y == CSS_OVERFLOW_AUTO) &&
-				box_vscrollbar_present(box);
-
-		res = box_handle_scrollbars((struct content *)html,
-					    box, has_x_scroll, has_y_scroll);
-		if (res != NSERROR_OK) {
-			NSLOG(netsurf, INFO, "%s", messages_get_errorcode(res));
+		if (html_redraw_list_recording(ctx)) {
+			if (!html_redraw_list_record_scrollbars(ctx))
+				return false;
+		} else if (!html_redraw_box_scrollbars(html, item,
+				x_parent, y_parent, clip, scale, ctx)) {
 			return false;
 		}
-
-		if (box->scroll_x != NULL)
-			scrollbar_redraw(box->scroll_x,
-					x_parent + box->x,
-					y_parent + box->y + box->padding[TOP] +
-					box->height + box->padding[BOTTOM] -
-					SCROLLBAR_WIDTH, clip, scale, ctx);
-		if (box->scroll_y != NULL)
-			scrollbar_redraw(box->scroll_y,
-					x_parent + box->x + box->padding[LEFT] +
-					box->width + box->padding[RIGHT] -
-					SCROLLBAR_WIDTH,
-					y_parent + box->y, clip, scale, ctx);
 	}
 
 	if (box->type == BOX_BLOCK || box->type == BOX_INLINE_BLOCK ||
@@ -1929,6 +2179,376 @@ bool html_redraw_box(const html_content *html, struct box *box,
 	return ((!plot->group_end) || (ctx->plot->group_end(ctx) == NSERROR_OK));
 }
 
+/**
+ * Clip rectangle of a replay, set in the plotters only when needed
+ */
+struct html_redraw_replay_clip {
+	struct rect clip; /**< Current clip rectangle */
+	bool set; /**< Clip rectangle is set in the plotters */
+};
+
+/**
+ * Set the current clip rectangle of a replay in the plotters.
+ *
+ * \param  current  clip rectangle of replay
+ * \param  ctx	    current redraw context
+ * \return true if successful, false otherwise
+ */
+
+static bool html_redraw_replay_set_clip(struct html_redraw_replay_clip *current,
+		const struct redraw_context *ctx)
+{
+	if (current->set)
+		return true;
+
+	if (ctx->plot->clip(ctx, &current->clip) != NSERROR_OK)
+		return false;
+
+	current->set = true;
+	return true;
+}
+
+/**
+ * Move a recorded rectangle to a box's position, within a clip rectangle.
+ *
+ * \param  r       recorded rectangle, relative to the box
+ * \param  x       coordinate of box
+ * \param  y       coordinate of box
+ * \param  clip    clip rectangle
+ * \param  result  updated to intersection of moved rectangle and clip
+ */
+
+static void html_redraw_replay_rect(const struct rect *r, int x, int y,
+		const struct rect *clip, struct rect *result)
+{
+	result->x0 = max(r->x0 + x, clip->x0);
+	result->y0 = max(r->y0 + y, clip->y0);
+	result->x1 = min(r->x1 + x, clip->x1);
+	result->y1 = min(r->y1 + y, clip->y1);
+}
+
+/**
+ * Replay a recorded shape plot.
+ *
+ * \param  op       recorded operation
+ * \param  x        coordinate of box
+ * \param  y        coordinate of box
+ * \param  current  clip rectangle of replay
+ * \param  ctx	    current redraw context
+ * \return true if successful, false otherwise
+ */
+
+static bool html_redraw_replay_shape(const struct html_redraw_op *op,
+		int x, int y, struct html_redraw_replay_clip *current,
+		const struct redraw_context *ctx)
+{
+	const plot_style_t *pstyle = &op->data.shape.style;
+	struct rect r;
+	int p[NOF_ELEMENTS(op->data.shape.point)];
+	unsigned int i;
+	nserror res;
+
+	/* skip plots outside the clip rectangle */
+	html_redraw_replay_rect(&op->bounds, x, y, &current->clip, &r);
+	if (r.x0 >= r.x1 || r.y0 >= r.y1)
+		return true;
+
+	if (!html_redraw_replay_set_clip(current, ctx))
+		return false;
+
+	r.x0 = op->rect.x0 + x;
+	r.y0 = op->rect.y0 + y;
+	r.x1 = op->rect.x1 + x;
+	r.y1 = op->rect.y1 + y;
+
+	switch (op->type) {
+	case HTML_REDRAW_OP_RECTANGLE:
+		res = ctx->plot->rectangle(ctx, pstyle, &r);
+		break;
+
+	case HTML_REDRAW_OP_LINE:
+		res = ctx->plot->line(ctx, pstyle, &r);
+		break;
+
+	case HTML_REDRAW_OP_POLYGON:
+		for (i = 0; i != op->data.shape.n; i++) {
+			p[i * 2] = op->data.shape.point[i * 2] + x;
+			p[i * 2 + 1] = op->data.shape.point[i * 2 + 1] + y;
+		}
+		res = ctx->plot->polygon(ctx, pstyle, p, op->data.shape.n);
+		break;
+
+	case HTML_REDRAW_OP_DISC:
+		res = ctx->plot->disc(ctx, pstyle,
+				op->data.shape.point[0] + x,
+				op->data.shape.point[1] + y,
+				op->data.shape.radius);
+		break;
+
+	case HTML_REDRAW_OP_ARC:
+		res = ctx->plot->arc(ctx, pstyle,
+				op->data.shape.point[0] + x,
+				op->data.shape.point[1] + y,
+				op->data.shape.radius,
+				op->data.shape.angle1,
+				op->data.shape.angle2);
+		break;
+
+	default:
+		res = NSERROR_OK;
+		break;
+	}
+
+	return res == NSERROR_OK;
+}
+
+/**
+ * Replay the recorded operations of a box, and those of its descendants.
+ *
+ * Draws what html_redraw_box() would draw. Replaced content, form
+ * controls, text and scrollbars are drawn from the live box state.
+ *
+ * \param  html	     html content
+ * \param  item	     redraw list entry of box to draw
+ * \param  x_parent  coordinate of parent box
+ * \param  y_parent  coordinate of parent box
+ * \param  clip      clip rectangle
+ * \param  scale     scale for redraw
+ * \param  ctx	     current redraw context
+ * \return true if successful, false otherwise
+ *
+ * clip is in target coordinates.
+ */
+
+static bool html_redraw_replay(const html_content *html,
+		const struct html_redraw_item *item,
+		int x_parent, int y_parent,
+		const struct rect *clip, float scale,
+		const struct redraw_context *ctx)
+{
+	const struct html_redraw_list *list = html->redraw_list;
+	const struct html_redraw_op *op;
+	struct box *box = item->box;
+	struct html_redraw_replay_clip current;
+	struct content_redraw_data bg_data;
+	struct rect r;
+	int x, y;
+	int x_children, y_children;
+	unsigned int i;
+
+	/* avoid trivial FP maths */
+	if (scale == 1.0) {
+		x = x_parent + box->x;
+		y = y_parent + box->y;
+	} else {
+		x = (x_parent + box->x) * scale;
+		y = (y_parent + box->y) * scale;
+	}
+
+	/* children and list marker are positioned less the scroll offset */
+	x_children = x_parent + box->x -
+			scrollbar_get_offset(box_get_scroll_x(box));
+	y_children = y_parent + box->y -
+			scrollbar_get_offset(box_get_scroll_y(box));
+
+	current.clip = *clip;
+	current.set = false;
+
+	for (i = item->op_first; ; i++) {
+		if (i == item->op_children) {
+			/* normal flow children, then floats */
+			html_redraw_replay_rect(&item->clip, x, y, clip, &r);
+			if (!html_redraw_box_run(html, item->children,
+					item->child_count,
+					x_children, y_children, &r, scale,
+					item->child_background, true, ctx) ||
+			    !html_redraw_box_run(html,
+					item->children + item->child_count,
+					item->float_count,
+					x_children, y_children, &r, scale,
+					item->child_background, true, ctx))
+				return false;
+			current.set = false;
+		}
+
+		if (i == item->op_end)
+			break;
+
+		op = &list->op[i];
+
+		switch (op->type) {
+		case HTML_REDRAW_OP_CLIP:
+			html_redraw_replay_rect(&op->rect, x, y, clip, &r);
+			if (r.x0 != current.clip.x0 ||
+					r.y0 != current.clip.y0 ||
+					r.x1 != current.clip.x1 ||
+					r.y1 != current.clip.y1) {
+				current.clip = r;
+				current.set = false;
+			}
+			break;
+
+		case HTML_REDRAW_OP_CULL:
+			/* box is completely outside the clip rectangle */
+			if (clip->y1 < op->rect.y0 + y ||
+					op->rect.y1 + y < clip->y0 ||
+					clip->x1 < op->rect.x0 + x ||
+					op->rect.x1 + x < clip->x0)
+				return true;
+			break;
+
+		case HTML_REDRAW_OP_EMPTY:
+			html_redraw_replay_rect(&op->rect, x, y, clip, &r);
+			if (r.x0 >= r.x1 || r.y0 >= r.y1)
+				return true;
+			break;
+
+		case HTML_REDRAW_OP_ZERO:
+			html_redraw_replay_rect(&op->rect, x, y, clip, &r);
+			if (r.x0 == r.x1 || r.y0 == r.y1)
+				return true;
+			break;
+
+		case HTML_REDRAW_OP_BACKGROUND:
+			if (!html_redraw_replay_set_clip(&current, ctx))
+				return false;
+			bg_data = op->data.background.data;
+			bg_data.x += x;
+			bg_data.y += y;
+			/* We just continue if redraw fails */
+			content_redraw(op->data.background.content,
+					&bg_data, &current.clip, ctx);
+			current.set = false;
+			break;
+
+		case HTML_REDRAW_OP_CONTENT:
+			if (!html_redraw_replay_set_clip(&current, ctx))
+				return false;
+			html_redraw_replay_rect(&op->rect, x, y, clip, &r);
+			if (!html_redraw_box_content(html, &op->data.content,
+					x, y, &r, scale, ctx))
+				return false;
+			current.set = false;
+			break;
+
+		case HTML_REDRAW_OP_MARKER:
+			if (!html_redraw_replay(html,
+					&list->item[item->marker],
+					x_children, y_children, clip, scale,
+					ctx))
+				return false;
+			current.set = false;
+			break;
+
+		case HTML_REDRAW_OP_SCROLLBARS:
+			if (!html_redraw_box_scrollbars(html, item,
+					x_parent, y_parent, clip, scale, ctx))
+				return false;
+			current.set = false;
+			break;
+
+		default:
+			if (!html_redraw_replay_shape(op, x, y, &current, ctx))
+				return false;
+			break;
+		}
+	}
+
+	/* restore the clip rectangle, as html_redraw_box() does */
+	if (current.set && (current.clip.x0 != clip->x0 ||
+			current.clip.y0 != clip->y0 ||
+			current.clip.x1 != clip->x1 ||
+			current.clip.y1 != clip->y1))
+		if (ctx->plot->clip(ctx, clip) != NSERROR_OK)
+			return false;
+
+	return true;
+}
+
+/**
+ * Record the operations of a redraw list entry and its descendants.
+ *
+ * Each box is drawn relative to its own position, with nothing clipped,
+ * so that its operations stay valid while it only moves.
+ *
+ * \param  html	     html content
+ * \param  index     index of redraw list entry
+ * \param  background  background colour under the entry's box
+ * \param  scale     scale for redraw
+ * \param  ctx	     context recording
+ * \return true if successful, false otherwise
+ */
+
+static bool html_redraw_record(const html_content *html, unsigned int index,
+		colour background, float scale,
+		const struct redraw_context *ctx)
+{
+	const struct html_redraw_list *list = html->redraw_list;
+	const struct html_redraw_item *item = &list->item[index];
+	struct box *box = item->box;
+	struct rect unbounded = {
+		-HTML_REDRAW_UNBOUNDED, -HTML_REDRAW_UNBOUNDED,
+		HTML_REDRAW_UNBOUNDED, HTML_REDRAW_UNBOUNDED
+	};
+	unsigned int i;
+	bool ok;
+
+	if (html_redraw_list_record_item(ctx, index, background)) {
+		ok = html_redraw_box(html, item, -box->x, -box->y, &unbounded,
+				scale, background, ctx);
+		html_redraw_list_record_item_end(ctx);
+		if (!ok)
+			return false;
+	}
+
+	for (i = 0; i != item->child_count + item->float_count; i++) {
+		if (!html_redraw_record(html, list->child[item->children + i],
+				item->child_background, scale, ctx))
+			return false;
+	}
+
+	if (item->marker != 0)
+		return html_redraw_record(html, item->marker,
+				item->child_background, scale, ctx);
+
+	return true;
+}
+
+/**
+ * Make sure the operations of a redraw list are recorded, if they are
+ * to be replayed.
+ *
+ * \param  html	     html content
+ * \param  scale     scale for redraw
+ * \param  background  background colour under the root box
+ * \param  ctx	     current redraw context
+ * \return true if the operations are to be replayed
+ */
+
+static bool html_redraw_recorded(const html_content *html, float scale,
+		colour background, const struct redraw_context *ctx)
+{
+	struct html_redraw_list *list = html->redraw_list;
+	struct redraw_context rec_ctx;
+	nserror res;
+
+	/* Printing draws each box at most once */
+	if (!ctx->interactive || html_redraw_printing)
+		return false;
+
+	if (html_redraw_list_record_start(list, ctx, scale, background,
+			&rec_ctx)) {
+		res = html_redraw_list_record_finish(list,
+				html_redraw_record(html, 0, background, scale,
+						&rec_ctx));
+		if (res != NSERROR_OK)
+			NSLOG(netsurf, INFO, "redraw list not recorded: %s",
+					messages_get_errorcode(res));
+	}
+
+	return list->recorded;
+}
+
 /**
  * Draw a CONTENT_HTML using the current set of plotters (plot).
  *
@@ -1956,6 +2576,13 @@ bool html_redraw(struct content *c, struct content_redraw_data *data,
 	box = html->layout;
 	assert(box);
 
+	/* The redraw list is built on the first redraw after layout, and
+	 * its operations recorded by the first interactive one */
+	if (html_redraw_list_get(html) == NULL) {
+		NSLOG(netsurf, INFO, "failed to build redraw list");
+		return false;
+	}
+
 	/* The select menu needs special treating because, when opened, it
 	 * reaches beyond its layout box.
 	 */
@@ -1979,8 +2606,17 @@ bool html_redraw(struct content *c, struct content_redraw_data *data,
 
 		result &= (ctx->plot->rectangle(ctx, &pstyle_fill_bg, clip) == NSERROR_OK);
 
-		result &= html_redraw_box(html, box, data->x, data->y, clip,
-				data->scale, pstyle_fill_bg.fill_colour, ctx);
+		if (html_redraw_recorded(html, data->scale,
+				pstyle_fill_bg.fill_colour, ctx))
+			result &= html_redraw_replay(html,
+					&html->redraw_list->item[0],
+					data->x, data->y, clip,
+					data->scale, ctx);
+		else
+			result &= html_redraw_box(html,
+					&html->redraw_list->item[0],
+					data->x, data->y, clip, data->scale,
+					pstyle_fill_bg.fill_colour, ctx);
 	}
 
 	if (select) {
@@ -1988,9 +2624,10 @@ bool html_redraw(struct content *c, struct content_redraw_data *data,
 		box = html->visible_select_menu->box;
 		box_coords(box, &menu_x, &menu_y);
 
-		menu_x -= box->border[LEFT].width;
-		menu_y += box->height + box->border[BOTTOM].width +
-				box->padding[BOTTOM] + box->padding[TOP];
+		menu_x -= box->edges->border[LEFT].width;
+		menu_y += box->height + box->edges->border[BOTTOM].width +
+				box->edges->padding[BOTTOM] +
+				box->edges->padding[TOP];
 		result &= form_redraw_select_menu(html->visible_select_menu,
 				data->x + menu_x, data->y + menu_y,
 				data->scale, clip, ctx);
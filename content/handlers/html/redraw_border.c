@@ -449,11 +449,12 @@ html_redraw_borders(struct box *box,
 		    float scale,
 		    const struct redraw_context *ctx)
 {
+	struct box_border *border = box->edges->border;
 	unsigned int sides[] = { LEFT, RIGHT, TOP, BOTTOM };
-	int top = box->border[TOP].width;
-	int right = box->border[RIGHT].width;
-	int bottom = box->border[BOTTOM].width;
-	int left = box->border[LEFT].width;
+	int top = border[TOP].width;
+	int right = border[RIGHT].width;
+	int bottom = border[BOTTOM].width;
+	int left = border[LEFT].width;
 	int x, y;
 	unsigned int i, side;
 	int p[8]; /* Box border vertices */
@@ -495,8 +496,8 @@ html_redraw_borders(struct box *box,
 		colour col = 0;
 		side = sides[i]; /* plot order */
 
-		if (box->border[side].width == 0 ||
-		    nscss_color_is_transparent(box->border[side].c)) {
+		if (border[side].width == 0 ||
+		    nscss_color_is_transparent(border[side].c)) {
 			continue;
 		}
 
@@ -510,16 +511,16 @@ html_redraw_borders(struct box *box,
 			z[4] = p[2];	z[5] = p[3];
 			z[6] = p[0];	z[7] = p[1];
 
-			if (nscss_color_is_transparent(box->border[TOP].c) == false &&
-			    box->border[TOP].style != CSS_BORDER_STYLE_DOUBLE) {
+			if (nscss_color_is_transparent(border[TOP].c) == false &&
+			    border[TOP].style != CSS_BORDER_STYLE_DOUBLE) {
 				/* make border overhang top corner fully,
 				 * if top border is opaque
 				 */
 				z[5] -= top;
 				square_end_1 = true;
 			}
-			if (nscss_color_is_transparent(box->border[BOTTOM].c) == false &&
-			    box->border[BOTTOM].style != CSS_BORDER_STYLE_DOUBLE) {
+			if (nscss_color_is_transparent(border[BOTTOM].c) == false &&
+			    border[BOTTOM].style != CSS_BORDER_STYLE_DOUBLE) {
 				/* make border overhang bottom corner fully,
 				 * if bottom border is opaque
 				 */
@@ -527,13 +528,13 @@ html_redraw_borders(struct box *box,
 				square_end_2 = true;
 			}
 
-			col = nscss_color_to_ns(box->border[side].c);
+			col = nscss_color_to_ns(border[side].c);
 
 			res = html_redraw_border_plot(side,
 						      z,
 						      col,
-						      box->border[side].style,
-						      box->border[side].width * scale,
+						      border[side].style,
+						      border[side].width * scale,
 						      square_end_1 && square_end_2,
 						      clip,
 						      ctx);
@@ -551,16 +552,16 @@ html_redraw_borders(struct box *box,
 			z[4] = p[4];	z[5] = p[5];
 			z[6] = p[6];	z[7] = p[7];
 
-			if (nscss_color_is_transparent(box->border[TOP].c) == false &&
-			    box->border[TOP].style != CSS_BORDER_STYLE_DOUBLE) {
+			if (nscss_color_is_transparent(border[TOP].c) == false &&
+			    border[TOP].style != CSS_BORDER_STYLE_DOUBLE) {
 				/* make border overhang top corner fully,
 				 * if top border is opaque
 				 */
 				z[3] -= top;
 				square_end_1 = true;
 			}
-			if (nscss_color_is_transparent(box->border[BOTTOM].c) == false &&
-			    box->border[BOTTOM].style != CSS_BORDER_STYLE_DOUBLE) {
+			if (nscss_color_is_transparent(border[BOTTOM].c) == false &&
+			    border[BOTTOM].style != CSS_BORDER_STYLE_DOUBLE) {
 				/* make border overhang bottom corner fully,
 				 * if bottom border is opaque
 				 */
@@ -568,13 +569,13 @@ html_redraw_borders(struct box *box,
 				square_end_2 = true;
 			}
 
-			col = nscss_color_to_ns(box->border[side].c);
+			col = nscss_color_to_ns(border[side].c);
 
 			res = html_redraw_border_plot(side,
 						      z,
 						      col,
-						      box->border[side].style,
-						      box->border[side].width * scale,
+						      border[side].style,
+						      border[side].width * scale,
 						      square_end_1 && square_end_2,
 						      clip,
 						      ctx);
@@ -599,16 +600,16 @@ html_redraw_borders(struct box *box,
 			z[4] = p[6];	z[5] = p[1];
 			z[6] = p[4];	z[7] = p[3];
 
-			if (box->border[TOP].style == CSS_BORDER_STYLE_SOLID &&
-			    box->border[TOP].c == box->border[LEFT].c) {
+			if (border[TOP].style == CSS_BORDER_STYLE_SOLID &&
+			    border[TOP].c == border[LEFT].c) {
 				/* don't bother overlapping left corner if
 				 * it's the same colour anyway
 				 */
 				z[2] += left;
 				square_end_1 = true;
 			}
-			if (box->border[TOP].style == CSS_BORDER_STYLE_SOLID &&
-			    box->border[TOP].c == box->border[RIGHT].c) {
+			if (border[TOP].style == CSS_BORDER_STYLE_SOLID &&
+			    border[TOP].c == border[RIGHT].c) {
 				/* don't bother overlapping right corner if
 				 * it's the same colour anyway
 				 */
@@ -616,13 +617,13 @@ html_redraw_borders(struct box *box,
 				square_end_2 = true;
 			}
 
-			col = nscss_color_to_ns(box->border[side].c);
+			col = nscss_color_to_ns(border[side].c);
 
 			res = html_redraw_border_plot(side,
 						      z,
 						      col,
-						      box->border[side].style,
-						      box->border[side].width * scale,
+						      border[side].style,
+						      border[side].width * scale,
 						      square_end_1 && square_end_2,
 						      clip,
 						      ctx);
@@ -647,16 +648,16 @@ html_redraw_borders(struct box *box,
 			z[4] = p[0];	z[5] = p[7];
 			z[6] = p[2];	z[7] = p[5];
 
-			if (box->border[BOTTOM].style == CSS_BORDER_STYLE_SOLID &&
-			    box->border[BOTTOM].c == box->border[LEFT].c) {
+			if (border[BOTTOM].style == CSS_BORDER_STYLE_SOLID &&
+			    border[BOTTOM].c == border[LEFT].c) {
 				/* don't bother overlapping left corner if
 				 * it's the same colour anyway
 				 */
 				z[4] += left;
 				square_end_1 = true;
 			}
-			if (box->border[BOTTOM].style == CSS_BORDER_STYLE_SOLID &&
-			    box->border[BOTTOM].c == box->border[RIGHT].c) {
+			if (border[BOTTOM].style == CSS_BORDER_STYLE_SOLID &&
+			    border[BOTTOM].c == border[RIGHT].c) {
 				/* don't bother overlapping right corner if
 				 * it's the same colour anyway
 				 */
@@ -664,13 +665,13 @@ html_redraw_borders(struct box *box,
 				square_end_2 = true;
 			}
 
-			col = nscss_color_to_ns(box->border[side].c);
+			col = nscss_color_to_ns(border[side].c);
 
 			res = html_redraw_border_plot(side,
 						      z,
 						      col,
-						      box->border[side].style,
-						      box->border[side].width * scale,
+						      border[side].style,
+						      border[side].width * scale,
 						      square_end_1 && square_end_2,
 						      clip,
 						      ctx);
@@ -711,10 +712,11 @@ html_redraw_inline_borders(struct box *box,
 			   bool last,
 			   const struct redraw_context *ctx)
 {
-	int top = box->border[TOP].width;
-	int right = box->border[RIGHT].width;
-	int bottom = box->border[BOTTOM].width;
-	int left = box->border[LEFT].width;
+	struct box_border *border = box->edges->border;
+	int top = border[TOP].width;
+	int right = border[RIGHT].width;
+	int bottom = border[BOTTOM].width;
+	int left = border[LEFT].width;
 	colour col;
 	int p[8]; /* Box border vertices */
 	int z[8]; /* Border vertices */
@@ -751,16 +753,16 @@ html_redraw_inline_borders(struct box *box,
 	square_end_2 = (bottom == 0);
 	if (left != 0 &&
 	    first &&
-	    nscss_color_is_transparent(box->border[LEFT].c) == false) {
-		col = nscss_color_to_ns(box->border[LEFT].c);
+	    nscss_color_is_transparent(border[LEFT].c) == false) {
+		col = nscss_color_to_ns(border[LEFT].c);
 
 		z[0] = p[0];	z[1] = p[7];
 		z[2] = p[2];	z[3] = p[5];
 		z[4] = p[2];	z[5] = p[3];
 		z[6] = p[0];	z[7] = p[1];
 
-		if (nscss_color_is_transparent(box->border[TOP].c) == false &&
-		    box->border[TOP].style != CSS_BORDER_STYLE_DOUBLE) {
+		if (nscss_color_is_transparent(border[TOP].c) == false &&
+		    border[TOP].style != CSS_BORDER_STYLE_DOUBLE) {
 			/* make border overhang top corner fully,
 			 * if top border is opaque
 			 */
@@ -768,8 +770,8 @@ html_redraw_inline_borders(struct box *box,
 			square_end_1 = true;
 		}
 
-		if (nscss_color_is_transparent(box->border[BOTTOM].c) == false &&
-		    box->border[BOTTOM].style != CSS_BORDER_STYLE_DOUBLE) {
+		if (nscss_color_is_transparent(border[BOTTOM].c) == false &&
+		    border[BOTTOM].style != CSS_BORDER_STYLE_DOUBLE) {
 			/* make border overhang bottom corner fully,
 			 * if bottom border is opaque
 			 */
@@ -780,7 +782,7 @@ html_redraw_inline_borders(struct box *box,
 		res = html_redraw_border_plot(LEFT,
 					      z,
 					      col,
-					      box->border[LEFT].style,
+					      border[LEFT].style,
 					      left,
 					      square_end_1 && square_end_2,
 					      clip,
@@ -795,16 +797,16 @@ html_redraw_inline_borders(struct box *box,
 	square_end_2 = (bottom == 0);
 	if (right != 0 &&
 	    last &&
-	    nscss_color_is_transparent(box->border[RIGHT].c) == false) {
-		col = nscss_color_to_ns(box->border[RIGHT].c);
+	    nscss_color_is_transparent(border[RIGHT].c) == false) {
+		col = nscss_color_to_ns(border[RIGHT].c);
 
 		z[0] = p[6];	z[1] = p[1];
 		z[2] = p[4];	z[3] = p[3];
 		z[4] = p[4];	z[5] = p[5];
 		z[6] = p[6];	z[7] = p[7];
 
-		if (nscss_color_is_transparent(box->border[TOP].c) == false &&
-		    box->border[TOP].style != CSS_BORDER_STYLE_DOUBLE) {
+		if (nscss_color_is_transparent(border[TOP].c) == false &&
+		    border[TOP].style != CSS_BORDER_STYLE_DOUBLE) {
 			/* make border overhang top corner fully,
 			 * if top border is opaque
 			 */
@@ -812,8 +814,8 @@ html_redraw_inline_borders(struct box *box,
 			square_end_1 = true;
 		}
 
-		if (nscss_color_is_transparent(box->border[BOTTOM].c) == false &&
-		    box->border[BOTTOM].style != CSS_BORDER_STYLE_DOUBLE) {
+		if (nscss_color_is_transparent(border[BOTTOM].c) == false &&
+		    border[BOTTOM].style != CSS_BORDER_STYLE_DOUBLE) {
 			/* make border overhang bottom corner fully,
 			 * if bottom border is opaque
 			 */
@@ -824,7 +826,7 @@ html_redraw_inline_borders(struct box *box,
 		res = html_redraw_border_plot(RIGHT,
 					      z,
 					      col,
-					      box->border[RIGHT].style,
+					      border[RIGHT].style,
 					      right,
 					      square_end_1 && square_end_2,
 					      clip,
@@ -838,8 +840,8 @@ html_redraw_inline_borders(struct box *box,
 	square_end_1 = (left == 0);
 	square_end_2 = (right == 0);
 	if (top != 0 &&
-	    nscss_color_is_transparent(box->border[TOP].c) == false) {
-		col = nscss_color_to_ns(box->border[TOP].c);
+	    nscss_color_is_transparent(border[TOP].c) == false) {
+		col = nscss_color_to_ns(border[TOP].c);
 
 		z[0] = p[2];	z[1] = p[3];
 		z[2] = p[0];	z[3] = p[1];
@@ -847,8 +849,8 @@ html_redraw_inline_borders(struct box *box,
 		z[6] = p[4];	z[7] = p[3];
 
 		if (first &&
-		    box->border[TOP].style == CSS_BORDER_STYLE_SOLID &&
-		    box->border[TOP].c == box->border[LEFT].c) {
+		    border[TOP].style == CSS_BORDER_STYLE_SOLID &&
+		    border[TOP].c == border[LEFT].c) {
 			/* don't bother overlapping left corner if
 			 * it's the same colour anyway
 			 */
@@ -857,8 +859,8 @@ html_redraw_inline_borders(struct box *box,
 		}
 
 		if (last &&
-		    box->border[TOP].style == CSS_BORDER_STYLE_SOLID &&
-		    box->border[TOP].c == box->border[RIGHT].c) {
+		    border[TOP].style == CSS_BORDER_STYLE_SOLID &&
+		    border[TOP].c == border[RIGHT].c) {
 			/* don't bother overlapping right corner if
 			 * it's the same colour anyway
 			 */
@@ -869,7 +871,7 @@ html_redraw_inline_borders(struct box *box,
 		res = html_redraw_border_plot(TOP,
 					      z,
 					      col,
-					      box->border[TOP].style,
+					      border[TOP].style,
 					      top,
 					      square_end_1 && square_end_2,
 					      clip,
@@ -883,8 +885,8 @@ html_redraw_inline_borders(struct box *box,
 	square_end_1 = (left == 0);
 	square_end_2 = (right == 0);
 	if (bottom != 0 &&
-	    nscss_color_is_transparent(box->border[BOTTOM].c) == false) {
-		col = nscss_color_to_ns(box->border[BOTTOM].c);
+	    nscss_color_is_transparent(border[BOTTOM].c) == false) {
+		col = nscss_color_to_ns(border[BOTTOM].c);
 
 		z[0] = p[4];	z[1] = p[5];
 		z[2] = p[6];	z[3] = p[7];
@@ -892,8 +894,8 @@ html_redraw_inline_borders(struct box *box,
 		z[6] = p[2];	z[7] = p[5];
 
 		if (first &&
-		    box->border[BOTTOM].style == CSS_BORDER_STYLE_SOLID &&
-		    box->border[BOTTOM].c == box->border[LEFT].c) {
+		    border[BOTTOM].style == CSS_BORDER_STYLE_SOLID &&
+		    border[BOTTOM].c == border[LEFT].c) {
 			/* don't bother overlapping left corner if
 			 * it's the same colour anyway
 			 */
@@ -902,8 +904,8 @@ html_redraw_inline_borders(struct box *box,
 		}
 
 		if (last &&
-		    box->border[BOTTOM].style == CSS_BORDER_STYLE_SOLID &&
-		    box->border[BOTTOM].c == box->border[RIGHT].c) {
+		    border[BOTTOM].style == CSS_BORDER_STYLE_SOLID &&
+		    border[BOTTOM].c == border[RIGHT].c) {
 			/* don't bother overlapping right corner if
 			 * it's the same colour anyway
 			 */
@@ -914,7 +916,7 @@ html_redraw_inline_borders(struct box *box,
 		res = html_redraw_border_plot(BOTTOM,
 					      z,
 					      col,
-					      box->border[BOTTOM].style,
+					      border[BOTTOM].style,
 					      bottom,
 					      square_end_1 && square_end_2,
 					      clip,
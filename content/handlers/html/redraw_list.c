@@ -0,0 +1,1135 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Implementation of the HTML redraw list.
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dom/dom.h>
+
+#include "utils/log.h"
+#include "utils/utils.h"
+#include "netsurf/plotters.h"
+#include "desktop/scrollbar.h"
+
+#include "html/box.h"
+#include "html/box_inspect.h"
+#include "html/private.h"
+#include "html/redraw_list.h"
+
+
+/**
+ * Ensure an array of a redraw list has space for more elements
+ *
+ * \param array  array to grow, updated on success
+ * \param alloc  allocated number of elements, updated on success
+ * \param need   number of elements required
+ * \param size   size of an element
+ * \return true on success, false on memory exhaustion
+ */
+static bool html_redraw_list_grow(void **array, unsigned int *alloc,
+		unsigned int need, size_t size)
+{
+	unsigned int alloc_new = *alloc;
+	void *array_new;
+
+	if (need <= *alloc)
+		return true;
+
+	if (alloc_new < 64)
+		alloc_new = 64;
+	while (alloc_new < need)
+		alloc_new *= 2;
+
+	array_new = realloc(*array, alloc_new * size);
+	if (array_new == NULL)
+		return false;
+
+	*array = array_new;
+	*alloc = alloc_new;
+
+	return true;
+}
+
+
+/**
+ * Set the vertical extents of a run of children in the child table
+ *
+ * \param list   redraw list
+ * \param first  index of first child in child table
+ * \param count  number of children
+ */
+static void html_redraw_list_extents(struct html_redraw_list *list,
+		unsigned int first, unsigned int count)
+{
+	struct html_redraw_item *item;
+	unsigned int i;
+	int y;
+
+	/* These use the same descendant boxes as the tests made by redraw
+	 * and box_contains_point, so no child which those would find is
+	 * skipped. */
+	y = INT_MIN;
+	for (i = first; i < first + count; i++) {
+		item = &list->item[list->child[i]];
+		if (y < item->box->y + item->box->descendant_y1 + 1)
+			y = item->box->y + item->box->descendant_y1 + 1;
+		item->y1 = y;
+	}
+
+	y = INT_MAX;
+	for (i = first + count; i-- > first; ) {
+		item = &list->item[list->child[i]];
+		if (item->box->y + item->box->descendant_y0 < y)
+			y = item->box->y + item->box->descendant_y0;
+		item->y0 = y;
+	}
+}
+
+
+/**
+ * State of a redraw list being built
+ */
+struct html_redraw_build {
+	struct html_redraw_list *list; /**< List being built */
+	/** Entries of the list being replaced, or NULL */
+	const struct html_redraw_item *old_item;
+	const unsigned int *old_child; /**< Its child table */
+	bool relaid; /**< Box tree was laid out since it was built */
+};
+
+
+/**
+ * Find a box among a run of children of the list being replaced
+ *
+ * The children are searched from a cursor, which moves past any found,
+ * so children which keep their order are each found at once.
+ *
+ * \param build   state of list being built
+ * \param box     box to find
+ * \param cursor  index in old child table to search from, updated
+ * \param end     end of run in old child table
+ * \return index of the box's old entry, or HTML_REDRAW_NONE
+ */
+static unsigned int html_redraw_list_match(
+		const struct html_redraw_build *build, const struct box *box,
+		unsigned int *cursor, unsigned int end)
+{
+	unsigned int i;
+
+	for (i = *cursor; i < end; i++) {
+		if (build->old_item[build->old_child[i]].box == box) {
+			*cursor = i + 1;
+			return build->old_child[i];
+		}
+	}
+
+	return HTML_REDRAW_NONE;
+}
+
+
+static bool html_redraw_list_add(const struct html_redraw_build *build,
+		struct box *box, unsigned int prev, bool kept,
+		unsigned int *index);
+
+/**
+ * Add the children of a redraw list entry, in the order they are painted
+ *
+ * \param build   state of list being built
+ * \param parent  index of entry to add children of
+ * \param kept    layout of the entry's contents was kept
+ * \return true on success, false on memory exhaustion
+ */
+static bool html_redraw_list_children(const struct html_redraw_build *build,
+		unsigned int parent, bool kept)
+{
+	struct html_redraw_list *list = build->list;
+	struct box *box = list->item[parent].box;
+	unsigned int prev = list->item[parent].prev;
+	unsigned int child_count = 0;
+	unsigned int float_count = 0;
+	unsigned int old_first = 0;
+	unsigned int old_floats = 0;
+	unsigned int old_end = 0;
+	unsigned int cursor;
+	unsigned int first;
+	unsigned int index;
+	unsigned int i;
+	struct box *c;
+
+	if (box->flags & DEFERRED)
+		/* Children haven't been laid out yet */
+		return true;
+
+	for (c = box->children; c; c = c->next)
+		if (c->type != BOX_FLOAT_LEFT && c->type != BOX_FLOAT_RIGHT)
+			child_count++;
+	for (c = box->float_children; c; c = c->next_float)
+		float_count++;
+
+	if (child_count + float_count == 0)
+		return true;
+
+	if (!html_redraw_list_grow((void **) &list->child, &list->child_alloc,
+			list->child_count + child_count + float_count,
+			sizeof(*list->child)))
+		return false;
+
+	first = list->child_count;
+	list->child_count += child_count + float_count;
+	list->item[parent].children = first;
+	list->item[parent].child_count = child_count;
+	list->item[parent].float_count = float_count;
+
+	if (prev != HTML_REDRAW_NONE) {
+		old_first = build->old_item[prev].children;
+		old_floats = old_first + build->old_item[prev].child_count;
+		old_end = old_floats + build->old_item[prev].float_count;
+	}
+
+	i = first;
+	cursor = old_first;
+	for (c = box->children; c; c = c->next) {
+		if (c->type == BOX_FLOAT_LEFT || c->type == BOX_FLOAT_RIGHT)
+			continue;
+		if (!html_redraw_list_add(build, c,
+				html_redraw_list_match(build, c, &cursor,
+						old_floats),
+				kept, &index))
+			return false;
+		list->child[i++] = index;
+	}
+	cursor = old_floats;
+	for (c = box->float_children; c; c = c->next_float) {
+		if (!html_redraw_list_add(build, c,
+				html_redraw_list_match(build, c, &cursor,
+						old_end),
+				kept, &index))
+			return false;
+		list->child[i++] = index;
+	}
+
+	html_redraw_list_extents(list, first, child_count);
+	html_redraw_list_extents(list, first + child_count, float_count);
+
+	return true;
+}
+
+
+/**
+ * Add a box and its descendants to a redraw list
+ *
+ * \param build  state of list being built
+ * \param box    box to add
+ * \param prev   index of the box's entry in the list being replaced, or
+ *               HTML_REDRAW_NONE
+ * \param kept   layout of the parent's contents was kept
+ * \param index  updated to index of the box's entry
+ * \return true on success, false on memory exhaustion
+ */
+static bool html_redraw_list_add(const struct html_redraw_build *build,
+		struct box *box, unsigned int prev, bool kept,
+		unsigned int *index)
+{
+	struct html_redraw_list *list = build->list;
+	struct html_redraw_item *item;
+	dom_html_element_type tag_type;
+	unsigned int i;
+
+	if (!html_redraw_list_grow((void **) &list->item, &list->item_alloc,
+			list->item_count + 1, sizeof(*list->item)))
+		return false;
+
+	i = list->item_count++;
+	item = &list->item[i];
+
+	kept = kept || (box->flags & LAYOUT_KEPT);
+
+	item->box = box;
+	item->children = 0;
+	item->child_count = 0;
+	item->float_count = 0;
+	item->marker = 0;
+	item->y0 = 0;
+	item->y1 = 0;
+	item->op_first = 0;
+	item->op_children = HTML_REDRAW_NONE;
+	item->op_end = 0;
+	item->prev = prev;
+	item->keep = prev != HTML_REDRAW_NONE && (kept || !build->relaid) &&
+			!(box->flags & REDRAW_STALE);
+
+	box->flags &= ~(LAYOUT_KEPT | REDRAW_STALE);
+
+	if (prev != HTML_REDRAW_NONE) {
+		/* The style is the same as when the old entry was made */
+		item->overflow_x = build->old_item[prev].overflow_x;
+		item->overflow_y = build->old_item[prev].overflow_y;
+		item->hidden = build->old_item[prev].hidden;
+		item->decorated = build->old_item[prev].decorated;
+		item->canvas = build->old_item[prev].canvas;
+	} else {
+		item->overflow_x = CSS_OVERFLOW_VISIBLE;
+		item->overflow_y = CSS_OVERFLOW_VISIBLE;
+		item->hidden = false;
+		item->decorated = false;
+		item->canvas = false;
+
+		if (box->style != NULL) {
+			item->overflow_x = css_computed_overflow_x(box->style);
+			item->overflow_y = css_computed_overflow_y(box->style);
+			item->hidden = css_computed_visibility(box->style) ==
+					CSS_VISIBILITY_HIDDEN;
+			item->decorated = box->type != BOX_TEXT &&
+					css_computed_text_decoration(
+							box->style) !=
+					CSS_TEXT_DECORATION_NONE;
+		}
+
+		if (box->node != NULL && dom_html_element_get_tag_type(
+				box->node, &tag_type) == DOM_NO_ERR) {
+			item->canvas = (tag_type ==
+					DOM_HTML_ELEMENT_TYPE_CANVAS);
+		}
+	}
+
+	if (!html_redraw_list_children(build, i, kept))
+		return false;
+
+	if (box_get_list_marker(box) != NULL) {
+		unsigned int old_marker = HTML_REDRAW_NONE;
+		unsigned int marker;
+
+		if (prev != HTML_REDRAW_NONE &&
+				build->old_item[prev].marker != 0)
+			old_marker = build->old_item[prev].marker;
+
+		if (!html_redraw_list_add(build, box_get_list_marker(box),
+				old_marker, kept, &marker))
+			return false;
+		list->item[i].marker = marker;
+	}
+
+	*index = i;
+
+	return true;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+void html_redraw_list_free(html_content *htmlc)
+{
+	struct html_redraw_list *list = htmlc->redraw_list;
+
+	if (list == NULL)
+		return;
+
+	free(list->item);
+	free(list->child);
+	free(list->op);
+	free(list->prev_item);
+	free(list->prev_op);
+	free(list->hit);
+	free(list->hover);
+	free(list);
+
+	htmlc->redraw_list = NULL;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+struct html_redraw_list *html_redraw_list_get(html_content *htmlc)
+{
+	struct html_redraw_list *list = htmlc->redraw_list;
+	struct html_redraw_item *old_item;
+	unsigned int *old_child;
+	struct html_redraw_build build;
+	unsigned int root;
+	bool ok;
+
+	if (list != NULL && list->root != htmlc->layout)
+		html_redraw_list_free(htmlc);
+	else if (list != NULL && !list->stale)
+		return list;
+
+	list = htmlc->redraw_list;
+	if (list == NULL) {
+		list = calloc(1, sizeof(*list));
+		if (list == NULL)
+			return NULL;
+
+		list->root = htmlc->layout;
+		htmlc->redraw_list = list;
+	}
+
+	/* The operations of the entries being replaced are kept until the
+	 * next recording, if they were all recorded */
+	free(list->prev_item);
+	free(list->prev_op);
+	list->prev_item = NULL;
+	list->prev_op = NULL;
+
+	old_item = list->item;
+	old_child = list->child;
+	if (list->recorded) {
+		list->prev_item = old_item;
+		list->prev_op = list->op;
+		list->op = NULL;
+		list->op_alloc = 0;
+	}
+	list->op_count = 0;
+
+	list->item = NULL;
+	list->item_count = 0;
+	list->item_alloc = 0;
+	list->child = NULL;
+	list->child_count = 0;
+	list->child_alloc = 0;
+
+	build.list = list;
+	build.old_item = list->prev_item;
+	build.old_child = old_child;
+	build.relaid = list->relaid;
+
+	ok = html_redraw_list_add(&build, htmlc->layout,
+			list->prev_item != NULL ? 0 : HTML_REDRAW_NONE,
+			false, &root);
+
+	free(old_child);
+	if (list->prev_item == NULL)
+		free(old_item);
+
+	list->relaid = false;
+	list->stale = false;
+	list->recorded = false;
+	list->failed = false;
+
+	if (!ok) {
+		html_redraw_list_free(htmlc);
+		return NULL;
+	}
+
+	NSLOG(netsurf, DEBUG, "redraw list of %u entries for %p",
+			list->item_count, htmlc);
+
+	return list;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+void html_redraw_list_relayout(html_content *htmlc)
+{
+	struct html_redraw_list *list = htmlc->redraw_list;
+
+	if (list == NULL)
+		return;
+
+	if (list->relaid) {
+		/* Which boxes kept their layout both times is not known */
+		html_redraw_list_free(htmlc);
+		return;
+	}
+
+	list->relaid = true;
+	list->stale = true;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+void html_redraw_list_invalidate(html_content *htmlc, struct box *box)
+{
+	/* A box's background may be clipped to its children, or drawn
+	 * by its parent, if it is the root element's first child */
+	box->flags |= REDRAW_STALE;
+	if (box->parent != NULL)
+		box->parent->flags |= REDRAW_STALE;
+	else if (box->children != NULL)
+		box->children->flags |= REDRAW_STALE;
+
+	if (htmlc->redraw_list != NULL)
+		htmlc->redraw_list->stale = true;
+}
+
+
+/**
+ * Add an operation to the redraw list entry being recorded
+ *
+ * \param ctx   context recording
+ * \param type  type of operation
+ * \param rect  rectangle of operation, or NULL if unbounded
+ * \return the operation, or NULL if recording failed
+ */
+static struct html_redraw_op *html_redraw_list_op(
+		const struct redraw_context *ctx,
+		enum html_redraw_op_type type, const struct rect *rect)
+{
+	struct html_redraw_list *list = ctx->priv;
+	struct html_redraw_op *op;
+
+	if (list->error != NSERROR_OK)
+		return NULL;
+
+	if (!html_redraw_list_grow((void **) &list->op, &list->op_alloc,
+			list->op_count + 1, sizeof(*list->op))) {
+		list->error = NSERROR_NOMEM;
+		return NULL;
+	}
+
+	op = &list->op[list->op_count++];
+	op->type = type;
+	op->bounds.x0 = -HTML_REDRAW_UNBOUNDED;
+	op->bounds.y0 = -HTML_REDRAW_UNBOUNDED;
+	op->bounds.x1 = HTML_REDRAW_UNBOUNDED;
+	op->bounds.y1 = HTML_REDRAW_UNBOUNDED;
+	op->rect = (rect != NULL) ? *rect : op->bounds;
+
+	return op;
+}
+
+
+/**
+ * Add a shape plot to the redraw list entry being recorded
+ *
+ * \param ctx     context recording
+ * \param type    type of operation
+ * \param pstyle  plot style
+ * \param bounds  rectangle containing the shape's geometry
+ * \return the operation, or NULL if recording failed
+ */
+static struct html_redraw_op *html_redraw_list_shape(
+		const struct redraw_context *ctx,
+		enum html_redraw_op_type type, const plot_style_t *pstyle,
+		const struct rect *bounds)
+{
+	struct html_redraw_op *op;
+	int width = 1;
+
+	op = html_redraw_list_op(ctx, type, bounds);
+	if (op == NULL)
+		return NULL;
+
+	/* strokes are centred on the geometry */
+	if (pstyle->stroke_type != PLOT_OP_TYPE_NONE)
+		width += plot_style_fixed_to_int(pstyle->stroke_width);
+
+	op->bounds.x0 = bounds->x0 - width;
+	op->bounds.y0 = bounds->y0 - width;
+	op->bounds.x1 = bounds->x1 + width;
+	op->bounds.y1 = bounds->y1 + width;
+	op->data.shape.style = *pstyle;
+
+	return op;
+}
+
+
+static nserror
+html_redraw_list_plot_clip(const struct redraw_context *ctx,
+		const struct rect *clip)
+{
+	struct html_redraw_list *list = ctx->priv;
+
+	html_redraw_list_op(ctx, HTML_REDRAW_OP_CLIP, clip);
+
+	return list->error;
+}
+
+
+static nserror
+html_redraw_list_plot_arc(const struct redraw_context *ctx,
+		const plot_style_t *pstyle,
+		int x, int y, int radius, int angle1, int angle2)
+{
+	struct html_redraw_list *list = ctx->priv;
+	struct html_redraw_op *op;
+	struct rect r = { x - radius, y - radius, x + radius, y + radius };
+
+	op = html_redraw_list_shape(ctx, HTML_REDRAW_OP_ARC, pstyle, &r);
+	if (op != NULL) {
+		op->data.shape.point[0] = x;
+		op->data.shape.point[1] = y;
+		op->data.shape.radius = radius;
+		op->data.shape.angle1 = angle1;
+		op->data.shape.angle2 = angle2;
+	}
+
+	return list->error;
+}
+
+
+static nserror
+html_redraw_list_plot_disc(const struct redraw_context *ctx,
+		const plot_style_t *pstyle,
+		int x, int y, int radius)
+{
+	struct html_redraw_list *list = ctx->priv;
+	struct html_redraw_op *op;
+	struct rect r = { x - radius, y - radius, x + radius, y + radius };
+
+	op = html_redraw_list_shape(ctx, HTML_REDRAW_OP_DISC, pstyle, &r);
+	if (op != NULL) {
+		op->data.shape.point[0] = x;
+		op->data.shape.point[1] = y;
+		op->data.shape.radius = radius;
+	}
+
+	return list->error;
+}
+
+
+static nserror
+html_redraw_list_plot_line(const struct redraw_context *ctx,
+		const plot_style_t *pstyle,
+		const struct rect *line)
+{
+	struct html_redraw_list *list = ctx->priv;
+	struct html_redraw_op *op;
+	struct rect r;
+
+	r.x0 = line->x0 < line->x1 ? line->x0 : line->x1;
+	r.y0 = line->y0 < line->y1 ? line->y0 : line->y1;
+	r.x1 = line->x0 < line->x1 ? line->x1 : line->x0;
+	r.y1 = line->y0 < line->y1 ? line->y1 : line->y0;
+
+	op = html_redraw_list_shape(ctx, HTML_REDRAW_OP_LINE, pstyle, &r);
+	if (op != NULL)
+		op->rect = *line;
+
+	return list->error;
+}
+
+
+static nserror
+html_redraw_list_plot_rectangle(const struct redraw_context *ctx,
+		const plot_style_t *pstyle,
+		const struct rect *rectangle)
+{
+	struct html_redraw_list *list = ctx->priv;
+
+	html_redraw_list_shape(ctx, HTML_REDRAW_OP_RECTANGLE, pstyle,
+			rectangle);
+
+	return list->error;
+}
+
+
+static nserror
+html_redraw_list_plot_polygon(const struct redraw_context *ctx,
+		const plot_style_t *pstyle,
+		const int *p,
+		unsigned int n)
+{
+	struct html_redraw_list *list = ctx->priv;
+	struct html_redraw_op *op;
+	struct rect r;
+	unsigned int i;
+
+	if (n * 2 > NOF_ELEMENTS(op->data.shape.point)) {
+		/* Borders only plot quadrilaterals */
+		if (list->error == NSERROR_OK)
+			list->error = NSERROR_NOT_IMPLEMENTED;
+		return list->error;
+	}
+
+	r.x0 = r.x1 = p[0];
+	r.y0 = r.y1 = p[1];
+	for (i = 1; i < n; i++) {
+		if (p[i * 2] < r.x0) r.x0 = p[i * 2];
+		if (p[i * 2] > r.x1) r.x1 = p[i * 2];
+		if (p[i * 2 + 1] < r.y0) r.y0 = p[i * 2 + 1];
+		if (p[i * 2 + 1] > r.y1) r.y1 = p[i * 2 + 1];
+	}
+
+	op = html_redraw_list_shape(ctx, HTML_REDRAW_OP_POLYGON, pstyle, &r);
+	if (op != NULL) {
+		memcpy(op->data.shape.point, p, n * 2 * sizeof(*p));
+		op->data.shape.n = n;
+	}
+
+	return list->error;
+}
+
+
+static nserror
+html_redraw_list_plot_path(const struct redraw_context *ctx,
+		const plot_style_t *pstyle,
+		const float *p,
+		unsigned int n,
+		const float transform[6])
+{
+	struct html_redraw_list *list = ctx->priv;
+
+	/* Nothing recorded plots paths */
+	if (list->error == NSERROR_OK)
+		list->error = NSERROR_NOT_IMPLEMENTED;
+
+	return list->error;
+}
+
+
+static nserror
+html_redraw_list_plot_bitmap(const struct redraw_context *ctx,
+		struct bitmap *bitmap,
+		int x, int y,
+		int width,
+		int height,
+		colour bg,
+		bitmap_flags_t flags)
+{
+	struct html_redraw_list *list = ctx->priv;
+
+	/* Bitmaps are only plotted by contents, which aren't recorded */
+	if (list->error == NSERROR_OK)
+		list->error = NSERROR_NOT_IMPLEMENTED;
+
+	return list->error;
+}
+
+
+static nserror
+html_redraw_list_plot_text(const struct redraw_context *ctx,
+		const plot_font_style_t *fstyle,
+		int x,
+		int y,
+		const char *text,
+		size_t length)
+{
+	struct html_redraw_list *list = ctx->priv;
+
+	/* Text is only plotted by contents, which aren't recorded */
+	if (list->error == NSERROR_OK)
+		list->error = NSERROR_NOT_IMPLEMENTED;
+
+	return list->error;
+}
+
+
+/** Plotters which record operations in a redraw list */
+static const struct plotter_table html_redraw_list_plotters = {
+	.clip = html_redraw_list_plot_clip,
+	.arc = html_redraw_list_plot_arc,
+	.disc = html_redraw_list_plot_disc,
+	.line = html_redraw_list_plot_line,
+	.rectangle = html_redraw_list_plot_rectangle,
+	.polygon = html_redraw_list_plot_polygon,
+	.path = html_redraw_list_plot_path,
+	.bitmap = html_redraw_list_plot_bitmap,
+	.text = html_redraw_list_plot_text,
+	.group_start = NULL,
+	.group_end = NULL,
+	.flush = NULL,
+	.option_knockout = false,
+};
+
+
+/* exported function documented in html/redraw_list.h */
+bool html_redraw_list_record_start(struct html_redraw_list *list,
+		const struct redraw_context *ctx, float scale,
+		colour background, struct redraw_context *rec_ctx)
+{
+	unsigned int i;
+
+	if (list->failed)
+		return false;
+
+	if (list->scale != scale ||
+			list->background_images != ctx->background_images ||
+			list->debug != html_redraw_debug ||
+			list->background != background) {
+		/* Nothing recorded before is drawn the same */
+		for (i = 0; i != list->item_count; i++)
+			list->item[i].keep = false;
+		list->recorded = false;
+		list->scale = scale;
+		list->background_images = ctx->background_images;
+		list->debug = html_redraw_debug;
+		list->background = background;
+	}
+
+	if (list->recorded)
+		return false;
+
+	list->op_count = 0;
+	list->recording = HTML_REDRAW_NONE;
+	list->error = NSERROR_OK;
+
+	*rec_ctx = *ctx;
+	rec_ctx->plot = &html_redraw_list_plotters;
+	rec_ctx->priv = list;
+
+	return true;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+nserror html_redraw_list_record_finish(struct html_redraw_list *list,
+		bool ok)
+{
+	nserror res = list->error;
+	unsigned int i;
+
+	if (res == NSERROR_OK && !ok)
+		res = NSERROR_INVALID;
+
+	/* The operations of the previous list are no longer needed */
+	for (i = 0; i != list->item_count; i++)
+		list->item[i].keep = false;
+	free(list->prev_item);
+	free(list->prev_op);
+	list->prev_item = NULL;
+	list->prev_op = NULL;
+
+	if (res != NSERROR_OK) {
+		list->op_count = 0;
+		list->failed = true;
+		return res;
+	}
+
+	list->recorded = true;
+
+	NSLOG(netsurf, DEBUG, "recorded %u operations for %u entries",
+			list->op_count, list->item_count);
+
+	return NSERROR_OK;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+bool html_redraw_list_record_item(const struct redraw_context *rec_ctx,
+		unsigned int index, colour background)
+{
+	struct html_redraw_list *list = rec_ctx->priv;
+	struct html_redraw_item *item = &list->item[index];
+	const struct html_redraw_item *prev;
+	unsigned int count;
+
+	if (item->keep &&
+			list->prev_item[item->prev].background == background) {
+		/* Copy the box's operations from the previous list */
+		prev = &list->prev_item[item->prev];
+		count = prev->op_end - prev->op_first;
+
+		if (!html_redraw_list_grow((void **) &list->op,
+				&list->op_alloc, list->op_count + count,
+				sizeof(*list->op))) {
+			list->error = NSERROR_NOMEM;
+			return false;
+		}
+
+		memcpy(&list->op[list->op_count],
+				&list->prev_op[prev->op_first],
+				count * sizeof(*list->op));
+
+		item->op_first = list->op_count;
+		item->op_children = HTML_REDRAW_NONE;
+		if (prev->op_children != HTML_REDRAW_NONE)
+			item->op_children = list->op_count +
+					prev->op_children - prev->op_first;
+		item->op_end = list->op_count + count;
+		item->clip = prev->clip;
+		item->background = background;
+		item->child_background = prev->child_background;
+
+		list->op_count += count;
+
+		return false;
+	}
+
+	item->op_first = list->op_count;
+	item->op_children = HTML_REDRAW_NONE;
+	item->op_end = list->op_count;
+	item->clip.x0 = -HTML_REDRAW_UNBOUNDED;
+	item->clip.y0 = -HTML_REDRAW_UNBOUNDED;
+	item->clip.x1 = HTML_REDRAW_UNBOUNDED;
+	item->clip.y1 = HTML_REDRAW_UNBOUNDED;
+	item->background = background;
+	item->child_background = background;
+
+	list->recording = index;
+
+	return true;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+void html_redraw_list_record_item_end(const struct redraw_context *rec_ctx)
+{
+	struct html_redraw_list *list = rec_ctx->priv;
+
+	list->item[list->recording].op_end = list->op_count;
+	list->recording = HTML_REDRAW_NONE;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+bool html_redraw_list_recording(const struct redraw_context *ctx)
+{
+	return ctx->plot == &html_redraw_list_plotters;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+bool html_redraw_list_record_test(const struct redraw_context *ctx,
+		enum html_redraw_op_type type, const struct rect *r)
+{
+	if (!html_redraw_list_recording(ctx))
+		return true;
+
+	return html_redraw_list_op(ctx, type, r) != NULL;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+bool html_redraw_list_record_background(const struct redraw_context *ctx,
+		struct hlcache_handle *content,
+		const struct content_redraw_data *data)
+{
+	struct html_redraw_op *op;
+
+	op = html_redraw_list_op(ctx, HTML_REDRAW_OP_BACKGROUND, NULL);
+	if (op == NULL)
+		return false;
+
+	op->data.background.content = content;
+	op->data.background.data = *data;
+
+	return true;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+bool html_redraw_list_record_content(const struct redraw_context *ctx,
+		const struct html_redraw_content *content,
+		const struct rect *clip)
+{
+	struct html_redraw_op *op;
+
+	op = html_redraw_list_op(ctx, HTML_REDRAW_OP_CONTENT, clip);
+	if (op == NULL)
+		return false;
+
+	op->data.content = *content;
+
+	return true;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+bool html_redraw_list_record_children(const struct redraw_context *ctx,
+		const struct rect *clip, colour background)
+{
+	struct html_redraw_list *list = ctx->priv;
+	struct html_redraw_item *item = &list->item[list->recording];
+
+	item->op_children = list->op_count;
+	item->clip = *clip;
+	item->child_background = background;
+
+	return list->error == NSERROR_OK;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+bool html_redraw_list_record_marker(const struct redraw_context *ctx,
+		colour background)
+{
+	struct html_redraw_list *list = ctx->priv;
+	struct html_redraw_item *item = &list->item[list->recording];
+
+	item->child_background = background;
+
+	return html_redraw_list_op(ctx, HTML_REDRAW_OP_MARKER, NULL) != NULL;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+bool html_redraw_list_record_scrollbars(const struct redraw_context *ctx)
+{
+	return html_redraw_list_op(ctx, HTML_REDRAW_OP_SCROLLBARS,
+			NULL) != NULL;
+}
+
+
+static bool html_redraw_list_hit_children(const html_content *htmlc,
+		struct html_redraw_list *list,
+		const struct html_redraw_item *item,
+		int x, int y, int box_x, int box_y);
+
+/**
+ * Find the boxes at a point among a run of children in the child table
+ *
+ * \param htmlc  html content
+ * \param list   redraw list
+ * \param first  index of first child in child table
+ * \param count  number of children
+ * \param x      point to find, in global document coordinates
+ * \param y      point to find, in global document coordinates
+ * \param box_x  position of the children's parent less its scroll offset
+ * \param box_y  position of the children's parent less its scroll offset
+ * \return true on success, false on memory exhaustion
+ */
+static bool html_redraw_list_hit_run(const html_content *htmlc,
+		struct html_redraw_list *list,
+		unsigned int first, unsigned int count,
+		int x, int y, int box_x, int box_y)
+{
+	const struct html_redraw_item *child;
+	unsigned int end = first + count;
+	unsigned int last = end;
+	unsigned int mid;
+	bool physically;
+	struct box *box;
+	int child_x, child_y;
+
+	/* find the first child which reaches down to the point */
+	while (first < last) {
+		mid = first + (last - first) / 2;
+		if (list->item[list->child[mid]].y1 <= y - box_y)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+
+	for (; first < end; first++) {
+		child = &list->item[list->child[first]];
+
+		if (y - box_y < child->y0)
+			/* neither it nor any later child reaches up to the
+			 * point */
+			break;
+
+		box = child->box;
+		child_x = box_x + box->x;
+		child_y = box_y + box->y;
+
+		if (!box_contains_point(&htmlc->unit_len_ctx, box,
+				x - child_x, y - child_y, &physically))
+			continue;
+
+		child_x -= scrollbar_get_offset(box_get_scroll_x(box));
+		child_y -= scrollbar_get_offset(box_get_scroll_y(box));
+
+		if (physically) {
+			if (!html_redraw_list_grow((void **) &list->hit,
+					&list->hit_alloc, list->hit_count + 1,
+					sizeof(*list->hit)))
+				return false;
+
+			list->hit[list->hit_count].box = box;
+			list->hit[list->hit_count].x = child_x;
+			list->hit[list->hit_count].y = child_y;
+			list->hit_count++;
+		}
+
+		if (!html_redraw_list_hit_children(htmlc, list, child,
+				x, y, child_x, child_y))
+			return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * Find the boxes at a point among the children of a redraw list entry
+ *
+ * Float children come first, as box_at_point() finds them first.
+ *
+ * \param htmlc  html content
+ * \param list   redraw list
+ * \param item   entry to find children of
+ * \param x      point to find, in global document coordinates
+ * \param y      point to find, in global document coordinates
+ * \param box_x  position of the entry's box less its scroll offset
+ * \param box_y  position of the entry's box less its scroll offset
+ * \return true on success, false on memory exhaustion
+ */
+static bool html_redraw_list_hit_children(const html_content *htmlc,
+		struct html_redraw_list *list,
+		const struct html_redraw_item *item,
+		int x, int y, int box_x, int box_y)
+{
+	if (item->float_count != 0 && !html_redraw_list_hit_run(htmlc, list,
+			item->children + item->child_count, item->float_count,
+			x, y, box_x, box_y))
+		return false;
+
+	if (item->child_count != 0 && !html_redraw_list_hit_run(htmlc, list,
+			item->children, item->child_count,
+			x, y, box_x, box_y))
+		return false;
+
+	return true;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+nserror html_redraw_list_boxes_at_point(html_content *htmlc,
+		int x, int y, int root_x, int root_y,
+		const struct html_redraw_hit **hits, unsigned int *count)
+{
+	struct html_redraw_list *list;
+
+	list = html_redraw_list_get(htmlc);
+	if (list == NULL)
+		return NSERROR_NOMEM;
+
+	list->hit_count = 0;
+	if (!html_redraw_list_hit_children(htmlc, list, &list->item[0],
+			x, y, root_x, root_y))
+		return NSERROR_NOMEM;
+
+	*hits = list->hit;
+	*count = list->hit_count;
+
+	return NSERROR_OK;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+bool html_redraw_list_set_hover(struct html_redraw_list *list,
+		const struct html_redraw_hit *hits, unsigned int count)
+{
+	list->hover_count = 0;
+
+	if (hits == NULL || count == 0)
+		return true;
+
+	if (!html_redraw_list_grow((void **) &list->hover, &list->hover_alloc,
+			count, sizeof(*list->hover)))
+		return false;
+
+	memcpy(list->hover, hits, count * sizeof(*list->hover));
+	list->hover_count = count;
+
+	return true;
+}
+
+
+/* exported function documented in html/redraw_list.h */
+bool html_redraw_list_is_hover(const struct html_redraw_list *list,
+		const struct html_redraw_hit *hits, unsigned int count)
+{
+	return list->hover_count != 0 && list->hover_count == count &&
+			memcmp(list->hover, hits,
+					count * sizeof(*list->hover)) == 0;
+}
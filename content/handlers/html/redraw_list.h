@@ -0,0 +1,456 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Interface to the HTML redraw list.
+ *
+ * The redraw list holds the boxes of a laid out box tree in the order
+ * they are painted, with the style derived state which would otherwise
+ * be computed on every redraw. The children of each entry are ordered so
+ * that those nowhere near a point or clip rectangle can be skipped with
+ * a binary search, which makes it the spatial index for both redraw and
+ * hit testing.
+ *
+ * Each entry also holds the plot operations which draw its box,
+ * recorded by the first interactive redraw and replayed by later ones.
+ * Operations are relative to the box's position, and their clip
+ * rectangles are within the clip of the box's parent, so an entry stays
+ * valid when its box only moves, or when an ancestor scrolls. Replaced
+ * content, form controls, text and scrollbars change without a layout,
+ * so they are recorded as operations which draw them from the live box.
+ */
+
+#ifndef NETSURF_HTML_REDRAW_LIST_H
+#define NETSURF_HTML_REDRAW_LIST_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utils/errors.h"
+#include "netsurf/types.h"
+#include "netsurf/content.h"
+#include "netsurf/plot_style.h"
+
+struct box;
+struct hlcache_handle;
+struct html_content;
+struct redraw_context;
+
+/** No entry or operation */
+#define HTML_REDRAW_NONE UINT_MAX
+
+/** Extent of the clip rectangle operations are recorded with */
+#define HTML_REDRAW_UNBOUNDED (1 << 28)
+
+/**
+ * Entry in the redraw list for one box
+ *
+ * The child table holds the box's normal flow children, followed by its
+ * float children.
+ */
+struct html_redraw_item {
+	struct box *box; /**< Box drawn by this entry */
+	unsigned int children; /**< Index of first child in child table */
+	unsigned int child_count; /**< Number of normal flow children */
+	unsigned int float_count; /**< Number of float children */
+	unsigned int marker; /**< Entry for list marker, or 0 if none */
+
+	/** Highest top of the subtrees of this and later siblings of the
+	 * same kind, relative to the parent */
+	int y0;
+	/** Lowest bottom of the subtrees of this and earlier siblings of
+	 * the same kind, relative to the parent */
+	int y1;
+
+	unsigned int op_first; /**< First recorded operation */
+	/** Operation before which the children are drawn, or
+	 * HTML_REDRAW_NONE if they are not drawn */
+	unsigned int op_children;
+	unsigned int op_end; /**< End of recorded operations */
+	struct rect clip; /**< Clip of children, relative to box */
+	colour background; /**< Background colour under box */
+	/** Background colour under children and list marker */
+	colour child_background;
+
+	/** Entry for the same box in the previous list, or
+	 * HTML_REDRAW_NONE */
+	unsigned int prev;
+	bool keep; /**< Operations of prev can be reused */
+
+	uint8_t overflow_x; /**< Computed overflow-x */
+	uint8_t overflow_y; /**< Computed overflow-y */
+	bool hidden; /**< Box has visibility: hidden */
+	bool decorated; /**< Box has text decoration */
+	bool canvas; /**< Box is for a canvas element */
+};
+
+/**
+ * Replaced content, form control or text of a box
+ *
+ * These are drawn from the live box state, as they change without the
+ * box tree being laid out again.
+ */
+struct html_redraw_content {
+	struct box *box; /**< Box to draw contents of */
+	int width; /**< Scaled width of content edge */
+	int height; /**< Scaled height of content edge */
+	int padding_left; /**< Scaled left padding */
+	int padding_top; /**< Scaled top padding */
+	colour background; /**< Background colour under contents */
+	bool canvas; /**< Box is for a canvas element */
+	plot_font_style_t fstyle; /**< Font style, if box has text */
+};
+
+/**
+ * Type of a recorded operation
+ */
+enum html_redraw_op_type {
+	HTML_REDRAW_OP_CLIP, /**< Clip to rect, within the box's clip */
+	HTML_REDRAW_OP_RECTANGLE, /**< Plot rectangle rect */
+	HTML_REDRAW_OP_LINE, /**< Plot line rect */
+	HTML_REDRAW_OP_POLYGON, /**< Plot polygon */
+	HTML_REDRAW_OP_DISC, /**< Plot disc */
+	HTML_REDRAW_OP_ARC, /**< Plot arc */
+	HTML_REDRAW_OP_BACKGROUND, /**< Redraw background image */
+	HTML_REDRAW_OP_CONTENT, /**< Draw contents from the live box */
+	HTML_REDRAW_OP_MARKER, /**< Draw list marker entry */
+	HTML_REDRAW_OP_SCROLLBARS, /**< Draw scrollbars from the live box */
+	/** End the box if rect is outside the box's clip */
+	HTML_REDRAW_OP_CULL,
+	/** End the box if rect, within the box's clip, is empty */
+	HTML_REDRAW_OP_EMPTY,
+	/** End the box if rect, within the box's clip, has no width or
+	 * height */
+	HTML_REDRAW_OP_ZERO
+};
+
+/**
+ * Recorded operation
+ *
+ * Coordinates are relative to the scaled position of the entry's box.
+ */
+struct html_redraw_op {
+	enum html_redraw_op_type type; /**< Type of operation */
+	struct rect rect; /**< Rectangle of clip, plot or test */
+	struct rect bounds; /**< Area a plot may touch */
+	union {
+		/** Plot of a shape */
+		struct {
+			plot_style_t style; /**< Plot style */
+			int point[8]; /**< Polygon vertices, or centre */
+			unsigned int n; /**< Number of vertices */
+			int radius; /**< Radius of disc or arc */
+			int angle1; /**< Start angle of arc */
+			int angle2; /**< End angle of arc */
+		} shape;
+		/** Redraw of a background image */
+		struct {
+			struct hlcache_handle *content; /**< Image */
+			struct content_redraw_data data; /**< Redraw data */
+		} background;
+		/** Contents drawn from the live box, clipped to rect */
+		struct html_redraw_content content;
+	} data;
+};
+
+/**
+ * Box found at a point
+ */
+struct html_redraw_hit {
+	struct box *box; /**< Box containing the point */
+	int x; /**< Position of box less its scroll offset */
+	int y; /**< Position of box less its scroll offset */
+};
+
+/**
+ * Redraw list of an HTML content
+ */
+struct html_redraw_list {
+	struct box *root; /**< Box tree the list was built for */
+	bool relaid; /**< Box tree was laid out since the list was built */
+	bool stale; /**< List must be built again */
+
+	struct html_redraw_item *item; /**< Entries, root first */
+	unsigned int item_count; /**< Number of entries */
+	unsigned int item_alloc; /**< Allocated size of item */
+
+	unsigned int *child; /**< Child table, entry indices */
+	unsigned int child_count; /**< Number of child table entries */
+	unsigned int child_alloc; /**< Allocated size of child */
+
+	struct html_redraw_op *op; /**< Recorded operations */
+	unsigned int op_count; /**< Number of operations */
+	unsigned int op_alloc; /**< Allocated size of op */
+
+	bool recorded; /**< Operations are recorded for every entry */
+	bool failed; /**< Operations could not be recorded */
+	unsigned int recording; /**< Entry being recorded */
+	nserror error; /**< Error which stopped recording */
+	float scale; /**< Scale of recorded operations */
+	bool background_images; /**< Background images were recorded */
+	bool debug; /**< Debug outlines were recorded */
+	colour background; /**< Background colour under the root box */
+
+	/** Entries of the previous list, while its operations may be
+	 * reused */
+	struct html_redraw_item *prev_item;
+	struct html_redraw_op *prev_op; /**< Operations of previous list */
+
+	struct html_redraw_hit *hit; /**< Result of the last point query */
+	unsigned int hit_count; /**< Number of boxes in hit */
+	unsigned int hit_alloc; /**< Allocated size of hit */
+
+	/** Result of an earlier point query, kept by the caller */
+	struct html_redraw_hit *hover;
+	unsigned int hover_count; /**< Number of boxes in hover, or 0 */
+	unsigned int hover_alloc; /**< Allocated size of hover */
+};
+
+
+/**
+ * Get the redraw list of an HTML content, building it if necessary
+ *
+ * Operations are not recorded; see html_redraw_list_record_start().
+ *
+ * \param htmlc HTML content with a laid out box tree
+ * \return the redraw list, or NULL on memory exhaustion
+ */
+struct html_redraw_list *html_redraw_list_get(struct html_content *htmlc);
+
+
+/**
+ * Discard the redraw list of an HTML content
+ *
+ * Must be called whenever any boxes in the box tree are freed. The list
+ * is rebuilt when it is next needed.
+ *
+ * \param htmlc HTML content
+ */
+void html_redraw_list_free(struct html_content *htmlc);
+
+
+/**
+ * Note that the box tree of an HTML content is about to be laid out
+ *
+ * The list is rebuilt when it is next needed. The operations of boxes
+ * which keep their layout are reused, if only one layout happens
+ * before then.
+ *
+ * \param htmlc HTML content
+ */
+void html_redraw_list_relayout(struct html_content *htmlc);
+
+
+/**
+ * Note that a box is drawn differently, without a layout
+ *
+ * The operations recorded for the box, and for those whose drawing
+ * depends on it, are recorded again when the list is next needed.
+ *
+ * \param htmlc HTML content
+ * \param box   box which changed
+ */
+void html_redraw_list_invalidate(struct html_content *htmlc, struct box *box);
+
+
+/**
+ * Start recording the operations of a redraw list
+ *
+ * Operations are recorded by drawing each entry's box with the returned
+ * context, between html_redraw_list_record_item() and
+ * html_redraw_list_record_item_end(), relative to its position and with
+ * an unbounded clip rectangle.
+ *
+ * \param list        redraw list
+ * \param ctx         context of the redraw the operations are for
+ * \param scale       scale of the redraw
+ * \param background  background colour under the root box
+ * \param rec_ctx     updated to the context to record with
+ * \return true if operations must be recorded, false if those
+ *         recorded already match, or they can't be recorded
+ */
+bool html_redraw_list_record_start(struct html_redraw_list *list,
+		const struct redraw_context *ctx, float scale,
+		colour background, struct redraw_context *rec_ctx);
+
+
+/**
+ * Finish recording the operations of a redraw list
+ *
+ * If recording failed, it is not tried again until the list is next
+ * built.
+ *
+ * \param list  redraw list
+ * \param ok    true if every entry was drawn successfully
+ * \return NSERROR_OK if the operations were recorded, or the error which
+ *         stopped them being recorded
+ */
+nserror html_redraw_list_record_finish(struct html_redraw_list *list,
+		bool ok);
+
+
+/**
+ * Start recording the operations of an entry
+ *
+ * If the entry's operations in the previous list can be reused they are
+ * copied instead, and nothing needs drawing.
+ *
+ * \param rec_ctx     context recording
+ * \param index       index of entry
+ * \param background  background colour under the entry's box
+ * \return true if the entry's box must be drawn, false if reused
+ */
+bool html_redraw_list_record_item(const struct redraw_context *rec_ctx,
+		unsigned int index, colour background);
+
+
+/**
+ * Finish recording the operations of an entry
+ *
+ * \param rec_ctx  context recording
+ */
+void html_redraw_list_record_item_end(const struct redraw_context *rec_ctx);
+
+
+/**
+ * Test whether a redraw context is recording operations
+ *
+ * \param ctx  redraw context
+ * \return true if recording
+ */
+bool html_redraw_list_recording(const struct redraw_context *ctx);
+
+
+/**
+ * Record a test which ends the box being drawn
+ *
+ * \param ctx   redraw context, which need not be recording
+ * \param type  HTML_REDRAW_OP_CULL, HTML_REDRAW_OP_EMPTY or
+ *              HTML_REDRAW_OP_ZERO
+ * \param r     rectangle to test
+ * \return true on success, false if recording failed
+ */
+bool html_redraw_list_record_test(const struct redraw_context *ctx,
+		enum html_redraw_op_type type, const struct rect *r);
+
+
+/**
+ * Record the drawing of a background image
+ *
+ * \param ctx      context recording
+ * \param content  background image
+ * \param data     redraw data for the image
+ * \return true on success, false if recording failed
+ */
+bool html_redraw_list_record_background(const struct redraw_context *ctx,
+		struct hlcache_handle *content,
+		const struct content_redraw_data *data);
+
+
+/**
+ * Record the drawing of the contents of the box being drawn
+ *
+ * \param ctx      context recording
+ * \param content  contents to draw
+ * \param clip     clip rectangle of the contents
+ * \return true on success, false if recording failed
+ */
+bool html_redraw_list_record_content(const struct redraw_context *ctx,
+		const struct html_redraw_content *content,
+		const struct rect *clip);
+
+
+/**
+ * Record the drawing of the children of the box being drawn
+ *
+ * \param ctx         context recording
+ * \param clip        clip rectangle of the children
+ * \param background  background colour under the children
+ * \return true on success, false if recording failed
+ */
+bool html_redraw_list_record_children(const struct redraw_context *ctx,
+		const struct rect *clip, colour background);
+
+
+/**
+ * Record the drawing of the list marker of the box being drawn
+ *
+ * \param ctx         context recording
+ * \param background  background colour under the list marker
+ * \return true on success, false if recording failed
+ */
+bool html_redraw_list_record_marker(const struct redraw_context *ctx,
+		colour background);
+
+
+/**
+ * Record the drawing of the scrollbars of the box being drawn
+ *
+ * \param ctx  context recording
+ * \return true on success, false if recording failed
+ */
+bool html_redraw_list_record_scrollbars(const struct redraw_context *ctx);
+
+
+/**
+ * Find the boxes at a point
+ *
+ * Finds the boxes box_at_point() would return for the root box, in the
+ * same order, without visiting the children of any box whose subtree
+ * does not reach the point vertically.
+ *
+ * \param htmlc   HTML content with a laid out box tree
+ * \param x       point to find, in global document coordinates
+ * \param y       point to find, in global document coordinates
+ * \param root_x  position of the root box
+ * \param root_y  position of the root box
+ * \param hits    updated to the boxes found, valid until the next query
+ * \param count   updated to the number of boxes found
+ * \return NSERROR_OK on success, or NSERROR_NOMEM
+ */
+nserror html_redraw_list_boxes_at_point(struct html_content *htmlc,
+		int x, int y, int root_x, int root_y,
+		const struct html_redraw_hit **hits, unsigned int *count);
+
+
+/**
+ * Record the result of a point query for later comparison
+ *
+ * \param list   redraw list the query was made on
+ * \param hits   boxes found, or NULL to forget any recorded result
+ * \param count  number of boxes found
+ * \return true if recorded, false on memory exhaustion
+ */
+bool html_redraw_list_set_hover(struct html_redraw_list *list,
+		const struct html_redraw_hit *hits, unsigned int count);
+
+
+/**
+ * Test whether a point query found the same boxes as the recorded one
+ *
+ * \param list   redraw list the query was made on
+ * \param hits   boxes found
+ * \param count  number of boxes found
+ * \return true if a result is recorded and matches
+ */
+bool html_redraw_list_is_hover(const struct html_redraw_list *list,
+		const struct html_redraw_hit *hits, unsigned int count);
+
+#endif
@@ -30,6 +30,8 @@
 #include "css/utils.h"
 
 #include "html/box.h"
+#include "html/box_inspect.h"
+#include "html/box_manipulate.h"
 #include "html/table.h"
 
 /* Define to enable verbose table debug */
@@ -257,12 +259,14 @@ table_cell_top_process_row(const css_unit_ctx *unit_len_ctx,
 		while (processed == false) {
 			for (c = row->children; c != NULL; c = c->next) {
 				/* Ignore cells to the left */
-				if (c->start_column + c->columns - 1 <
-				    cell->start_column)
+				if (box_get_start_column(c) +
+				    box_get_columns(c) - 1 <
+				    box_get_start_column(cell))
 					continue;
 				/* Ignore cells to the right */
-				if (c->start_column > cell->start_column +
-				    cell->columns - 1)
+				if (box_get_start_column(c) >
+				    box_get_start_column(cell) +
+				    box_get_columns(cell) - 1)
 					continue;
 
 				/* Flag that we've processed a cell */
@@ -399,7 +403,7 @@ table_used_left_border_for_cell(const css_unit_ctx *unit_len_ctx, struct box *ce
 	a.unit = CSS_UNIT_PX;
 	a_src = BOX_TABLE_CELL;
 
-	if (cell->prev != NULL || cell->start_column != 0) {
+	if (cell->prev != NULL || box_get_start_column(cell) != 0) {
 		/* Cell to the left -- consider its right border */
 		struct box *prev = NULL;
 
@@ -410,9 +414,9 @@ table_used_left_border_for_cell(const css_unit_ctx *unit_len_ctx, struct box *ce
 			for (row = cell->parent; row != NULL; row = row->prev) {
 				for (prev = row->children; prev != NULL;
 				     prev = prev->next) {
-					if (prev->start_column +
-					    prev->columns ==
-					    cell->start_column)
+					if (box_get_start_column(prev) +
+					    box_get_columns(prev) ==
+					    box_get_start_column(cell))
 						break;
 				}
 
@@ -443,7 +447,7 @@ table_used_left_border_for_cell(const css_unit_ctx *unit_len_ctx, struct box *ce
 		struct box *row = cell->parent;
 		struct box *group = row->parent;
 		struct box *table = group->parent;
-		unsigned int rows = cell->rows;
+		unsigned int rows = box_get_rows(cell);
 
 		while (rows-- > 0 && row != NULL) {
 			/* Spanned rows -- consider their left border */
@@ -501,9 +505,9 @@ table_used_left_border_for_cell(const css_unit_ctx *unit_len_ctx, struct box *ce
 	}
 
 	/* a now contains the used left border for the cell */
-	cell->border[LEFT].style = a.style;
-	cell->border[LEFT].c = a.c;
-	cell->border[LEFT].width = FIXTOINT(css_unit_len2device_px(
+	cell->edges->border[LEFT].style = a.style;
+	cell->edges->border[LEFT].c = a.c;
+	cell->edges->border[LEFT].width = FIXTOINT(css_unit_len2device_px(
 			cell->style, unit_len_ctx, a.width, a.unit));
 }
 
@@ -602,9 +606,9 @@ table_used_top_border_for_cell(const css_unit_ctx *unit_len_ctx, struct box *cel
 	}
 
 	/* a now contains the used top border for the cell */
-	cell->border[TOP].style = a.style;
-	cell->border[TOP].c = a.c;
-	cell->border[TOP].width = FIXTOINT(css_unit_len2device_px(
+	cell->edges->border[TOP].style = a.style;
+	cell->edges->border[TOP].c = a.c;
+	cell->edges->border[TOP].width = FIXTOINT(css_unit_len2device_px(
 			cell->style, unit_len_ctx, a.width, a.unit));
 }
 
@@ -631,8 +635,9 @@ table_used_right_border_for_cell(const css_unit_ctx *unit_len_ctx, struct box *c
 	a.unit = CSS_UNIT_PX;
 	a_src = BOX_TABLE_CELL;
 
-	if (cell->next != NULL || cell->start_column + cell->columns !=
-	    cell->parent->parent->parent->columns) {
+	if (cell->next != NULL ||
+	    box_get_start_column(cell) + box_get_columns(cell) !=
+	    box_get_columns(cell->parent->parent->parent)) {
 		/* Cell is not at right edge of table -- no right border */
 		a.style = CSS_BORDER_STYLE_NONE;
 		a.width = 0;
@@ -642,7 +647,7 @@ table_used_right_border_for_cell(const css_unit_ctx *unit_len_ctx, struct box *c
 		struct box *row = cell->parent;
 		struct box *group = row->parent;
 		struct box *table = group->parent;
-		unsigned int rows = cell->rows;
+		unsigned int rows = box_get_rows(cell);
 
 		while (rows-- > 0 && row != NULL) {
 			/* Spanned rows -- consider their right border */
@@ -705,9 +710,9 @@ table_used_right_border_for_cell(const css_unit_ctx *unit_len_ctx, struct box *c
 	}
 
 	/* a now contains the used right border for the cell */
-	cell->border[RIGHT].style = a.style;
-	cell->border[RIGHT].c = a.c;
-	cell->border[RIGHT].width = FIXTOINT(css_unit_len2device_px(
+	cell->edges->border[RIGHT].style = a.style;
+	cell->edges->border[RIGHT].c = a.c;
+	cell->edges->border[RIGHT].width = FIXTOINT(css_unit_len2device_px(
 			cell->style, unit_len_ctx, a.width, a.unit));
 }
 
@@ -725,7 +730,7 @@ table_used_bottom_border_for_cell(const css_unit_ctx *unit_len_ctx,
 	struct border a, b;
 	box_type a_src, b_src;
 	struct box *row = cell->parent;
-	unsigned int rows = cell->rows;
+	unsigned int rows = box_get_rows(cell);
 
 	/* Initialise to computed bottom border for cell */
 	a.style = css_computed_border_bottom_style(cell->style);
@@ -800,35 +805,80 @@ table_used_bottom_border_for_cell(const css_unit_ctx *unit_len_ctx,
 	}
 
 	/* a now contains the used bottom border for the cell */
-	cell->border[BOTTOM].style = a.style;
-	cell->border[BOTTOM].c = a.c;
-	cell->border[BOTTOM].width = FIXTOINT(css_unit_len2device_px(
+	cell->edges->border[BOTTOM].style = a.style;
+	cell->edges->border[BOTTOM].c = a.c;
+	cell->edges->border[BOTTOM].width = FIXTOINT(css_unit_len2device_px(
 			cell->style, unit_len_ctx, a.width, a.unit));
 }
 
 
+/**
+ * Find the first row of a table, as the fixed table layout sees it
+ *
+ * Header rows are displayed first wherever the header row group is in
+ * the document, so the first row of the first non-empty header group is
+ * preferred. Otherwise it is the first row of the first non-empty group.
+ *
+ * \param table box of type BOX_TABLE
+ * \return the first row, or NULL if the table has no rows
+ */
+static struct box *table_first_row(const struct box *table)
+{
+	struct box *row_group;
+
+	for (row_group = table->children; row_group;
+			row_group = row_group->next) {
+		if (row_group->children != NULL &&
+		    row_group->style != NULL &&
+		    ns_computed_display_static(row_group->style) ==
+				CSS_DISPLAY_TABLE_HEADER_GROUP)
+			return row_group->children;
+	}
+
+	for (row_group = table->children; row_group;
+			row_group = row_group->next) {
+		if (row_group->children != NULL)
+			return row_group->children;
+	}
+
+	return NULL;
+}
+
+
 /* exported interface documented in html/table.h */
 bool
-table_calculate_column_types(const css_unit_ctx *unit_len_ctx, struct box *table)
+table_calculate_column_types(const css_unit_ctx *unit_len_ctx,
+			     struct box *table,
+			     struct box_arena *arena)
 {
 	unsigned int i, j;
 	struct column *col;
 	struct box *row_group, *row, *cell;
+	struct box *first_row = NULL;
+	bool fixed = table_is_fixed_layout(table);
 
-	if (table->col)
-		/* table->col already constructed, for example frameset table */
+	if (box_get_col(table))
+		/* table->ext->col already constructed, for example frameset table */
 		return true;
 
-	table->col = col = talloc_array(table, struct column, table->columns);
+	if (box_ensure_ext(table, arena) == NULL)
+		return false;
+
+	table->ext->col = col = talloc_array(arena, struct column,
+			box_get_columns(table));
 	if (!col)
 		return false;
 
-	for (i = 0; i != table->columns; i++) {
+	for (i = 0; i != box_get_columns(table); i++) {
 		col[i].type = COLUMN_WIDTH_UNKNOWN;
 		col[i].width = 0;
-		col[i].positioned = true;
+		/* with fixed layout, cells after the first row are ignored */
+		col[i].positioned = !fixed;
 	}
 
+	if (fixed)
+		first_row = table_first_row(table);
+
 	/* 1st pass: cells with colspan 1 only */
 	for (row_group = table->children; row_group; row_group =row_group->next)
 		for (row = row_group->children; row; row = row->next)
@@ -840,9 +890,11 @@ table_calculate_column_types(const css_unit_ctx *unit_len_ctx, struct box *table
 				assert(cell->type == BOX_TABLE_CELL);
 				assert(cell->style);
 
-				if (cell->columns != 1)
+				if (box_get_columns(cell) != 1)
+					continue;
+				if (fixed && row != first_row)
 					continue;
-				i = cell->start_column;
+				i = box_get_start_column(cell);
 
 				if (css_computed_position(cell->style) !=
 				    CSS_POSITION_ABSOLUTE &&
@@ -892,16 +944,19 @@ table_calculate_column_types(const css_unit_ctx *unit_len_ctx, struct box *table
 				css_fixed value = 0;
 				css_unit unit = CSS_UNIT_PX;
 
-				if (cell->columns == 1)
+				if (box_get_columns(cell) == 1)
+					continue;
+				if (fixed && row != first_row)
 					continue;
-				i = cell->start_column;
+				i = box_get_start_column(cell);
 
-				for (j = i; j < i + cell->columns; j++) {
+				for (j = i; j < i + box_get_columns(cell);
+						j++) {
 					col[j].positioned = false;
 				}
 
 				/* count column types in spanned cells */
-				for (j = 0; j != cell->columns; j++) {
+				for (j = 0; j != box_get_columns(cell); j++) {
 					if (col[i + j].type == COLUMN_WIDTH_FIXED) {
 						fixed_width += col[i + j].width;
 						fixed_columns++;
@@ -924,7 +979,7 @@ table_calculate_column_types(const css_unit_ctx *unit_len_ctx, struct box *table
 				 * or unknown width, split extra width among unknown columns */
 				if (type == CSS_WIDTH_SET && unit != CSS_UNIT_PCT &&
 				    fixed_columns + unknown_columns ==
-				    cell->columns) {
+				    box_get_columns(cell)) {
 					int width = (FIXTOFLT(css_unit_len2device_px(
 							cell->style,
 							unit_len_ctx,
@@ -932,7 +987,8 @@ table_calculate_column_types(const css_unit_ctx *unit_len_ctx, struct box *table
 						fixed_width) / unknown_columns;
 					if (width < 0)
 						width = 0;
-					for (j = 0; j != cell->columns; j++) {
+					for (j = 0; j != box_get_columns(cell);
+							j++) {
 						if (col[i + j].type == COLUMN_WIDTH_UNKNOWN) {
 							col[i + j].type = COLUMN_WIDTH_FIXED;
 							col[i + j].width = width;
@@ -943,12 +999,13 @@ table_calculate_column_types(const css_unit_ctx *unit_len_ctx, struct box *table
 				/* as above for percentage width */
 				if (type == CSS_WIDTH_SET && unit == CSS_UNIT_PCT &&
 				    percent_columns + unknown_columns ==
-				    cell->columns) {
+				    box_get_columns(cell)) {
 					int width = (FIXTOFLT(value) -
 						     percent_width) / unknown_columns;
 					if (width < 0)
 						width = 0;
-					for (j = 0; j != cell->columns; j++) {
+					for (j = 0; j != box_get_columns(cell);
+							j++) {
 						if (col[i + j].type == COLUMN_WIDTH_UNKNOWN) {
 							col[i + j].type = COLUMN_WIDTH_PERCENT;
 							col[i + j].width = width;
@@ -958,13 +1015,13 @@ table_calculate_column_types(const css_unit_ctx *unit_len_ctx, struct box *table
 			}
 
 	/* use AUTO if no width type was specified */
-	for (i = 0; i != table->columns; i++) {
+	for (i = 0; i != box_get_columns(table); i++) {
 		if (col[i].type == COLUMN_WIDTH_UNKNOWN)
 			col[i].type = COLUMN_WIDTH_AUTO;
 	}
 
 #ifdef TABLE_DEBUG
-	for (i = 0; i != table->columns; i++)
+	for (i = 0; i != box_get_columns(table); i++)
 		NSLOG(netsurf, INFO,
 		      "table %p, column %u: type %s, width %i",
 		      table,
@@ -983,6 +1040,25 @@ table_calculate_column_types(const css_unit_ctx *unit_len_ctx, struct box *table
 }
 
 
+/* exported interface documented in html/table.h */
+bool table_is_fixed_layout(const struct box *table)
+{
+	css_fixed value = 0;
+	css_unit unit = CSS_UNIT_PX;
+
+	assert(table->type == BOX_TABLE);
+
+	/* An auto width table uses the automatic algorithm (CSS 2.1 17.5.2),
+	 * as does one with no first row to take column widths from */
+	return table->style != NULL &&
+			css_computed_table_layout(table->style) ==
+				CSS_TABLE_LAYOUT_FIXED &&
+			css_computed_width(table->style, &value, &unit) ==
+				CSS_WIDTH_SET &&
+			table_first_row(table) != NULL;
+}
+
+
 /* exported interface documented in html/table.h */
 void table_used_border_for_cell(const css_unit_ctx *unit_len_ctx, struct box *cell)
 {
@@ -996,45 +1072,45 @@ void table_used_border_for_cell(const css_unit_ctx *unit_len_ctx, struct box *ce
 		css_unit unit = CSS_UNIT_PX;
 
 		/* Left border */
-		cell->border[LEFT].style =
+		cell->edges->border[LEFT].style =
 			css_computed_border_left_style(cell->style);
 		css_computed_border_left_color(cell->style,
-					       &cell->border[LEFT].c);
+					       &cell->edges->border[LEFT].c);
 		css_computed_border_left_width(cell->style, &width, &unit);
-		cell->border[LEFT].width =
+		cell->edges->border[LEFT].width =
 			FIXTOINT(css_unit_len2device_px(
 					cell->style, unit_len_ctx,
 					width, unit));
 
 		/* Top border */
-		cell->border[TOP].style =
+		cell->edges->border[TOP].style =
 			css_computed_border_top_style(cell->style);
 		css_computed_border_top_color(cell->style,
-					      &cell->border[TOP].c);
+					      &cell->edges->border[TOP].c);
 		css_computed_border_top_width(cell->style, &width, &unit);
-		cell->border[TOP].width =
+		cell->edges->border[TOP].width =
 			FIXTOINT(css_unit_len2device_px(
 					cell->style, unit_len_ctx,
 					width, unit));
 
 		/* Right border */
-		cell->border[RIGHT].style =
+		cell->edges->border[RIGHT].style =
 			css_computed_border_right_style(cell->style);
 		css_computed_border_right_color(cell->style,
-						&cell->border[RIGHT].c);
+						&cell->edges->border[RIGHT].c);
 		css_computed_border_right_width(cell->style, &width, &unit);
-		cell->border[RIGHT].width =
+		cell->edges->border[RIGHT].width =
 			FIXTOINT(css_unit_len2device_px(
 					cell->style, unit_len_ctx,
 					width, unit));
 
 		/* Bottom border */
-		cell->border[BOTTOM].style =
+		cell->edges->border[BOTTOM].style =
 			css_computed_border_bottom_style(cell->style);
 		css_computed_border_bottom_color(cell->style,
-						 &cell->border[BOTTOM].c);
+				&cell->edges->border[BOTTOM].c);
 		css_computed_border_bottom_width(cell->style, &width, &unit);
-		cell->border[BOTTOM].width =
+		cell->edges->border[BOTTOM].width =
 			FIXTOINT(css_unit_len2device_px(
 					cell->style, unit_len_ctx,
 					width, unit));
@@ -1055,9 +1131,10 @@ void table_used_border_for_cell(const css_unit_ctx *unit_len_ctx, struct box *ce
 	/* Finally, ensure that any borders configured as
 	 * hidden or none have zero width. (c.f. layout_find_dimensions) */
 	for (side = 0; side != 4; side++) {
-		if (cell->border[side].style == CSS_BORDER_STYLE_HIDDEN ||
-		    cell->border[side].style ==
+		if (cell->edges->border[side].style ==
+		    CSS_BORDER_STYLE_HIDDEN ||
+		    cell->edges->border[side].style ==
 		    CSS_BORDER_STYLE_NONE)
-			cell->border[side].width = 0;
+			cell->edges->border[side].width = 0;
 	}
 }
@@ -28,6 +28,7 @@
 #include <stdbool.h>
 
 struct box;
+struct box_arena;
 
 
 /**
@@ -35,12 +36,27 @@ struct box;
  *
  * \param unit_len_ctx Length conversion context
  * \param table box of type BOX_TABLE
+ * \param arena box arena to allocate the column array from
  * \return true on success, false on memory exhaustion
  *
- * The table->col array is allocated and type and width are filled in for each
- * column.
+ * The table->ext->col array is allocated and type and width are filled in for each
+ * column.  Only the first row is considered for tables using the fixed
+ * table layout algorithm.
  */
-bool table_calculate_column_types(const css_unit_ctx *unit_len_ctx,	struct box *table);
+bool table_calculate_column_types(const css_unit_ctx *unit_len_ctx,	struct box *table, struct box_arena *arena);
+
+
+/**
+ * Determine whether a table uses the fixed table layout algorithm.
+ *
+ * With the fixed algorithm, column widths depend only on the table width
+ * and the cells of the first row, not on the content of any cell.
+ *
+ * \param table box of type BOX_TABLE
+ * \return true if the table has table-layout: fixed, a specified width and
+ *         at least one row
+ */
+bool table_is_fixed_layout(const struct box *table);
 
 
 /**
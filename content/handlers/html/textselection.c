@@ -124,17 +124,17 @@ coords_from_range(struct box *box,
 
 	/* If selection starts inside marker */
 	if (box->parent &&
-	    box->parent->list_marker == box &&
+	    box_get_list_marker(box->parent) == box &&
 	    !do_marker) {
 		/* set box to main list element */
 		box = box->parent;
 	}
 
 	/* If box has a list marker */
-	if (box->list_marker) {
+	if (box_get_list_marker(box)) {
 		/* do the marker box before continuing with the rest of the
 		 * list element */
-		res = coords_from_range(box->list_marker,
+		res = coords_from_range(box_get_list_marker(box),
 					start_idx,
 					end_idx,
 					rdwi,
@@ -169,8 +169,10 @@ coords_from_range(struct box *box,
 			 */
 			box_coords(box, &x, &y);
 
-			width = box->padding[LEFT] + box->width + box->padding[RIGHT];
-			height = box->padding[TOP] + box->height + box->padding[BOTTOM];
+			width = box->edges->padding[LEFT] + box->width +
+				box->edges->padding[RIGHT];
+			height = box->edges->padding[TOP] + box->height +
+				box->edges->padding[BOTTOM];
 
 			if ((box->type == BOX_TEXT) &&
 			    (box->space != 0)) {
@@ -329,17 +331,17 @@ selection_copy(struct box *box,
 
 	/* If selection starts inside marker */
 	if (box->parent &&
-	    box->parent->list_marker == box &&
+	    box_get_list_marker(box->parent) == box &&
 	    !do_marker) {
 		/* set box to main list element */
 		box = box->parent;
 	}
 
 	/* If box has a list marker */
-	if (box->list_marker) {
+	if (box_get_list_marker(box)) {
 		/* do the marker box before continuing with the rest of the
 		 * list element */
-		res = selection_copy(box->list_marker,
+		res = selection_copy(box_get_list_marker(box),
 				     unit_len_ctx,
 				     start_idx,
 				     end_idx,
@@ -457,8 +459,9 @@ static unsigned selection_label_subtree(struct box *box, unsigned idx)
 	}
 
 	while (child) {
-		if (child->list_marker) {
-			idx = selection_label_subtree(child->list_marker, idx);
+		if (box_get_list_marker(child)) {
+			idx = selection_label_subtree(
+					box_get_list_marker(child), idx);
 		}
 
 		idx = selection_label_subtree(child, idx);
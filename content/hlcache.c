@@ -24,10 +24,12 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <nsutils/time.h>
 
 #include "utils/http.h"
 #include "utils/log.h"
 #include "utils/messages.h"
+#include "utils/nsoption.h"
 #include "utils/ring.h"
 #include "utils/utils.h"
 #include "netsurf/misc.h"
@@ -75,6 +77,9 @@ struct hlcache_entry {
 
 	hlcache_entry *next;		/**< Next sibling */
 	hlcache_entry *prev;		/**< Previous sibling */
+
+	uint64_t unused_since;		/**< When the content lost its last
+					 * user, in ms, or 0 if in use */
 };
 
 /** Current state of the cache.
@@ -104,6 +109,34 @@ static struct hlcache_s *hlcache = NULL;
  ******************************************************************************/
 
 
+/**
+ * Determine whether an unused content should stay in the cache
+ *
+ * Parsing a large stylesheet costs far more than keeping it, and the
+ * next page from the same site usually links the same sheets, so
+ * stylesheets may be kept for a while after their last user goes.
+ *
+ * \param entry  Entry with no users
+ * \param now    Current time, in ms
+ * \return true to keep the entry, false to destroy it
+ */
+static bool hlcache_entry_retained(hlcache_entry *entry, uint64_t now)
+{
+	uint64_t retain = nsoption_uint(stylesheet_retain_time) * 1000;
+
+	if (retain == 0 ||
+	    content__get_status(entry->content) != CONTENT_STATUS_DONE ||
+	    entry->content->handler->type() != CONTENT_CSS)
+		return false;
+
+	if (entry->unused_since == 0) {
+		entry->unused_since = now;
+		return true;
+	}
+
+	return now - entry->unused_since < retain;
+}
+
 /**
  * Attempt to clean the cache
  */
@@ -111,6 +144,9 @@ static void hlcache_clean(void *force_clean_flag)
 {
 	hlcache_entry *entry, *next;
 	bool force_clean = (force_clean_flag != NULL);
+	uint64_t now;
+
+	nsu_getmonotonic_ms(&now);
 
 	for (entry = hlcache->content_list; entry != NULL; entry = next) {
 		next = entry->next;
@@ -118,7 +154,13 @@ static void hlcache_clean(void *force_clean_flag)
 		if (entry->content == NULL)
 			continue;
 
-		if (content_count_users(entry->content) != 0)
+		if (content_count_users(entry->content) != 0) {
+			entry->unused_since = 0;
+			continue;
+		}
+
+		if (force_clean == false &&
+				hlcache_entry_retained(entry, now))
 			continue;
 
 		if (content__get_status(entry->content) == CONTENT_STATUS_LOADING) {
@@ -264,6 +306,8 @@ static nserror hlcache_find_content(hlcache_retrieval_ctx *ctx,
 		if (entry == NULL)
 			return NSERROR_NOMEM;
 
+		entry->unused_since = 0;
+
 		/* Create content using llhandle */
 		entry->content = content_factory_create_content(ctx->llcache,
 				ctx->child.charset, ctx->child.quirks,
@@ -306,6 +306,18 @@ nserror browser_window_get_dimensions(struct browser_window *bw,
 		int *width, int *height);
 
 
+/**
+ * Get the scroll offset of a browser window's content.
+ *
+ * \param bw	  browser window
+ * \param sx	  updated to x offset in unscaled content px
+ * \param sy	  updated to y offset in unscaled content px
+ * \return NSERROR_OK, or appropriate error otherwise.
+ */
+nserror browser_window_get_scroll(struct browser_window *bw,
+		int *sx, int *sy);
+
+
 /**
  * Update the extent of the inside of a browser window to that of the current
  * content
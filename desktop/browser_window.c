@@ -1551,6 +1551,10 @@ browser_window_callback(hlcache_handle *c, const hlcache_event *event, void *pw)
 		if (!(event->data.background)) {
 			/* Reformatted content should be redrawn */
 			browser_window_update(bw, false);
+		} else {
+			/* The content requests redraws of anything which
+			 * moved, but its size may have changed */
+			browser_window_update_extent(bw);
 		}
 		break;
 
@@ -4029,6 +4033,30 @@ browser_window_get_dimensions(struct browser_window *bw,
 }
 
 
+/* Exported interface, documented in browser_private.h */
+nserror
+browser_window_get_scroll(struct browser_window *bw, int *sx, int *sy)
+{
+	assert(bw);
+
+	if (bw->window == NULL) {
+		/* Core managed browser window */
+		*sx = scrollbar_get_offset(bw->scroll_x);
+		*sy = scrollbar_get_offset(bw->scroll_y);
+		return NSERROR_OK;
+	}
+
+	/* Front end window */
+	if (!guit->window->get_scroll(bw->window, sx, sy))
+		return NSERROR_INVALID;
+
+	*sx /= bw->scale;
+	*sy /= bw->scale;
+
+	return NSERROR_OK;
+}
+
+
 /* Exported interface, documented in netsurf/browser_window.h */
 void
 browser_window_set_dimensions(struct browser_window *bw, int width, int height)
@@ -254,7 +254,7 @@ nserror browser_window_create_iframes(struct browser_window *bw)
 		/* linking */
 		window->box = cur->box;
 		window->parent = bw;
-		window->box->iframe = window;
+		window->box->ext->iframe = window;
 
 		/* iframe dimensions */
 		box_bounds(window->box, &rect);
@@ -287,6 +287,28 @@ nserror browser_window_create_iframes(struct browser_window *bw)
 }
 
 
+/* exported function documented in desktop/frames.h */
+void browser_window_relink_iframes(struct browser_window *bw)
+{
+	struct browser_window *window;
+	struct content_html_iframe *cur;
+	int index = 0;
+
+	if (content_get_type(bw->current_content) != CONTENT_HTML) {
+		return;
+	}
+
+	for (cur = html_get_iframe(bw->current_content);
+			cur != NULL && index < bw->iframe_count;
+			cur = cur->next) {
+		window = &(bw->iframes[index++]);
+
+		window->box = cur->box;
+		window->box->ext->iframe = window;
+	}
+}
+
+
 /* exported function documented in desktop/frames.h */
 void browser_window_recalculate_iframes(struct browser_window *bw)
 {
@@ -311,7 +333,8 @@ nserror browser_window_destroy_iframes(struct browser_window *bw)
 	if (bw->iframes != NULL) {
 		for (i = 0; i < bw->iframe_count; i++) {
 			if (bw->iframes[i].box != NULL) {
-				bw->iframes[i].box->iframe = NULL;
+				if (bw->iframes[i].box->ext != NULL)
+					bw->iframes[i].box->ext->iframe = NULL;
 				bw->iframes[i].box = NULL;
 			}
 			browser_window_destroy_internal(&bw->iframes[i]);
@@ -36,6 +36,16 @@ struct content_html_frames;
  */
 nserror browser_window_create_iframes(struct browser_window *bw);
 
+/**
+ * Reattach iframes to the boxes of a rebuilt box tree.
+ *
+ * The content must have the same iframes, in the same order, as when
+ * they were created by browser_window_create_iframes().
+ *
+ * \param bw The browser window to reattach iframes for.
+ */
+void browser_window_relink_iframes(struct browser_window *bw);
+
 /**
  * Recalculate iframe positions following a resize.
  *
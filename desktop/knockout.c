@@ -64,6 +64,7 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -80,9 +81,24 @@
 /* Define to enable knockout debug */
 #undef KNOCKOUT_DEBUG
 
-#define KNOCKOUT_ENTRIES 3072	/* 40 bytes each */
-#define KNOCKOUT_BOXES 768	/* 28 bytes each */
-#define KNOCKOUT_POLYGONS 3072	/* 4 bytes each */
+/* Initial buffer sizes, the buffers are grown as needed during a redraw */
+#define KNOCKOUT_ENTRIES 3072
+#define KNOCKOUT_BOXES 768	/* boxes per block */
+#define KNOCKOUT_POLYGONS 3072
+
+/* Limit on how far the buffers grow before being flushed early */
+#define KNOCKOUT_GROWTH_LIMIT 64
+
+/* Limit on the number of boxes a top level box is split into. Once reached
+ * the box stops being knocked out, which bounds the cost of each knockout */
+#define KNOCKOUT_PIECES 64
+
+/* Top level boxes are indexed by grids of square cells, one grid for each
+ * size of box, held in a hash table which grows with the number of boxes.
+ * The smallest cells are 1 << KNOCKOUT_GRID_SHIFT pixels square. */
+#define KNOCKOUT_GRID_SHIFT 5
+#define KNOCKOUT_GRID_LEVELS 10
+#define KNOCKOUT_GRID_BITS 10	/* initial hash table size, as a power of 2 */
 
 struct knockout_box;
 struct knockout_entry;
@@ -103,8 +119,11 @@ typedef enum {
 
 
 struct knockout_box {
-	struct rect bbox;
+	struct rect bbox;		/* area, or bounds of children if split */
 	bool deleted;			/* box has been deleted, ignore */
+	bool frozen;			/* top level box no longer knocked out */
+	int pieces;			/* top level box: boxes it is split into */
+	unsigned int cell;		/* top level box: key of its grid cell */
 	struct knockout_box *child;
 	struct knockout_box *next;
 };
@@ -123,7 +142,7 @@ struct knockout_entry {
 			plot_style_t plot_style;
 		} line;
 		struct {
-			int *p;
+			unsigned int p;	/* offset into knockout_polygons */
 			unsigned int n;
 			plot_style_t plot_style;
 		} polygon;
@@ -169,12 +188,39 @@ struct knockout_entry {
 };
 
 
-static struct knockout_entry knockout_entries[KNOCKOUT_ENTRIES];
-static struct knockout_box knockout_boxes[KNOCKOUT_BOXES];
-static int knockout_polygons[KNOCKOUT_POLYGONS];
+/** Block of knockout boxes, boxes are never moved once allocated */
+struct knockout_box_block {
+	struct knockout_box_block *next;
+	struct knockout_box box[KNOCKOUT_BOXES];
+};
+
+
+/* The buffers start out in static storage and move to the heap if they
+ * need to grow. The heap storage is released at the end of the redraw. */
+static struct knockout_entry knockout_entry_store[KNOCKOUT_ENTRIES];
+static struct knockout_box_block knockout_box_store;
+static int knockout_polygon_store[KNOCKOUT_POLYGONS];
+
+static struct knockout_entry *knockout_entries = knockout_entry_store;
+static int *knockout_polygons = knockout_polygon_store;
+static int knockout_entry_max = KNOCKOUT_ENTRIES;
+static int knockout_polygon_max = KNOCKOUT_POLYGONS;
+static int knockout_box_blocks = 1;
+
 static int knockout_entry_cur = 0;
+static struct knockout_box_block *knockout_box_block = &knockout_box_store;
 static int knockout_box_cur = 0;
 static int knockout_polygon_cur = 0;
+
+/** Hash table of top level boxes by grid cell */
+static struct knockout_box *knockout_grid_store[1 << KNOCKOUT_GRID_BITS];
+static struct knockout_box **knockout_grid = knockout_grid_store;
+static int knockout_grid_bits = KNOCKOUT_GRID_BITS;
+/** Number of boxes added to the hash table */
+static int knockout_grid_boxes = 0;
+/** Number of boxes added to each grid */
+static int knockout_grid_count[KNOCKOUT_GRID_LEVELS];
+/** Top level boxes too large for any grid */
 static struct knockout_box *knockout_list = NULL;
 
 static struct plotter_table real_plot;
@@ -183,6 +229,233 @@ static struct rect clip_cur;
 static int nested_depth = 0;
 
 
+/**
+ * Grow a knockout buffer
+ *
+ * The buffer is moved from its static storage to the heap the first time
+ * it grows, and doubles in size each time after that.
+ *
+ * \param buf   The buffer to grow
+ * \param store The static storage of the buffer
+ * \param size  The size of each element of the buffer
+ * \param max   The number of elements in buf, updated on success
+ * \param need  The number of elements required
+ * \param limit The largest number of elements the buffer may grow to
+ * \return The grown buffer, or NULL if it could not be grown
+ */
+static void *
+knockout_grow(void *buf, void *store, size_t size, int *max, int need,
+	      int limit)
+{
+	int nmax = *max;
+	void *nbuf;
+
+	if (need > limit) {
+		return NULL;
+	}
+	while (nmax < need) {
+		nmax *= 2;
+	}
+	if (nmax > limit) {
+		nmax = limit;
+	}
+
+	if (buf == store) {
+		nbuf = malloc(nmax * size);
+		if (nbuf != NULL) {
+			memcpy(nbuf, buf, *max * size);
+		}
+	} else {
+		nbuf = realloc(buf, nmax * size);
+	}
+	if (nbuf != NULL) {
+		*max = nmax;
+	}
+	return nbuf;
+}
+
+
+/**
+ * Ensure knockout boxes can be allocated
+ *
+ * \param count The number of boxes which will be allocated
+ * \return true on success, false if the box buffer is full
+ */
+static bool knockout_box_reserve(int count)
+{
+	struct knockout_box_block *block = knockout_box_block;
+
+	if (knockout_box_cur + count <= KNOCKOUT_BOXES) {
+		return true;
+	}
+
+	if (block->next == NULL) {
+		if (knockout_box_blocks >= KNOCKOUT_GROWTH_LIMIT) {
+			return false;
+		}
+		block->next = malloc(sizeof(struct knockout_box_block));
+		if (block->next == NULL) {
+			return false;
+		}
+		block->next->next = NULL;
+		knockout_box_blocks++;
+	}
+
+	knockout_box_block = block->next;
+	knockout_box_cur = 0;
+	return true;
+}
+
+
+/**
+ * Allocate a knockout box
+ *
+ * The box must have been reserved with knockout_box_reserve()
+ *
+ * \return The new box
+ */
+static inline struct knockout_box *knockout_box_new(void)
+{
+	assert(knockout_box_cur < KNOCKOUT_BOXES);
+	return &knockout_box_block->box[knockout_box_cur++];
+}
+
+
+/**
+ * Find the grid level for a top level box
+ *
+ * \param bbox The bounding box of the box
+ * \return The grid level, or KNOCKOUT_GRID_LEVELS if too large for any grid
+ */
+static int knockout_grid_level(const struct rect *bbox)
+{
+	unsigned int size = (unsigned int)bbox->x1 - (unsigned int)bbox->x0;
+	unsigned int height = (unsigned int)bbox->y1 - (unsigned int)bbox->y0;
+	int level;
+
+	if ((bbox->x1 < bbox->x0) || (bbox->y1 < bbox->y0)) {
+		return KNOCKOUT_GRID_LEVELS;
+	}
+	if (height > size) {
+		size = height;
+	}
+
+	for (level = 0; level < KNOCKOUT_GRID_LEVELS; level++) {
+		if (size <= (1u << (KNOCKOUT_GRID_SHIFT + level))) {
+			break;
+		}
+	}
+	return level;
+}
+
+
+/**
+ * Get the key of a grid cell
+ *
+ * \param level The grid level
+ * \param cx    The column of the cell
+ * \param cy    The row of the cell
+ * \return The key of the cell
+ */
+static inline unsigned int knockout_grid_key(int level, int cx, int cy)
+{
+	return ((unsigned int)cx * 0x8da6b343u) +
+			((unsigned int)cy * 0xd8163841u) +
+			(unsigned int)level;
+}
+
+
+/**
+ * Get the list of top level boxes in a grid cell
+ *
+ * \param key The key of the cell
+ * \return The head of the list of boxes in the cell
+ */
+static inline struct knockout_box **knockout_grid_cell(unsigned int key)
+{
+	return &knockout_grid[(key * 0x9e3779b1u) >> (32 - knockout_grid_bits)];
+}
+
+
+/**
+ * Grow the grid hash table
+ *
+ * Boxes which have been deleted or frozen are dropped from the table. The
+ * table is left unchanged if it cannot be grown.
+ */
+static void knockout_grid_grow(void)
+{
+	struct knockout_box **old = knockout_grid;
+	struct knockout_box **grid;
+	struct knockout_box **cell;
+	struct knockout_box *box;
+	struct knockout_box *next;
+	int size = 1 << knockout_grid_bits;
+	int i;
+
+	if (size * 2 > (1 << KNOCKOUT_GRID_BITS) * KNOCKOUT_GROWTH_LIMIT) {
+		return;
+	}
+	grid = calloc(size * 2, sizeof(struct knockout_box *));
+	if (grid == NULL) {
+		return;
+	}
+
+	knockout_grid = grid;
+	knockout_grid_bits++;
+	for (i = 0; i < size; i++) {
+		for (box = old[i]; box != NULL; box = next) {
+			next = box->next;
+			if (box->deleted || box->frozen)
+				continue;
+			cell = knockout_grid_cell(box->cell);
+			box->next = *cell;
+			*cell = box;
+		}
+	}
+
+	if (old != knockout_grid_store) {
+		free(old);
+	} else {
+		memset(old, 0, sizeof(knockout_grid_store));
+	}
+}
+
+
+/**
+ * Release any heap storage used by the knockout buffers
+ */
+static void knockout_release(void)
+{
+	struct knockout_box_block *block;
+
+	if (knockout_entries != knockout_entry_store) {
+		free(knockout_entries);
+		knockout_entries = knockout_entry_store;
+		knockout_entry_max = KNOCKOUT_ENTRIES;
+	}
+
+	if (knockout_polygons != knockout_polygon_store) {
+		free(knockout_polygons);
+		knockout_polygons = knockout_polygon_store;
+		knockout_polygon_max = KNOCKOUT_POLYGONS;
+	}
+
+	if (knockout_grid != knockout_grid_store) {
+		free(knockout_grid);
+		knockout_grid = knockout_grid_store;
+		knockout_grid_bits = KNOCKOUT_GRID_BITS;
+	}
+
+	while (knockout_box_store.next != NULL) {
+		block = knockout_box_store.next;
+		knockout_box_store.next = block->next;
+		free(block);
+	}
+	knockout_box_blocks = 1;
+}
+
+
 /**
  * fill an area recursively
  */
@@ -268,8 +541,9 @@ static nserror knockout_plot_flush(const struct redraw_context *ctx)
 	/* debugging information */
 #ifdef KNOCKOUT_DEBUG
 	NSLOG(netsurf, INFO, "Entries are %i/%i, %i/%i, %i/%i",
-	      knockout_entry_cur, KNOCKOUT_ENTRIES, knockout_box_cur,
-	      KNOCKOUT_BOXES, knockout_polygon_cur, KNOCKOUT_POLYGONS);
+	      knockout_entry_cur, knockout_entry_max, knockout_box_cur,
+	      knockout_box_blocks * KNOCKOUT_BOXES, knockout_polygon_cur,
+	      knockout_polygon_max);
 #endif
 
 	for (i = 0; i < knockout_entry_cur; i++) {
@@ -289,17 +563,23 @@ static nserror knockout_plot_flush(const struct redraw_context *ctx)
 		case KNOCKOUT_PLOT_POLYGON:
 			res = real_plot.polygon(ctx,
 				&knockout_entries[i].data.polygon.plot_style,
+				knockout_polygons +
 				knockout_entries[i].data.polygon.p,
 				knockout_entries[i].data.polygon.n);
 			break;
 
 		case KNOCKOUT_PLOT_FILL:
-			box = knockout_entries[i].box->child;
-			if (box) {
+			/* a split box whose bounds were later covered is
+			 * deleted along with all its pieces */
+			box = knockout_entries[i].box;
+			if (box->deleted) {
+				break;
+			}
+			if (box->child) {
 				res = knockout_plot_fill_recursive(ctx,
-								   box,
+								   box->child,
 				      &knockout_entries[i].data.fill.plot_style);
-			} else if (!knockout_entries[i].box->deleted) {
+			} else {
 				res = real_plot.rectangle(ctx,
 				       &knockout_entries[i].data.fill.plot_style,
 				       &knockout_entries[i].data.fill.r);
@@ -338,12 +618,15 @@ static nserror knockout_plot_flush(const struct redraw_context *ctx)
 			break;
 
 		case KNOCKOUT_PLOT_BITMAP:
-			box = knockout_entries[i].box->child;
-			if (box) {
+			box = knockout_entries[i].box;
+			if (box->deleted) {
+				break;
+			}
+			if (box->child) {
 				res = knockout_plot_bitmap_recursive(ctx,
-						box,
+						box->child,
 						&knockout_entries[i]);
-			} else if (!knockout_entries[i].box->deleted) {
+			} else {
 				res = real_plot.bitmap(ctx,
 					knockout_entries[i].data.bitmap.bitmap,
 					knockout_entries[i].data.bitmap.x,
@@ -371,57 +654,204 @@ static nserror knockout_plot_flush(const struct redraw_context *ctx)
 		}
 	}
 
+	/* empty the grid only if boxes were added to it */
+	if (knockout_grid_boxes > 0) {
+		memset(knockout_grid, 0, sizeof(struct knockout_box *) <<
+				knockout_grid_bits);
+		memset(knockout_grid_count, 0, sizeof(knockout_grid_count));
+		knockout_grid_boxes = 0;
+	}
+	knockout_list = NULL;
+
 	knockout_entry_cur = 0;
+	knockout_box_block = &knockout_box_store;
 	knockout_box_cur = 0;
 	knockout_polygon_cur = 0;
-	knockout_list = NULL;
 
 	return ffres;
 }
 
 
 /**
- * Knockout a section of previous rendering
+ * Complete the current knockout entry and make room for the next
+ *
+ * \param ctx The current redraw context.
+ * \return NSERROR_OK on success else error code from flushing.
+ */
+static nserror knockout_entry_next(const struct redraw_context *ctx)
+{
+	struct knockout_entry *entries;
+
+	if (++knockout_entry_cur < knockout_entry_max) {
+		return NSERROR_OK;
+	}
+
+	entries = knockout_grow(knockout_entries, knockout_entry_store,
+				sizeof(struct knockout_entry),
+				&knockout_entry_max, knockout_entry_cur + 1,
+				KNOCKOUT_ENTRIES * KNOCKOUT_GROWTH_LIMIT);
+	if (entries == NULL) {
+		return knockout_plot_flush(ctx);
+	}
+
+	knockout_entries = entries;
+	return NSERROR_OK;
+}
+
+
+/**
+ * Create a top level box which can be knocked out by later plots
+ *
+ * Top level boxes are kept in the grid cell containing their top left
+ * corner, at the level where each cell is at least as large as the box.
+ *
+ * \param ctx  The current redraw context.
+ * \param bbox The bounding box of the box
+ * \param res  Updated with the result of flushing the buffers if they
+ *             were full, otherwise unchanged
+ * \return The new box
+ */
+static struct knockout_box *
+knockout_box_top(const struct redraw_context *ctx,
+		 const struct rect *bbox,
+		 nserror *res)
+{
+	struct knockout_box *box;
+	struct knockout_box **cell;
+	int level;
+	int shift;
+
+	if (!knockout_box_reserve(1)) {
+		/* the first block is always available once flushed */
+		*res = knockout_plot_flush(ctx);
+	}
+	box = knockout_box_new();
+
+	box->bbox = *bbox;
+	box->deleted = false;
+	box->frozen = false;
+	box->pieces = 0;
+	box->child = NULL;
+
+	level = knockout_grid_level(bbox);
+	if (level == KNOCKOUT_GRID_LEVELS) {
+		cell = &knockout_list;
+	} else {
+		if (knockout_grid_boxes >= (1 << knockout_grid_bits)) {
+			knockout_grid_grow();
+		}
+		shift = KNOCKOUT_GRID_SHIFT + level;
+		box->cell = knockout_grid_key(level,
+					      bbox->x0 >> shift,
+					      bbox->y0 >> shift);
+		cell = knockout_grid_cell(box->cell);
+		knockout_grid_count[level]++;
+		knockout_grid_boxes++;
+	}
+	box->next = *cell;
+	*cell = box;
+
+	return box;
+}
+
+
+/**
+ * Add a child to a knockout box
+ *
+ * The box must have been reserved with knockout_box_reserve()
+ *
+ * \param parent The box being split
+ * \param bbox  The area of the child
+ */
+static void
+knockout_box_split(struct knockout_box *parent, const struct rect *bbox)
+{
+	struct knockout_box *box = knockout_box_new();
+
+	box->bbox = *bbox;
+	box->deleted = false;
+	box->child = NULL;
+	box->next = parent->child;
+	parent->child = box;
+}
+
+
+/**
+ * Shrink the bounds of a split knockout box to those of its children
+ *
+ * Keeping the bounds tight lets later knockouts skip the box without
+ * visiting its children. A box with no remaining children is deleted.
+ *
+ * \param box The split box
+ */
+static void knockout_box_bound(struct knockout_box *box)
+{
+	struct knockout_box *child;
+	bool empty = true;
+
+	for (child = box->child; child; child = child->next) {
+		if (child->deleted)
+			continue;
+		if (empty) {
+			box->bbox = child->bbox;
+			empty = false;
+			continue;
+		}
+		if (child->bbox.x0 < box->bbox.x0)
+			box->bbox.x0 = child->bbox.x0;
+		if (child->bbox.y0 < box->bbox.y0)
+			box->bbox.y0 = child->bbox.y0;
+		if (child->bbox.x1 > box->bbox.x1)
+			box->bbox.x1 = child->bbox.x1;
+		if (child->bbox.y1 > box->bbox.y1)
+			box->bbox.y1 = child->bbox.y1;
+	}
+
+	if (empty)
+		box->deleted = true;
+}
+
+
+/**
+ * Knockout a section of previous rendering from a list of boxes
  *
  * \param ctx The current redraw context.
  * \param x0    The left edge of the removal box
  * \param y0    The bottom edge of the removal box
  * \param x1    The right edge of the removal box
  * \param y1    The top edge of the removal box
- * \param owner The parent box set to consider, or NULL for top level
+ * \param list  The list of boxes to consider
+ * \param owner The box the list is the children of, or NULL for top level
+ * \param top   The top level box owner belongs to, or NULL for top level
+ * \return true to continue, false if the buffers had to be flushed
  */
-static void
-knockout_calculate(const struct redraw_context *ctx,
-		   int x0, int y0, int x1, int y1,
-		   struct knockout_box *owner)
+static bool
+knockout_calculate_list(const struct redraw_context *ctx,
+			int x0, int y0, int x1, int y1,
+			struct knockout_box **list,
+			struct knockout_box *owner,
+			struct knockout_box *top)
 {
-	struct knockout_box *box;
 	struct knockout_box *parent;
 	struct knockout_box *prev = NULL;
+	struct knockout_box *root;
+	struct rect piece[4];
 	int nx0, ny0, nx1, ny1;
+	int n;
 
-	if (owner == NULL)
-		box = knockout_list;
-	else
-		box = owner->child;
-
-	for (parent = box; parent; parent = parent->next) {
-		/* permanently delink deleted nodes */
-		if (parent->deleted) {
+	for (parent = *list; parent; parent = parent->next) {
+		/* permanently delink deleted nodes, and top level nodes
+		 * which are no longer being knocked out */
+		if (parent->deleted || (owner == NULL && parent->frozen)) {
 			if (prev) {
 				/* not the first valid element: just skip future */
 				prev->next = parent->next;
 			} else {
-				if (owner) {
-					/* first valid element: update child reference */
-					owner->child = parent->next;
-					/* have we deleted all child nodes? */
-					if (!owner->child)
-						owner->deleted = true;
-				} else {
-					/* we are the head of the list */
-					knockout_list = parent->next;
-				}
+				/* first valid element: update list head */
+				*list = parent->next;
+				/* have we deleted all child nodes? */
+				if (owner && !*list)
+					owner->deleted = true;
 			}
 			continue;
 		} else {
@@ -446,66 +876,148 @@ knockout_calculate(const struct redraw_context *ctx,
 
 		/* has the box been replaced by children? */
 		if (parent->child) {
-			knockout_calculate(ctx, x0, y0, x1, y1, parent);
-		} else {
-			/* we need a maximum of 4 child boxes */
-			if (knockout_box_cur + 4 >= KNOCKOUT_BOXES) {
-				knockout_plot_flush(ctx);
-				return;
-			}
+			if (!knockout_calculate_list(ctx, x0, y0, x1, y1,
+					&parent->child, parent,
+					(top != NULL) ? top : parent))
+				return false;
+			knockout_box_bound(parent);
+			continue;
+		}
 
-			/* clip top */
-			if (y1 < ny1) {
-				knockout_boxes[knockout_box_cur].bbox.x0 = nx0;
-				knockout_boxes[knockout_box_cur].bbox.y0 = y1;
-				knockout_boxes[knockout_box_cur].bbox.x1 = nx1;
-				knockout_boxes[knockout_box_cur].bbox.y1 = ny1;
-				knockout_boxes[knockout_box_cur].deleted = false;
-				knockout_boxes[knockout_box_cur].child = NULL;
-				knockout_boxes[knockout_box_cur].next = parent->child;
-				parent->child = &knockout_boxes[knockout_box_cur++];
-				ny1 = y1;
-			}
-			/* clip bottom */
-			if (y0 > ny0) {
-				knockout_boxes[knockout_box_cur].bbox.x0 = nx0;
-				knockout_boxes[knockout_box_cur].bbox.y0 = ny0;
-				knockout_boxes[knockout_box_cur].bbox.x1 = nx1;
-				knockout_boxes[knockout_box_cur].bbox.y1 = y0;
-				knockout_boxes[knockout_box_cur].deleted = false;
-				knockout_boxes[knockout_box_cur].child = NULL;
-				knockout_boxes[knockout_box_cur].next = parent->child;
-				parent->child = &knockout_boxes[knockout_box_cur++];
-				ny0 = y0;
-			}
-			/* clip right */
-			if (x1 < nx1) {
-				knockout_boxes[knockout_box_cur].bbox.x0 = x1;
-				knockout_boxes[knockout_box_cur].bbox.y0 = ny0;
-				knockout_boxes[knockout_box_cur].bbox.x1 = nx1;
-				knockout_boxes[knockout_box_cur].bbox.y1 = ny1;
-				knockout_boxes[knockout_box_cur].deleted = false;
-				knockout_boxes[knockout_box_cur].child = NULL;
-				knockout_boxes[knockout_box_cur].next = parent->child;
-				parent->child = &knockout_boxes[knockout_box_cur++];
-				/* nx1 isn't used again, but if it was it would
-				 * need to be updated to x1 here. */
-			}
-			/* clip left */
-			if (x0 > nx0) {
-				knockout_boxes[knockout_box_cur].bbox.x0 = nx0;
-				knockout_boxes[knockout_box_cur].bbox.y0 = ny0;
-				knockout_boxes[knockout_box_cur].bbox.x1 = x0;
-				knockout_boxes[knockout_box_cur].bbox.y1 = ny1;
-				knockout_boxes[knockout_box_cur].deleted = false;
-				knockout_boxes[knockout_box_cur].child = NULL;
-				knockout_boxes[knockout_box_cur].next = parent->child;
-				parent->child = &knockout_boxes[knockout_box_cur++];
-				/* nx0 isn't used again, but if it was it would
-				 * need to be updated to x0 here. */
+		/* find the up to 4 pieces left after the knockout */
+		n = 0;
+		/* clip top */
+		if (y1 < ny1) {
+			piece[n].x0 = nx0;
+			piece[n].y0 = y1;
+			piece[n].x1 = nx1;
+			piece[n++].y1 = ny1;
+			ny1 = y1;
+		}
+		/* clip bottom */
+		if (y0 > ny0) {
+			piece[n].x0 = nx0;
+			piece[n].y0 = ny0;
+			piece[n].x1 = nx1;
+			piece[n++].y1 = y0;
+			ny0 = y0;
+		}
+		/* clip right */
+		if (x1 < nx1) {
+			piece[n].x0 = x1;
+			piece[n].y0 = ny0;
+			piece[n].x1 = nx1;
+			piece[n++].y1 = ny1;
+			/* nx1 isn't used again, but if it was it would
+			 * need to be updated to x1 here. */
+		}
+		/* clip left */
+		if (x0 > nx0) {
+			piece[n].x0 = nx0;
+			piece[n].y0 = ny0;
+			piece[n].x1 = x0;
+			piece[n++].y1 = ny1;
+			/* nx0 isn't used again, but if it was it would
+			 * need to be updated to x0 here. */
+		}
+
+		/* a child box left as a single piece can simply shrink */
+		if ((n == 1) && (owner != NULL)) {
+			parent->bbox = piece[0];
+			continue;
+		}
+
+		/* stop knocking out boxes which have been split too far */
+		root = (top != NULL) ? top : parent;
+		if (root->pieces + n > KNOCKOUT_PIECES) {
+			root->frozen = true;
+			continue;
+		}
+
+		if (!knockout_box_reserve(n)) {
+			knockout_plot_flush(ctx);
+			return false;
+		}
+		root->pieces += n;
+		while (n > 0) {
+			knockout_box_split(parent, &piece[--n]);
+		}
+		knockout_box_bound(parent);
+	}
+
+	return true;
+}
+
+
+/**
+ * Knockout a section of previous rendering
+ *
+ * Only the grid cells which can hold top level boxes overlapping the
+ * removal box are considered. Boxes in each grid are no larger than its
+ * cells, so they must start in a cell no more than one before the removal
+ * box. If that is more cells than the hash table holds, the whole table
+ * is considered instead.
+ *
+ * \param ctx The current redraw context.
+ * \param x0    The left edge of the removal box
+ * \param y0    The bottom edge of the removal box
+ * \param x1    The right edge of the removal box
+ * \param y1    The top edge of the removal box
+ */
+static void
+knockout_calculate(const struct redraw_context *ctx,
+		   int x0, int y0, int x1, int y1)
+{
+	struct rect range[KNOCKOUT_GRID_LEVELS];
+	struct knockout_box **cell;
+	int size = 1 << knockout_grid_bits;
+	int cells = 0;
+	int level;
+	int shift;
+	int cx, cy;
+	int i;
+
+	for (level = 0; level < KNOCKOUT_GRID_LEVELS; level++) {
+		if (knockout_grid_count[level] == 0)
+			continue;
+
+		shift = KNOCKOUT_GRID_SHIFT + level;
+		range[level].x0 = (x0 - (1 << shift) + 1) >> shift;
+		range[level].y0 = (y0 - (1 << shift) + 1) >> shift;
+		range[level].x1 = (x1 - 1) >> shift;
+		range[level].y1 = (y1 - 1) >> shift;
+		cells += (range[level].x1 - range[level].x0 + 1) *
+				(range[level].y1 - range[level].y0 + 1);
+	}
+
+	if (cells > size) {
+		for (i = 0; i < size; i++) {
+			cell = &knockout_grid[i];
+			if ((*cell != NULL) &&
+			    !knockout_calculate_list(ctx, x0, y0, x1, y1,
+						     cell, NULL, NULL))
+				return;
+		}
+	} else {
+		for (level = 0; level < KNOCKOUT_GRID_LEVELS; level++) {
+			if (knockout_grid_count[level] == 0)
+				continue;
+
+			for (cy = range[level].y0; cy <= range[level].y1; cy++)
+			for (cx = range[level].x0; cx <= range[level].x1; cx++) {
+				cell = knockout_grid_cell(
+						knockout_grid_key(level, cx, cy));
+				if ((*cell != NULL) &&
+				    !knockout_calculate_list(ctx,
+							     x0, y0, x1, y1,
+							     cell, NULL, NULL))
+					return;
 			}
 		}
 	}
+
+	knockout_calculate_list(ctx, x0, y0, x1, y1,
+				&knockout_list, NULL, NULL);
 }
 
 
@@ -527,6 +1039,7 @@ knockout_plot_rectangle(const struct redraw_context *ctx,
 			const plot_style_t *pstyle,
 			const struct rect *rect)
 {
+	struct knockout_box *box;
 	int kx0, ky0, kx1, ky1;
 	nserror res = NSERROR_OK;
 
@@ -544,21 +1057,17 @@ knockout_plot_rectangle(const struct redraw_context *ctx,
 		}
 
 		/* fills both knock out and get knocked out */
-		knockout_calculate(ctx, kx0, ky0, kx1, ky1, NULL);
-		knockout_boxes[knockout_box_cur].bbox = *rect;
-		knockout_boxes[knockout_box_cur].deleted = false;
-		knockout_boxes[knockout_box_cur].child = NULL;
-		knockout_boxes[knockout_box_cur].next = knockout_list;
-		knockout_list = &knockout_boxes[knockout_box_cur];
-		knockout_entries[knockout_entry_cur].box = &knockout_boxes[knockout_box_cur];
+		knockout_calculate(ctx, kx0, ky0, kx1, ky1);
+		box = knockout_box_top(ctx, rect, &res);
+		if (res != NSERROR_OK) {
+			return res;
+		}
+		knockout_entries[knockout_entry_cur].box = box;
 		knockout_entries[knockout_entry_cur].data.fill.r = *rect;
 		knockout_entries[knockout_entry_cur].data.fill.plot_style = *pstyle;
 		knockout_entries[knockout_entry_cur].data.fill.plot_style.stroke_type = PLOT_OP_TYPE_NONE; /* ensure we only plot the fill */
 		knockout_entries[knockout_entry_cur].type = KNOCKOUT_PLOT_FILL;
-		if ((++knockout_entry_cur >= KNOCKOUT_ENTRIES) ||
-		    (++knockout_box_cur >= KNOCKOUT_BOXES)) {
-			res = knockout_plot_flush(ctx);
-		}
+		res = knockout_entry_next(ctx);
 	}
 
 	if (pstyle->stroke_type != PLOT_OP_TYPE_NONE) {
@@ -568,9 +1077,7 @@ knockout_plot_rectangle(const struct redraw_context *ctx,
 		knockout_entries[knockout_entry_cur].data.fill.plot_style = *pstyle;
 		knockout_entries[knockout_entry_cur].data.fill.plot_style.fill_type = PLOT_OP_TYPE_NONE; /* ensure we only plot the outline */
 		knockout_entries[knockout_entry_cur].type = KNOCKOUT_PLOT_RECTANGLE;
-		if (++knockout_entry_cur >= KNOCKOUT_ENTRIES) {
-			res = knockout_plot_flush(ctx);
-		}
+		res = knockout_entry_next(ctx);
 	}
 	return res;
 }
@@ -595,10 +1102,7 @@ knockout_plot_line(const struct redraw_context *ctx,
 	knockout_entries[knockout_entry_cur].data.line.l = *line;
 	knockout_entries[knockout_entry_cur].data.line.plot_style = *pstyle;
 	knockout_entries[knockout_entry_cur].type = KNOCKOUT_PLOT_LINE;
-	if (++knockout_entry_cur >= KNOCKOUT_ENTRIES) {
-		return knockout_plot_flush(ctx);
-	}
-	return NSERROR_OK;
+	return knockout_entry_next(ctx);
 }
 
 
@@ -622,37 +1126,42 @@ knockout_plot_polygon(const struct redraw_context *ctx,
 		      const int *p,
 		      unsigned int n)
 {
-	int *dest;
+	int *polygons;
+	int need = knockout_polygon_cur + (int)(n * 2);
 	nserror res = NSERROR_OK;
 	nserror ffres = NSERROR_OK;
 
-	/* ensure we have sufficient room even when flushed */
-	if (n * 2 >= KNOCKOUT_POLYGONS) {
-		ffres = knockout_plot_flush(ctx);
-		res = real_plot.polygon(ctx, pstyle, p, n);
-		/* return the first error */
-		if ((res != NSERROR_OK) && (ffres == NSERROR_OK)) {
-			ffres = res;
+	/* ensure we have enough room, growing or flushing as necessary */
+	if (need > knockout_polygon_max) {
+		polygons = knockout_grow(knockout_polygons,
+				knockout_polygon_store, sizeof(int),
+				&knockout_polygon_max, need,
+				KNOCKOUT_POLYGONS * KNOCKOUT_GROWTH_LIMIT);
+		if (polygons != NULL) {
+			knockout_polygons = polygons;
+		} else {
+			ffres = knockout_plot_flush(ctx);
+			if (n * 2 > (unsigned int)knockout_polygon_max) {
+				/* too large to buffer even when flushed */
+				res = real_plot.polygon(ctx, pstyle, p, n);
+				/* return the first error */
+				if ((res != NSERROR_OK) &&
+				    (ffres == NSERROR_OK)) {
+					ffres = res;
+				}
+				return ffres;
+			}
 		}
-		return ffres;
-	}
-
-	/* ensure we have enough room right now */
-	if (knockout_polygon_cur + n * 2 >= KNOCKOUT_POLYGONS) {
-		ffres = knockout_plot_flush(ctx);
 	}
 
 	/* copy our data */
-	dest = &(knockout_polygons[knockout_polygon_cur]);
-	memcpy(dest, p, n * 2 * sizeof(int));
+	memcpy(knockout_polygons + knockout_polygon_cur, p, n * 2 * sizeof(int));
+	knockout_entries[knockout_entry_cur].data.polygon.p = knockout_polygon_cur;
 	knockout_polygon_cur += n * 2;
-	knockout_entries[knockout_entry_cur].data.polygon.p = dest;
 	knockout_entries[knockout_entry_cur].data.polygon.n = n;
 	knockout_entries[knockout_entry_cur].data.polygon.plot_style = *pstyle;
 	knockout_entries[knockout_entry_cur].type = KNOCKOUT_PLOT_POLYGON;
-	if (++knockout_entry_cur >= KNOCKOUT_ENTRIES) {
-		res = knockout_plot_flush(ctx);
-	}
+	res = knockout_entry_next(ctx);
 	/* return the first error */
 	if ((res != NSERROR_OK) && (ffres == NSERROR_OK)) {
 		ffres = res;
@@ -713,9 +1222,7 @@ knockout_plot_clip(const struct redraw_context *ctx, const struct rect *clip)
 
 	knockout_entries[knockout_entry_cur].data.clip = *clip;
 	knockout_entries[knockout_entry_cur].type = KNOCKOUT_PLOT_CLIP;
-	if (++knockout_entry_cur >= KNOCKOUT_ENTRIES) {
-		res = knockout_plot_flush(ctx);
-	}
+	res = knockout_entry_next(ctx);
 	return res;
 }
 
@@ -747,9 +1254,7 @@ knockout_plot_text(const struct redraw_context *ctx,
 	knockout_entries[knockout_entry_cur].data.text.length = length;
 	knockout_entries[knockout_entry_cur].data.text.font_style = *fstyle;
 	knockout_entries[knockout_entry_cur].type = KNOCKOUT_PLOT_TEXT;
-	if (++knockout_entry_cur >= KNOCKOUT_ENTRIES) {
-		res = knockout_plot_flush(ctx);
-	}
+	res = knockout_entry_next(ctx);
 	return res;
 }
 
@@ -780,9 +1285,7 @@ knockout_plot_disc(const struct redraw_context *ctx,
 	knockout_entries[knockout_entry_cur].data.disc.radius = radius;
 	knockout_entries[knockout_entry_cur].data.disc.plot_style = *pstyle;
 	knockout_entries[knockout_entry_cur].type = KNOCKOUT_PLOT_DISC;
-	if (++knockout_entry_cur >= KNOCKOUT_ENTRIES) {
-		res = knockout_plot_flush(ctx);
-	}
+	res = knockout_entry_next(ctx);
 	return res;
 }
 
@@ -821,9 +1324,7 @@ knockout_plot_arc(const struct redraw_context *ctx,
 	knockout_entries[knockout_entry_cur].data.arc.angle2 = angle2;
 	knockout_entries[knockout_entry_cur].data.arc.plot_style = *pstyle;
 	knockout_entries[knockout_entry_cur].type = KNOCKOUT_PLOT_ARC;
-	if (++knockout_entry_cur >= KNOCKOUT_ENTRIES) {
-		res = knockout_plot_flush(ctx);
-	}
+	res = knockout_entry_next(ctx);
 	return res;
 }
 
@@ -860,6 +1361,8 @@ knockout_plot_bitmap(const struct redraw_context *ctx,
 		     colour bg,
 		     bitmap_flags_t flags)
 {
+	struct knockout_box *box;
+	struct rect bbox;
 	int kx0, ky0, kx1, ky1;
 	nserror res;
 	nserror ffres = NSERROR_OK;
@@ -888,17 +1391,14 @@ knockout_plot_bitmap(const struct redraw_context *ctx,
 
 	/* tiled bitmaps both knock out and get knocked out */
 	if (guit->bitmap->get_opaque(bitmap)) {
-		knockout_calculate(ctx, kx0, ky0, kx1, ky1, NULL);
+		knockout_calculate(ctx, kx0, ky0, kx1, ky1);
 	}
-	knockout_boxes[knockout_box_cur].bbox.x0 = kx0;
-	knockout_boxes[knockout_box_cur].bbox.y0 = ky0;
-	knockout_boxes[knockout_box_cur].bbox.x1 = kx1;
-	knockout_boxes[knockout_box_cur].bbox.y1 = ky1;
-	knockout_boxes[knockout_box_cur].deleted = false;
-	knockout_boxes[knockout_box_cur].child = NULL;
-	knockout_boxes[knockout_box_cur].next = knockout_list;
-	knockout_list = &knockout_boxes[knockout_box_cur];
-	knockout_entries[knockout_entry_cur].box = &knockout_boxes[knockout_box_cur];
+	bbox.x0 = kx0;
+	bbox.y0 = ky0;
+	bbox.x1 = kx1;
+	bbox.y1 = ky1;
+	box = knockout_box_top(ctx, &bbox, &ffres);
+	knockout_entries[knockout_entry_cur].box = box;
 	knockout_entries[knockout_entry_cur].data.bitmap.x = x;
 	knockout_entries[knockout_entry_cur].data.bitmap.y = y;
 	knockout_entries[knockout_entry_cur].data.bitmap.width = width;
@@ -908,9 +1408,9 @@ knockout_plot_bitmap(const struct redraw_context *ctx,
 	knockout_entries[knockout_entry_cur].data.bitmap.flags = flags;
 	knockout_entries[knockout_entry_cur].type = KNOCKOUT_PLOT_BITMAP;
 
-	if ((++knockout_entry_cur >= KNOCKOUT_ENTRIES) ||
-	    (++knockout_box_cur >= KNOCKOUT_BOXES)) {
-		ffres = knockout_plot_flush(ctx);
+	res = knockout_entry_next(ctx);
+	if ((res != NSERROR_OK) && (ffres == NSERROR_OK)) {
+		ffres = res;
 	}
 	res = knockout_plot_clip(ctx, &clip_cur);
 	/* return the first error */
@@ -939,10 +1439,7 @@ knockout_plot_group_start(const struct redraw_context *ctx, const char *name)
 
 	knockout_entries[knockout_entry_cur].data.group_start.name = name;
 	knockout_entries[knockout_entry_cur].type = KNOCKOUT_PLOT_GROUP_START;
-	if (++knockout_entry_cur >= KNOCKOUT_ENTRIES) {
-		return knockout_plot_flush(ctx);
-	}
-	return NSERROR_OK;
+	return knockout_entry_next(ctx);
 }
 
 
@@ -961,10 +1458,7 @@ static nserror knockout_plot_group_end(const struct redraw_context *ctx)
 	}
 
 	knockout_entries[knockout_entry_cur].type = KNOCKOUT_PLOT_GROUP_END;
-	if (++knockout_entry_cur >= KNOCKOUT_ENTRIES) {
-		return knockout_plot_flush(ctx);
-	}
-	return NSERROR_OK;
+	return knockout_entry_next(ctx);
 }
 
 /* exported functions documented in desktop/knockout.h */
@@ -998,7 +1492,9 @@ bool knockout_plot_end(const struct redraw_context *ctx)
 {
 	/* only output when we've finished any nesting */
 	if (--nested_depth == 0) {
-		return knockout_plot_flush(ctx);
+		nserror res = knockout_plot_flush(ctx);
+		knockout_release();
+		return res;
 	}
 
 	assert(nested_depth > 0);
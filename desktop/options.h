@@ -101,6 +101,9 @@ NSOPTION_UINT(disc_cache_size, 1024 * 1024 * 1024)
 /** Preferred expiry age of disc cache / days. */
 NSOPTION_INTEGER(disc_cache_age, 28)
 
+/** Time to keep parsed stylesheets no page is using / seconds. */
+NSOPTION_UINT(stylesheet_retain_time, 0)
+
 /** Whether to block advertisements */
 NSOPTION_BOOL(block_advertisements, false)
 
@@ -180,6 +183,12 @@ NSOPTION_BOOL(incremental_reflow, true)
 /* Minimum time (in cs) between HTML reflows while objects are fetching */
 NSOPTION_UINT(min_reflow_period, DEFAULT_REFLOW_PERIOD)
 
+/* Whether to display web pages before their source has fully arrived */
+NSOPTION_BOOL(progressive_render, false)
+
+/* Whether to lay out text far below the viewport after the rest */
+NSOPTION_BOOL(deferred_layout, false)
+
 /* use core selection menu */
 NSOPTION_BOOL(core_select_menu, false)
 
@@ -0,0 +1,1097 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Framebuffer band rendering implementation.
+ *
+ * While a redraw is recorded every plot operation is stored along with
+ *  the rows it can touch, clipped to the clip rectangle in force. Glyphs
+ *  are looked up and copied as the text is recorded because neither font
+ *  cache may be used from more than one thread.
+ *
+ * The area redrawn is then divided into one band per thread. Each band
+ *  replays the operations reaching its rows into a private RAM surface,
+ *  offset so the top left of the band is at the origin. The main thread
+ *  renders bands alongside the workers and, once all are complete,
+ *  copies them to the screen surface.
+ *
+ * If memory runs out while recording, what has been recorded is plotted
+ *  directly and the rest of the redraw is plotted as it arrives. If the
+ *  bands cannot be set up the recording is plotted directly instead.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libnsfb.h>
+#include <libnsfb_plot.h>
+
+#include "utils/utils.h"
+#include "utils/log.h"
+#include "utils/nsoption.h"
+#include "netsurf/plotters.h"
+
+#include "framebuffer/framebuffer.h"
+#include "framebuffer/bands.h"
+
+#ifdef FB_USE_BAND_THREADS
+
+#include <pthread.h>
+#include <unistd.h>
+
+/** Greatest number of bands a redraw is split into */
+#define FB_BANDS_MAX 16
+
+/** Least height of a band in pixels */
+#define FB_BANDS_MIN_HEIGHT 32
+
+/** Alignment of data in the recording arena */
+#define FB_BANDS_ALIGN 8
+
+/** Recorded plot operations */
+enum fb_bands_op {
+	FB_BANDS_CLIP,
+	FB_BANDS_ARC,
+	FB_BANDS_DISC,
+	FB_BANDS_LINE,
+	FB_BANDS_RECTANGLE,
+	FB_BANDS_POLYGON,
+	FB_BANDS_BITMAP,
+	FB_BANDS_GLYPH,
+};
+
+/** A recorded plot operation */
+struct fb_bands_entry {
+	enum fb_bands_op op; /**< Operation */
+	int y0; /**< First row the operation can touch */
+	int y1; /**< Row after the last the operation can touch */
+	plot_style_t style; /**< Style of shape operations */
+	union {
+		/** Clip, line and rectangle operations */
+		struct rect rect;
+		/** Arc and disc operations */
+		struct {
+			int x, y, radius, angle1, angle2;
+		} arc;
+		/** Polygon operation */
+		struct {
+			size_t p; /**< Offset of vertices in arena */
+			unsigned int n; /**< Number of vertices */
+		} polygon;
+		/** Bitmap operation */
+		struct {
+			struct bitmap *bitmap;
+			int x, y, width, height;
+			colour bg;
+			bitmap_flags_t flags;
+		} bitmap;
+		/** Glyph from a text operation */
+		struct {
+			nsfb_bbox_t loc; /**< Area covered by glyph */
+			size_t p; /**< Offset of glyph image in arena */
+			int pitch; /**< Row pitch of glyph image */
+			bool mono; /**< Glyph image is one bit per pixel */
+			nsfb_colour_t colour; /**< Colour of glyph */
+		} glyph;
+	} u;
+};
+
+/** The redraw being recorded */
+static struct {
+	nsfb_t *nsfb; /**< Surface the redraw is for */
+	enum nsfb_format_e format; /**< Pixel format of the redraw surface */
+	struct rect box; /**< Area being redrawn */
+	struct rect clip; /**< Clip rectangle in force */
+
+	/** Recording failed and operations are plotted directly */
+	bool direct;
+
+	struct fb_bands_entry *entry; /**< Recorded operations */
+	unsigned int entry_count; /**< Number of recorded operations */
+	unsigned int entry_alloc; /**< Allocated size of entry */
+
+	uint8_t *data; /**< Arena for vertices and glyph images */
+	size_t data_used; /**< Bytes of data in use */
+	size_t data_alloc; /**< Allocated size of data */
+
+	unsigned int max_points; /**< Most vertices of any polygon */
+} fb_bands_rec;
+
+/** A band of a redraw and the surface it is rendered to */
+struct fb_band {
+	nsfb_t *surface; /**< Surface rendered to */
+	int width; /**< Allocated width of surface */
+	int height; /**< Allocated height of surface */
+	enum nsfb_format_e format; /**< Pixel format of surface */
+
+	int dx; /**< Offset from redraw to surface coordinates */
+	int dy; /**< Offset from redraw to surface coordinates */
+	struct rect area; /**< Area of surface rendered, surface coordinates */
+
+	int *points; /**< Translated polygon vertices */
+	unsigned int points_alloc; /**< Allocated size of points, in ints */
+};
+
+static struct fb_band fb_bands[FB_BANDS_MAX];
+
+/** Rendering thread pool */
+static struct {
+	pthread_mutex_t lock; /**< Protects the pool */
+	pthread_cond_t start; /**< Signalled when bands are ready */
+	pthread_cond_t done; /**< Signalled when the last band completes */
+
+	pthread_t thread[FB_BANDS_MAX]; /**< Worker threads */
+	int threads; /**< Number of worker threads */
+
+	unsigned int generation; /**< Incremented for each redraw */
+	int next; /**< Next band to render */
+	int count; /**< Number of bands in the redraw */
+	int pending; /**< Number of bands not yet rendered */
+	bool quit; /**< Workers should exit */
+} fb_bands_pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.start = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER,
+};
+
+
+/**
+ * Get the number of threads to render with.
+ *
+ * \return number of threads including the main thread.
+ */
+static int fb_bands_threads(void)
+{
+	int threads = nsoption_int(fb_render_threads);
+
+	if (threads <= 0) {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+
+	if (threads < 1) {
+		threads = 1;
+	} else if (threads > FB_BANDS_MAX) {
+		threads = FB_BANDS_MAX;
+	}
+
+	return threads;
+}
+
+
+/**
+ * Replay the recorded operations into a band.
+ *
+ * \param band The band to render.
+ */
+static void fb_bands_replay(struct fb_band *band)
+{
+	struct redraw_context ctx = {
+		.interactive = true,
+		.background_images = true,
+		.plot = &fb_plotters,
+		.priv = band->surface
+	};
+	const struct fb_bands_entry *e;
+	const struct fb_bands_entry *end;
+	const int *p;
+	struct rect r;
+	nsfb_bbox_t loc;
+	bool skip = false;
+	unsigned int i;
+
+	/* operations are culled against the band in redraw coordinates */
+	int y0 = band->area.y0 - band->dy;
+	int y1 = band->area.y1 - band->dy;
+
+	fb_plotters.clip(&ctx, &band->area);
+
+	end = fb_bands_rec.entry + fb_bands_rec.entry_count;
+	for (e = fb_bands_rec.entry; e != end; e++) {
+		if (e->op == FB_BANDS_CLIP) {
+			/* libnsfb keeps the old clip if the new one is
+			 * outside the surface so skip until the next clip
+			 * instead */
+			r.x0 = max(e->u.rect.x0 + band->dx, band->area.x0);
+			r.y0 = max(e->u.rect.y0 + band->dy, band->area.y0);
+			r.x1 = min(e->u.rect.x1 + band->dx, band->area.x1);
+			r.y1 = min(e->u.rect.y1 + band->dy, band->area.y1);
+			skip = (r.x0 >= r.x1) || (r.y0 >= r.y1);
+			if (!skip) {
+				fb_plotters.clip(&ctx, &r);
+			}
+			continue;
+		}
+
+		if (skip || e->y1 <= y0 || e->y0 >= y1) {
+			continue;
+		}
+
+		switch (e->op) {
+		case FB_BANDS_ARC:
+			fb_plotters.arc(&ctx, &e->style,
+					e->u.arc.x + band->dx,
+					e->u.arc.y + band->dy,
+					e->u.arc.radius,
+					e->u.arc.angle1,
+					e->u.arc.angle2);
+			break;
+
+		case FB_BANDS_DISC:
+			fb_plotters.disc(&ctx, &e->style,
+					e->u.arc.x + band->dx,
+					e->u.arc.y + band->dy,
+					e->u.arc.radius);
+			break;
+
+		case FB_BANDS_LINE:
+		case FB_BANDS_RECTANGLE:
+			r.x0 = e->u.rect.x0 + band->dx;
+			r.y0 = e->u.rect.y0 + band->dy;
+			r.x1 = e->u.rect.x1 + band->dx;
+			r.y1 = e->u.rect.y1 + band->dy;
+			if (e->op == FB_BANDS_LINE) {
+				fb_plotters.line(&ctx, &e->style, &r);
+			} else {
+				fb_plotters.rectangle(&ctx, &e->style, &r);
+			}
+			break;
+
+		case FB_BANDS_POLYGON:
+			p = (const int *)(fb_bands_rec.data + e->u.polygon.p);
+			if (band->points != NULL) {
+				for (i = 0; i != e->u.polygon.n; i++) {
+					band->points[2 * i] = p[2 * i] +
+							band->dx;
+					band->points[2 * i + 1] =
+							p[2 * i + 1] +
+							band->dy;
+				}
+				p = band->points;
+			}
+			fb_plotters.polygon(&ctx, &e->style, p,
+					e->u.polygon.n);
+			break;
+
+		case FB_BANDS_BITMAP:
+			fb_plotters.bitmap(&ctx, e->u.bitmap.bitmap,
+					e->u.bitmap.x + band->dx,
+					e->u.bitmap.y + band->dy,
+					e->u.bitmap.width,
+					e->u.bitmap.height,
+					e->u.bitmap.bg,
+					e->u.bitmap.flags);
+			break;
+
+		case FB_BANDS_GLYPH:
+			loc.x0 = e->u.glyph.loc.x0 + band->dx;
+			loc.y0 = e->u.glyph.loc.y0 + band->dy;
+			loc.x1 = e->u.glyph.loc.x1 + band->dx;
+			loc.y1 = e->u.glyph.loc.y1 + band->dy;
+			if (e->u.glyph.mono) {
+				nsfb_plot_glyph1(band->surface, &loc,
+						fb_bands_rec.data +
+						e->u.glyph.p,
+						e->u.glyph.pitch,
+						e->u.glyph.colour);
+			} else {
+				nsfb_plot_glyph8(band->surface, &loc,
+						fb_bands_rec.data +
+						e->u.glyph.p,
+						e->u.glyph.pitch,
+						e->u.glyph.colour);
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+
+/**
+ * Replay the recorded operations directly to the redraw surface.
+ */
+static void fb_bands_replay_direct(void)
+{
+	struct fb_band band;
+
+	memset(&band, 0, sizeof(band));
+	band.surface = fb_bands_rec.nsfb;
+	band.area = fb_bands_rec.box;
+
+	fb_bands_replay(&band);
+}
+
+
+/**
+ * Render bands until none are left.
+ *
+ * Called with the pool lock held, which is released while rendering.
+ */
+static void fb_bands_work(void)
+{
+	int band;
+
+	while (fb_bands_pool.next < fb_bands_pool.count) {
+		band = fb_bands_pool.next++;
+		pthread_mutex_unlock(&fb_bands_pool.lock);
+
+		fb_bands_replay(&fb_bands[band]);
+
+		pthread_mutex_lock(&fb_bands_pool.lock);
+		if (--fb_bands_pool.pending == 0) {
+			pthread_cond_signal(&fb_bands_pool.done);
+		}
+	}
+}
+
+
+/**
+ * Rendering thread.
+ *
+ * \param arg unused.
+ * \return NULL
+ */
+static void *fb_bands_worker(void *arg)
+{
+	unsigned int generation;
+
+	pthread_mutex_lock(&fb_bands_pool.lock);
+	generation = fb_bands_pool.generation;
+	for (;;) {
+		while (!fb_bands_pool.quit &&
+		       fb_bands_pool.generation == generation) {
+			pthread_cond_wait(&fb_bands_pool.start,
+					&fb_bands_pool.lock);
+		}
+		if (fb_bands_pool.quit) {
+			break;
+		}
+		generation = fb_bands_pool.generation;
+
+		fb_bands_work();
+	}
+	pthread_mutex_unlock(&fb_bands_pool.lock);
+
+	return NULL;
+}
+
+
+/**
+ * Set up the bands for the recorded redraw.
+ *
+ * \param count The number of bands to split the redraw into.
+ * \return true on success, false if memory is exhausted.
+ */
+static bool fb_bands_layout(int count)
+{
+	struct fb_band *band;
+	int width = fb_bands_rec.box.x1 - fb_bands_rec.box.x0;
+	int height = fb_bands_rec.box.y1 - fb_bands_rec.box.y0;
+	int band_height = (height + count - 1) / count;
+	int y = fb_bands_rec.box.y0;
+	unsigned int points = fb_bands_rec.max_points * 2;
+	int *p;
+	int b;
+
+	for (b = 0; b != count; b++) {
+		band = &fb_bands[b];
+
+		/* surfaces are in the format of the redraw surface, so the
+		 * bands are copied without conversion. They are only ever
+		 * grown so one whose size changes is only reallocated when
+		 * it becomes larger */
+		if (band->surface == NULL ||
+		    band->format != fb_bands_rec.format ||
+		    band->width < width || band->height < band_height) {
+			if (band->surface != NULL) {
+				nsfb_free(band->surface);
+			}
+			band->width = max(width, band->width);
+			band->height = max(band_height, band->height);
+			band->format = fb_bands_rec.format;
+
+			band->surface = nsfb_new(NSFB_SURFACE_RAM);
+			if (band->surface == NULL) {
+				return false;
+			}
+			nsfb_set_geometry(band->surface,
+					band->width, band->height,
+					band->format);
+			if (nsfb_init(band->surface) == -1) {
+				nsfb_free(band->surface);
+				band->surface = NULL;
+				return false;
+			}
+		}
+
+		if (band->points_alloc < points) {
+			p = realloc(band->points, points * sizeof(*p));
+			if (p == NULL) {
+				return false;
+			}
+			band->points = p;
+			band->points_alloc = points;
+		}
+
+		band->dx = -fb_bands_rec.box.x0;
+		band->dy = -y;
+		band->area.x0 = 0;
+		band->area.y0 = 0;
+		band->area.x1 = width;
+		band->area.y1 = min(band_height, fb_bands_rec.box.y1 - y);
+
+		y += band_height;
+	}
+
+	return true;
+}
+
+
+/**
+ * Record an operation.
+ *
+ * \param op The operation.
+ * \param y0 The first row the operation can touch.
+ * \param y1 The row after the last the operation can touch.
+ * \param entry Updated to the entry to fill in, or NULL if the operation
+ *               is entirely clipped.
+ * \return true if the operation is recorded, false if it must be
+ *          plotted directly.
+ */
+static bool
+fb_bands_record(enum fb_bands_op op, int y0, int y1,
+		struct fb_bands_entry **entry)
+{
+	struct fb_bands_entry *e;
+	unsigned int alloc;
+
+	if (fb_bands_rec.direct) {
+		return false;
+	}
+
+	*entry = NULL;
+
+	if (op != FB_BANDS_CLIP) {
+		y0 = max(y0, fb_bands_rec.clip.y0);
+		y1 = min(y1, fb_bands_rec.clip.y1);
+		if (y0 >= y1) {
+			return true;
+		}
+	}
+
+	if (fb_bands_rec.entry_count == fb_bands_rec.entry_alloc) {
+		alloc = fb_bands_rec.entry_alloc * 2;
+		if (alloc == 0) {
+			alloc = 1024;
+		}
+		e = realloc(fb_bands_rec.entry, alloc * sizeof(*e));
+		if (e == NULL) {
+			NSLOG(netsurf, INFO, "plotting redraw directly");
+			fb_bands_replay_direct();
+			fb_bands_rec.direct = true;
+			return false;
+		}
+		fb_bands_rec.entry = e;
+		fb_bands_rec.entry_alloc = alloc;
+	}
+
+	e = &fb_bands_rec.entry[fb_bands_rec.entry_count++];
+	e->op = op;
+	e->y0 = y0;
+	e->y1 = y1;
+	*entry = e;
+
+	return true;
+}
+
+
+/**
+ * Store data for the last recorded operation.
+ *
+ * On failure the recording, including the last operation, is plotted
+ *  directly so the caller must plot the data itself.
+ *
+ * \param size The number of bytes to store.
+ * \param data The data to store.
+ * \param offset Updated to the offset of the data in the arena.
+ * \return true on success, false if memory is exhausted.
+ */
+static bool fb_bands_store(size_t size, const void *data, size_t *offset)
+{
+	size_t used = (fb_bands_rec.data_used + FB_BANDS_ALIGN - 1) &
+			~(size_t)(FB_BANDS_ALIGN - 1);
+	size_t alloc;
+	uint8_t *d;
+
+	if (used + size > fb_bands_rec.data_alloc) {
+		alloc = max(fb_bands_rec.data_alloc * 2, used + size);
+		alloc = max(alloc, (size_t)65536);
+		d = realloc(fb_bands_rec.data, alloc);
+		if (d == NULL) {
+			NSLOG(netsurf, INFO, "plotting redraw directly");
+			fb_bands_rec.entry_count--;
+			fb_bands_replay_direct();
+			fb_bands_rec.direct = true;
+			return false;
+		}
+		fb_bands_rec.data = d;
+		fb_bands_rec.data_alloc = alloc;
+	}
+
+	memcpy(fb_bands_rec.data + used, data, size);
+	fb_bands_rec.data_used = used + size;
+	*offset = used;
+
+	return true;
+}
+
+
+/**
+ * Record a clip rectangle change.
+ *
+ * \param ctx The current redraw context.
+ * \param clip The rectangle to limit all subsequent plot
+ *              operations within.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+fb_bands_clip(const struct redraw_context *ctx, const struct rect *clip)
+{
+	struct fb_bands_entry *e;
+
+	if (!fb_bands_record(FB_BANDS_CLIP, clip->y0, clip->y1, &e)) {
+		return fb_plotters.clip(ctx, clip);
+	}
+	e->u.rect = *clip;
+	fb_bands_rec.clip = *clip;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Record an arc.
+ *
+ * \param ctx The current redraw context.
+ * \param style Style controlling the arc plot.
+ * \param x The x coordinate of the arc.
+ * \param y The y coordinate of the arc.
+ * \param radius The radius of the arc.
+ * \param angle1 The start angle of the arc.
+ * \param angle2 The finish angle of the arc.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+fb_bands_arc(const struct redraw_context *ctx,
+		const plot_style_t *style,
+		int x, int y, int radius, int angle1, int angle2)
+{
+	struct fb_bands_entry *e;
+
+	if (!fb_bands_record(FB_BANDS_ARC,
+			y - radius - 1, y + radius + 2, &e)) {
+		return fb_plotters.arc(ctx, style,
+				x, y, radius, angle1, angle2);
+	}
+	if (e != NULL) {
+		e->style = *style;
+		e->u.arc.x = x;
+		e->u.arc.y = y;
+		e->u.arc.radius = radius;
+		e->u.arc.angle1 = angle1;
+		e->u.arc.angle2 = angle2;
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Record a circle.
+ *
+ * \param ctx The current redraw context.
+ * \param style Style controlling the circle plot.
+ * \param x x coordinate of circle centre.
+ * \param y y coordinate of circle centre.
+ * \param radius circle radius.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+fb_bands_disc(const struct redraw_context *ctx,
+		const plot_style_t *style,
+		int x, int y, int radius)
+{
+	struct fb_bands_entry *e;
+
+	if (!fb_bands_record(FB_BANDS_DISC,
+			y - radius - 1, y + radius + 2, &e)) {
+		return fb_plotters.disc(ctx, style, x, y, radius);
+	}
+	if (e != NULL) {
+		e->style = *style;
+		e->u.arc.x = x;
+		e->u.arc.y = y;
+		e->u.arc.radius = radius;
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Record a line.
+ *
+ * \param ctx The current redraw context.
+ * \param style Style controlling the line plot.
+ * \param line A rectangle defining the line to be drawn
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+fb_bands_line(const struct redraw_context *ctx,
+		const plot_style_t *style,
+		const struct rect *line)
+{
+	struct fb_bands_entry *e;
+	int width = plot_style_fixed_to_int(style->stroke_width) + 1;
+
+	if (!fb_bands_record(FB_BANDS_LINE,
+			min(line->y0, line->y1) - width,
+			max(line->y0, line->y1) + width + 1, &e)) {
+		return fb_plotters.line(ctx, style, line);
+	}
+	if (e != NULL) {
+		e->style = *style;
+		e->u.rect = *line;
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Record a rectangle.
+ *
+ * \param ctx The current redraw context.
+ * \param style Style controlling the rectangle plot.
+ * \param rect A rectangle defining the line to be drawn
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+fb_bands_rectangle(const struct redraw_context *ctx,
+		const plot_style_t *style,
+		const struct rect *rect)
+{
+	struct fb_bands_entry *e;
+	int width = 0;
+
+	if (style->stroke_type != PLOT_OP_TYPE_NONE) {
+		width = plot_style_fixed_to_int(style->stroke_width) + 1;
+	}
+
+	if (!fb_bands_record(FB_BANDS_RECTANGLE,
+			rect->y0 - width, rect->y1 + width + 1, &e)) {
+		return fb_plotters.rectangle(ctx, style, rect);
+	}
+	if (e != NULL) {
+		e->style = *style;
+		e->u.rect = *rect;
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Record a polygon.
+ *
+ * \param ctx The current redraw context.
+ * \param style Style controlling the polygon plot.
+ * \param p verticies of polygon
+ * \param n number of verticies.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+fb_bands_polygon(const struct redraw_context *ctx,
+		const plot_style_t *style,
+		const int *p,
+		unsigned int n)
+{
+	struct fb_bands_entry *e;
+	int y0 = INT_MAX;
+	int y1 = INT_MIN;
+	unsigned int i;
+
+	for (i = 0; i != n; i++) {
+		y0 = min(y0, p[2 * i + 1]);
+		y1 = max(y1, p[2 * i + 1]);
+	}
+
+	if (!fb_bands_record(FB_BANDS_POLYGON, y0, y1 + 1, &e)) {
+		return fb_plotters.polygon(ctx, style, p, n);
+	}
+	if (e != NULL) {
+		if (!fb_bands_store(n * 2 * sizeof(*p), p,
+				&e->u.polygon.p)) {
+			return fb_plotters.polygon(ctx, style, p, n);
+		}
+		e->style = *style;
+		e->u.polygon.n = n;
+		fb_bands_rec.max_points = max(fb_bands_rec.max_points, n);
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Record a path.
+ *
+ * Paths are not implemented by the framebuffer plotters so are passed
+ *  straight through.
+ *
+ * \param ctx The current redraw context.
+ * \param pstyle Style controlling the path plot.
+ * \param p elements of path
+ * \param n nunber of elements on path
+ * \param transform A transform to apply to the path.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+fb_bands_path(const struct redraw_context *ctx,
+		const plot_style_t *pstyle,
+		const float *p,
+		unsigned int n,
+		const float transform[6])
+{
+	return fb_plotters.path(ctx, pstyle, p, n, transform);
+}
+
+
+/**
+ * Record a bitmap.
+ *
+ * The bitmap itself is not copied, it must remain unchanged until the
+ *  recording is rendered.
+ *
+ * \param ctx The current redraw context.
+ * \param bitmap The bitmap to plot
+ * \param x The x coordinate to plot the bitmap
+ * \param y The y coordiante to plot the bitmap
+ * \param width The width of area to plot the bitmap into
+ * \param height The height of area to plot the bitmap into
+ * \param bg the background colour to alpha blend into
+ * \param flags the flags controlling the type of plot operation
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+fb_bands_bitmap(const struct redraw_context *ctx,
+		struct bitmap *bitmap,
+		int x, int y,
+		int width,
+		int height,
+		colour bg,
+		bitmap_flags_t flags)
+{
+	struct fb_bands_entry *e;
+	int y0 = y;
+	int y1 = y + height;
+
+	/* repeated bitmaps may fill the whole clip rectangle */
+	if (flags & (BITMAPF_REPEAT_X | BITMAPF_REPEAT_Y)) {
+		y0 = fb_bands_rec.clip.y0;
+		y1 = fb_bands_rec.clip.y1;
+	}
+
+	if (!fb_bands_record(FB_BANDS_BITMAP, y0, y1, &e)) {
+		return fb_plotters.bitmap(ctx, bitmap,
+				x, y, width, height, bg, flags);
+	}
+	if (e != NULL) {
+		e->u.bitmap.bitmap = bitmap;
+		e->u.bitmap.x = x;
+		e->u.bitmap.y = y;
+		e->u.bitmap.width = width;
+		e->u.bitmap.height = height;
+		e->u.bitmap.bg = bg;
+		e->u.bitmap.flags = flags;
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Record one glyph of a string.
+ *
+ * \param pw The colour of the text.
+ * \param loc The area covered by the glyph.
+ * \param pixels The glyph image.
+ * \param pitch The row pitch of the glyph image.
+ * \param size The size of the glyph image in bytes.
+ * \param mono true if the glyph image is one bit per pixel.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+fb_bands_glyph(void *pw,
+		const nsfb_bbox_t *loc,
+		const uint8_t *pixels,
+		int pitch,
+		size_t size,
+		bool mono)
+{
+	nsfb_colour_t colour = *(nsfb_colour_t *)pw;
+	struct fb_bands_entry *e;
+
+	if (fb_bands_record(FB_BANDS_GLYPH, loc->y0, loc->y1, &e)) {
+		if (e == NULL) {
+			return NSERROR_OK;
+		}
+		if (fb_bands_store(size, pixels, &e->u.glyph.p)) {
+			e->u.glyph.loc = *loc;
+			e->u.glyph.pitch = pitch;
+			e->u.glyph.mono = mono;
+			e->u.glyph.colour = colour;
+			return NSERROR_OK;
+		}
+	}
+
+	if (mono) {
+		nsfb_plot_glyph1(fb_bands_rec.nsfb, (nsfb_bbox_t *)loc,
+				pixels, pitch, colour);
+	} else {
+		nsfb_plot_glyph8(fb_bands_rec.nsfb, (nsfb_bbox_t *)loc,
+				pixels, pitch, colour);
+	}
+	return NSERROR_OK;
+}
+
+
+/**
+ * Record text.
+ *
+ * \param ctx The current redraw context.
+ * \param fstyle plot style for this text
+ * \param x x coordinate
+ * \param y y coordinate
+ * \param text UTF-8 string to plot
+ * \param length length of string, in bytes
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+fb_bands_text(const struct redraw_context *ctx,
+		const struct plot_font_style *fstyle,
+		int x,
+		int y,
+		const char *text,
+		size_t length)
+{
+	nsfb_colour_t colour = fstyle->foreground;
+
+	if (fb_bands_rec.direct) {
+		return fb_plotters.text(ctx, fstyle, x, y, text, length);
+	}
+
+	return framebuffer_text_glyphs(fstyle, x, y, text, length,
+			fb_bands_glyph, &colour);
+}
+
+
+/** plot operation table recording for band rendering */
+static const struct plotter_table fb_bands_plotters = {
+	.clip = fb_bands_clip,
+	.arc = fb_bands_arc,
+	.disc = fb_bands_disc,
+	.line = fb_bands_line,
+	.rectangle = fb_bands_rectangle,
+	.polygon = fb_bands_polygon,
+	.path = fb_bands_path,
+	.bitmap = fb_bands_bitmap,
+	.text = fb_bands_text,
+	.option_knockout = true,
+};
+
+
+/* exported function documented in framebuffer/bands.h */
+bool
+fb_bands_start(nsfb_t *nsfb, struct redraw_context *ctx, const struct rect *clip)
+{
+	int width;
+	int height;
+
+	if (fb_bands_threads() < 2 ||
+	    clip->y1 - clip->y0 < 2 * FB_BANDS_MIN_HEIGHT ||
+	    clip->x1 <= clip->x0) {
+		return false;
+	}
+
+	nsfb_get_geometry(nsfb, &width, &height, &fb_bands_rec.format);
+
+	fb_bands_rec.nsfb = nsfb;
+	fb_bands_rec.box.x0 = max(clip->x0, 0);
+	fb_bands_rec.box.y0 = max(clip->y0, 0);
+	fb_bands_rec.box.x1 = min(clip->x1, width);
+	fb_bands_rec.box.y1 = min(clip->y1, height);
+	fb_bands_rec.clip = fb_bands_rec.box;
+	fb_bands_rec.direct = false;
+	fb_bands_rec.entry_count = 0;
+	fb_bands_rec.data_used = 0;
+	fb_bands_rec.max_points = 0;
+
+	ctx->plot = &fb_bands_plotters;
+
+	return true;
+}
+
+
+/* exported function documented in framebuffer/bands.h */
+nserror fb_bands_end(struct redraw_context *ctx)
+{
+	nsfb_bbox_t clip;
+	nsfb_bbox_t box;
+	nsfb_bbox_t loc;
+	nsfb_bbox_t area;
+	int threads;
+	int count;
+	int b;
+
+	ctx->plot = &fb_plotters;
+
+	if (fb_bands_rec.direct) {
+		return NSERROR_OK;
+	}
+
+	threads = fb_bands_threads();
+	count = min(threads, (fb_bands_rec.box.y1 - fb_bands_rec.box.y0) /
+			FB_BANDS_MIN_HEIGHT);
+
+	pthread_mutex_lock(&fb_bands_pool.lock);
+	while (fb_bands_pool.threads < threads - 1) {
+		if (pthread_create(&fb_bands_pool.thread[fb_bands_pool.threads],
+				NULL, fb_bands_worker, NULL) != 0) {
+			NSLOG(netsurf, INFO, "unable to start render thread");
+			break;
+		}
+		fb_bands_pool.threads++;
+	}
+	pthread_mutex_unlock(&fb_bands_pool.lock);
+
+	if (fb_bands_pool.threads == 0 || count < 2 ||
+	    !fb_bands_layout(count)) {
+		fb_bands_replay_direct();
+		return NSERROR_OK;
+	}
+
+	pthread_mutex_lock(&fb_bands_pool.lock);
+	fb_bands_pool.next = 0;
+	fb_bands_pool.count = count;
+	fb_bands_pool.pending = count;
+	fb_bands_pool.generation++;
+	pthread_cond_broadcast(&fb_bands_pool.start);
+
+	fb_bands_work();
+	while (fb_bands_pool.pending != 0) {
+		pthread_cond_wait(&fb_bands_pool.done, &fb_bands_pool.lock);
+	}
+	pthread_mutex_unlock(&fb_bands_pool.lock);
+
+	/* copy the bands to the redraw surface, leaving the caller's clip
+	 * rectangle as it was */
+	nsfb_plot_get_clip(fb_bands_rec.nsfb, &clip);
+
+	box.x0 = fb_bands_rec.box.x0;
+	box.y0 = fb_bands_rec.box.y0;
+	box.x1 = fb_bands_rec.box.x1;
+	box.y1 = fb_bands_rec.box.y1;
+	nsfb_plot_set_clip(fb_bands_rec.nsfb, &box);
+
+	for (b = 0; b != count; b++) {
+		area.x0 = fb_bands[b].area.x0;
+		area.y0 = fb_bands[b].area.y0;
+		area.x1 = fb_bands[b].area.x1;
+		area.y1 = fb_bands[b].area.y1;
+
+		loc.x0 = area.x0 - fb_bands[b].dx;
+		loc.y0 = area.y0 - fb_bands[b].dy;
+		loc.x1 = area.x1 - fb_bands[b].dx;
+		loc.y1 = area.y1 - fb_bands[b].dy;
+
+		nsfb_plot_copy(fb_bands[b].surface, &area,
+				fb_bands_rec.nsfb, &loc);
+	}
+
+	nsfb_plot_set_clip(fb_bands_rec.nsfb, &clip);
+
+	return NSERROR_OK;
+}
+
+
+/* exported function documented in framebuffer/bands.h */
+void fb_bands_finalise(void)
+{
+	int b;
+
+	pthread_mutex_lock(&fb_bands_pool.lock);
+	fb_bands_pool.quit = true;
+	pthread_cond_broadcast(&fb_bands_pool.start);
+	pthread_mutex_unlock(&fb_bands_pool.lock);
+
+	for (b = 0; b != fb_bands_pool.threads; b++) {
+		pthread_join(fb_bands_pool.thread[b], NULL);
+	}
+	fb_bands_pool.threads = 0;
+
+	for (b = 0; b != FB_BANDS_MAX; b++) {
+		if (fb_bands[b].surface != NULL) {
+			nsfb_free(fb_bands[b].surface);
+		}
+		free(fb_bands[b].points);
+	}
+	memset(fb_bands, 0, sizeof(fb_bands));
+
+	free(fb_bands_rec.entry);
+	free(fb_bands_rec.data);
+	memset(&fb_bands_rec, 0, sizeof(fb_bands_rec));
+}
+
+#else
+
+/* exported function documented in framebuffer/bands.h */
+bool
+fb_bands_start(nsfb_t *nsfb, struct redraw_context *ctx, const struct rect *clip)
+{
+	return false;
+}
+
+/* exported function documented in framebuffer/bands.h */
+nserror fb_bands_end(struct redraw_context *ctx)
+{
+	return NSERROR_OK;
+}
+
+/* exported function documented in framebuffer/bands.h */
+void fb_bands_finalise(void)
+{
+}
+
+#endif
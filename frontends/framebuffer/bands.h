@@ -0,0 +1,69 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Framebuffer band rendering interface.
+ *
+ * A redraw of a large area is recorded rather than plotted, then the
+ *  recording is rasterised in horizontal bands by a pool of threads, each
+ *  band into its own surface, and the bands copied to the screen once
+ *  they are all complete.
+ */
+
+#ifndef NETSURF_FB_BANDS_H
+#define NETSURF_FB_BANDS_H
+
+struct redraw_context;
+struct rect;
+
+/**
+ * Start recording a redraw for rendering in bands.
+ *
+ * If the redraw is to be recorded the plot operation table of the redraw
+ *  context is replaced, and fb_bands_end() must be called once the redraw
+ *  is complete.
+ *
+ * \param nsfb The surface the redraw is for.
+ * \param ctx The redraw context to record.
+ * \param clip The area being redrawn.
+ * \return true if the redraw is being recorded, false if it should be
+ *          plotted directly.
+ */
+bool fb_bands_start(nsfb_t *nsfb, struct redraw_context *ctx, const struct rect *clip);
+
+/**
+ * Render a recorded redraw.
+ *
+ * Rasterises the redraw recorded since fb_bands_start() and copies it to
+ *  the surface. The plot operation table of the redraw context is
+ *  restored.
+ *
+ * \param ctx The redraw context passed to fb_bands_start().
+ * \return NSERROR_OK on success else error code.
+ */
+nserror fb_bands_end(struct redraw_context *ctx);
+
+/**
+ * Finalise band rendering.
+ *
+ * Stops the rendering threads and releases all resources.
+ */
+void fb_bands_finalise(void);
+
+#endif
@@ -44,6 +44,31 @@
 /* netsurf framebuffer library handle */
 static nsfb_t *nsfb;
 
+/** surface and colour glyphs are plotted with */
+struct framebuffer_glyph_plot {
+	nsfb_t *surface;
+	nsfb_colour_t colour;
+};
+
+
+/**
+ * Get the surface plot operations render to.
+ *
+ * The redraw context private pointer may select a surface other than
+ *  the current one, which allows plots to several surfaces to proceed
+ *  at the same time.
+ *
+ * \param ctx The current redraw context.
+ * \return The surface to plot to.
+ */
+static inline nsfb_t *framebuffer_surface(const struct redraw_context *ctx)
+{
+	if (ctx->priv != NULL) {
+		return ctx->priv;
+	}
+	return nsfb;
+}
+
 
 /**
  * \brief Sets a clip rectangle for subsequent plot operations.
@@ -56,13 +81,15 @@ static nsfb_t *nsfb;
 static nserror
 framebuffer_plot_clip(const struct redraw_context *ctx, const struct rect *clip)
 {
+	nsfb_t *surface = framebuffer_surface(ctx);
 	nsfb_bbox_t nsfb_clip;
+
 	nsfb_clip.x0 = clip->x0;
 	nsfb_clip.y0 = clip->y0;
 	nsfb_clip.x1 = clip->x1;
 	nsfb_clip.y1 = clip->y1;
 
-	if (!nsfb_plot_set_clip(nsfb, &nsfb_clip)) {
+	if (!nsfb_plot_set_clip(surface, &nsfb_clip)) {
 		return NSERROR_INVALID;
 	}
 	return NSERROR_OK;
@@ -90,7 +117,9 @@ framebuffer_plot_arc(const struct redraw_context *ctx,
 	       const plot_style_t *style,
 	       int x, int y, int radius, int angle1, int angle2)
 {
-	if (!nsfb_plot_arc(nsfb, x, y, radius, angle1, angle2, style->fill_colour)) {
+	nsfb_t *surface = framebuffer_surface(ctx);
+
+	if (!nsfb_plot_arc(surface, x, y, radius, angle1, angle2, style->fill_colour)) {
 		return NSERROR_INVALID;
 	}
 	return NSERROR_OK;
@@ -114,18 +143,20 @@ framebuffer_plot_disc(const struct redraw_context *ctx,
 		const plot_style_t *style,
 		int x, int y, int radius)
 {
+	nsfb_t *surface = framebuffer_surface(ctx);
 	nsfb_bbox_t ellipse;
+
 	ellipse.x0 = x - radius;
 	ellipse.y0 = y - radius;
 	ellipse.x1 = x + radius;
 	ellipse.y1 = y + radius;
 
 	if (style->fill_type != PLOT_OP_TYPE_NONE) {
-		nsfb_plot_ellipse_fill(nsfb, &ellipse, style->fill_colour);
+		nsfb_plot_ellipse_fill(surface, &ellipse, style->fill_colour);
 	}
 
 	if (style->stroke_type != PLOT_OP_TYPE_NONE) {
-		nsfb_plot_ellipse(nsfb, &ellipse, style->stroke_colour);
+		nsfb_plot_ellipse(surface, &ellipse, style->stroke_colour);
 	}
 	return NSERROR_OK;
 }
@@ -147,6 +178,7 @@ framebuffer_plot_line(const struct redraw_context *ctx,
 		const plot_style_t *style,
 		const struct rect *line)
 {
+	nsfb_t *surface = framebuffer_surface(ctx);
 	nsfb_bbox_t rect;
 	nsfb_plot_pen_t pen;
 
@@ -169,7 +201,7 @@ framebuffer_plot_line(const struct redraw_context *ctx,
 
 		pen.stroke_colour = style->stroke_colour;
 		pen.stroke_width = plot_style_fixed_to_int(style->stroke_width);
-		nsfb_plot_line(nsfb, &rect, &pen);
+		nsfb_plot_line(surface, &rect, &pen);
 	}
 
 	return NSERROR_OK;
@@ -194,6 +226,7 @@ framebuffer_plot_rectangle(const struct redraw_context *ctx,
 		     const plot_style_t *style,
 		     const struct rect *nsrect)
 {
+	nsfb_t *surface = framebuffer_surface(ctx);
 	nsfb_bbox_t rect;
 	bool dotted = false;
 	bool dashed = false;
@@ -204,7 +237,7 @@ framebuffer_plot_rectangle(const struct redraw_context *ctx,
 	rect.y1 = nsrect->y1;
 
 	if (style->fill_type != PLOT_OP_TYPE_NONE) {
-		nsfb_plot_rectangle_fill(nsfb, &rect, style->fill_colour);
+		nsfb_plot_rectangle_fill(surface, &rect, style->fill_colour);
 	}
 
 	if (style->stroke_type != PLOT_OP_TYPE_NONE) {
@@ -216,7 +249,7 @@ framebuffer_plot_rectangle(const struct redraw_context *ctx,
 			dashed = true;
 		}
 
-		nsfb_plot_rectangle(nsfb, &rect,
+		nsfb_plot_rectangle(surface, &rect,
 				plot_style_fixed_to_int(style->stroke_width),
 				style->stroke_colour, dotted, dashed);
 	}
@@ -244,7 +277,9 @@ framebuffer_plot_polygon(const struct redraw_context *ctx,
 		   const int *p,
 		   unsigned int n)
 {
-	if (!nsfb_plot_polygon(nsfb, p, n, style->fill_colour)) {
+	nsfb_t *surface = framebuffer_surface(ctx);
+
+	if (!nsfb_plot_polygon(surface, p, n, style->fill_colour)) {
 		return NSERROR_INVALID;
 	}
 	return NSERROR_OK;
@@ -319,6 +354,7 @@ framebuffer_plot_bitmap(const struct redraw_context *ctx,
 	enum nsfb_format_e bmformat;
 	unsigned char *bmptr;
 	nsfb_t *bm = (nsfb_t *)bitmap;
+	nsfb_t *surface = framebuffer_surface(ctx);
 
 	/* x and y define coordinate of top left of of the initial explicitly
 	 * placed tile. The width and height are the image scaling and the
@@ -333,13 +369,13 @@ framebuffer_plot_bitmap(const struct redraw_context *ctx,
 		loc.x1 = loc.x0 + width;
 		loc.y1 = loc.y0 + height;
 
-		if (!nsfb_plot_copy(bm, NULL, nsfb, &loc)) {
+		if (!nsfb_plot_copy(bm, NULL, surface, &loc)) {
 			return NSERROR_INVALID;
 		}
 		return NSERROR_OK;
 	}
 
-	nsfb_plot_get_clip(nsfb, &clipbox);
+	nsfb_plot_get_clip(surface, &clipbox);
 	nsfb_get_geometry(bm, &bmwidth, &bmheight, &bmformat);
 	nsfb_get_buffer(bm, &bmptr, &bmstride);
 
@@ -347,7 +383,7 @@ framebuffer_plot_bitmap(const struct redraw_context *ctx,
 	 * of the area.  Can only be done when image is fully opaque. */
 	if ((bmwidth == 1) && (bmheight == 1)) {
 		if ((*(nsfb_colour_t *)bmptr & 0xff000000) != 0) {
-			if (!nsfb_plot_rectangle_fill(nsfb, &clipbox,
+			if (!nsfb_plot_rectangle_fill(surface, &clipbox,
 						      *(nsfb_colour_t *)bmptr)) {
 				return NSERROR_INVALID;
 			}
@@ -362,7 +398,7 @@ framebuffer_plot_bitmap(const struct redraw_context *ctx,
 		if (framebuffer_bitmap_get_opaque(bm)) {
 			/** TODO: Currently using top left pixel. Maybe centre
 			 *        pixel or average value would be better. */
-			if (!nsfb_plot_rectangle_fill(nsfb, &clipbox,
+			if (!nsfb_plot_rectangle_fill(surface, &clipbox,
 						      *(nsfb_colour_t *)bmptr)) {
 				return NSERROR_INVALID;
 			}
@@ -387,7 +423,7 @@ framebuffer_plot_bitmap(const struct redraw_context *ctx,
 	loc.y1 = loc.y0 + height;
 
 	/* plot tiling across and down to extents */
-	nsfb_plot_bitmap_tiles(nsfb, &loc,
+	nsfb_plot_bitmap_tiles(surface, &loc,
 			repeat_x ? ((clipbox.x1 - x) + width  - 1) / width  : 1,
 			repeat_y ? ((clipbox.y1 - y) + height - 1) / height : 1,
 			(nsfb_colour_t *)bmptr, bmwidth, bmheight,
@@ -398,30 +434,22 @@ framebuffer_plot_bitmap(const struct redraw_context *ctx,
 
 
 #ifdef FB_USE_FREETYPE
-/**
- * Text plotting.
- *
- * \param ctx The current redraw context.
- * \param fstyle plot style for this text
- * \param x x coordinate
- * \param y y coordinate
- * \param text UTF-8 string to plot
- * \param length length of string, in bytes
- * \return NSERROR_OK on success else error code.
- */
-static nserror
-framebuffer_plot_text(const struct redraw_context *ctx,
-		const struct plot_font_style *fstyle,
+/* exported function documented in framebuffer/framebuffer.h */
+nserror
+framebuffer_text_glyphs(const struct plot_font_style *fstyle,
 		int x,
 		int y,
 		const char *text,
-		size_t length)
+		size_t length,
+		framebuffer_glyph_cb cb,
+		void *pw)
 {
 	uint32_t ucs4;
 	size_t nxtchr = 0;
 	FT_Glyph glyph;
 	FT_BitmapGlyph bglyph;
 	nsfb_bbox_t loc;
+	nserror res;
 
 	while (nxtchr < length) {
 		ucs4 = utf8_to_ucs4(text + nxtchr, length - nxtchr);
@@ -439,19 +467,15 @@ framebuffer_plot_text(const struct redraw_context *ctx,
 			loc.x1 = loc.x0 + bglyph->bitmap.width;
 			loc.y1 = loc.y0 + bglyph->bitmap.rows;
 
-			/* now, draw to our target surface */
-			if (bglyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO) {
-			    nsfb_plot_glyph1(nsfb,
-					     &loc,
-					     bglyph->bitmap.buffer,
-					     bglyph->bitmap.pitch,
-					     fstyle->foreground);
-			} else {
-			    nsfb_plot_glyph8(nsfb,
-					     &loc,
-					     bglyph->bitmap.buffer,
-					     bglyph->bitmap.pitch,
-					     fstyle->foreground);
+			res = cb(pw, &loc,
+				 bglyph->bitmap.buffer,
+				 bglyph->bitmap.pitch,
+				 (size_t)bglyph->bitmap.pitch *
+				 bglyph->bitmap.rows,
+				 bglyph->bitmap.pixel_mode ==
+				 FT_PIXEL_MODE_MONO);
+			if (res != NSERROR_OK) {
+				return res;
 			}
 		}
 		x += glyph->advance.x >> 16;
@@ -463,6 +487,91 @@ framebuffer_plot_text(const struct redraw_context *ctx,
 
 #else
 
+/* exported function documented in framebuffer/framebuffer.h */
+nserror
+framebuffer_text_glyphs(const struct plot_font_style *fstyle,
+		int x,
+		int y,
+		const char *text,
+		size_t length,
+		framebuffer_glyph_cb cb,
+		void *pw)
+{
+	enum fb_font_style style = fb_get_font_style(fstyle);
+	int size = fb_get_font_size(fstyle);
+	const uint8_t *chrp;
+	size_t nxtchr = 0;
+	nsfb_bbox_t loc;
+	uint32_t ucs4;
+	int p = FB_FONT_PITCH * size;
+	int w = FB_FONT_WIDTH * size;
+	int h = FB_FONT_HEIGHT * size;
+	nserror res;
+
+	y -= ((h * 3) / 4);
+	/* the coord is the bottom-left of the pixels offset by 1 to make
+	 * it work since fb coords are the top-left of pixels */
+	y += 1;
+
+	while (nxtchr < length) {
+		ucs4 = utf8_to_ucs4(text + nxtchr, length - nxtchr);
+		nxtchr = utf8_next(text, length, nxtchr);
+
+		if (!codepoint_displayable(ucs4))
+			continue;
+
+		loc.x0 = x;
+		loc.y0 = y;
+		loc.x1 = loc.x0 + w;
+		loc.y1 = loc.y0 + h;
+
+		chrp = fb_get_glyph(ucs4, style, size);
+		res = cb(pw, &loc, chrp, p, (size_t)(w / 8) * h, true);
+		if (res != NSERROR_OK) {
+			return res;
+		}
+
+		x += w;
+
+	}
+
+	return NSERROR_OK;
+}
+#endif
+
+
+/**
+ * Plot one glyph of a string to a surface.
+ *
+ * \param pw The surface and colour to plot with.
+ * \param loc The area covered by the glyph.
+ * \param pixels The glyph image.
+ * \param pitch The row pitch of the glyph image.
+ * \param size The size of the glyph image in bytes.
+ * \param mono true if the glyph image is one bit per pixel.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+framebuffer_plot_glyph(void *pw,
+		const nsfb_bbox_t *loc,
+		const uint8_t *pixels,
+		int pitch,
+		size_t size,
+		bool mono)
+{
+	const struct framebuffer_glyph_plot *gp = pw;
+
+	if (mono) {
+		nsfb_plot_glyph1(gp->surface, (nsfb_bbox_t *)loc,
+				pixels, pitch, gp->colour);
+	} else {
+		nsfb_plot_glyph8(gp->surface, (nsfb_bbox_t *)loc,
+				pixels, pitch, gp->colour);
+	}
+	return NSERROR_OK;
+}
+
+
 /**
  * Text plotting.
  *
@@ -482,43 +591,14 @@ framebuffer_plot_text(const struct redraw_context *ctx,
 		const char *text,
 		size_t length)
 {
-    enum fb_font_style style = fb_get_font_style(fstyle);
-    int size = fb_get_font_size(fstyle);
-    const uint8_t *chrp;
-    size_t nxtchr = 0;
-    nsfb_bbox_t loc;
-    uint32_t ucs4;
-    int p = FB_FONT_PITCH * size;
-    int w = FB_FONT_WIDTH * size;
-    int h = FB_FONT_HEIGHT * size;
-
-    y -= ((h * 3) / 4);
-    /* the coord is the bottom-left of the pixels offset by 1 to make
-     * it work since fb coords are the top-left of pixels */
-    y += 1;
-
-    while (nxtchr < length) {
-	ucs4 = utf8_to_ucs4(text + nxtchr, length - nxtchr);
-	nxtchr = utf8_next(text, length, nxtchr);
-
-	if (!codepoint_displayable(ucs4))
-		continue;
-
-	loc.x0 = x;
-	loc.y0 = y;
-	loc.x1 = loc.x0 + w;
-	loc.y1 = loc.y0 + h;
+	struct framebuffer_glyph_plot gp;
 
-	chrp = fb_get_glyph(ucs4, style, size);
-	nsfb_plot_glyph1(nsfb, &loc, chrp, p, fstyle->foreground);
+	gp.surface = framebuffer_surface(ctx);
+	gp.colour = fstyle->foreground;
 
-	x += w;
-
-    }
-
-    return NSERROR_OK;
+	return framebuffer_text_glyphs(fstyle, x, y, text, length,
+			framebuffer_plot_glyph, &gp);
 }
-#endif
 
 
 /** framebuffer plot operation table */
@@ -37,4 +37,38 @@ bool framebuffer_set_cursor(struct fbtk_bitmap *bm);
  */
 nsfb_t *framebuffer_set_surface(nsfb_t *new_nsfb);
 
+/**
+ * Callback for each glyph of a string.
+ *
+ * \param pw The client data passed to framebuffer_text_glyphs.
+ * \param loc The area covered by the glyph.
+ * \param pixels The glyph image, valid only for the duration of the call.
+ * \param pitch The row pitch of the glyph image as expected by libnsfb.
+ * \param size The size of the glyph image in bytes.
+ * \param mono true if the glyph image is one bit per pixel, false if
+ *              it is eight.
+ * \return NSERROR_OK to continue else error code to stop.
+ */
+typedef nserror (*framebuffer_glyph_cb)(void *pw, const nsfb_bbox_t *loc,
+		const uint8_t *pixels, int pitch, size_t size, bool mono);
+
+/**
+ * Lay out the glyphs of a string.
+ *
+ * Looks up each glyph of a string in the font and passes it to a
+ *  callback at the position the text plotter would draw it.
+ *
+ * \param fstyle plot style for this text
+ * \param x x coordinate
+ * \param y y coordinate
+ * \param text UTF-8 string to plot
+ * \param length length of string, in bytes
+ * \param cb callback for each glyph
+ * \param pw client data passed to cb
+ * \return NSERROR_OK on success else the error returned by cb.
+ */
+nserror framebuffer_text_glyphs(const struct plot_font_style *fstyle,
+		int x, int y, const char *text, size_t length,
+		framebuffer_glyph_cb cb, void *pw);
+
 #endif
@@ -47,6 +47,7 @@
 #include "framebuffer/gui.h"
 #include "framebuffer/fbtk.h"
 #include "framebuffer/framebuffer.h"
+#include "framebuffer/bands.h"
 #include "framebuffer/schedule.h"
 #include "framebuffer/findfile.h"
 #include "framebuffer/image_data.h"
@@ -220,6 +221,21 @@ widget_scroll_x(struct gui_window *gw, int x, bool abs)
 	fbtk_set_scroll_position(gw->hscroll, bwidget->scrollx + bwidget->panx);
 }
 
+static void
+fb_redraw(fbtk_widget_t *widget,
+	  struct browser_widget_s *bwidget,
+	  struct browser_window *bw);
+
+/**
+ * Scroll the browser widget by the pending pan.
+ *
+ * The part of the window which remains visible is moved with a single
+ *  copy and only the newly exposed strips are redrawn. Nothing rendered
+ *  by the core is positioned relative to the viewport (fixed position
+ *  boxes are laid out against the document) so the copied pixels stay
+ *  correct, and any area already waiting to be redrawn, such as an
+ *  animation frame, is moved along with them.
+ */
 static void
 fb_pan(fbtk_widget_t *widget,
        struct browser_widget_s *bwidget,
@@ -229,118 +245,90 @@ fb_pan(fbtk_widget_t *widget,
 	int y;
 	int width;
 	int height;
+	int panx = bwidget->panx;
+	int pany = bwidget->pany;
 	nsfb_bbox_t srcbox;
 	nsfb_bbox_t dstbox;
+	bbox_t dirty;
 
 	nsfb_t *nsfb = fbtk_get_nsfb(widget);
 
 	height = fbtk_get_height(widget);
 	width = fbtk_get_width(widget);
 
-	NSLOG(netsurf, DEEPDEBUG, "panning %d, %d",
-			bwidget->panx, bwidget->pany);
+	NSLOG(netsurf, DEEPDEBUG, "panning %d, %d", panx, pany);
 
 	x = fbtk_get_absx(widget);
 	y = fbtk_get_absy(widget);
 
-	/* if the pan exceeds the viewport size just redraw the whole area */
-	if (bwidget->pany >= height || bwidget->pany <= -height ||
-	    bwidget->panx >= width || bwidget->panx <= -width) {
+	bwidget->scrollx += panx;
+	bwidget->scrolly += pany;
 
-		bwidget->scrolly += bwidget->pany;
-		bwidget->scrollx += bwidget->panx;
-		fb_queue_redraw(widget, 0, 0, width, height);
+	/* ensure we don't try to scroll again */
+	bwidget->panx = 0;
+	bwidget->pany = 0;
+	bwidget->pan_required = false;
+
+	/* the pending redraw area moves with the content */
+	dirty = bwidget->redraw_box;
+	if (bwidget->redraw_required) {
+		dirty.x0 -= panx;
+		dirty.y0 -= pany;
+		dirty.x1 -= panx;
+		dirty.y1 -= pany;
+
+		bwidget->redraw_box.y0 = bwidget->redraw_box.x0 = INT_MAX;
+		bwidget->redraw_box.y1 = bwidget->redraw_box.x1 = -(INT_MAX);
+		bwidget->redraw_required = false;
+	}
 
-		/* ensure we don't try to scroll again */
-		bwidget->panx = 0;
-		bwidget->pany = 0;
-		bwidget->pan_required = false;
+	/* if the pan exceeds the viewport size, or the whole viewport must
+	 * be redrawn anyway, just redraw the whole area */
+	if (pany >= height || pany <= -height ||
+	    panx >= width || panx <= -width ||
+	    (dirty.x0 <= 0 && dirty.y0 <= 0 &&
+	     dirty.x1 >= width && dirty.y1 >= height)) {
+		fb_queue_redraw(widget, 0, 0, width, height);
 		return;
 	}
 
-	if (bwidget->pany < 0) {
-		/* pan up by less then viewport height */
-		srcbox.x0 = x;
-		srcbox.y0 = y;
-		srcbox.x1 = srcbox.x0 + width;
-		srcbox.y1 = srcbox.y0 + height + bwidget->pany;
-
-		dstbox.x0 = x;
-		dstbox.y0 = y - bwidget->pany;
-		dstbox.x1 = dstbox.x0 + width;
-		dstbox.y1 = dstbox.y0 + height + bwidget->pany;
-
-		/* move part that remains visible up */
-		nsfb_plot_copy(nsfb, &srcbox, nsfb, &dstbox);
-
-		/* redraw newly exposed area */
-		bwidget->scrolly += bwidget->pany;
-		fb_queue_redraw(widget, 0, 0, width, - bwidget->pany);
-
-	} else if (bwidget->pany > 0) {
-		/* pan down by less then viewport height */
-		srcbox.x0 = x;
-		srcbox.y0 = y + bwidget->pany;
-		srcbox.x1 = srcbox.x0 + width;
-		srcbox.y1 = srcbox.y0 + height - bwidget->pany;
-
-		dstbox.x0 = x;
-		dstbox.y0 = y;
-		dstbox.x1 = dstbox.x0 + width;
-		dstbox.y1 = dstbox.y0 + height - bwidget->pany;
-
-		/* move part that remains visible down */
-		nsfb_plot_copy(nsfb, &srcbox, nsfb, &dstbox);
-
-		/* redraw newly exposed area */
-		bwidget->scrolly += bwidget->pany;
-		fb_queue_redraw(widget, 0, height - bwidget->pany,
-				width, height);
+	/* move part that remains visible */
+	srcbox.x0 = x + max(panx, 0);
+	srcbox.y0 = y + max(pany, 0);
+	srcbox.x1 = x + width + min(panx, 0);
+	srcbox.y1 = y + height + min(pany, 0);
+
+	dstbox.x0 = srcbox.x0 - panx;
+	dstbox.y0 = srcbox.y0 - pany;
+	dstbox.x1 = srcbox.x1 - panx;
+	dstbox.y1 = srcbox.y1 - pany;
+
+	nsfb_plot_copy(nsfb, &srcbox, nsfb, &dstbox);
+
+	if (dirty.x0 < dirty.x1 && dirty.y0 < dirty.y1) {
+		fb_queue_redraw(widget, dirty.x0, dirty.y0, dirty.x1, dirty.y1);
 	}
 
-	if (bwidget->panx < 0) {
-		/* pan left by less then viewport width */
-		srcbox.x0 = x;
-		srcbox.y0 = y;
-		srcbox.x1 = srcbox.x0 + width + bwidget->panx;
-		srcbox.y1 = srcbox.y0 + height;
-
-		dstbox.x0 = x - bwidget->panx;
-		dstbox.y0 = y;
-		dstbox.x1 = dstbox.x0 + width + bwidget->panx;
-		dstbox.y1 = dstbox.y0 + height;
-
-		/* move part that remains visible left */
-		nsfb_plot_copy(nsfb, &srcbox, nsfb, &dstbox);
-
-		/* redraw newly exposed area */
-		bwidget->scrollx += bwidget->panx;
-		fb_queue_redraw(widget, 0, 0, -bwidget->panx, height);
-
-	} else if (bwidget->panx > 0) {
-		/* pan right by less then viewport width */
-		srcbox.x0 = x + bwidget->panx;
-		srcbox.y0 = y;
-		srcbox.x1 = srcbox.x0 + width - bwidget->panx;
-		srcbox.y1 = srcbox.y0 + height;
-
-		dstbox.x0 = x;
-		dstbox.y0 = y;
-		dstbox.x1 = dstbox.x0 + width - bwidget->panx;
-		dstbox.y1 = dstbox.y0 + height;
-
-		/* move part that remains visible right */
-		nsfb_plot_copy(nsfb, &srcbox, nsfb, &dstbox);
-
-		/* redraw newly exposed area */
-		bwidget->scrollx += bwidget->panx;
-		fb_queue_redraw(widget, width - bwidget->panx, 0,
-				width, height);
+	/* redraw newly exposed area */
+	if (pany < 0) {
+		fb_queue_redraw(widget, 0, 0, width, -pany);
+	} else if (pany > 0) {
+		fb_queue_redraw(widget, 0, height - pany, width, height);
 	}
 
-	bwidget->pan_required = false;
-	bwidget->panx = 0;
-	bwidget->pany = 0;
+	if (panx != 0) {
+		/* the strips exposed by a diagonal pan are bounded by the
+		 * whole viewport so redraw them separately */
+		if (bwidget->redraw_required) {
+			fb_redraw(widget, bwidget, bw);
+		}
+
+		if (panx < 0) {
+			fb_queue_redraw(widget, 0, 0, -panx, height);
+		} else {
+			fb_queue_redraw(widget, width - panx, 0, width, height);
+		}
+	}
 }
 
 static void
@@ -376,10 +364,18 @@ fb_redraw(fbtk_widget_t *widget,
 	clip.x1 = bwidget->redraw_box.x1;
 	clip.y1 = bwidget->redraw_box.y1;
 
-	browser_window_redraw(bw,
-			x - bwidget->scrollx,
-			y - bwidget->scrolly,
-			&clip, &ctx);
+	if (fb_bands_start(nsfb, &ctx, &clip)) {
+		browser_window_redraw(bw,
+				x - bwidget->scrollx,
+				y - bwidget->scrolly,
+				&clip, &ctx);
+		fb_bands_end(&ctx);
+	} else {
+		browser_window_redraw(bw,
+				x - bwidget->scrollx,
+				y - bwidget->scrolly,
+				&clip, &ctx);
+	}
 
 	if (fbtk_get_caret(widget, &caret_x, &caret_y, &caret_h)) {
 		/* This widget has caret, so render it */
@@ -644,6 +640,7 @@ static void gui_quit(void)
 
 	urldb_save_cookies(nsoption_charp(cookie_jar));
 
+	fb_bands_finalise();
 	framebuffer_finalise();
 }
 
@@ -30,6 +30,8 @@ NSOPTION_INTEGER(fb_refresh, 70)
 NSOPTION_STRING(fb_device, NULL)
 NSOPTION_STRING(fb_input_devpath, NULL)
 NSOPTION_STRING(fb_input_glob, NULL)
+/** number of threads rendering redraws, 0 for one per processor */
+NSOPTION_INTEGER(fb_render_threads, 0)
 
 /***** toolkit options *****/
 
@@ -0,0 +1,389 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Test knockout rendering.
+ *
+ * Fills are sent through the knockout plotters to a plotter which
+ * paints a small surface, counting how often each pixel is drawn. The
+ * result is compared with painting the same fills directly.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+#include "utils/errors.h"
+#include "netsurf/plotters.h"
+#include "desktop/gui_internal.h"
+#include "desktop/knockout.h"
+
+#define SURFACE_SIZE 256
+
+/* the knockout plotters only use the gui table for bitmaps */
+struct netsurf_table *guit = NULL;
+
+/** Colour of each pixel of the surface */
+static colour surface[SURFACE_SIZE][SURFACE_SIZE];
+
+/** Number of times each pixel of the surface was plotted */
+static unsigned int surface_plots[SURFACE_SIZE][SURFACE_SIZE];
+
+/** Colour of each pixel when the fills are painted directly */
+static colour reference[SURFACE_SIZE][SURFACE_SIZE];
+
+/** Clip rectangle of the surface plotter */
+static struct rect surface_clip;
+
+/** Number of rectangles the surface plotter was asked to draw */
+static unsigned int surface_rectangles;
+
+/** Error the surface plotter returns for every rectangle */
+static nserror surface_error;
+
+
+/**
+ * Paint a rectangle onto a surface, limited by a clip rectangle
+ */
+static void
+paint(colour pixels[SURFACE_SIZE][SURFACE_SIZE],
+      unsigned int counts[SURFACE_SIZE][SURFACE_SIZE],
+      const struct rect *clip,
+      const struct rect *r,
+      colour c)
+{
+	int x0 = (r->x0 > clip->x0) ? r->x0 : clip->x0;
+	int y0 = (r->y0 > clip->y0) ? r->y0 : clip->y0;
+	int x1 = (r->x1 < clip->x1) ? r->x1 : clip->x1;
+	int y1 = (r->y1 < clip->y1) ? r->y1 : clip->y1;
+	int x, y;
+
+	for (y = y0; y < y1; y++) {
+		for (x = x0; x < x1; x++) {
+			pixels[y][x] = c;
+			if (counts != NULL) {
+				counts[y][x]++;
+			}
+		}
+	}
+}
+
+
+static nserror
+surface_plot_clip(const struct redraw_context *ctx, const struct rect *clip)
+{
+	surface_clip = *clip;
+	return NSERROR_OK;
+}
+
+
+static nserror
+surface_plot_rectangle(const struct redraw_context *ctx,
+		       const plot_style_t *pstyle,
+		       const struct rect *r)
+{
+	surface_rectangles++;
+	if (surface_error != NSERROR_OK) {
+		return surface_error;
+	}
+	if (pstyle->fill_type != PLOT_OP_TYPE_NONE) {
+		paint(surface, surface_plots, &surface_clip, r,
+		      pstyle->fill_colour);
+	}
+	return NSERROR_OK;
+}
+
+
+static const struct plotter_table surface_plotters = {
+	.clip = surface_plot_clip,
+	.rectangle = surface_plot_rectangle,
+	.option_knockout = false,
+};
+
+
+/**
+ * A fill plotted by a test
+ */
+struct fill {
+	int x0, y0, x1, y1;
+	colour c;
+};
+
+
+/**
+ * Plot fills through the knockout plotters and directly
+ *
+ * \param fills The fills to plot, in painting order
+ * \param count The number of fills
+ */
+static void plot_fills(const struct fill *fills, unsigned int count)
+{
+	struct redraw_context ctx = {
+		.interactive = true,
+		.background_images = true,
+		.plot = &surface_plotters,
+	};
+	struct redraw_context knk_ctx;
+	struct rect clip = { 0, 0, SURFACE_SIZE, SURFACE_SIZE };
+	plot_style_t pstyle = {
+		.fill_type = PLOT_OP_TYPE_SOLID,
+	};
+	unsigned int i;
+
+	memset(surface, 0, sizeof(surface));
+	memset(surface_plots, 0, sizeof(surface_plots));
+	memset(reference, 0, sizeof(reference));
+	surface_rectangles = 0;
+	surface_error = NSERROR_OK;
+
+	ck_assert(knockout_plot_start(&ctx, &knk_ctx));
+	ck_assert(knk_ctx.plot->clip(&knk_ctx, &clip) == NSERROR_OK);
+
+	for (i = 0; i < count; i++) {
+		struct rect r = {
+			fills[i].x0, fills[i].y0, fills[i].x1, fills[i].y1
+		};
+
+		pstyle.fill_colour = fills[i].c;
+		ck_assert(knk_ctx.plot->rectangle(&knk_ctx, &pstyle, &r) ==
+			  NSERROR_OK);
+		paint(reference, NULL, &clip, &r, fills[i].c);
+	}
+
+	knockout_plot_end(&ctx);
+}
+
+
+/**
+ * Check the knocked out plot matches painting directly
+ *
+ * \param overdraw true if pixels may be plotted more than once
+ */
+static void check_surface(bool overdraw)
+{
+	int x, y;
+
+	for (y = 0; y < SURFACE_SIZE; y++) {
+		for (x = 0; x < SURFACE_SIZE; x++) {
+			ck_assert_uint_eq(surface[y][x], reference[y][x]);
+			if (reference[y][x] == 0) {
+				ck_assert_uint_eq(surface_plots[y][x], 0);
+			} else if (!overdraw) {
+				ck_assert_uint_eq(surface_plots[y][x], 1);
+			}
+		}
+	}
+}
+
+
+/* Tests */
+
+/**
+ * Nested overlapping fills, like the backgrounds of a page, a container
+ * and overlapping children. Every pixel is plotted once.
+ */
+START_TEST(knockout_nested_fill_test)
+{
+	static const struct fill fills[] = {
+		{ 0, 0, 256, 256, 0x111111 },
+		{ 16, 16, 240, 240, 0x222222 },
+		{ 32, 32, 128, 128, 0x333333 },
+		{ 96, 96, 224, 224, 0x444444 },
+		{ 100, 40, 120, 200, 0x555555 },
+		{ 64, 64, 160, 160, 0x666666 },
+	};
+
+	plot_fills(fills, sizeof(fills) / sizeof(fills[0]));
+	check_surface(false);
+}
+END_TEST
+
+
+/**
+ * A fill which covers every piece of an earlier split fill leaves
+ * nothing of it to plot, so its bounds shrink to nothing.
+ */
+START_TEST(knockout_split_bound_test)
+{
+	static const struct fill fills[] = {
+		{ 0, 0, 200, 200, 0x111111 },
+		{ 50, 50, 150, 150, 0x222222 },
+		{ 0, 0, 100, 200, 0x333333 },
+		{ 100, 0, 200, 200, 0x444444 },
+		{ 20, 20, 40, 40, 0x555555 },
+	};
+
+	plot_fills(fills, sizeof(fills) / sizeof(fills[0]));
+	check_surface(false);
+}
+END_TEST
+
+
+/**
+ * Fills of several sizes, so they are held in grids of different cell
+ * sizes, including ones which straddle cell edges, knocked out by later
+ * fills which start in other cells.
+ */
+START_TEST(knockout_grid_lookup_test)
+{
+	struct fill fills[512];
+	unsigned int count = 0;
+	int x, y;
+
+	/* small fills across the whole surface */
+	for (y = 0; y < SURFACE_SIZE; y += 16) {
+		for (x = 0; x < SURFACE_SIZE; x += 16) {
+			fills[count].x0 = x + 4;
+			fills[count].y0 = y + 4;
+			fills[count].x1 = x + 20;
+			fills[count].y1 = y + 20;
+			fills[count].c = 0x010000 * (count + 1);
+			count++;
+		}
+	}
+
+	/* larger fills over parts of them */
+	fills[count++] = (struct fill) { 30, 30, 130, 60, 0x0000f0 };
+	fills[count++] = (struct fill) { 63, 0, 65, 256, 0x0000f1 };
+	fills[count++] = (struct fill) { 150, 90, 250, 250, 0x0000f2 };
+
+	/* a fill over everything */
+	fills[count++] = (struct fill) { 2, 2, 254, 254, 0x0000f3 };
+
+	plot_fills(fills, count);
+	check_surface(false);
+
+	/* only the fill over everything and the edges it leaves of the
+	 * small fills around the surface border are plotted */
+	ck_assert_uint_lt(surface_rectangles, 4 * SURFACE_SIZE / 16 + 8);
+}
+END_TEST
+
+
+/**
+ * Random fills, compared with painting them directly. Heavily split
+ * fills stop being knocked out, so pixels may be plotted more than once.
+ */
+START_TEST(knockout_random_fill_test)
+{
+	struct fill fills[400];
+	unsigned int i;
+
+	srand(_i + 1);
+
+	for (i = 0; i < sizeof(fills) / sizeof(fills[0]); i++) {
+		int w = 1 + rand() % ((i % 4 == 0) ? 256 : 32);
+		int h = 1 + rand() % ((i % 4 == 0) ? 256 : 32);
+
+		fills[i].x0 = rand() % (SURFACE_SIZE + 16) - 16;
+		fills[i].y0 = rand() % (SURFACE_SIZE + 16) - 16;
+		fills[i].x1 = fills[i].x0 + w;
+		fills[i].y1 = fills[i].y0 + h;
+		fills[i].c = i + 1;
+	}
+
+	plot_fills(fills, sizeof(fills) / sizeof(fills[0]));
+	check_surface(true);
+}
+END_TEST
+
+
+/**
+ * An error from the plotter when the buffers are flushed is returned
+ */
+START_TEST(knockout_flush_error_test)
+{
+	struct redraw_context ctx = {
+		.interactive = true,
+		.background_images = true,
+		.plot = &surface_plotters,
+	};
+	struct redraw_context knk_ctx;
+	struct rect clip = { 0, 0, SURFACE_SIZE, SURFACE_SIZE };
+	plot_style_t pstyle = {
+		.fill_type = PLOT_OP_TYPE_SOLID,
+	};
+	nserror res = NSERROR_OK;
+	unsigned int i;
+
+	surface_rectangles = 0;
+	surface_error = NSERROR_INVALID;
+
+	ck_assert(knockout_plot_start(&ctx, &knk_ctx));
+	ck_assert(knk_ctx.plot->clip(&knk_ctx, &clip) == NSERROR_OK);
+
+	/* enough fills to need the buffers flushing */
+	for (i = 0; (i < 1000000) && (res == NSERROR_OK); i++) {
+		struct rect r = {
+			i % SURFACE_SIZE, 0, i % SURFACE_SIZE + 1, 1
+		};
+		res = knk_ctx.plot->rectangle(&knk_ctx, &pstyle, &r);
+	}
+	ck_assert(res == NSERROR_INVALID);
+	ck_assert_uint_gt(surface_rectangles, 0);
+
+	knockout_plot_end(&ctx);
+	surface_error = NSERROR_OK;
+}
+END_TEST
+
+
+static TCase *knockout_fill_case_create(void)
+{
+	TCase *tc;
+
+	tc = tcase_create("Fill");
+
+	tcase_add_test(tc, knockout_nested_fill_test);
+	tcase_add_test(tc, knockout_split_bound_test);
+	tcase_add_test(tc, knockout_grid_lookup_test);
+	tcase_add_loop_test(tc, knockout_random_fill_test, 0, 8);
+	tcase_add_test(tc, knockout_flush_error_test);
+
+	return tc;
+}
+
+
+static Suite *knockout_suite(void)
+{
+	Suite *s;
+	s = suite_create("Knockout");
+
+	suite_add_tcase(s, knockout_fill_case_create());
+
+	return s;
+}
+
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(knockout_suite());
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
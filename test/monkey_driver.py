@@ -454,13 +454,22 @@ def run_test_step_action_plot_check(ctx, step):
         checks = {}
 
     all_text_list = []
+    texts = []
     bitmaps = []
     for plot in win.redraw(coords=area):
         if plot[0] == 'TEXT':
             all_text_list.extend(plot[6:])
+            texts.append((int(plot[2]), int(plot[4]), " ".join(plot[6:])))
         if plot[0] == 'BITMAP':
             bitmaps.append(plot[1:])
     all_text = " ".join(all_text_list)
+
+    def text_plot(text):
+        for plot in texts:
+            if plot[2] == text:
+                return plot
+        raise AssertionError("Text not plotted: {}".format(repr(text)))
+
     for check in checks:
         if 'text-contains' in check.keys():
             print("        Check {} in {}".format(repr(check['text-contains']), repr(all_text)))
@@ -468,6 +477,22 @@ def run_test_step_action_plot_check(ctx, step):
         elif 'text-not-contains' in check.keys():
             print("        Check {} NOT in {}".format(repr(check['text-not-contains']), repr(all_text)))
             assert check['text-not-contains'] not in all_text
+        elif 'text-plotted' in check.keys():
+            print("        Check {} plotted on its own".format(repr(check['text-plotted'])))
+            text_plot(check['text-plotted'])
+        elif 'text-position' in check.keys():
+            print("        Check text position {}".format(check['text-position']))
+            relation = check['text-position'].split()
+            assert len(relation) == 3
+            text1 = text_plot(relation[0])
+            text2 = text_plot(relation[2])
+            assert relation[1] in ('below', 'right-of', 'aligned-with')
+            if relation[1] == 'below':
+                assert text1[1] > text2[1]
+            elif relation[1] == 'right-of':
+                assert text1[0] > text2[0]
+            elif relation[1] == 'aligned-with':
+                assert text1[0] == text2[0]
         elif 'bitmap-count' in check.keys():
             print("        Check bitmap count is {}".format(int(check['bitmap-count'])))
             assert len(bitmaps) == int(check['bitmap-count'])